@@ -44,6 +44,7 @@ public class LPrefab : ModuleRules
             {
                 "UnrealEd",
                 "EditorStyle",
+                "DerivedDataCache",
                 "TargetPlatform",
                 "Slate",
                 "SlateCore",
@@ -5,6 +5,41 @@
 #include "PrefabSystem/LPrefab.h"
 #include "LPrefabModule.h"
 #include LPREFAB_SERIALIZER_NEWEST_INCLUDE
+#include "Engine/Engine.h"
+#include "Engine/LatentActionManager.h"
+#include "LatentActions.h"
+
+class FLPrefabLoadPrefabAsyncAction : public FPendingLatentAction
+{
+public:
+	struct FResult
+	{
+		bool bIsDone = false;
+		TWeakObjectPtr<AActor> LoadedRootActor;
+	};
+	TSharedRef<FResult, ESPMode::ThreadSafe> Result = MakeShared<FResult, ESPMode::ThreadSafe>();
+	AActor*& LoadedRootActor;
+	FName ExecutionFunction;
+	int32 OutputLink;
+	FWeakObjectPtr CallbackTarget;
+
+	FLPrefabLoadPrefabAsyncAction(const FLatentActionInfo& InLatentInfo, AActor*& OutLoadedRootActor)
+		: LoadedRootActor(OutLoadedRootActor)
+		, ExecutionFunction(InLatentInfo.ExecutionFunction)
+		, OutputLink(InLatentInfo.Linkage)
+		, CallbackTarget(InLatentInfo.CallbackTarget)
+	{
+	}
+
+	virtual void UpdateOperation(FLatentResponse& Response)override
+	{
+		if (Result->bIsDone)
+		{
+			LoadedRootActor = Result->LoadedRootActor.Get();
+		}
+		Response.FinishAndTriggerIf(Result->bIsDone, ExecutionFunction, OutputLink, CallbackTarget);
+	}
+};
 
 void ULPrefabBPLibrary::DestroyActorWithHierarchy(AActor* Target, bool WithHierarchy)
 {
@@ -47,6 +82,31 @@ AActor* ULPrefabBPLibrary::LoadPrefabWithReplacement(UObject* WorldContextObject
 	return InPrefab->LoadPrefabWithReplacement(WorldContextObject, InParent, InReplaceAssetMap, InReplaceClassMap, InCallbackBeforeAwake);
 }
 
+void ULPrefabBPLibrary::LoadPrefabAsync(UObject* WorldContextObject, ULPrefab* InPrefab, USceneComponent* InParent, float FrameBudgetMs, AActor*& LoadedRootActor, FLatentActionInfo LatentInfo)
+{
+	LoadedRootActor = nullptr;
+	auto World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	if (World == nullptr)return;
+	auto& LatentActionManager = World->GetLatentActionManager();
+	if (LatentActionManager.FindExistingAction<FLPrefabLoadPrefabAsyncAction>(LatentInfo.CallbackTarget, LatentInfo.UUID) != nullptr)
+	{
+		UE_LOG(LPrefab, Warning, TEXT("[%s].%d This LoadPrefabAsync node is already running"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+		return;
+	}
+	auto Action = new FLPrefabLoadPrefabAsyncAction(LatentInfo, LoadedRootActor);
+	LatentActionManager.AddNewAction(LatentInfo.CallbackTarget, LatentInfo.UUID, Action);
+	if (!IsValid(InPrefab))
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d InPrefab not valid"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+		Action->Result->bIsDone = true;
+		return;
+	}
+	//action could be removed before load complete, so only keep the result
+	InPrefab->LoadPrefabAsync(World, InParent, FrameBudgetMs, [Result = Action->Result](AActor* InLoadedRootActor) {
+		Result->bIsDone = true;
+		Result->LoadedRootActor = InLoadedRootActor;
+		});
+}
 AActor* ULPrefabBPLibrary::DuplicateActor(AActor* Target, USceneComponent* Parent)
 {
 	return LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::DuplicateActor(Target, Parent);
@@ -66,6 +126,15 @@ AActor* ULPrefabBPLibrary::DuplicateActorWithPreparedData(FLPrefabDuplicateDataC
 		return nullptr;
 	}
 }
+TArray<AActor*> ULPrefabBPLibrary::DuplicateActorWithPreparedDataBatch(FLPrefabDuplicateDataContainer& Data, int32 Count, const TArray<USceneComponent*>& Parents, const TArray<FTransform>& Transforms)
+{
+	TArray<AActor*> Result;
+	if (Data.bIsValid)
+	{
+		LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::DuplicateActorWithPreparedDataBatch(Data.DuplicateData, Count, Parents, Transforms, Result);
+	}
+	return Result;
+}
 
 UActorComponent* ULPrefabBPLibrary::GetComponentInParent(AActor* InActor, TSubclassOf<UActorComponent> ComponentClass, bool IncludeSelf, AActor* InStopNode)
 {
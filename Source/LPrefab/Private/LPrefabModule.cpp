@@ -5,19 +5,59 @@
 #include "Interfaces/IPluginManager.h"
 #include "Misc/Paths.h"
 #include "ShaderCore.h"
+#include "PrefabSystem/LPrefab.h"
+#include "UObject/UObjectGlobals.h"
+#include LPREFAB_SERIALIZER_NEWEST_INCLUDE
+#include "PrefabSystem/LPrefabObjectReaderAndWriter.h"
 
 #define LOCTEXT_NAMESPACE "FLPrefabModule"
 DEFINE_LOG_CATEGORY(LPrefab);
 
+DEFINE_STAT(STAT_LPrefab_ParseSaveData);
+DEFINE_STAT(STAT_LPrefab_Deserialize);
+DEFINE_STAT(STAT_LPrefab_GenerateActors);
+DEFINE_STAT(STAT_LPrefab_GenerateObjects);
+DEFINE_STAT(STAT_LPrefab_ApplyProperties);
+DEFINE_STAT(STAT_LPrefab_ApplyOverrideParameters);
+DEFINE_STAT(STAT_LPrefab_AttachComponents);
+DEFINE_STAT(STAT_LPrefab_PostSetProperties);
+DEFINE_STAT(STAT_LPrefab_RegisterComponents);
+DEFINE_STAT(STAT_LPrefab_FinishDeserialize);
+DEFINE_STAT(STAT_LPrefab_Awake);
+DEFINE_STAT(STAT_LPrefab_LoadPrefabBatch);
+DEFINE_STAT(STAT_LPrefab_Serialize);
+DEFINE_STAT(STAT_LPrefab_DuplicateActor);
+DEFINE_STAT(STAT_LPrefab_RefreshOnSubPrefabDirty);
+DEFINE_STAT(STAT_LPrefab_GetAllPrefabArray);
+DEFINE_STAT(STAT_LPrefab_TranscodeBuildData);
+DEFINE_STAT(STAT_LPrefab_ParsedSaveDataCacheHit);
+DEFINE_STAT(STAT_LPrefab_ParsedSaveDataCacheMiss);
+DEFINE_STAT(STAT_LPrefab_BuildDataDDCHit);
+DEFINE_STAT(STAT_LPrefab_BuildDataDDCMiss);
+DEFINE_STAT(STAT_LPrefab_ParsedSaveDataMemory);
+
 void FLPrefabModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
+	ReleaseIdleParsedSaveDataTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateStatic(&ULPrefab::ReleaseIdleParsedSaveData), 1.0f);
+	//class's interface and property may change after hot reload
+	ReloadCompleteDelegateHandle = FCoreUObjectDelegates::ReloadCompleteDelegate.AddLambda([](EReloadCompleteReason) {
+		LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::ClearPrefabInterfaceCache();
+		LPrefabSystem::FLPrefabSkipPropertyCache::Clear();
+		LPrefabSystem::FLPrefabMemberPropertyCache::Clear();
+		LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabIncrementalSaveCache::InvalidateAll();
+#if WITH_EDITOR
+		LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::ClearTranscodeClassCache();
+#endif
+		});
 }
 
 void FLPrefabModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	FTSTicker::GetCoreTicker().RemoveTicker(ReleaseIdleParsedSaveDataTickerHandle);
+	FCoreUObjectDelegates::ReloadCompleteDelegate.Remove(ReloadCompleteDelegateHandle);
 }
 
 #undef LOCTEXT_NAMESPACE
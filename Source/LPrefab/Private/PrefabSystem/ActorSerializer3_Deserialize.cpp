@@ -35,7 +35,7 @@ namespace LPrefabSystem3
 #endif
 		serializer.bOverrideVersions = true;
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
@@ -59,7 +59,7 @@ namespace LPrefabSystem3
 #endif
 		serializer.bOverrideVersions = true;
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
@@ -88,7 +88,7 @@ namespace LPrefabSystem3
 #endif
 		serializer.bOverrideVersions = true;
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
@@ -116,7 +116,7 @@ namespace LPrefabSystem3
 		serializer.DeserializationSessionId = InParentDeserializationSessionId;
 		serializer.bIsSubPrefab = true;
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
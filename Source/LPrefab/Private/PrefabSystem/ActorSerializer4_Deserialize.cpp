@@ -36,7 +36,7 @@ namespace LPrefabSystem4
 #endif
 		serializer.bOverrideVersions = true;
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
@@ -60,7 +60,7 @@ namespace LPrefabSystem4
 #endif
 		serializer.bOverrideVersions = true;
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
@@ -89,7 +89,7 @@ namespace LPrefabSystem4
 #endif
 		serializer.bOverrideVersions = true;
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
@@ -118,7 +118,7 @@ namespace LPrefabSystem4
 		serializer.bIsSubPrefab = true;
 		serializer.ActorIndexInPrefab = InOutActorIndex;
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
@@ -42,7 +42,7 @@ namespace LPrefabSystem5
 #endif
 		serializer.bOverrideVersions = true;
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
@@ -66,7 +66,7 @@ namespace LPrefabSystem5
 #endif
 		serializer.bOverrideVersions = true;
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
@@ -95,7 +95,7 @@ namespace LPrefabSystem5
 #endif
 		serializer.bOverrideVersions = true;
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
@@ -115,7 +115,7 @@ namespace LPrefabSystem5
 #endif
 		serializer.bOverrideVersions = true;
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
@@ -165,7 +165,7 @@ namespace LPrefabSystem5
 		serializer.bIsSubPrefab = true;
 		serializer.ActorIndexInPrefab = InOutActorIndex;
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
@@ -694,6 +694,7 @@ namespace LPrefabSystem5
 							}
 						}
 						break;
+						case ELPrefabVersion::DeferredSubPrefab:
 						case ELPrefabVersion::NewObjectOnNestedPrefab:
 						{
 							auto NewOnSubPrefabFinishDeserializeFunction =
@@ -46,7 +46,7 @@ namespace LPrefabSystem5
 		serializer.SubPrefabMap = InSubPrefabMap;
 		serializer.bIsEditorOrRuntime = InForEditorOrRuntimeUse;
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabObjectWriter Writer(InOutBuffer, serializer, ExcludeProperties);
 			Writer.DoSerialize(InObject);
 		};
@@ -86,7 +86,7 @@ namespace LPrefabSystem5
 		}
 		else
 		{
-			if (!WillSerializeActorArray.Contains(Actor))return;
+			if (!IsWillSerializeActor(Actor))return;
 			auto ActorGuid = MapObjectToGuid[Actor];
 
 			OutActorSaveData.ObjectClass = FindOrAddClassFromList(Actor->GetClass());
@@ -250,7 +250,7 @@ namespace LPrefabSystem5
 		//collect actor
 		if (!SubPrefabMap.Contains(Actor))//sub prefab's actor should not put to the list
 		{
-			WillSerializeActorArray.Add(Actor);
+			AddWillSerializeActor(Actor);
 		}
 		if (!MapObjectToGuid.Contains(Actor))
 		{
@@ -283,7 +283,7 @@ namespace LPrefabSystem5
 				{
 					if (auto ParentComp = SceneComp->GetAttachParent())
 					{
-						if (WillSerializeActorArray.Contains(ParentComp->GetOwner()))//check if parent component belongs to this prefab
+						if (IsWillSerializeActor(ParentComp->GetOwner()))//check if parent component belongs to this prefab
 						{
 							ComponentSaveDataItem.SceneComponentParentGuid = MapObjectToGuid[ParentComp];//@todo: better way to store SceneComponent's parent?
 						}
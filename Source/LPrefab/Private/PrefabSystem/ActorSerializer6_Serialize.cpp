@@ -62,7 +62,7 @@ namespace LPrefabSystem6
 		serializer.SubPrefabMap = InSubPrefabMap;
 		serializer.bIsEditorOrRuntime = InForEditorOrRuntimeUse;
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabObjectWriter Writer(InOutBuffer, serializer, ExcludeProperties);
 			Writer.DoSerialize(InObject);
 		};
@@ -100,7 +100,7 @@ namespace LPrefabSystem6
 		}
 		else
 		{
-			if (!WillSerializeActorArray.Contains(Actor))return;
+			if (!IsWillSerializeActor(Actor))return;
 			auto ActorGuid = MapObjectToGuid[Actor];
 
 			OutActorSaveData.ObjectClass = FindOrAddClassFromList(Actor->GetClass());
@@ -259,7 +259,7 @@ namespace LPrefabSystem6
 		//collect actor
 		if (!SubPrefabMap.Contains(Actor))//sub prefab's actor should not put to the list
 		{
-			WillSerializeActorArray.Add(Actor);
+			AddWillSerializeActor(Actor);
 		}
 		if (!MapObjectToGuid.Contains(Actor))
 		{
@@ -290,7 +290,7 @@ namespace LPrefabSystem6
 			{
 				if (auto ParentComp = SceneComp->GetAttachParent())
 				{
-					if (WillSerializeActorArray.Contains(ParentComp->GetOwner()))//check if parent component belongs to this prefab
+					if (IsWillSerializeActor(ParentComp->GetOwner()))//check if parent component belongs to this prefab
 					{
 						MapSceneComponentToParent.Add(MapObjectToGuid[Object], MapObjectToGuid[ParentComp]);
 					}
@@ -72,7 +72,7 @@ namespace LPrefabSystem7
 		}
 		serializer.bIsEditorOrRuntime = InForEditorOrRuntimeUse;
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabObjectWriter Writer(InOutBuffer, serializer, ExcludeProperties);
 			Writer.DoSerialize(InObject);
 		};
@@ -265,7 +265,7 @@ namespace LPrefabSystem7
 		bool bIsSubprefabActor = SubPrefabActorArray.Contains(Actor);
 		if (!bIsSubprefabActor)//sub prefab's actor should not put to the list
 		{
-			WillSerializeActorArray.Add(Actor);//sub-prefab just keep a reference, no need to serialize
+			AddWillSerializeActor(Actor);//sub-prefab just keep a reference, no need to serialize
 			TrySerializeActorArray.Add(Actor);
 		}
 		else
@@ -0,0 +1,259 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "PrefabSystem/ActorSerializer8.h"
+#include "PrefabSystem/LPrefabDeferredSubPrefabComponent.h"
+#include "PrefabSystem/LPrefabObjectReaderAndWriter.h"
+#include "PrefabSystem/LPrefabManager.h"
+#include "PrefabSystem/LPrefabSettings.h"
+#include "GameFramework/Actor.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "LPrefabModule.h"
+
+#if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
+PRAGMA_DISABLE_OPTIMIZATION
+#endif
+
+static TAutoConsoleVariable<int32> CVarLPrefabDeferSubPrefab(
+	TEXT("LPrefab.DeferSubPrefab"),
+	1,
+	TEXT("1- Sub prefab marked as deferred load is replaced by a placeholder component when load prefab in game world, and loaded when call Realize on it. 0- Always load sub prefab together with parent prefab."),
+	ECVF_Default);
+
+namespace LPrefabSystem8
+{
+	bool ActorSerializer::CanDeferSubPrefab(UWorld* InWorld)
+	{
+		return InWorld->IsGameWorld() && CVarLPrefabDeferSubPrefab.GetValueOnGameThread() != 0;
+	}
+
+	void ActorSerializer::GenerateDeferredSubPrefab(const FLGUIActorSaveData& InActorData, int32 InActorIndex)
+	{
+		auto SubPrefabAsset = Cast<ULPrefab>(FindAssetFromListByIndex(InActorData.PrefabAssetIndex));
+		if (SubPrefabAsset == nullptr)return;
+		//root actor is always generated first, placeholder is owned by it
+		auto OwnerActor = DeserializeState.CreatedRootActor;
+		if (OwnerActor == nullptr || DeserializeState.Prefab == nullptr || !DeserializeState.SharedSaveData.IsValid())return;
+
+		if (!DeferredSubPrefabScope.IsValid())
+		{
+			DeferredSubPrefabScope = MakeShared<FDeferredSubPrefabScope>();
+			DeferredSubPrefabScope->Prefab = DeserializeState.Prefab;
+			DeferredSubPrefabScope->bIsEditorOrRuntime = bIsEditorOrRuntime;
+			DeferredSubPrefabScope->SaveData = DeserializeState.SharedSaveData;
+		}
+		auto Placeholder = NewObject<ULPrefabDeferredSubPrefabComponent>(OwnerActor, NAME_None, RF_Transient);
+		Placeholder->SubPrefabAsset = SubPrefabAsset;
+		Placeholder->SubPrefabAssetIndex = InActorData.PrefabAssetIndex;
+		Placeholder->OverrideParameterCount = InActorData.MapObjectGuidToSubPrefabOverrideParameter.Num();
+		Placeholder->ActorIndex = InActorIndex;
+		Placeholder->Scope = DeferredSubPrefabScope;
+		OwnerActor->AddInstanceComponent(Placeholder);
+		Placeholder->RegisterComponent();
+		//attach in AttachComponents step, same as sub prefab's root component
+		if (InActorData.RootComponentParentGuid.IsValid())
+		{
+			FComponentDataStruct CompData;
+			CompData.Component = Placeholder;
+			CompData.SceneComponentParentGuid = InActorData.RootComponentParentGuid;
+			SubPrefabRootComponents.Add(CompData);
+		}
+		DeferredSubPrefabCount++;
+	}
+
+	bool ActorSerializer::RealizeDeferredSubPrefab(ULPrefabDeferredSubPrefabComponent* InPlaceholder, AActor*& OutRootActor)
+	{
+		OutRootActor = nullptr;
+		auto Scope = InPlaceholder->Scope;
+		if (!Scope.IsValid())
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Placeholder is not created by prefab system!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return true;
+		}
+		if (!Scope->bLoadFinished)return false;
+		auto Prefab = Scope->Prefab.Get();
+		auto World = InPlaceholder->GetWorld();
+		if (!IsValid(Prefab) || !IsValid(World))
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Parent prefab or world is not valid anymore!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return true;
+		}
+		auto& SaveData = *Scope->SaveData;
+		if (!SaveData.SavedActors.IsValidIndex(InPlaceholder->ActorIndex))return true;
+		auto& ActorData = SaveData.SavedActors[InPlaceholder->ActorIndex];
+		auto StartTime = FDateTime::Now();
+
+		ActorSerializer serializer;
+		serializer.TargetWorld = World;
+		serializer.bIsEditorOrRuntime = Scope->bIsEditorOrRuntime;
+		serializer.bOverrideVersions = true;
+		serializer.LPrefabManager = ULPrefabWorldSubsystem::GetInstance(World);
+		serializer.SetupForPrefab(Prefab);
+		serializer.bDeltaAgainstArchetype = SaveData.bDeltaAgainstArchetype;
+		serializer.bTargetedOverrideParameter = SaveData.bTargetedOverrideParameter;
+		serializer.bTaggedPropertyData = SaveData.bTaggedPropertyData;
+		serializer.SetupReaderFunctions();
+		serializer.MapGuidToObject.Reserve(Scope->MapGuidToObject.Num());
+		for (auto& KeyValue : Scope->MapGuidToObject)
+		{
+			if (auto Object = KeyValue.Value.Get())
+			{
+				serializer.MapGuidToObject.Add(KeyValue.Key, Object);
+			}
+		}
+		serializer.DeserializationSessionId = FGuid::NewGuid();
+		serializer.LPrefabManager->BeginPrefabSystemProcessingActor(serializer.DeserializationSessionId);
+
+		serializer.bRegisterComponentsOnce = CanRegisterComponentsOnce(World);
+		//same as sub prefab in GenerateActors step
+		serializer.BeginGenerateSubPrefab(ActorData, InPlaceholder->ActorIndex);
+		if (serializer.DeserializeState.SubPrefabContext.IsValid())
+		{
+			auto SubSerializer = serializer.DeserializeState.SubPrefabContext->Serializer;
+			SubSerializer->StepDeserialize(MAX_dbl);
+			OutRootActor = SubSerializer->DeserializeState.CreatedRootActor;
+			serializer.FinishGenerateSubPrefab(ActorData);
+		}
+		if (OutRootActor != nullptr)
+		{
+			for (auto& Item : serializer.SubPrefabOverrideParameters)
+			{
+				serializer.ApplyOverrideParameterData(Item.Object, Item.ParameterDatas, Item.ParameterNames);
+			}
+			if (auto RootComp = OutRootActor->GetRootComponent())
+			{
+				if (auto ParentComp = InPlaceholder->GetAttachParent())
+				{
+					if (RootComp->IsRegistered())
+					{
+						RootComp->AttachToComponent(ParentComp, FAttachmentTransformRules::KeepRelativeTransform);
+					}
+					else
+					{
+						RootComp->SetupAttachment(ParentComp);
+					}
+				}
+			}
+
+			//parent prefab's object may reference this sub prefab, read these properties again
+			serializer.BuildObjectIndexTable(SaveData);
+			for (int i = Scope->UnresolvedObjectDatas.Num() - 1; i >= 0; i--)
+			{
+				auto& Item = Scope->UnresolvedObjectDatas[i];
+				auto Object = Item.Object.Get();
+				if (!IsValid(Object))
+				{
+					Scope->UnresolvedObjectDatas.RemoveAtSwap(i);
+					continue;
+				}
+				//only read the unresolved properties, other properties keep their current value
+				if (!serializer.CanReadPropertiesByName() && !(Item.bIsOverrideParameter && serializer.bTargetedOverrideParameter))
+				{
+					UE_LOG(LPrefab, Warning, TEXT("[%s].%d Property data of prefab '%s' can't be read by property name, reference to deferred sub prefab is not resolved. Please cook it again."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *Prefab->GetPathName());
+					Scope->UnresolvedObjectDatas.RemoveAtSwap(i);
+					continue;
+				}
+				TArray<FName> StillUnresolvedProperties;
+				serializer.OnlyReadPropertyNames = &Item.PropertyNames;
+				serializer.UnresolvedObjectReferenceProperties = &StillUnresolvedProperties;
+				if (Item.bIsOverrideParameter)
+				{
+					serializer.ApplyOverrideParameterData(Object, Item.OverrideData, Item.OverrideNames);
+				}
+				else
+				{
+					serializer.ApplyObjectData(Object, const_cast<TArray<uint8>&>(*Item.Data), Cast<USceneComponent>(Object) != nullptr);
+				}
+				serializer.UnresolvedObjectReferenceProperties = nullptr;
+				serializer.OnlyReadPropertyNames = nullptr;
+				if (StillUnresolvedProperties.Num() == 0)//all reference is resolved, no need to read it again
+				{
+					Scope->UnresolvedObjectDatas.RemoveAtSwap(i);
+				}
+				else
+				{
+					Item.PropertyNames = MoveTemp(StillUnresolvedProperties);
+				}
+			}
+
+			if (serializer.bRegisterComponentsOnce)
+			{
+				serializer.PrepareRegisterComponents();
+				for (auto Comp : serializer.ComponentsToRegister)
+				{
+					if (IsValid(Comp) && !Comp->IsRegistered())
+					{
+						Comp->RegisterComponent();
+					}
+				}
+				serializer.ComponentsToRegister.Empty();
+			}
+			else
+			{
+				for (auto& Comp : serializer.AllComponents)
+				{
+					PostSetPropertiesOnActor(Comp);
+				}
+			}
+			if (auto RootComp = OutRootActor->GetRootComponent())
+			{
+				RootComp->UpdateComponentToWorld();
+			}
+			//other deferred sub prefab may reference objects of this one
+			for (auto& KeyValue : serializer.MapGuidToObject)
+			{
+				Scope->MapGuidToObject.Add(KeyValue.Key, KeyValue.Value.Get());
+			}
+			//parent prefab's component that attach to this sub prefab's component
+			for (int i = Scope->PendingAttachments.Num() - 1; i >= 0; i--)
+			{
+				auto& Item = Scope->PendingAttachments[i];
+				auto SceneComp = Item.Component.Get();
+				if (!IsValid(SceneComp))
+				{
+					Scope->PendingAttachments.RemoveAtSwap(i);
+					continue;
+				}
+				auto ParentObjectPtr = serializer.MapGuidToObject.Find(Item.ParentGuid);
+				if (ParentObjectPtr == nullptr)continue;
+				if (auto ParentComp = Cast<USceneComponent>(*ParentObjectPtr))
+				{
+					if (SceneComp->IsRegistered())
+					{
+						SceneComp->AttachToComponent(ParentComp, FAttachmentTransformRules::KeepRelativeTransform);
+					}
+					else
+					{
+						SceneComp->SetupAttachment(ParentComp);
+					}
+				}
+				Scope->PendingAttachments.RemoveAtSwap(i);
+			}
+		}
+
+		for (auto Actor : serializer.AllActors)
+		{
+			serializer.LPrefabManager->RemoveActorForPrefabSystem(Actor, serializer.DeserializationSessionId);
+		}
+		serializer.LPrefabManager->EndPrefabSystemProcessingActor(serializer.DeserializationSessionId);
+		if (OutRootActor != nullptr)
+		{
+			DispatchAwake(World, serializer.AllActors);
+		}
+
+		if (ULPrefabSettings::GetLogPrefabLoadTime())
+		{
+			auto TimeSpan = FDateTime::Now() - StartTime;
+			UE_LOG(LPrefab, Log, TEXT("Realize deferred sub prefab: '%s' in prefab: '%s', total time: %fms"), *GetNameSafe(InPlaceholder->SubPrefabAsset), *Prefab->GetName(), TimeSpan.GetTotalMilliseconds());
+		}
+		if (OutRootActor != nullptr)
+		{
+			InPlaceholder->DestroyComponent();//sub prefab is attached to placeholder's parent, placeholder is not needed anymore
+		}
+		return true;
+	}
+}
+
+#if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
+PRAGMA_ENABLE_OPTIMIZATION
+#endif
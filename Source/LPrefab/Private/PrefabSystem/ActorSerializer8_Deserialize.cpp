@@ -1,4 +1,4 @@
-// Copyright 2019-Present LexLiu. All Rights Reserved.
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
 
 #include "PrefabSystem/ActorSerializer8.h"
 #include "PrefabSystem/LPrefabObjectReaderAndWriter.h"
@@ -15,6 +15,9 @@
 #include "Serialization/MemoryReader.h"
 #include "PrefabSystem/ILPrefabInterface.h"
 #include "PhysicsEngine/BodyInstance.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/ObjectKey.h"
+#include "Misc/MemStack.h"
 #if WITH_EDITOR
 #include "LPrefabUtils.h"
 #endif
@@ -25,8 +28,42 @@ PRAGMA_DISABLE_OPTIMIZATION
 
 #define LOCTEXT_NAMESPACE "LPrefabSystem8_Deserialize"
 
+static TAutoConsoleVariable<int32> CVarLPrefabRegisterComponentsOnce(
+	TEXT("LPrefab.RegisterComponentsOnce"),
+	0,
+	TEXT("1- When load prefab in game world, apply all properties and build the whole attachment tree before register any component, then register every component once in parent-to-child order. Component's BeginPlay is called when it is registered, which is later than actor's BeginPlay. 0- Register component when attach it, and re-register it after properties are applied."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarLPrefabCookedAwakeList(
+	TEXT("LPrefab.CookedAwakeList"),
+	1,
+	TEXT("1- If cooked build data has the list of objects that need Awake, dispatch Awake with it instead of checking every actor and component. 0- Always check every actor and component."),
+	ECVF_Default);
+
 namespace LPrefabSystem8
 {
+	/** Key is class, value is if it implements ILPrefabInterface. */
+	static TMap<FObjectKey, bool> ClassImplementsPrefabInterfaceCache;
+
+	bool ActorSerializer::ImplementsPrefabInterface(const UClass* InClass)
+	{
+		check(IsInGameThread());
+		//FObjectKey is not reused by new class even if old class is garbage collected
+		FObjectKey ClassKey(InClass);
+		if (auto ResultPtr = ClassImplementsPrefabInterfaceCache.Find(ClassKey))
+		{
+			return *ResultPtr;
+		}
+		bool bImplements = InClass->ImplementsInterface(ULPrefabInterface::StaticClass());
+		ClassImplementsPrefabInterfaceCache.Add(ClassKey, bImplements);
+		return bImplements;
+	}
+
+	void ActorSerializer::ClearPrefabInterfaceCache()
+	{
+		ClassImplementsPrefabInterfaceCache.Empty();
+	}
+
 	AActor* ActorSerializer::LoadPrefabWithExistingObjects(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent
 		, TMap<FGuid, TObjectPtr<UObject>>& InOutMapGuidToObjects, TMap<TObjectPtr<AActor>, FLSubPrefabData>& OutSubPrefabMap
 	)
@@ -59,15 +96,7 @@ namespace LPrefabSystem8
 		serializer.bIsEditorOrRuntime = false;
 #endif
 		serializer.bOverrideVersions = true;
-		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
-			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
-			Reader.DoSerialize(InObject);
-		};
-		serializer.WriterOrReaderFunctionForSubPrefabOverride = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, const TArray<FName>& InOverridePropertyNames) {
-			LPrefabSystem::FLPrefabOverrideParameterObjectReader Reader(InOutBuffer, serializer, InOverridePropertyNames);
-			Reader.DoSerialize(InObject);
-		};
+		serializer.SetupReaderFunctions();
 		auto rootActor = serializer.DeserializeActor(Parent, InPrefab, nullptr, false, FVector::ZeroVector, FQuat::Identity, FVector::OneVector);
 		InOutMapGuidToObjects = serializer.MapGuidToObject;
 		OutSubPrefabMap = serializer.SubPrefabMap;
@@ -75,6 +104,10 @@ namespace LPrefabSystem8
 	}
 
 	AActor* ActorSerializer::LoadPrefab(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent, bool SetRelativeTransformToIdentity, TFunction<void(AActor*)> CallbackBeforeAwake)
+	{
+		return LoadPrefabWithSaveData(InWorld, InPrefab, nullptr, Parent, SetRelativeTransformToIdentity, MoveTemp(CallbackBeforeAwake));
+	}
+	AActor* ActorSerializer::LoadPrefabWithSaveData(UWorld* InWorld, ULPrefab* InPrefab, const TSharedPtr<const FLPrefabSaveData, ESPMode::ThreadSafe>& InSaveData, USceneComponent* Parent, bool SetRelativeTransformToIdentity, TFunction<void(AActor*)> CallbackBeforeAwake)
 	{
 		if (!IsValid(InWorld))
 		{
@@ -89,20 +122,14 @@ namespace LPrefabSystem8
 
 		ActorSerializer serializer;
 		serializer.TargetWorld = InWorld;
-		serializer.CallbackBeforeAwake = CallbackBeforeAwake;
+		serializer.CallbackBeforeAwake = MoveTemp(CallbackBeforeAwake);
 #if !WITH_EDITOR
 		serializer.bIsEditorOrRuntime = false;
 #endif
 		serializer.bOverrideVersions = true;
-		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
-			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
-			Reader.DoSerialize(InObject);
-		};
-		serializer.WriterOrReaderFunctionForSubPrefabOverride = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, const TArray<FName>& InOverridePropertyNames) {
-			LPrefabSystem::FLPrefabOverrideParameterObjectReader Reader(InOutBuffer, serializer, InOverridePropertyNames);
-			Reader.DoSerialize(InObject);
-		};
+		serializer.bCanDeferSubPrefab = CanDeferSubPrefab(InWorld);
+		serializer.GivenSaveData = InSaveData;
+		serializer.SetupReaderFunctions();
 		AActor* result = nullptr;
 		if (SetRelativeTransformToIdentity)
 		{
@@ -129,27 +156,210 @@ namespace LPrefabSystem8
 
 		ActorSerializer serializer;
 		serializer.TargetWorld = InWorld;
-		serializer.CallbackBeforeAwake = CallbackBeforeAwake;
+		serializer.CallbackBeforeAwake = MoveTemp(CallbackBeforeAwake);
 #if !WITH_EDITOR
 		serializer.bIsEditorOrRuntime = false;
 #endif
 		serializer.bOverrideVersions = true;
-		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
-			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
-			Reader.DoSerialize(InObject);
-		};
-		serializer.WriterOrReaderFunctionForSubPrefabOverride = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, const TArray<FName>& InOverridePropertyNames) {
-			LPrefabSystem::FLPrefabOverrideParameterObjectReader Reader(InOutBuffer, serializer, InOverridePropertyNames);
-			Reader.DoSerialize(InObject);
-		};
+		serializer.bCanDeferSubPrefab = CanDeferSubPrefab(InWorld);
+		serializer.SetupReaderFunctions();
 		return serializer.DeserializeActor(Parent, InPrefab, nullptr, true, RelativeLocation, RelativeRotation, RelativeScale);
 	}
+	AActor* ActorSerializer::LoadPrefabWithReplacement(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent, const TMap<UObject*, UObject*>& InReplaceAssetMap, const TMap<UClass*, UClass*>& InReplaceClassMap, TFunction<void(AActor*)> CallbackBeforeAwake)
+	{
+		if (!IsValid(InWorld))
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Not valid world!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return nullptr;
+		}
+		if (!IsValid(InPrefab))
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d InPrefab is null!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return nullptr;
+		}
+
+		ActorSerializer serializer;
+		serializer.TargetWorld = InWorld;
+		serializer.CallbackBeforeAwake = MoveTemp(CallbackBeforeAwake);
+#if !WITH_EDITOR
+		serializer.bIsEditorOrRuntime = false;
+#endif
+		serializer.bOverrideVersions = true;
+		serializer.bCanDeferSubPrefab = CanDeferSubPrefab(InWorld);
+		serializer.ReplaceAssetMap = InReplaceAssetMap.Num() > 0 ? &InReplaceAssetMap : nullptr;
+		serializer.ReplaceClassMap = InReplaceClassMap.Num() > 0 ? &InReplaceClassMap : nullptr;
+		serializer.SetupReaderFunctions();
+		return serializer.DeserializeActor(Parent, InPrefab, nullptr);
+	}
+	void ActorSerializer::LoadPrefabBatch(UWorld* InWorld, ULPrefab* InPrefab, TArrayView<const FTransform> InTransforms, TArrayView<USceneComponent* const> InParents, TArray<AActor*>& OutRoots)
+	{
+		OutRoots.Reset();
+		if (!IsValid(InWorld))
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Not valid world!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return;
+		}
+		if (!IsValid(InPrefab))
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d InPrefab is null!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return;
+		}
+		auto InstanceCount = InTransforms.Num();
+		if (InParents.Num() > 1 && InParents.Num() != InstanceCount)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d InParents count (%d) should be 0, 1 or same as InTransforms count (%d)!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, InParents.Num(), InstanceCount);
+			return;
+		}
+		if (InstanceCount == 0)return;
+		SCOPE_CYCLE_COUNTER(STAT_LPrefab_LoadPrefabBatch);
+		LPREFAB_TRACE_SCOPE_TEXT(TEXT("LPrefab.LoadPrefabBatch %s, instance: %d"), *InPrefab->GetName(), InstanceCount);
+		auto StartTime = FDateTime::Now();
+
+		bool bIsEditorOrRuntime = true;
+#if !WITH_EDITOR
+		bIsEditorOrRuntime = false;
+#endif
+		//parse and resolve reference lists once, every instance copy from the template
+		auto SaveData = InPrefab->GetParsedSaveData(bIsEditorOrRuntime);
+		ActorSerializer Template;
+		Template.TargetWorld = InWorld;
+		Template.bIsEditorOrRuntime = bIsEditorOrRuntime;
+		Template.bOverrideVersions = true;
+		Template.LPrefabManager = ULPrefabWorldSubsystem::GetInstance(InWorld);
+		Template.SetupForPrefab(InPrefab);
+#if !UE_BUILD_SHIPPING
+		if (!bIsEditorOrRuntime && SaveData->bDeltaAgainstArchetype)
+		{
+			InPrefab->CheckArchetypeHashForBuild(Template.ReferenceClassList);
+		}
+#endif
+
+		auto& SavedActors = SaveData->SavedActors;
+		TArray<TUniquePtr<ActorSerializer>> Instances;
+		Instances.Reserve(InstanceCount);
+		for (int i = 0; i < InstanceCount; i++)
+		{
+			auto& serializer = *Instances.Add_GetRef(MakeUnique<ActorSerializer>(Template));
+			serializer.SetupReaderFunctions();
+			serializer.DeserializeState.StartTime = StartTime;
+			serializer.DeserializeState.Prefab = InPrefab;
+			serializer.DeserializeState.SharedSaveData = SaveData;
+			auto Parent = InParents.Num() == 0 ? nullptr : InParents[InParents.Num() == 1 ? 0 : i];
+			auto& Transform = InTransforms[i];
+			serializer.BeginDeserializeActorFromData(*SaveData, Parent, true, Transform.GetLocation(), Transform.GetRotation(), Transform.GetScale3D());
+		}
+
+		//generate actors in class-major order: same actor slot for all instances, slots sorted by class, so the same spawn code runs continuously
+		FMemMark Mark(FMemStack::Get());
+		TArray<int32, TMemStackAllocator<>> ActorSlotOrder;
+		ActorSlotOrder.Reserve(SavedActors.Num());
+		for (int SlotIndex = 0; SlotIndex < SavedActors.Num(); SlotIndex++)
+		{
+			ActorSlotOrder.Add(SlotIndex);
+		}
+		ActorSlotOrder.StableSort([&SavedActors](int32 A, int32 B) {
+			auto& ActorA = SavedActors[A];
+			auto& ActorB = SavedActors[B];
+			if (ActorA.bIsPrefab != ActorB.bIsPrefab)return !ActorA.bIsPrefab;
+			return ActorA.bIsPrefab ? ActorA.PrefabAssetIndex < ActorB.PrefabAssetIndex : ActorA.ObjectClass < ActorB.ObjectClass;
+			});
+		//collected actors and components should keep the slot order, because Awake and attachment follow these order
+		struct FSlotRange
+		{
+			int32 ActorStart = 0, ActorCount = 0;
+			int32 ComponentStart = 0, ComponentCount = 0;
+			int32 SubPrefabRootStart = 0, SubPrefabRootCount = 0;
+		};
+		TArray<TArray<FSlotRange>> InstanceSlotRanges;
+		InstanceSlotRanges.SetNum(InstanceCount);
+		for (auto& SlotRanges : InstanceSlotRanges)
+		{
+			SlotRanges.SetNum(SavedActors.Num());
+		}
+		for (auto SlotIndex : ActorSlotOrder)
+		{
+			auto& ActorData = SavedActors[SlotIndex];
+			for (int i = 0; i < InstanceCount; i++)
+			{
+				auto& serializer = *Instances[i];
+				auto& Range = InstanceSlotRanges[i][SlotIndex];
+				Range.ActorStart = serializer.AllActors.Num();
+				Range.ComponentStart = serializer.AllComponents.Num();
+				Range.SubPrefabRootStart = serializer.SubPrefabRootComponents.Num();
+				if (ActorData.bIsPrefab)
+				{
+					serializer.BeginGenerateSubPrefab(ActorData, SlotIndex);
+					if (serializer.DeserializeState.SubPrefabContext.IsValid())
+					{
+						serializer.DeserializeState.SubPrefabContext->Serializer->StepDeserialize(MAX_dbl);
+						serializer.FinishGenerateSubPrefab(ActorData);
+					}
+				}
+				else
+				{
+					serializer.GenerateActor(ActorData, SlotIndex, FGuid());
+				}
+				Range.ActorCount = serializer.AllActors.Num() - Range.ActorStart;
+				Range.ComponentCount = serializer.AllComponents.Num() - Range.ComponentStart;
+				Range.SubPrefabRootCount = serializer.SubPrefabRootComponents.Num() - Range.SubPrefabRootStart;
+			}
+		}
+		for (int i = 0; i < InstanceCount; i++)
+		{
+			auto& serializer = *Instances[i];
+			TArray<AActor*> SortedActors;
+			TArray<UActorComponent*> SortedComponents;
+			TArray<FComponentDataStruct> SortedSubPrefabRootComponents;
+			SortedActors.Reserve(serializer.AllActors.Num());
+			SortedComponents.Reserve(serializer.AllComponents.Num());
+			SortedSubPrefabRootComponents.Reserve(serializer.SubPrefabRootComponents.Num());
+			for (auto& Range : InstanceSlotRanges[i])
+			{
+				SortedActors.Append(serializer.AllActors.GetData() + Range.ActorStart, Range.ActorCount);
+				SortedComponents.Append(serializer.AllComponents.GetData() + Range.ComponentStart, Range.ComponentCount);
+				SortedSubPrefabRootComponents.Append(serializer.SubPrefabRootComponents.GetData() + Range.SubPrefabRootStart, Range.SubPrefabRootCount);
+			}
+			serializer.AllActors = MoveTemp(SortedActors);
+			serializer.AllComponents = MoveTemp(SortedComponents);
+			serializer.SubPrefabRootComponents = MoveTemp(SortedSubPrefabRootComponents);
+			serializer.DeserializeState.Cursor = SavedActors.Num();
+			if (serializer.DeserializeState.CreatedRootActor == nullptr)
+			{
+				serializer.StepDeserialize(MAX_dbl);//no actor generated, this will end the load
+			}
+		}
+
+		//generate objects, same object slot for all instances
+		for (auto& ObjectData : SaveData->SavedObjects)
+		{
+			for (auto& Instance : Instances)
+			{
+				if (Instance->DeserializeState.Step == EDeserializeStep::Done)continue;
+				Instance->GenerateObject(ObjectData.ObjectGuid, ObjectData);
+			}
+		}
+
+		//rest steps are done instance by instance
+		OutRoots.Reserve(InstanceCount);
+		for (auto& Instance : Instances)
+		{
+			auto& State = Instance->DeserializeState;
+			if (State.Step != EDeserializeStep::Done)
+			{
+				State.Step = EDeserializeStep::ApplyProperties;
+				State.Cursor = 0;
+				Instance->StepDeserialize(MAX_dbl);
+			}
+			OutRoots.Add(State.CreatedRootActor);
+		}
+	}
+
 	AActor* ActorSerializer::LoadSubPrefab(
 		UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent
 		, const FGuid& InParentDeserializationSessionId
 		, TMap<FGuid, TObjectPtr<UObject>>& InMapGuidToObject
 		, const TFunction<void(AActor*, const TMap<FGuid, TObjectPtr<UObject>>&, const TMap<TObjectPtr<UObject>, FGuid>&, const TArray<AActor*>&, const TArray<UActorComponent*>&)>& InOnSubPrefabFinishDeserializeFunction
+		, FLPrefabApplyRecord* InApplyRecord
 	)
 	{
 		ActorSerializer serializer;
@@ -161,266 +371,899 @@ namespace LPrefabSystem8
 		serializer.MapGuidToObject = InMapGuidToObject;
 		serializer.DeserializationSessionId = InParentDeserializationSessionId;
 		serializer.bIsSubPrefab = true;
-		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
-			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
-			Reader.DoSerialize(InObject);
-		};
-		serializer.WriterOrReaderFunctionForSubPrefabOverride = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, const TArray<FName>& InOverridePropertyNames) {
-			LPrefabSystem::FLPrefabOverrideParameterObjectReader Reader(InOutBuffer, serializer, InOverridePropertyNames);
-			Reader.DoSerialize(InObject);
-		};
+		serializer.ApplyRecord = InApplyRecord;
+		serializer.SetupReaderFunctions();
 		serializer.OnSubPrefabFinishDeserializeFunction = InOnSubPrefabFinishDeserializeFunction;
 		auto rootActor = serializer.DeserializeActor(Parent, InPrefab, nullptr, false, FVector::ZeroVector, FQuat::Identity, FVector::OneVector);
 		return rootActor;
 	}
 
-	void ActorSerializer::PostSetPropertiesOnActor(UActorComponent* Comp)
+	AActor* ActorSerializer::LoadPrefabWithApplyRecord(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent, const FTransform& InTransform
+		, FLPrefabApplyRecord& OutApplyRecord, TArray<AActor*>& OutCreatedActors, bool InDispatchAwake)
 	{
-		//here two methods to apply the deserialized data to component
-#if 0//This method is simple and robust because it use built-in funtion. But also performance-cost (about 1.5-2.0x time cost to the whole deserialize process), because a lot of unnecessary properties are set here
-		auto CompInstanceData = Comp->GetComponentInstanceData();
-		CompInstanceData->ApplyToComponent(Comp, ECacheApplyPhase::PostUserConstructionScript);
-#else//In this method I search all "ApplyToComponent" function and get the important part (I think), so result may miss something, if it does then contact me and I will add the missing part
-		if (auto PrimitiveComp = Cast<UPrimitiveComponent>(Comp))
+		if (!IsValid(InWorld))
 		{
-			//fix collision data. this is same as UPrimitiveComponent.UpdateCollisionProfile
-			{
-				PrimitiveComp->BodyInstance.LoadProfileData(false);
-			}
-			if (auto SplineComp = Cast<USplineComponent>(Comp))
-			{
-				SplineComp->UpdateSpline();
-			}
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Not valid world!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return nullptr;
 		}
-		Comp->ReregisterComponent();
+		if (!IsValid(InPrefab))
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d InPrefab is null!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return nullptr;
+		}
+
+		ActorSerializer serializer;
+		serializer.TargetWorld = InWorld;
+#if !WITH_EDITOR
+		serializer.bIsEditorOrRuntime = false;
 #endif
+		serializer.bOverrideVersions = true;
+		serializer.ApplyRecord = &OutApplyRecord;
+		serializer.bDispatchAwake = InDispatchAwake;
+		serializer.SetupReaderFunctions();
+		auto rootActor = serializer.DeserializeActor(Parent, InPrefab, nullptr, true, InTransform.GetLocation(), InTransform.GetRotation(), InTransform.GetScale3D());
+		OutCreatedActors = serializer.AllActors;
+		return rootActor;
 	}
 
-#define LPREFAB_LOG_DETAIL_TIME 0
-	AActor* ActorSerializer::DeserializeActorFromData(FLPrefabSaveData& SaveData, USceneComponent* Parent, bool ReplaceTransform, FVector InLocation, FQuat InRotation, FVector InScale)
+	/** Copy of serialized property values of an object, to find out if the object is changed by apply data. */
+	class FLPrefabPropertySnapshot
 	{
-#if LPREFAB_LOG_DETAIL_TIME
-		auto Time = FDateTime::Now();
-#endif
-		if (LPrefabManager == nullptr)
-		{
-			LPrefabManager = ULPrefabWorldSubsystem::GetInstance(TargetWorld);
-		}
-		if (!bIsSubPrefab)
+	public:
+		FLPrefabPropertySnapshot(UObject* InObject)
+			: Object(InObject)
+			, Class(InObject->GetClass())
 		{
-			if (!DeserializationSessionId.IsValid())
+			Memory = (uint8*)FMemory::Malloc(Class->GetStructureSize(), Class->GetMinAlignment());
+			Class->InitializeStruct(Memory);
+			for (FProperty* Property = Class->PropertyLink; Property != nullptr; Property = Property->PropertyLinkNext)
 			{
-				DeserializationSessionId = FGuid::NewGuid();
-				LPrefabManager->BeginPrefabSystemProcessingActor(DeserializationSessionId);
+				if (LPrefabSystem::LPrefab_ShouldSkipProperty(Property))continue;
+				Property->CopyCompleteValue_InContainer(Memory, Object);
 			}
 		}
-		auto CreatedRootActor = GenerateActorArray(SaveData.SavedActors, SaveData.SavedObjects, SaveData.MapSceneComponentToParent, FGuid());
-		if (CreatedRootActor == nullptr)
+		~FLPrefabPropertySnapshot()
 		{
-			UE_LOG(LPrefab, Error, TEXT("[%s].%d No actor generated!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
-
-			if (!bIsSubPrefab)
-			{
-				check(DeserializationSessionId.IsValid());
-				LPrefabManager->EndPrefabSystemProcessingActor(DeserializationSessionId);
-			}
-			return nullptr;
+			Class->DestroyStruct(Memory);
+			FMemory::Free(Memory);
 		}
-		GenerateObjectArray(SaveData.SavedObjects, SaveData.MapSceneComponentToParent);
-#if LPREFAB_LOG_DETAIL_TIME
-		UE_LOG(LPrefab, Log, TEXT("--GenerateObject take time: %fms"), (FDateTime::Now() - Time).GetTotalMilliseconds());
-		Time = FDateTime::Now();
-#endif
-		//properties
-		for (auto& KeyValue : SaveData.SavedObjectData)
+		FLPrefabPropertySnapshot(const FLPrefabPropertySnapshot&) = delete;
+		FLPrefabPropertySnapshot& operator=(const FLPrefabPropertySnapshot&) = delete;
+
+		bool IsChanged()const
 		{
-			if (auto ObjectPtr = MapGuidToObject.Find(KeyValue.Key))
+			for (FProperty* Property = Class->PropertyLink; Property != nullptr; Property = Property->PropertyLinkNext)
 			{
-				WriterOrReaderFunction(*ObjectPtr, KeyValue.Value, Cast<USceneComponent>(*ObjectPtr) != nullptr);
+				if (LPrefabSystem::LPrefab_ShouldSkipProperty(Property))continue;
+				for (int i = 0; i < Property->ArrayDim; i++)
+				{
+					if (!Property->Identical_InContainer(Memory, Object, i))
+					{
+						return true;
+					}
+				}
 			}
+			return false;
 		}
+	private:
+		UObject* Object = nullptr;
+		UClass* Class = nullptr;
+		uint8* Memory = nullptr;
+	};
 
-		//sub prefab override properties
-		for (auto& Item : SubPrefabOverrideParameters)
+	void ActorSerializer::ReapplyPrefabState(UWorld* InWorld, const FLPrefabApplyRecord& InApplyRecord, TSet<UObject*>* OutChangedObjects)
+	{
+		//every scope use it's own serializer, so object reference can resolve to right object
+		TArray<TUniquePtr<ActorSerializer>> ScopeSerializers;
+		ScopeSerializers.SetNum(InApplyRecord.Scopes.Num());
+		//delta data not store property that same as archetype, so restore archetype value first
+		TArray<bool> ScopeIsDeltaData;
+		ScopeIsDeltaData.SetNumZeroed(InApplyRecord.Scopes.Num());
+		for (int i = 0; i < InApplyRecord.Scopes.Num(); i++)
 		{
-			WriterOrReaderFunctionForSubPrefabOverride(Item.Object, Item.ParameterDatas, Item.ParameterNames);
-		}
-
-#if LPREFAB_LOG_DETAIL_TIME
-		UE_LOG(LPrefab, Log, TEXT("--DeserializeObject take time: %fms"), (FDateTime::Now() - Time).GetTotalMilliseconds());
-		Time = FDateTime::Now();
+			auto& Scope = InApplyRecord.Scopes[i];
+			auto Prefab = Scope.Prefab.Get();
+			if (!IsValid(Prefab))
+			{
+				UE_LOG(LPrefab, Warning, TEXT("[%s].%d Prefab asset is not valid anymore, skip it."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+				continue;
+			}
+			auto serializer = MakeUnique<ActorSerializer>();
+			serializer->TargetWorld = InWorld;
+#if !WITH_EDITOR
+			serializer->bIsEditorOrRuntime = false;
 #endif
-
-		//component attachment
-		for (auto& CompData : ComponentsInThisPrefab)
-		{
-			if (auto SceneComp = Cast<USceneComponent>(CompData.Component))
+			serializer->bOverrideVersions = true;
+			serializer->SetupForPrefab(Prefab);
+			serializer->SetupReaderFunctions();
+			for (auto& KeyValue : Scope.MapGuidToObject)
 			{
-				if (CompData.SceneComponentParentGuid.IsValid())
+				if (auto Object = KeyValue.Value.Get())
 				{
-					USceneComponent* ParentComp = nullptr;
-					auto ParentObjectPtr = MapGuidToObject.Find(CompData.SceneComponentParentGuid);
-					if (ParentObjectPtr != nullptr)
-					{
-						ParentComp = Cast<USceneComponent>(*ParentObjectPtr);
-					}
-					if (!ParentComp)
-					{
-#if WITH_EDITOR
-						if (TargetWorld != ULPrefabManagerObject::GetPreviewWorldForPrefabPackage())//skip preview world, only show this in PrefabEditor or LevelEditor
-						{
-							auto MissingParentMsg = FText::Format(LOCTEXT("MissingParentMsg", "Prefab '{0}' fail to find parent for component '{1}.{2}', do you delete it? The component will attach to root")
-								, FText::FromString(PrefabAssetPath), FText::FromString(SceneComp->GetOwner()->GetActorLabel()), FText::FromString(SceneComp->GetName()));
-							LPrefabUtils::EditorNotification(MissingParentMsg, 10);
-							UE_LOG(LPrefab, Error, TEXT("[%s].%d %s"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *MissingParentMsg.ToString());
-						}
-#endif
-						ParentComp = CreatedRootActor->GetRootComponent();
-					}
-					if (SceneComp->IsRegistered())
-					{
-						SceneComp->AttachToComponent(ParentComp, FAttachmentTransformRules::KeepRelativeTransform);
-					}
-					else
-					{
-						SceneComp->SetupAttachment(ParentComp);
-					}
-
+					serializer->MapGuidToObject.Add(KeyValue.Key, Object);
 				}
 			}
-			if (!CompData.Component->IsRegistered())
+			if (Scope.SaveData.IsValid())
 			{
-				CompData.Component->RegisterComponent();
+				serializer->BuildObjectIndexTable(*Scope.SaveData);
+				serializer->bDeltaAgainstArchetype = Scope.SaveData->bDeltaAgainstArchetype;
+				serializer->bTargetedOverrideParameter = Scope.SaveData->bTargetedOverrideParameter;
+				serializer->bTaggedPropertyData = Scope.SaveData->bTaggedPropertyData;
+				ScopeIsDeltaData[i] = Scope.SaveData->bDeltaAgainstArchetype;
 			}
+			ScopeSerializers[i] = MoveTemp(serializer);
 		}
-		for (auto& CompData : SubPrefabRootComponents)
+
+		//object could have data and override parameter data, so compare after all data is applied
+		TMap<UObject*, TUniquePtr<FLPrefabPropertySnapshot>> Snapshots;
+		for (auto& Item : InApplyRecord.ObjectDatas)
 		{
-			auto SceneComp = (USceneComponent*)CompData.Component;
-			if (auto ParentObjectPtr = MapGuidToObject.Find(CompData.SceneComponentParentGuid))
+			auto Object = Item.Object.Get();
+			if (!IsValid(Object))continue;
+			if (!ScopeSerializers.IsValidIndex(Item.ScopeIndex) || !ScopeSerializers[Item.ScopeIndex].IsValid())continue;
+			auto& serializer = *ScopeSerializers[Item.ScopeIndex];
+			if (OutChangedObjects != nullptr && !Snapshots.Contains(Object))
 			{
-				if (auto ParentComp = Cast<USceneComponent>(*ParentObjectPtr))
+				Snapshots.Add(Object, MakeUnique<FLPrefabPropertySnapshot>(Object));
+			}
+			if (Item.bIsOverrideParameter)
+			{
+				serializer.ApplyOverrideParameterData(Object, const_cast<TArray<uint8>&>(Item.OverrideData), Item.OverrideNames);
+			}
+			else
+			{
+				auto bIsSceneComponent = Cast<USceneComponent>(Object) != nullptr;
+				if (ScopeIsDeltaData[Item.ScopeIndex])
 				{
-					SceneComp->AttachToComponent(ParentComp, FAttachmentTransformRules::KeepRelativeTransform);
+					RestoreArchetypeValues(Object, serializer.GetExcludeProperties(bIsSceneComponent));
 				}
+				serializer.ApplyObjectData(Object, const_cast<TArray<uint8>&>(*Item.Data), bIsSceneComponent);
 			}
 		}
-
-		if (!bIsSubPrefab)//sub-prefab's re-register should handle in parent after all override property
+		for (auto& KeyValue : Snapshots)
 		{
-			//mark component reregister to use new property value
-			for (auto& Comp : AllComponents)
+			if (KeyValue.Value->IsChanged())
 			{
-				PostSetPropertiesOnActor(Comp);
+				OutChangedObjects->Add(KeyValue.Key);
 			}
 		}
+	}
 
-		//attach root actor's parent
-		if (USceneComponent* RootComp = CreatedRootActor->GetRootComponent())
+	void ActorSerializer::RestoreArchetypeValues(UObject* InObject, const TSet<FName>& InExcludeProperties)
+	{
+		auto Archetype = InObject->GetArchetype();
+		if (Archetype == nullptr || Archetype->GetClass() != InObject->GetClass())return;
+		for (TFieldIterator<FProperty> PropertyItr(InObject->GetClass()); PropertyItr; ++PropertyItr)
 		{
-			if (Parent)
-			{
-				RootComp->AttachToComponent(Parent, FAttachmentTransformRules::KeepRelativeTransform);
-			}
-			if (!bIsSubPrefab)//need to do this in root actor and it will propogate to children. If do this in subprefab and parent prefab override transform data on subprefab's actor, then transform goes wrong
+			auto Property = *PropertyItr;
+			if (LPrefabSystem::LPrefab_ShouldSkipProperty(Property))continue;
+			if (InExcludeProperties.Contains(Property->GetFName()))continue;
+			//instanced object belongs to it's owner, archetype's one must not be used
+			if (Property->HasAnyPropertyFlags(CPF_InstancedReference | CPF_ContainsInstancedReference))continue;
+			TArray<const FStructProperty*> EncounteredStructProps;
+			if (Property->ContainsObjectReference(EncounteredStructProps))
 			{
-				RootComp->UpdateComponentToWorld();
-			}
-			if (ReplaceTransform)
-			{
-				RootComp->SetRelativeLocationAndRotation(InLocation, InRotation);
-				RootComp->SetRelativeScale3D(InScale);
+				//only restore single object reference that point to asset or null, other object may belongs to the archetype
+				auto ObjectProperty = CastField<FObjectPropertyBase>(Property);
+				if (ObjectProperty == nullptr || Property->ArrayDim != 1)continue;
+				auto ArchetypeValue = ObjectProperty->GetObjectPropertyValue_InContainer(Archetype);
+				if (ArchetypeValue != nullptr && !ArchetypeValue->IsAsset())continue;
 			}
+			Property->CopyCompleteValue_InContainer(InObject, Archetype);
 		}
+	}
 
+	void ActorSerializer::DispatchAwake(UWorld* InWorld, const TArray<AActor*>& InActors)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_LPrefab_Awake);
+		LPREFAB_TRACE_SCOPE_TEXT(TEXT("LPrefab.Awake actor: %d"), InActors.Num());
 #if WITH_EDITOR
-		if (!bIsSubPrefab)//sub-prefab's RerunConstructionScripts should handle in parent after all override property, and after root actor attach to parent
+		if (!InWorld->IsGameWorld())
 		{
-			if (!TargetWorld->IsGameWorld())
+			for (int i = 0; i < InActors.Num(); i++)
 			{
-				ULPrefabManagerObject::Deserialize_ProcessComponentsBeforeRerunConstructionScript.ExecuteIfBound(AllComponents);
-				//refresh it
-				for (auto& Actor : AllActors)
+				auto& Actor = InActors[i];
+				if (ImplementsPrefabInterface(Actor->GetClass()))
 				{
-					Actor->RerunConstructionScripts();
-					Actor->ReregisterAllComponents();
+					ILPrefabInterface::Execute_EditorAwake(Actor);
+				}
+				auto Components = Actor->GetComponents();
+				for (auto& Comp : Components)
+				{
+					if (ImplementsPrefabInterface(Comp->GetClass()))
+					{
+						ILPrefabInterface::Execute_EditorAwake(Comp);
+					}
 				}
 			}
 		}
+		else
 #endif
-
-		if (OnSubPrefabFinishDeserializeFunction != nullptr)
 		{
-			OnSubPrefabFinishDeserializeFunction(CreatedRootActor, MapGuidToObject, MapObjectToOriginGuid, AllActors, AllComponents);
+			for (int i = 0; i < InActors.Num(); i++)
+			{
+				DispatchActorAwake(InActors[i]);
+			}
 		}
-		if (CallbackBeforeAwake != nullptr)
+	}
+
+	void ActorSerializer::DispatchActorAwake(AActor* InActor)
+	{
+		if (ImplementsPrefabInterface(InActor->GetClass()))
 		{
-			CallbackBeforeAwake(CreatedRootActor);
+			ILPrefabInterface::Execute_Awake(InActor);
 		}
-
-#if LPREFAB_LOG_DETAIL_TIME
-		Time = FDateTime::Now();
-#endif
-		if (!bIsSubPrefab)
+		auto Components = InActor->GetComponents();
+		for (auto& Comp : Components)
 		{
-			check(DeserializationSessionId.IsValid());
-			for (auto item : AllActors)
+			if (ImplementsPrefabInterface(Comp->GetClass()))
 			{
-				LPrefabManager->RemoveActorForPrefabSystem(item, DeserializationSessionId);
+				ILPrefabInterface::Execute_Awake(Comp);
 			}
-			LPrefabManager->EndPrefabSystemProcessingActor(DeserializationSessionId);
+		}
+	}
 
-#if WITH_EDITOR
-			if (!TargetWorld->IsGameWorld())
+	bool ActorSerializer::DispatchAwakeFromSaveData()
+	{
+		auto SaveData = DeserializeState.SaveData;
+		if (SaveData == nullptr || !SaveData->bHasAwakeObjectIndices)return false;
+		if (!TargetWorld->IsGameWorld() || CVarLPrefabCookedAwakeList.GetValueOnGameThread() == 0)return false;
+		if (ObjectsByIndex.Num() != SaveData->ObjectGuids.Num())return false;
+		if (SubPrefabMap.Num() > 0)return false;//deferred sub prefab is loaded together with parent, its objects are not in the list
+		auto& SavedActors = SaveData->SavedActors;
+		if (SaveData->AwakeObjectCounts.Num() != SavedActors.Num() || SaveData->AwakeComponentCounts.Num() != SavedActors.Num())return false;
+		SCOPE_CYCLE_COUNTER(STAT_LPrefab_Awake);
+		LPREFAB_TRACE_SCOPE_TEXT(TEXT("LPrefab.Awake cooked list: %d"), SaveData->AwakeObjectIndices.Num());
+		//Actors are in the same order as DispatchAwake(AllActors). The list of an actor is only used if the actor has the same component count as when cooked,
+		//otherwise it has components that are not in build data (eg: created by construction script or in OnRegister), so check every component of it same as DispatchAwake.
+		int32 Cursor = 0;
+		for (int i = 0; i < SavedActors.Num(); i++)
+		{
+			auto ListStart = Cursor;
+			Cursor += SaveData->AwakeObjectCounts[i];
+			if (SavedActors[i].bIsPrefab)continue;//deferred sub prefab call Awake when realize
+			auto Actor = Cast<AActor>(MapGuidToObject.FindRef(SavedActors[i].ActorGuid));
+			if (!IsValid(Actor))continue;//could be destroyed by other's Awake
+			if (Actor->GetComponents().Num() != SaveData->AwakeComponentCounts[i])
 			{
-				for (int i = 0; i < AllActors.Num(); i++)
-				{
-					auto& Actor = AllActors[i];
-					if (Actor->GetClass()->ImplementsInterface(ULPrefabInterface::StaticClass()))
-					{
-						ILPrefabInterface::Execute_EditorAwake(Actor);
-					}
-					auto Components = Actor->GetComponents();
-					for (auto& Comp : Components)
-					{
-						if (Comp->GetClass()->ImplementsInterface(ULPrefabInterface::StaticClass()))
-						{
-							ILPrefabInterface::Execute_EditorAwake(Comp);
-						}
-					}
-				}
-		}
-			else
-#endif
+				DispatchActorAwake(Actor);
+				continue;
+			}
+			for (int ListIndex = ListStart; ListIndex < Cursor && ListIndex < SaveData->AwakeObjectIndices.Num(); ListIndex++)
 			{
-				for (int i = 0; i < AllActors.Num(); i++)
+				auto Index = SaveData->AwakeObjectIndices[ListIndex];
+				auto Object = ObjectsByIndex.IsValidIndex(Index) ? ObjectsByIndex[Index] : nullptr;
+				if (IsValid(Object))//could be destroyed by other's Awake
 				{
-					auto& Actor = AllActors[i];
-					if (Actor->GetClass()->ImplementsInterface(ULPrefabInterface::StaticClass()))
-					{
-						ILPrefabInterface::Execute_Awake(Actor);
-					}
-					auto Components = Actor->GetComponents();
-					for (auto& Comp : Components)
-					{
-						if (Comp->GetClass()->ImplementsInterface(ULPrefabInterface::StaticClass()))
-						{
-							ILPrefabInterface::Execute_Awake(Comp);
-						}
-					}
+					ILPrefabInterface::Execute_Awake(Object);
 				}
 			}
 		}
+		return true;
+	}
+
+	ActorSerializer::FReusableObjectReader::FReusableObjectReader() {}
+	ActorSerializer::FReusableObjectReader::FReusableObjectReader(const FReusableObjectReader& Other) {}
+	ActorSerializer::FReusableObjectReader& ActorSerializer::FReusableObjectReader::operator=(const FReusableObjectReader& Other)
+	{
+		Reader.Reset();
+		Buffer.Empty();
+		return *this;
+	}
+	ActorSerializer::FReusableObjectReader::~FReusableObjectReader() {}
+
+	void ActorSerializer::SetupReaderFunctions()
+	{
+		//default reader is used when these are null, a TFunction capture allocate on heap
+		WriterOrReaderFunction = nullptr;
+		WriterOrReaderFunctionForSubPrefabOverride = nullptr;
+	}
+	void ActorSerializer::ApplyObjectData(UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent)
+	{
+		if (WriterOrReaderFunction)
+		{
+			WriterOrReaderFunction(InObject, InOutBuffer, InIsSceneComponent);
+			return;
+		}
+		const auto& ExcludeProperties = GetExcludeProperties(InIsSceneComponent);
+		auto& Reusable = ReusableObjectReader;
+		if (Reusable.bIsReading)//should not happen, but don't break the reader in use
+		{
+			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, *this, ExcludeProperties);
+			Reader.DoSerialize(InObject);
+			return;
+		}
+		if (!Reusable.Reader.IsValid())
+		{
+			Reusable.Reader = MakeUnique<LPrefabSystem::FLPrefabObjectReader>(Reusable.Buffer, *this, ExcludeProperties);
+		}
+		Reusable.Reader->ResetForObject(InOutBuffer, ExcludeProperties);
+		Reusable.bIsReading = true;
+		Reusable.Reader->DoSerialize(InObject);
+		Reusable.bIsReading = false;
+	}
+	void ActorSerializer::ApplyOverrideParameterData(UObject* InObject, TArray<uint8>& InOutBuffer, const TArray<FName>& InOverridePropertyNames)
+	{
+		if (WriterOrReaderFunctionForSubPrefabOverride)
+		{
+			WriterOrReaderFunctionForSubPrefabOverride(InObject, InOutBuffer, InOverridePropertyNames);
+			return;
+		}
+		LPrefabSystem::FLPrefabOverrideParameterObjectReader Reader(InOutBuffer, *this, InOverridePropertyNames);
+		if (bTargetedOverrideParameter)
+		{
+			Reader.DoSerializeTargeted(InObject);
+		}
+		else
+		{
+			Reader.DoSerialize(InObject);
+		}
+	}
+
+	bool ActorSerializer::CanRegisterComponentsOnce(UWorld* InWorld)
+	{
+		return InWorld->IsGameWorld() && CVarLPrefabRegisterComponentsOnce.GetValueOnGameThread() != 0;
+	}
 
+	void ActorSerializer::PostSetPropertiesBeforeRegister(UActorComponent* Comp)
+	{
+		if (auto PrimitiveComp = Cast<UPrimitiveComponent>(Comp))
+		{
+			//fix collision data. this is same as UPrimitiveComponent.UpdateCollisionProfile
+			{
+				PrimitiveComp->BodyInstance.LoadProfileData(false);
+			}
+			if (auto SplineComp = Cast<USplineComponent>(Comp))
+			{
+				SplineComp->UpdateSpline();
+			}
+		}
+	}
+
+	void ActorSerializer::PostSetPropertiesOnActor(UActorComponent* Comp)
+	{
+		//here two methods to apply the deserialized data to component
+#if 0//This method is simple and robust because it use built-in funtion. But also performance-cost (about 1.5-2.0x time cost to the whole deserialize process), because a lot of unnecessary properties are set here
+		auto CompInstanceData = Comp->GetComponentInstanceData();
+		CompInstanceData->ApplyToComponent(Comp, ECacheApplyPhase::PostUserConstructionScript);
+#else//In this method I search all "ApplyToComponent" function and get the important part (I think), so result may miss something, if it does then contact me and I will add the missing part
+		PostSetPropertiesBeforeRegister(Comp);
+		Comp->ReregisterComponent();
+#endif
+	}
+
+#define LPREFAB_LOG_DETAIL_TIME 0
+	AActor* ActorSerializer::DeserializeActorFromData(const FLPrefabSaveData& SaveData, USceneComponent* Parent, bool ReplaceTransform, FVector InLocation, FQuat InRotation, FVector InScale)
+	{
+		BeginDeserializeActorFromData(SaveData, Parent, ReplaceTransform, InLocation, InRotation, InScale);
+		while (!StepDeserialize(MAX_dbl))
+		{
+		}
+		return DeserializeState.CreatedRootActor;
+	}
+
+	void ActorSerializer::BeginDeserializeActorFromData(const FLPrefabSaveData& SaveData, USceneComponent* Parent, bool ReplaceTransform, FVector InLocation, FQuat InRotation, FVector InScale)
+	{
+		auto& State = DeserializeState;
+		State.SaveData = &SaveData;
+		bDeltaAgainstArchetype = SaveData.bDeltaAgainstArchetype;//reader must use the same property serialization as writer
+		bTargetedOverrideParameter = SaveData.bTargetedOverrideParameter;
+		bTaggedPropertyData = SaveData.bTaggedPropertyData;
+		State.Parent = Parent;
+		State.ReplaceTransform = ReplaceTransform;
+		State.Location = InLocation;
+		State.Rotation = InRotation;
+		State.Scale = InScale;
+		State.Step = EDeserializeStep::GenerateActors;
+		State.Cursor = 0;
+		State.CreatedRootActor = nullptr;
 #if LPREFAB_LOG_DETAIL_TIME
-		UE_LOG(LPrefab, Log, TEXT("--Call Awake (and OnEnable) take time: %fms"), (FDateTime::Now() - Time).GetTotalMilliseconds());
+		State.StepStartTime = FDateTime::Now();
 #endif
+		//size containers once from saved counts, so they don't regrow while generating objects. Reserve do nothing if already large enough (eg: sub prefab)
+		MapGuidToObject.Reserve(MapGuidToObject.Num() + SaveData.SavedObjectData.Num());
+		MapObjectToOriginGuid.Reserve(MapObjectToOriginGuid.Num() + SaveData.SavedObjectData.Num());
+		AllActors.Reserve(AllActors.Num() + SaveData.SavedActors.Num());
+		AllComponents.Reserve(AllComponents.Num() + SaveData.SavedObjects.Num());
+		ComponentsInThisPrefab.Reserve(SaveData.SavedObjects.Num());
+		if (LPrefabManager == nullptr)
+		{
+			LPrefabManager = ULPrefabWorldSubsystem::GetInstance(TargetWorld);
+		}
+		if (!bIsSubPrefab)
+		{
+			bRegisterComponentsOnce = CanRegisterComponentsOnce(TargetWorld);
+			bRootTransformSetBeforeRegister = false;
+			if (!DeserializationSessionId.IsValid())
+			{
+				DeserializationSessionId = FGuid::NewGuid();
+				LPrefabManager->BeginPrefabSystemProcessingActor(DeserializationSessionId);
+			}
+		}
+	}
+
+	bool ActorSerializer::StepDeserialize(double InDeadline)
+	{
+		auto& State = DeserializeState;
+		auto& SaveData = *State.SaveData;
+		SCOPE_CYCLE_COUNTER(STAT_LPrefab_Deserialize);
+		TRACE_CPUPROFILER_EVENT_SCOPE(LPrefab.Deserialize);//static name, time sliced load resume this many times
+		//at least one unit of work is done before check the deadline, so the load will always go forward
+		auto IsOverBudget = [InDeadline] {
+			return InDeadline != MAX_dbl && FPlatformTime::Seconds() >= InDeadline;
+		};
+		auto GotoStep = [&State](EDeserializeStep InStep) {
+#if LPREFAB_LOG_DETAIL_TIME
+			UE_LOG(LPrefab, Log, TEXT("--Step %d take time: %fms"), (int)State.Step, (FDateTime::Now() - State.StepStartTime).GetTotalMilliseconds());
+			State.StepStartTime = FDateTime::Now();
+#endif
+			State.Step = InStep;
+			State.Cursor = 0;
+		};
+
+		while (State.Step != EDeserializeStep::Done)
+		{
+			switch (State.Step)
+			{
+			case EDeserializeStep::GenerateActors:
+			{
+				SCOPE_CYCLE_COUNTER(STAT_LPrefab_GenerateActors);
+				TRACE_CPUPROFILER_EVENT_SCOPE(LPrefab.GenerateActors);
+				while (State.Cursor < SaveData.SavedActors.Num())
+				{
+					auto& ActorData = SaveData.SavedActors[State.Cursor];
+					if (ActorData.bIsPrefab && ActorData.bDeferLoad && bCanDeferSubPrefab && State.Cursor != 0)
+					{
+						GenerateDeferredSubPrefab(ActorData, State.Cursor);
+					}
+					else if (ActorData.bIsPrefab)
+					{
+						if (!State.SubPrefabContext.IsValid())
+						{
+							BeginGenerateSubPrefab(ActorData, State.Cursor);
+						}
+						if (State.SubPrefabContext.IsValid())//not valid if sub prefab asset is missing
+						{
+							if (!State.SubPrefabContext->Serializer->StepDeserialize(InDeadline))
+							{
+								return false;//sub prefab is not finished, continue it in next step
+							}
+							FinishGenerateSubPrefab(ActorData);
+						}
+					}
+					else
+					{
+						GenerateActor(ActorData, State.Cursor, FGuid());
+					}
+					State.Cursor++;
+					if (IsOverBudget())return false;
+				}
+				if (State.CreatedRootActor == nullptr)
+				{
+					UE_LOG(LPrefab, Error, TEXT("[%s].%d No actor generated!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
 
-		return CreatedRootActor;
+					if (!bIsSubPrefab)
+					{
+						check(DeserializationSessionId.IsValid());
+						LPrefabManager->EndPrefabSystemProcessingActor(DeserializationSessionId);
+					}
+					GotoStep(EDeserializeStep::Done);
+					break;
+				}
+				GotoStep(EDeserializeStep::GenerateObjects);
+			}
+			break;
+			case EDeserializeStep::GenerateObjects:
+			{
+				SCOPE_CYCLE_COUNTER(STAT_LPrefab_GenerateObjects);
+				TRACE_CPUPROFILER_EVENT_SCOPE(LPrefab.GenerateObjects);
+				while (State.Cursor < SaveData.SavedObjects.Num())
+				{
+					auto& ObjectData = SaveData.SavedObjects[State.Cursor];
+					GenerateObject(ObjectData.ObjectGuid, ObjectData);
+					State.Cursor++;
+					if (IsOverBudget())return false;
+				}
+				GotoStep(EDeserializeStep::ApplyProperties);
+			}
+			break;
+			case EDeserializeStep::ApplyProperties:
+			{
+				SCOPE_CYCLE_COUNTER(STAT_LPrefab_ApplyProperties);
+				TRACE_CPUPROFILER_EVENT_SCOPE(LPrefab.ApplyProperties);
+				if (State.Cursor == 0)
+				{
+					BuildObjectIndexTable(SaveData);//all objects are created, now object reference can be resolved by index
+				}
+				while (State.Cursor < SaveData.SavedObjectData.Num())
+				{
+					auto& ObjectData = SaveData.SavedObjectData[State.Cursor];
+					UObject* Object = ObjectsByIndex.IsValidIndex(ObjectData.ObjectIndex) ? ObjectsByIndex[ObjectData.ObjectIndex] : MapGuidToObject.FindRef(ObjectData.ObjectGuid).Get();
+					if (Object != nullptr)
+					{
+						TArray<FName> UnresolvedProperties;
+						UnresolvedObjectReferenceProperties = DeferredSubPrefabScope.IsValid() ? &UnresolvedProperties : nullptr;//reference to deferred sub prefab can't be resolved now
+						ApplyObjectData(Object, const_cast<TArray<uint8>&>(ObjectData.Data), Cast<USceneComponent>(Object) != nullptr);//reader only read the buffer, so shared SaveData stay unchanged
+						UnresolvedObjectReferenceProperties = nullptr;
+						if (UnresolvedProperties.Num() > 0)
+						{
+							auto& UnresolvedItem = DeferredSubPrefabScope->UnresolvedObjectDatas.AddDefaulted_GetRef();
+							UnresolvedItem.Object = Object;
+							UnresolvedItem.Data = &ObjectData.Data;
+							UnresolvedItem.PropertyNames = MoveTemp(UnresolvedProperties);
+						}
+						if (ApplyRecord != nullptr)
+						{
+							auto& RecordItem = ApplyRecord->ObjectDatas.AddDefaulted_GetRef();
+							RecordItem.ScopeIndex = ApplyRecordScopeIndex;
+							RecordItem.Object = Object;
+							RecordItem.Data = &ObjectData.Data;
+						}
+					}
+					State.Cursor++;
+					if (IsOverBudget())return false;
+				}
+				GotoStep(EDeserializeStep::ApplyOverrideParameters);
+			}
+			break;
+			case EDeserializeStep::ApplyOverrideParameters:
+			{
+				SCOPE_CYCLE_COUNTER(STAT_LPrefab_ApplyOverrideParameters);
+				TRACE_CPUPROFILER_EVENT_SCOPE(LPrefab.ApplyOverrideParameters);
+				//sub prefab override properties
+				while (State.Cursor < SubPrefabOverrideParameters.Num())
+				{
+					auto& Item = SubPrefabOverrideParameters[State.Cursor];
+					TArray<FName> UnresolvedProperties;
+					UnresolvedObjectReferenceProperties = DeferredSubPrefabScope.IsValid() ? &UnresolvedProperties : nullptr;
+					ApplyOverrideParameterData(Item.Object, Item.ParameterDatas, Item.ParameterNames);
+					UnresolvedObjectReferenceProperties = nullptr;
+					if (UnresolvedProperties.Num() > 0)
+					{
+						auto& UnresolvedItem = DeferredSubPrefabScope->UnresolvedObjectDatas.AddDefaulted_GetRef();
+						UnresolvedItem.Object = Item.Object;
+						UnresolvedItem.OverrideData = Item.ParameterDatas;
+						UnresolvedItem.OverrideNames = Item.ParameterNames;
+						UnresolvedItem.bIsOverrideParameter = true;
+						UnresolvedItem.PropertyNames = MoveTemp(UnresolvedProperties);
+					}
+					if (ApplyRecord != nullptr)
+					{
+						auto& RecordItem = ApplyRecord->ObjectDatas.AddDefaulted_GetRef();
+						RecordItem.ScopeIndex = ApplyRecordScopeIndex;
+						RecordItem.Object = Item.Object;
+						RecordItem.OverrideData = Item.ParameterDatas;
+						RecordItem.OverrideNames = Item.ParameterNames;
+						RecordItem.bIsOverrideParameter = true;
+					}
+					State.Cursor++;
+					if (IsOverBudget())return false;
+				}
+				GotoStep(EDeserializeStep::AttachComponents);
+			}
+			break;
+			case EDeserializeStep::AttachComponents:
+			{
+				SCOPE_CYCLE_COUNTER(STAT_LPrefab_AttachComponents);
+				TRACE_CPUPROFILER_EVENT_SCOPE(LPrefab.AttachComponents);
+				//component attachment
+				while (State.Cursor < ComponentsInThisPrefab.Num())
+				{
+					AttachComponent(ComponentsInThisPrefab[State.Cursor]);
+					State.Cursor++;
+					if (IsOverBudget())return false;
+				}
+				for (auto& CompData : SubPrefabRootComponents)
+				{
+					auto SceneComp = (USceneComponent*)CompData.Component;
+					if (auto ParentObjectPtr = MapGuidToObject.Find(CompData.SceneComponentParentGuid))
+					{
+						if (auto ParentComp = Cast<USceneComponent>(*ParentObjectPtr))
+						{
+							if (SceneComp->IsRegistered())
+							{
+								SceneComp->AttachToComponent(ParentComp, FAttachmentTransformRules::KeepRelativeTransform);
+							}
+							else
+							{
+								SceneComp->SetupAttachment(ParentComp);
+							}
+						}
+					}
+				}
+				if (bIsSubPrefab)
+				{
+					GotoStep(EDeserializeStep::Finish);//sub-prefab's re-register should handle in parent after all override property
+				}
+				else
+				{
+					GotoStep(bRegisterComponentsOnce ? EDeserializeStep::RegisterComponents : EDeserializeStep::PostSetProperties);
+				}
+			}
+			break;
+			case EDeserializeStep::PostSetProperties:
+			{
+				SCOPE_CYCLE_COUNTER(STAT_LPrefab_PostSetProperties);
+				TRACE_CPUPROFILER_EVENT_SCOPE(LPrefab.PostSetProperties);
+				//mark component reregister to use new property value
+				while (State.Cursor < AllComponents.Num())
+				{
+					PostSetPropertiesOnActor(AllComponents[State.Cursor]);
+					State.Cursor++;
+					if (IsOverBudget())return false;
+				}
+				GotoStep(EDeserializeStep::Finish);
+			}
+			break;
+			case EDeserializeStep::RegisterComponents:
+			{
+				SCOPE_CYCLE_COUNTER(STAT_LPrefab_RegisterComponents);
+				TRACE_CPUPROFILER_EVENT_SCOPE(LPrefab.RegisterComponents);
+				//all properties are applied and attachment tree is ready, register every component once
+				if (State.Cursor == 0)
+				{
+					PrepareRegisterComponents();
+				}
+				while (State.Cursor < ComponentsToRegister.Num())
+				{
+					auto Comp = ComponentsToRegister[State.Cursor];
+					if (IsValid(Comp) && !Comp->IsRegistered())
+					{
+						Comp->RegisterComponent();
+					}
+					State.Cursor++;
+					if (IsOverBudget())return false;
+				}
+				ComponentsToRegister.Empty();
+				GotoStep(EDeserializeStep::Finish);
+			}
+			break;
+			case EDeserializeStep::Finish:
+			{
+				SCOPE_CYCLE_COUNTER(STAT_LPrefab_FinishDeserialize);
+				TRACE_CPUPROFILER_EVENT_SCOPE(LPrefab.FinishDeserialize);
+				FinishDeserialize();
+				GotoStep(EDeserializeStep::Done);
+			}
+			break;
+			case EDeserializeStep::Done:
+				break;
+			}
+		}
+
+		if (State.Prefab != nullptr)
+		{
+			EndDeserializeActor();
+		}
+		return true;
 	}
-	AActor* ActorSerializer::DeserializeActor(USceneComponent* Parent, ULPrefab* InPrefab, const TFunction<void()>& InCallbackBeforeDeserialize, bool ReplaceTransform, FVector InLocation, FQuat InRotation, FVector InScale)
+
+	void ActorSerializer::AttachComponent(const FComponentDataStruct& CompData)
+	{
+		if (auto SceneComp = Cast<USceneComponent>(CompData.Component))
+		{
+			if (CompData.SceneComponentParentGuid.IsValid())
+			{
+				USceneComponent* ParentComp = nullptr;
+				auto ParentObjectPtr = MapGuidToObject.Find(CompData.SceneComponentParentGuid);
+				if (ParentObjectPtr != nullptr)
+				{
+					ParentComp = Cast<USceneComponent>(*ParentObjectPtr);
+				}
+				if (!ParentComp)
+				{
+					if (DeferredSubPrefabScope.IsValid())
+					{
+						//parent may be inside deferred sub prefab, attach it again after realize
+						auto& PendingItem = DeferredSubPrefabScope->PendingAttachments.AddDefaulted_GetRef();
+						PendingItem.Component = SceneComp;
+						PendingItem.ParentGuid = CompData.SceneComponentParentGuid;
+					}
+#if WITH_EDITOR
+					else if (TargetWorld != ULPrefabManagerObject::GetPreviewWorldForPrefabPackage())//skip preview world, only show this in PrefabEditor or LevelEditor
+					{
+						auto MissingParentMsg = FText::Format(LOCTEXT("MissingParentMsg", "Prefab '{0}' fail to find parent for component '{1}.{2}', do you delete it? The component will attach to root")
+							, FText::FromString(PrefabAssetPath), FText::FromString(SceneComp->GetOwner()->GetActorLabel()), FText::FromString(SceneComp->GetName()));
+						LPrefabUtils::EditorNotification(MissingParentMsg, 10);
+						UE_LOG(LPrefab, Error, TEXT("[%s].%d %s"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *MissingParentMsg.ToString());
+					}
+#endif
+					ParentComp = DeserializeState.CreatedRootActor->GetRootComponent();
+				}
+				if (SceneComp->IsRegistered())
+				{
+					SceneComp->AttachToComponent(ParentComp, FAttachmentTransformRules::KeepRelativeTransform);
+				}
+				else
+				{
+					SceneComp->SetupAttachment(ParentComp);
+				}
+
+			}
+		}
+		if (!bRegisterComponentsOnce && !CompData.Component->IsRegistered())
+		{
+			CompData.Component->RegisterComponent();
+		}
+	}
+
+	void ActorSerializer::PrepareRegisterComponents()
+	{
+		auto& State = DeserializeState;
+		//root is attached and placed before register, so its transform is calculated only once
+		if (State.CreatedRootActor != nullptr)
+		{
+			auto RootComp = State.CreatedRootActor->GetRootComponent();
+			if (RootComp != nullptr && !RootComp->IsRegistered())
+			{
+				if (IsValid(State.Parent))
+				{
+					RootComp->SetupAttachment(State.Parent);
+				}
+				if (State.ReplaceTransform)
+				{
+					RootComp->SetRelativeLocation_Direct(State.Location);
+					RootComp->SetRelativeRotation_Direct(State.Rotation.Rotator());
+					RootComp->SetRelativeScale3D_Direct(State.Scale);
+				}
+				bRootTransformSetBeforeRegister = true;
+			}
+		}
+		for (auto Comp : AutoRegisterDisabledComponents)
+		{
+			Comp->bAutoRegister = true;
+		}
+
+		//parent must register before child, so child can get parent's transform when register. non-scene component goes last
+		struct FComponentToRegister
+		{
+			UActorComponent* Component;
+			int32 Depth;
+		};
+		//these containers only live in this function, use frame arena to avoid heap allocation. Reserved up front, so they never grow after other marks
+		FMemMark Mark(FMemStack::Get());
+		TArray<FComponentToRegister, TMemStackAllocator<>> SortedComponents;
+		SortedComponents.Reserve(AllComponents.Num() + AutoRegisterDisabledComponents.Num());
+		TSet<UActorComponent*, DefaultKeyFuncs<UActorComponent*>, TSetAllocator<TSparseArrayAllocator<TMemStackAllocator<>, TMemStackAllocator<>>, TMemStackAllocator<>>> AddedComponents;
+		AddedComponents.Reserve(SortedComponents.Max());
+		auto AddComponent = [&SortedComponents, &AddedComponents](UActorComponent* InComp) {
+			bool bAlreadyAdded = false;
+			AddedComponents.Add(InComp, &bAlreadyAdded);
+			if (bAlreadyAdded)return;
+			int32 Depth = MAX_int32;
+			if (auto SceneComp = Cast<USceneComponent>(InComp))
+			{
+				Depth = 0;
+				for (auto AttachParent = SceneComp->GetAttachParent(); AttachParent != nullptr; AttachParent = AttachParent->GetAttachParent())
+				{
+					Depth++;
+				}
+			}
+			SortedComponents.Add({ InComp, Depth });
+		};
+		for (auto Comp : AutoRegisterDisabledComponents)
+		{
+			AddComponent(Comp);
+		}
+		for (auto Comp : AllComponents)
+		{
+			AddComponent(Comp);
+		}
+		AutoRegisterDisabledComponents.Empty();
+		SortedComponents.StableSort([](const FComponentToRegister& A, const FComponentToRegister& B) {
+			return A.Depth < B.Depth;
+			});
+
+		ComponentsToRegister.Reset(SortedComponents.Num());
+		for (auto& Item : SortedComponents)
+		{
+			//these are done by re-register in normal mode
+			PostSetPropertiesBeforeRegister(Item.Component);
+			ComponentsToRegister.Add(Item.Component);
+		}
+	}
+
+	void ActorSerializer::FinishDeserialize()
+	{
+		auto& State = DeserializeState;
+		auto CreatedRootActor = State.CreatedRootActor;
+		//attach root actor's parent. if already done before register, then skip it
+		USceneComponent* RootComp = CreatedRootActor->GetRootComponent();
+		if (RootComp != nullptr && !bRootTransformSetBeforeRegister)
+		{
+			if (IsValid(State.Parent))
+			{
+				RootComp->AttachToComponent(State.Parent, FAttachmentTransformRules::KeepRelativeTransform);
+			}
+			if (!bIsSubPrefab)//need to do this in root actor and it will propogate to children. If do this in subprefab and parent prefab override transform data on subprefab's actor, then transform goes wrong
+			{
+				RootComp->UpdateComponentToWorld();
+			}
+			if (State.ReplaceTransform)
+			{
+				RootComp->SetRelativeLocationAndRotation(State.Location, State.Rotation);
+				RootComp->SetRelativeScale3D(State.Scale);
+			}
+		}
+
+#if WITH_EDITOR
+		if (!bIsSubPrefab)//sub-prefab's RerunConstructionScripts should handle in parent after all override property, and after root actor attach to parent
+		{
+			if (!TargetWorld->IsGameWorld())
+			{
+				ULPrefabManagerObject::Deserialize_ProcessComponentsBeforeRerunConstructionScript.ExecuteIfBound(AllComponents);
+				//refresh it
+				for (auto& Actor : AllActors)
+				{
+					Actor->RerunConstructionScripts();
+					Actor->ReregisterAllComponents();
+				}
+			}
+		}
+#endif
+
+		if (DeferredSubPrefabScope.IsValid())
+		{
+			//deferred sub prefab can be realized from now on, even inside Awake
+			auto& ScopeMapGuidToObject = DeferredSubPrefabScope->MapGuidToObject;
+			ScopeMapGuidToObject.Reserve(MapGuidToObject.Num());
+			for (auto& KeyValue : MapGuidToObject)
+			{
+				ScopeMapGuidToObject.Add(KeyValue.Key, KeyValue.Value.Get());
+			}
+			DeferredSubPrefabScope->bLoadFinished = true;
+		}
+
+		if (OnSubPrefabFinishDeserializeFunction != nullptr)
+		{
+			OnSubPrefabFinishDeserializeFunction(CreatedRootActor, MapGuidToObject, MapObjectToOriginGuid, AllActors, AllComponents);
+		}
+		if (CallbackBeforeAwake != nullptr)
+		{
+			CallbackBeforeAwake(CreatedRootActor);
+		}
+
+		if (!bIsSubPrefab)
+		{
+			check(DeserializationSessionId.IsValid());
+			for (auto item : AllActors)
+			{
+				LPrefabManager->RemoveActorForPrefabSystem(item, DeserializationSessionId);
+			}
+			LPrefabManager->EndPrefabSystemProcessingActor(DeserializationSessionId);
+
+			//Awake is called after the whole hierarchy is ready, include all sub prefabs
+			if (bDispatchAwake)
+			{
+				if (!DispatchAwakeFromSaveData())
+				{
+					DispatchAwake(TargetWorld, AllActors);
+				}
+			}
+		}
+	}
+
+	void ActorSerializer::AddReferencedObjects(FReferenceCollector& Collector)
+	{
+		//objects created by the load may not referenced by anything before their properties are applied, so keep them alive when load across frames
+		for (auto& KeyValue : MapGuidToObject)
+		{
+			Collector.AddReferencedObject(KeyValue.Value);
+		}
+		Collector.AddReferencedObject(DeserializeState.Prefab);
+		Collector.AddReferencedObject(DeserializeState.Parent);
+		//soft references are loaded into these lists, nothing else keeps them alive
+		Collector.AddReferencedObjects(ReferenceAssetList);
+		Collector.AddReferencedObjects(ReferenceClassList);
+		if (DeserializeState.SubPrefabContext.IsValid())
+		{
+			Collector.AddReferencedObject(DeserializeState.SubPrefabContext->SubPrefabData.PrefabAsset);
+			DeserializeState.SubPrefabContext->Serializer->AddReferencedObjects(Collector);
+		}
+	}
+
+	void ActorSerializer::SetupForPrefab(ULPrefab* InPrefab)
 	{
-		auto StartTime = FDateTime::Now();
 		PrefabAssetPath = InPrefab->GetPathName();
 #if WITH_EDITOR
 		if (bIsEditorOrRuntime)
@@ -439,8 +1282,7 @@ namespace LPrefabSystem8
 #endif
 		{
 			//fill new reference data
-			this->ReferenceAssetList = InPrefab->ReferenceAssetListForBuild;
-			this->ReferenceClassList = InPrefab->ReferenceClassListForBuild;
+			InPrefab->GetReferenceListForBuild(this->ReferenceAssetList, this->ReferenceClassList);
 			this->ReferenceNameList = InPrefab->ReferenceNameListForBuild;
 
 			this->ArchiveVersion = FPackageFileVersion(InPrefab->ArchiveVersion_ForBuild, (EUnrealEngineObjectUE5Version)InPrefab->ArchiveVersionUE5_ForBuild);
@@ -448,59 +1290,146 @@ namespace LPrefabSystem8
 			this->ArEngineNetVer = InPrefab->ArEngineNetVer_ForBuild;
 			this->ArGameNetVer = InPrefab->ArGameNetVer_ForBuild;
 		}
+		if (ReplaceAssetMap != nullptr)
+		{
+			for (auto& Asset : this->ReferenceAssetList)
+			{
+				if (auto ReplaceAssetPtr = ReplaceAssetMap->Find(Asset))
+				{
+					Asset = *ReplaceAssetPtr;
+				}
+			}
+		}
+		if (ReplaceClassMap != nullptr)
+		{
+			for (auto& Class : this->ReferenceClassList)
+			{
+				if (auto ReplaceClassPtr = ReplaceClassMap->Find(Class))
+				{
+					Class = *ReplaceClassPtr;
+				}
+			}
+		}
 		this->PrefabVersion = InPrefab->PrefabVersion;
 		this->ArEngineVer = FEngineVersionBase(InPrefab->EngineMajorVersion, InPrefab->EngineMinorVersion, InPrefab->EnginePatchVersion);
+	}
 
-		FLPrefabSaveData SaveData;
+	AActor* ActorSerializer::DeserializeActor(USceneComponent* Parent, ULPrefab* InPrefab, const TFunction<void()>& InCallbackBeforeDeserialize, bool ReplaceTransform, FVector InLocation, FQuat InRotation, FVector InScale)
+	{
+		BeginDeserializeActor(Parent, InPrefab, InCallbackBeforeDeserialize, ReplaceTransform, InLocation, InRotation, InScale);
+		while (!StepDeserialize(MAX_dbl))
 		{
-			auto& LoadedData =
-#if WITH_EDITOR
-				bIsEditorOrRuntime ? InPrefab->BinaryData :
-#endif
-				InPrefab->BinaryDataForBuild;
+		}
+		return DeserializeState.CreatedRootActor;
+	}
 
-			auto FromBinary = FMemoryReader(LoadedData, false);
-#if WITH_EDITOR
-			if (bIsEditorOrRuntime)
-			{
-				FStructuredArchiveFromArchive(FromBinary).GetSlot() << SaveData;
-			}
-			else
+	void ActorSerializer::BeginDeserializeActor(USceneComponent* Parent, ULPrefab* InPrefab, const TFunction<void()>& InCallbackBeforeDeserialize, bool ReplaceTransform, FVector InLocation, FQuat InRotation, FVector InScale)
+	{
+		DeserializeState.StartTime = FDateTime::Now();
+		DeserializeState.Prefab = InPrefab;
+		SetupForPrefab(InPrefab);
+
+		//hold a reference, so the data is still valid even if prefab's cache is cleared during load
+		DeserializeState.SharedSaveData = GivenSaveData.IsValid() ? GivenSaveData : InPrefab->GetParsedSaveData(bIsEditorOrRuntime);
+#if !UE_BUILD_SHIPPING
+		if (!bIsEditorOrRuntime && DeserializeState.SharedSaveData->bDeltaAgainstArchetype && ReplaceClassMap == nullptr)
+		{
+			InPrefab->CheckArchetypeHashForBuild(this->ReferenceClassList);
+		}
 #endif
-			{
-				FromBinary << SaveData;
-			}
+		if (ApplyRecord != nullptr)
+		{
+			ApplyRecordScopeIndex = ApplyRecord->Scopes.AddDefaulted();
+			ApplyRecord->Scopes[ApplyRecordScopeIndex].Prefab = InPrefab;
+			ApplyRecord->Scopes[ApplyRecordScopeIndex].SaveData = DeserializeState.SharedSaveData;
 		}
 
 		if (InCallbackBeforeDeserialize != nullptr)InCallbackBeforeDeserialize();
-		auto CreatedRootActor = DeserializeActorFromData(SaveData, Parent, ReplaceTransform, InLocation, InRotation, InScale);
+		BeginDeserializeActorFromData(*DeserializeState.SharedSaveData, Parent, ReplaceTransform, InLocation, InRotation, InScale);
+	}
+
+	void ActorSerializer::EndDeserializeActor()
+	{
+		if (ApplyRecord != nullptr)
+		{
+			auto& ScopeMapGuidToObject = ApplyRecord->Scopes[ApplyRecordScopeIndex].MapGuidToObject;
+			for (auto& KeyValue : MapGuidToObject)
+			{
+				ScopeMapGuidToObject.Add(KeyValue.Key, KeyValue.Value.Get());
+			}
+		}
 
 		if (ULPrefabSettings::GetLogPrefabLoadTime())
 		{
-			auto TimeSpan = FDateTime::Now() - StartTime;
-			UE_LOG(LPrefab, Log, TEXT("Load prefab: '%s', total time: %fms"), *InPrefab->GetName(), TimeSpan.GetTotalMilliseconds());
+			auto TimeSpan = FDateTime::Now() - DeserializeState.StartTime;
+			if (DeferredSubPrefabCount > 0)
+			{
+				UE_LOG(LPrefab, Log, TEXT("Load prefab: '%s', total time: %fms, deferred sub prefab: %d"), *DeserializeState.Prefab->GetName(), TimeSpan.GetTotalMilliseconds(), DeferredSubPrefabCount);
+			}
+			else
+			{
+				UE_LOG(LPrefab, Log, TEXT("Load prefab: '%s', total time: %fms"), *DeserializeState.Prefab->GetName(), TimeSpan.GetTotalMilliseconds());
+			}
 		}
 
 #if WITH_EDITOR
 		ULPrefabManagerObject::MarkBroadcastLevelActorListChanged();//UE5 will not auto refresh scene outliner and display actor label, so manually refresh it.
 #endif
-
-		return CreatedRootActor;
 	}
 
+	TSharedPtr<const FLPrefabSaveData, ESPMode::ThreadSafe> ActorSerializer::ParseSaveData(ULPrefab* InPrefab, bool InForEditorOrRuntimeUse)
+	{
+		TArray<uint8> BuildDataStorage;//build data loaded from disk, released after parse
+		auto& LoadedData =
+#if WITH_EDITOR
+			InForEditorOrRuntimeUse ? InPrefab->BinaryData :
+#endif
+			InPrefab->GetBinaryDataForBuild(BuildDataStorage);
+		return ParseSaveData(LoadedData, InForEditorOrRuntimeUse, InForEditorOrRuntimeUse ? InPrefab->PrefabVersion : InPrefab->GetBuildDataLayoutVersion());
+	}
 
+	TSharedPtr<const FLPrefabSaveData, ESPMode::ThreadSafe> ActorSerializer::ParseSaveData(const TArray<uint8>& InData, bool InForEditorOrRuntimeUse, uint16 InDataVersion)
+	{
+		LPREFAB_TRACE_SCOPE_TEXT(TEXT("LPrefab.ParseSaveData bytes: %d"), InData.Num());
+		auto SaveData = MakeShared<FLPrefabSaveData, ESPMode::ThreadSafe>();
+		auto FromBinary = FMemoryReader(InData, false);
+#if WITH_EDITOR
+		if (InForEditorOrRuntimeUse)
+		{
+			SaveData->Serialize(FStructuredArchiveFromArchive(FromBinary).GetSlot(), InDataVersion);
+		}
+		else
+#endif
+		if (InDataVersion >= (uint16)ELPrefabVersion::CompactBuildData)
+		{
+			SaveData->SerializeCompact(FromBinary, InDataVersion);
+		}
+		else
+		{
+			SaveData->Serialize(FromBinary, InDataVersion);
+		}
+		return SaveData;
+	}
 
+	void ActorSerializer::BuildObjectIndexTable(const FLPrefabSaveData& InSaveData)
+	{
+		ObjectsByIndex.SetNumUninitialized(InSaveData.ObjectGuids.Num());
+		for (int i = 0; i < InSaveData.ObjectGuids.Num(); i++)
+		{
+			ObjectsByIndex[i] = MapGuidToObject.FindRef(InSaveData.ObjectGuids[i]);
+		}
+	}
 
-	void ActorSerializer::GenerateObjectArray(TMap<FGuid, FLGUIObjectSaveData>& SavedObjects, TMap<FGuid, FGuid>& MapSceneComponentToParent)
+	void ActorSerializer::GenerateObject(const FGuid& ObjectGuid, const FLGUIObjectSaveData& ObjectData)
 	{
-		auto CollectDefaultSubobjects = [&](UObject* Target, const FGuid& TargetGuid, FLGUICommonObjectSaveData& ObjectData) {
+		auto CollectDefaultSubobjects = [&](UObject* Target, const FGuid& TargetGuid, const FLGUICommonObjectSaveData& InObjectData) {
 			//collect default sub object
 			TArray<UObject*> DefaultSubObjects;
 			Target->CollectDefaultSubobjects(DefaultSubObjects);
 			for (auto DefaultSubObject : DefaultSubObjects)
 			{
 				if (DefaultSubObject->HasAnyFlags(EObjectFlags::RF_Transient))continue;
-				auto Index = ObjectData.DefaultSubObjectNameArray.IndexOfByKey(DefaultSubObject->GetFName());
+				auto Index = InObjectData.DefaultSubObjectNameArray.IndexOfByKey(DefaultSubObject->GetFName());
 				if (Index == INDEX_NONE)
 				{
 #if WITH_EDITOR
@@ -513,320 +1442,328 @@ namespace LPrefabSystem8
 					UE_LOG(LPrefab, Warning, TEXT("[%s].%d Missing guid for default sub object: %s"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(DefaultSubObject->GetFName().ToString()));
 					continue;
 				}
-				auto DefaultSubObjectGuid = ObjectData.DefaultSubObjectGuidArray[Index];
+				auto DefaultSubObjectGuid = InObjectData.DefaultSubObjectGuidArray[Index];
 				MapGuidToObject.Add(DefaultSubObjectGuid, DefaultSubObject);
 				MapObjectToOriginGuid.Add(DefaultSubObject, DefaultSubObjectGuid);
 			}
 		};
-		for (auto& KeyValuePair : SavedObjects)
-		{
-			auto& ObjectGuid = KeyValuePair.Key;
-			auto& ObjectData = KeyValuePair.Value;
-			UObject* CreatedNewObject = nullptr;
+		UObject* CreatedNewObject = nullptr;
 #if WITH_EDITOR
-			//MapGuidToObject can passed from LoadPrefabWithExistingObjects, so we need to find from map first. This only needed in editor, because runtime never use LoadPrefabWithExistingObjects
-			if (auto ObjectPtr = MapGuidToObject.Find(ObjectGuid))
+		//MapGuidToObject can passed from LoadPrefabWithExistingObjects, so we need to find from map first. This only needed in editor, because runtime never use LoadPrefabWithExistingObjects
+		if (auto ObjectPtr = MapGuidToObject.Find(ObjectGuid))
+		{
+			CreatedNewObject = *ObjectPtr;
+			MapObjectToOriginGuid.Add(CreatedNewObject, ObjectGuid);
+			CollectDefaultSubobjects(CreatedNewObject, ObjectGuid, ObjectData);
+		}
+		else
+#endif
+		{
+			if (auto ObjectClass = FindClassFromListByIndex(ObjectData.ObjectClass))
 			{
-				CreatedNewObject = *ObjectPtr;
-				MapObjectToOriginGuid.Add(CreatedNewObject, ObjectGuid);
-				CollectDefaultSubobjects(CreatedNewObject, ObjectGuid, ObjectData);
+				if (ObjectClass->IsChildOf(AActor::StaticClass()))
+				{
+					UE_LOG(LPrefab, Warning, TEXT("[%s].%d Wrong object class: '%s'. Prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(ObjectClass->GetFName().ToString()), *PrefabAssetPath);
+					return;
+				}
+
+				if (auto OuterObjectPtr = MapGuidToObject.Find(ObjectData.OuterObjectGuid))
+				{
+					CreatedNewObject = NewObject<UObject>(*OuterObjectPtr, ObjectClass, ObjectData.ObjectName, (EObjectFlags)ObjectData.ObjectFlags);
+					MapGuidToObject.Add(ObjectGuid, CreatedNewObject);
+					MapObjectToOriginGuid.Add(CreatedNewObject, ObjectGuid);
+					CollectDefaultSubobjects(CreatedNewObject, ObjectGuid, ObjectData);
+				}
+				else
+				{
+					UE_LOG(LPrefab, Warning, TEXT("[%s].%d Missing Outer object when creating object: '%s'. Prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(ObjectData.ObjectName.ToString()), *PrefabAssetPath);
+					return;
+				}
 			}
-			else
+		}
+		if (auto CreatedNewComponent = Cast<UActorComponent>(CreatedNewObject))
+		{
+			FComponentDataStruct CompData;
+			CompData.Component = CreatedNewComponent;
+			CompData.SceneComponentParentGuid = ObjectData.SceneComponentParentGuid;
+			ComponentsInThisPrefab.Add(CompData);
+			AllComponents.Add(CreatedNewComponent);
+		}
+	}
+
+	void ActorSerializer::BeginGenerateSubPrefab(const FLGUIActorSaveData& InActorData, int32 InActorIndex)
+	{
+		auto PrefabIndex = InActorData.PrefabAssetIndex;
+		auto SubPrefabAsset = Cast<ULPrefab>(FindAssetFromListByIndex(PrefabIndex));
+		if (SubPrefabAsset == nullptr)return;
+
+		auto Context = MakeShared<FSubPrefabLoadContext>();
+		Context->ActorData = &InActorData;
+		Context->ActorIndex = InActorIndex;
+		Context->SubPrefabData.PrefabAsset = SubPrefabAsset;
+#if WITH_EDITOR
+		Context->SubPrefabData.bDeferLoad = InActorData.bDeferLoad;
+#endif
+
+#if WITH_EDITOR
+		if (SubPrefabAsset->PrefabVersion < (uint16)ELPrefabVersion::NewObjectOnNestedPrefab)
+		{
+			SubPrefabAsset->RecreatePrefab();//if is old version then recreate to make it new version
+		}
 #endif
+		auto& SubMapGuidToObject = Context->SubPrefabData.MapGuidToObject;
+		for (auto& KeyValue : InActorData.MapObjectGuidFromParentPrefabToSubPrefab)
+		{
+			Context->MapObjectGuidFromSubPrefabToParentPrefab.Add(KeyValue.Value, KeyValue.Key);
+		}
+#if WITH_EDITOR
+		//edit mode must check if the object already exist, because the deserialize process could happen when use revert-prefab
+		if (bIsEditorOrRuntime)
+		{
+			for (auto& KeyValue : Context->MapObjectGuidFromSubPrefabToParentPrefab)
 			{
-				if (auto ObjectClass = FindClassFromListByIndex(ObjectData.ObjectClass))
+				auto ObjectPtr = MapGuidToObject.Find(KeyValue.Value);
+				if (!SubMapGuidToObject.Contains(KeyValue.Key) && ObjectPtr != nullptr)
 				{
-					if (ObjectClass->IsChildOf(AActor::StaticClass()))
-					{
-						UE_LOG(LPrefab, Warning, TEXT("[%s].%d Wrong object class: '%s'. Prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(ObjectClass->GetFName().ToString()), *PrefabAssetPath);
-						continue;
-					}
+					SubMapGuidToObject.Add(KeyValue.Key, *ObjectPtr);
+				}
+			}
+		}
+#endif
+		//SaveData is shared by all loads of this prefab, so copy the map before adding new id
+		Context->MapObjectIdToNewlyCreatedId = InActorData.MapObjectIdToNewlyCreatedId;
 
-					if (auto OuterObjectPtr = MapGuidToObject.Find(ObjectData.OuterObjectGuid))
+		auto ContextPtr = &Context.Get();
+		auto NewOnSubPrefabFinishDeserializeFunction =
+			[this, ContextPtr](AActor*, const TMap<FGuid, TObjectPtr<UObject>>& InSubPrefabMapGuidToObject, const TMap<TObjectPtr<UObject>, FGuid>& InMapObjectToOriginGuid, const TArray<AActor*>& InSubActors, const TArray<UActorComponent*>& InSubComponents) {
+			auto& ActorData = *ContextPtr->ActorData;
+			auto& SubPrefabData = ContextPtr->SubPrefabData;
+			auto GetObjectGuidInParent = [&](const FGuid& GuidInSubPrefab, const FGuid& GuidInOriginPrefab) {
+				FGuid GuidInParent;
+				auto ObjectGuidInParentPrefabPtr = ContextPtr->MapObjectGuidFromSubPrefabToParentPrefab.Find(GuidInSubPrefab);
+				if (ObjectGuidInParentPrefabPtr == nullptr)
+				{
+					auto UniqueId = FLGUISubPrefabObjectUniqueIdSaveData{ ActorData.ActorGuid, GuidInOriginPrefab };
+					if (auto GuidInParentPtr = ContextPtr->MapObjectIdToNewlyCreatedId.Find(UniqueId))
 					{
-						CreatedNewObject = NewObject<UObject>(*OuterObjectPtr, ObjectClass, ObjectData.ObjectName, (EObjectFlags)ObjectData.ObjectFlags);
-						MapGuidToObject.Add(ObjectGuid, CreatedNewObject);
-						MapObjectToOriginGuid.Add(CreatedNewObject, ObjectGuid);
-						CollectDefaultSubobjects(CreatedNewObject, ObjectGuid, ObjectData);
+						GuidInParent = *GuidInParentPtr;
 					}
 					else
 					{
-						UE_LOG(LPrefab, Warning, TEXT("[%s].%d Missing Outer object when creating object: '%s'. Prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(ObjectData.ObjectName.ToString()), *PrefabAssetPath);
-						continue;
+						GuidInParent = FGuid::NewGuid();
+						ContextPtr->MapObjectIdToNewlyCreatedId.Add(UniqueId, GuidInParent);
 					}
+					ContextPtr->bAnyGuidFrom_MapObjectIdToNewlyCreatedId = true;
+					ContextPtr->MapObjectGuidFromSubPrefabToParentPrefab.Add(GuidInSubPrefab, GuidInParent);
+				}
+				else
+				{
+					GuidInParent = *ObjectGuidInParentPrefabPtr;
+				}
+				return GuidInParent;
+				};
+			//collect sub prefab's object and guid to parent map, so all objects are ready when set override parameters
+			for (auto& KeyValue : InSubPrefabMapGuidToObject)
+			{
+				auto& GuidInSubPrefab = KeyValue.Key;
+				auto& ObjectInSubPrefab = KeyValue.Value;
+
+				auto GuidInParent = GetObjectGuidInParent(GuidInSubPrefab, InMapObjectToOriginGuid[ObjectInSubPrefab]);
+
+				if (auto RecordDataPtr = ActorData.MapObjectGuidToSubPrefabOverrideParameter.Find(GuidInParent))
+				{
+					FLPrefabOverrideParameterData OverrideDataItem;
+					OverrideDataItem.MemberPropertyNames = RecordDataPtr->OverrideParameterNames;
+					OverrideDataItem.Object = ObjectInSubPrefab;
+					SubPrefabData.ObjectOverrideParameterArray.Add(OverrideDataItem);
+
+					FSubPrefabObjectOverrideParameterData OverrideData;
+					OverrideData.Object = ObjectInSubPrefab;
+					OverrideData.ParameterDatas = RecordDataPtr->OverrideParameterData;
+					OverrideData.ParameterNames = RecordDataPtr->OverrideParameterNames;
+					SubPrefabOverrideParameters.Add(OverrideData);//collect override parameters, so when all objects are generated, restore these parameters will get all value back
+				}
+
+				SubPrefabData.MapObjectGuidFromParentPrefabToSubPrefab.Add(GuidInParent, GuidInSubPrefab);
+				SubPrefabData.MapGuidToObject.Add(GuidInSubPrefab, ObjectInSubPrefab);
+				if (!MapGuidToObject.Contains(GuidInParent))
+				{
+					MapGuidToObject.Add(GuidInParent, ObjectInSubPrefab);
 				}
 			}
-			if (auto CreatedNewComponent = Cast<UActorComponent>(CreatedNewObject))
+			//if we don't need to get any guid from MapObjectIdToNewlyCreatedId, that means subprefab already have a persistent guid for all objects, then we can drop the data
+			if (ContextPtr->bAnyGuidFrom_MapObjectIdToNewlyCreatedId)
 			{
-				FComponentDataStruct CompData;
-				CompData.Component = CreatedNewComponent;
-				if (auto ParentGuidPtr = MapSceneComponentToParent.Find(ObjectGuid))
+				//convert data to save
+				for (auto& DataItem : ContextPtr->MapObjectIdToNewlyCreatedId)
 				{
-					CompData.SceneComponentParentGuid = *ParentGuidPtr;
+					SubPrefabData.MapObjectIdToNewlyCreatedId.Add({ DataItem.Key.RootActorGuidInParentPrefab, DataItem.Key.ObjectGuidInOrignPrefab }, DataItem.Value);
 				}
-				ComponentsInThisPrefab.Add(CompData);
-				AllComponents.Add(CreatedNewComponent);
+			}
+			//collect sub-prefab's actor to parent prefab
+			AllActors.Append(InSubActors);
+			AllComponents.Append(InSubComponents);
+			MapObjectToOriginGuid.Append(InMapObjectToOriginGuid);
+			};
+
+		//same as LoadSubPrefab, but keep the serializer so the sub prefab can be loaded step by step
+		auto SubSerializer = MakeShared<ActorSerializer>();
+		SubSerializer->TargetWorld = TargetWorld;
+#if !WITH_EDITOR
+		SubSerializer->bIsEditorOrRuntime = false;
+#endif
+		SubSerializer->bOverrideVersions = true;
+		SubSerializer->MapGuidToObject = SubMapGuidToObject;
+		SubSerializer->DeserializationSessionId = DeserializationSessionId;
+		SubSerializer->bIsSubPrefab = true;
+		SubSerializer->ApplyRecord = ApplyRecord;
+		SubSerializer->bRegisterComponentsOnce = bRegisterComponentsOnce;
+		SubSerializer->SetupReaderFunctions();
+		SubSerializer->OnSubPrefabFinishDeserializeFunction = NewOnSubPrefabFinishDeserializeFunction;
+		Context->Serializer = SubSerializer;
+		DeserializeState.SubPrefabContext = Context;
+
+		SubSerializer->BeginDeserializeActor(nullptr, SubPrefabAsset, nullptr, false, FVector::ZeroVector, FQuat::Identity, FVector::OneVector);
+	}
+
+	void ActorSerializer::FinishGenerateSubPrefab(const FLGUIActorSaveData& InActorData)
+	{
+		auto Context = DeserializeState.SubPrefabContext;
+		DeserializeState.SubPrefabContext.Reset();
+
+		auto SubPrefabRootActor = Context->Serializer->DeserializeState.CreatedRootActor;
+		//sub prefab's components are registered by parent
+		AutoRegisterDisabledComponents.Append(Context->Serializer->AutoRegisterDisabledComponents);
+		if (SubPrefabRootActor != nullptr)
+		{
+			if (InActorData.RootComponentParentGuid.IsValid())
+			{
+				FComponentDataStruct CompData;
+				CompData.Component = SubPrefabRootActor->GetRootComponent();
+				CompData.SceneComponentParentGuid = InActorData.RootComponentParentGuid;
+				SubPrefabRootComponents.Add(CompData);
+			}
+
+			SubPrefabMap.Add(SubPrefabRootActor, Context->SubPrefabData);
+
+			if (Context->ActorIndex == 0)
+			{
+				DeserializeState.CreatedRootActor = SubPrefabRootActor;
 			}
 		}
 	}
 
-	AActor* ActorSerializer::GenerateActorArray(TArray<FLGUIActorSaveData>& SavedActors, TMap<FGuid, FLGUIObjectSaveData>& SavedObjects, TMap<FGuid, FGuid>& MapSceneComponentToParent, FGuid ParentGuid)
+	void ActorSerializer::GenerateActor(const FLGUIActorSaveData& InActorData, int32 InActorIndex, FGuid ParentGuid)
 	{
-		AActor* RootActor = nullptr;//first actor is the RootActor
-		for (int i = 0; i < SavedActors.Num(); i++)
+		if (auto ActorClass = FindClassFromListByIndex(InActorData.ObjectClass))
 		{
-			auto& InActorData = SavedActors[i];
-			if (InActorData.bIsPrefab)
+			if (!ActorClass->IsChildOf(AActor::StaticClass()))//if not the right class, use default
 			{
-				auto PrefabIndex = InActorData.PrefabAssetIndex;
-				if (auto PrefabAssetObject = FindAssetFromListByIndex(PrefabIndex))
+				UE_LOG(LPrefab, Warning, TEXT("[%s].%d Find class: '%s' at index: %d, but is not a Actor class, use default. Prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(ActorClass->GetFName().ToString()), InActorData.ObjectClass, *PrefabAssetPath);
+				ActorClass = AActor::StaticClass();
+			}
+
+			auto CollectDefaultSubobjects = [&](AActor* TargetActor) {
+				//Collect default sub objects
+				TArray<UObject*> DefaultSubObjects;
+				TargetActor->CollectDefaultSubobjects(DefaultSubObjects);
+				for (auto DefaultSubObject : DefaultSubObjects)
 				{
-					if (auto SubPrefabAsset = Cast<ULPrefab>(PrefabAssetObject))
+					if (DefaultSubObject->HasAnyFlags(EObjectFlags::RF_Transient))continue;
+					auto Index = InActorData.DefaultSubObjectNameArray.IndexOfByKey(DefaultSubObject->GetFName());
+					if (Index == INDEX_NONE)
 					{
-						AActor* SubPrefabRootActor = nullptr;
-						FLSubPrefabData SubPrefabData;
-						SubPrefabData.PrefabAsset = SubPrefabAsset;
+						UE_LOG(LPrefab, Warning, TEXT("[%s].%d Missing guid for default sub object: %s"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(DefaultSubObject->GetFName().ToString()));
+						continue;
+					}
+					auto DefaultSubObjectGuid = InActorData.DefaultSubObjectGuidArray[Index];
+					MapGuidToObject.Add(DefaultSubObjectGuid, DefaultSubObject);
+					MapObjectToOriginGuid.Add(DefaultSubObject, DefaultSubObjectGuid);
+				}
+				};
 
+			AActor* NewActor = nullptr;
+			bool bNeedFinishSpawn = false;
 #if WITH_EDITOR
-						if (SubPrefabAsset->PrefabVersion < (uint16)ELPrefabVersion::NewObjectOnNestedPrefab)
-						{
-							SubPrefabAsset->RecreatePrefab();//if is old version then recreate to make it new version
-						}
+			//MapGuidToObject can passed from LoadPrefabWithExistingObjects, so we need to find from map first. This only needed in editor, because runtime never use LoadPrefabWithExistingObjects
+			if (auto ActorPtr = MapGuidToObject.Find(InActorData.ActorGuid))
+			{
+				NewActor = (AActor*)(*ActorPtr);
+				MapObjectToOriginGuid.Add(NewActor, InActorData.ActorGuid);
+				CollectDefaultSubobjects(NewActor);
+			}
+			else
 #endif
-						//sub prefab
-						{
-							auto& SubMapGuidToObject = SubPrefabData.MapGuidToObject;
-							TMap<FGuid, FGuid> MapObjectGuidFromSubPrefabToParentPrefab;
-							for (auto& KeyValue : InActorData.MapObjectGuidFromParentPrefabToSubPrefab)
-							{
-								MapObjectGuidFromSubPrefabToParentPrefab.Add(KeyValue.Value, KeyValue.Key);
-							}
+			{
+				FActorSpawnParameters Spawnparameters;
+				Spawnparameters.ObjectFlags = (EObjectFlags)InActorData.ObjectFlags;
+				Spawnparameters.bDeferConstruction = true;
+				Spawnparameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
 #if WITH_EDITOR
-							//edit mode must check if the object already exist, because the deserialize process could happen when use revert-prefab
-							if (bIsEditorOrRuntime)
-							{
-								for (auto& KeyValue : MapObjectGuidFromSubPrefabToParentPrefab)
-								{
-									auto ObjectPtr = MapGuidToObject.Find(KeyValue.Value);
-									if (!SubMapGuidToObject.Contains(KeyValue.Key) && ObjectPtr != nullptr)
-									{
-										SubMapGuidToObject.Add(KeyValue.Key, *ObjectPtr);
-									}
-								}
-							}
+				//ref: LevelActor.cpp::SpawnActor 
+				//LGUI's editor preview world (or other simple world (not UE5's open world)) don't need external actor, so we need to remove the flag, or game will crash when check external package.
+				if ((Spawnparameters.ObjectFlags & EObjectFlags::RF_HasExternalPackage) != 0
+					&& !TargetWorld->GetCurrentLevel()->IsUsingExternalActors()
+					)
+				{
+					Spawnparameters.ObjectFlags = Spawnparameters.ObjectFlags & (~EObjectFlags::RF_HasExternalPackage);
+				}
 #endif
-							bool bAnyGuidFrom_MapObjectIdToNewlyCreatedId = false;
-							auto GetObjectGuidInParent = [&](const FGuid& GuidInSubPrefab, const FGuid& GuidInOriginPrefab) {
-								FGuid GuidInParent;
-								auto ObjectGuidInParentPrefabPtr = MapObjectGuidFromSubPrefabToParentPrefab.Find(GuidInSubPrefab);
-								if (ObjectGuidInParentPrefabPtr == nullptr)
-								{
-									auto UniqueId = FLGUISubPrefabObjectUniqueIdSaveData{ InActorData.ActorGuid, GuidInOriginPrefab };
-									if (auto GuidInParentPtr = InActorData.MapObjectIdToNewlyCreatedId.Find(UniqueId))
-									{
-										GuidInParent = *GuidInParentPtr;
-									}
-									else
-									{
-										GuidInParent = FGuid::NewGuid();
-										InActorData.MapObjectIdToNewlyCreatedId.Add(UniqueId, GuidInParent);
-									}
-									bAnyGuidFrom_MapObjectIdToNewlyCreatedId = true;
-									MapObjectGuidFromSubPrefabToParentPrefab.Add(GuidInSubPrefab, GuidInParent);
-								}
-								else
-								{
-									GuidInParent = *ObjectGuidInParentPrefabPtr;
-								}
-								return GuidInParent;
-								};
-							auto NewOnSubPrefabFinishDeserializeFunction =
-								[&](AActor*, const TMap<FGuid, TObjectPtr<UObject>>& InSubPrefabMapGuidToObject, const TMap<TObjectPtr<UObject>, FGuid>& InMapObjectToOriginGuid, const TArray<AActor*>& InSubActors, const TArray<UActorComponent*>& InSubComponents) {
-								//collect sub prefab's object and guid to parent map, so all objects are ready when set override parameters
-								for (auto& KeyValue : InSubPrefabMapGuidToObject)
-								{
-									auto& GuidInSubPrefab = KeyValue.Key;
-									auto& ObjectInSubPrefab = KeyValue.Value;
-
-									auto GuidInParent = GetObjectGuidInParent(GuidInSubPrefab, InMapObjectToOriginGuid[ObjectInSubPrefab]);
-
-									if (auto RecordDataPtr = InActorData.MapObjectGuidToSubPrefabOverrideParameter.Find(GuidInParent))
-									{
-										FLPrefabOverrideParameterData OverrideDataItem;
-										OverrideDataItem.MemberPropertyNames = RecordDataPtr->OverrideParameterNames;
-										OverrideDataItem.Object = ObjectInSubPrefab;
-										SubPrefabData.ObjectOverrideParameterArray.Add(OverrideDataItem);
-
-										FSubPrefabObjectOverrideParameterData OverrideData;
-										OverrideData.Object = ObjectInSubPrefab;
-										OverrideData.ParameterDatas = RecordDataPtr->OverrideParameterData;
-										OverrideData.ParameterNames = RecordDataPtr->OverrideParameterNames;
-										SubPrefabOverrideParameters.Add(OverrideData);//collect override parameters, so when all objects are generated, restore these parameters will get all value back
-									}
-
-									SubPrefabData.MapObjectGuidFromParentPrefabToSubPrefab.Add(GuidInParent, GuidInSubPrefab);
-									SubPrefabData.MapGuidToObject.Add(GuidInSubPrefab, ObjectInSubPrefab);
-									if (!MapGuidToObject.Contains(GuidInParent))
-									{
-										MapGuidToObject.Add(GuidInParent, ObjectInSubPrefab);
-									}
-								}
-								//if we don't need to get any guid from MapObjectIdToNewlyCreatedId, that means subprefab already have a persistent guid for all objects, then we can clear the data
-								if (!bAnyGuidFrom_MapObjectIdToNewlyCreatedId)
-								{
-									if (InActorData.MapObjectIdToNewlyCreatedId.Num() > 0)
-									{
-										InActorData.MapObjectIdToNewlyCreatedId.Empty();
-									}
-								}
-								else
-								{
-									//convert data to save
-									for (auto& DataItem : InActorData.MapObjectIdToNewlyCreatedId)
-									{
-										SubPrefabData.MapObjectIdToNewlyCreatedId.Add({ DataItem.Key.RootActorGuidInParentPrefab, DataItem.Key.ObjectGuidInOrignPrefab }, DataItem.Value);
-									}
-								}
-								//collect sub-prefab's actor to parent prefab
-								AllActors.Append(InSubActors);
-								AllComponents.Append(InSubComponents);
-								MapObjectToOriginGuid.Append(InMapObjectToOriginGuid);
-								};
-
-							SubPrefabRootActor = ActorSerializer::LoadSubPrefab(this->TargetWorld, SubPrefabAsset, nullptr, DeserializationSessionId, SubMapGuidToObject
-								, NewOnSubPrefabFinishDeserializeFunction
-							);
-						}
-						
-						if (SubPrefabRootActor != nullptr)
+				if (bRegisterComponentsOnce)
+				{
+					//native default components are registered inside SpawnActor, disable it so they are registered after properties are applied
+					Spawnparameters.CustomPreSpawnInitalization = [this](AActor* InActor) {
+						for (auto Comp : InActor->GetComponents())
 						{
-							FComponentDataStruct CompData;
-							CompData.Component = SubPrefabRootActor->GetRootComponent();
-							FGuid SubPrefabRootCompGuid;
-							for (auto& KeyValue : MapGuidToObject)
-							{
-								if (KeyValue.Value == CompData.Component)
-								{
-									SubPrefabRootCompGuid = KeyValue.Key;
-									break;
-								}
-							}
-							if (auto ParentGuidPtr = MapSceneComponentToParent.Find(SubPrefabRootCompGuid))
-							{
-								CompData.SceneComponentParentGuid = *ParentGuidPtr;
-								SubPrefabRootComponents.Add(CompData);
-							}
-
-							SubPrefabMap.Add(SubPrefabRootActor, SubPrefabData);
-
-							if (i == 0)
+							if (Comp->bAutoRegister && !Comp->IsRegistered())
 							{
-								RootActor = SubPrefabRootActor;
+								Comp->bAutoRegister = false;
+								AutoRegisterDisabledComponents.Add(Comp);
 							}
 						}
-					}
+					};
 				}
+				NewActor = TargetWorld->SpawnActor<AActor>(ActorClass, Spawnparameters);
+				MapGuidToObject.Add(InActorData.ActorGuid, NewActor);
+				MapObjectToOriginGuid.Add(NewActor, InActorData.ActorGuid);
+				CollectDefaultSubobjects(NewActor);
+				bNeedFinishSpawn = true;
 			}
-			else
+			//add actor before FinishSpawing, so it's good for component (or other default subobject) to check if actor is processing by prefab system
+			LPrefabManager->AddActorForPrefabSystem(NewActor, DeserializationSessionId);
+			if (bNeedFinishSpawn)
 			{
-				if (auto ActorClass = FindClassFromListByIndex(InActorData.ObjectClass))
-				{
-					if (!ActorClass->IsChildOf(AActor::StaticClass()))//if not the right class, use default
-					{
-						UE_LOG(LPrefab, Warning, TEXT("[%s].%d Find class: '%s' at index: %d, but is not a Actor class, use default. Prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(ActorClass->GetFName().ToString()), InActorData.ObjectClass, *PrefabAssetPath);
-						ActorClass = AActor::StaticClass();
-					}
-
-					auto CollectDefaultSubobjects = [&](AActor* TargetActor) {
-						//Collect default sub objects
-						TArray<UObject*> DefaultSubObjects;
-						TargetActor->CollectDefaultSubobjects(DefaultSubObjects);
-						for (auto DefaultSubObject : DefaultSubObjects)
-						{
-							if (DefaultSubObject->HasAnyFlags(EObjectFlags::RF_Transient))continue;
-							auto Index = InActorData.DefaultSubObjectNameArray.IndexOfByKey(DefaultSubObject->GetFName());
-							if (Index == INDEX_NONE)
-							{
-								UE_LOG(LPrefab, Warning, TEXT("[%s].%d Missing guid for default sub object: %s"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(DefaultSubObject->GetFName().ToString()));
-								continue;
-							}
-							auto DefaultSubObjectGuid = InActorData.DefaultSubObjectGuidArray[Index];
-							MapGuidToObject.Add(DefaultSubObjectGuid, DefaultSubObject);
-							MapObjectToOriginGuid.Add(DefaultSubObject, DefaultSubObjectGuid);
-						}
-						};
-
-					AActor* NewActor = nullptr;
-					bool bNeedFinishSpawn = false;
-#if WITH_EDITOR
-					//MapGuidToObject can passed from LoadPrefabWithExistingObjects, so we need to find from map first. This only needed in editor, because runtime never use LoadPrefabWithExistingObjects
-					if (auto ActorPtr = MapGuidToObject.Find(InActorData.ActorGuid))
-					{
-						NewActor = (AActor*)(*ActorPtr);
-						MapObjectToOriginGuid.Add(NewActor, InActorData.ActorGuid);
-						CollectDefaultSubobjects(NewActor);
-					}
-					else
-#endif
-					{
-						FActorSpawnParameters Spawnparameters;
-						Spawnparameters.ObjectFlags = (EObjectFlags)InActorData.ObjectFlags;
-						Spawnparameters.bDeferConstruction = true;
-						Spawnparameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
-#if WITH_EDITOR
-						//ref: LevelActor.cpp::SpawnActor 
-						//LGUI's editor preview world (or other simple world (not UE5's open world)) don't need external actor, so we need to remove the flag, or game will crash when check external package.
-						if ((Spawnparameters.ObjectFlags & EObjectFlags::RF_HasExternalPackage) != 0
-							&& !TargetWorld->GetCurrentLevel()->IsUsingExternalActors()
-							)
-						{
-							Spawnparameters.ObjectFlags = Spawnparameters.ObjectFlags & (~EObjectFlags::RF_HasExternalPackage);
-						}
-#endif
-						NewActor = TargetWorld->SpawnActor<AActor>(ActorClass, Spawnparameters);
-						MapGuidToObject.Add(InActorData.ActorGuid, NewActor);
-						MapObjectToOriginGuid.Add(NewActor, InActorData.ActorGuid);
-						CollectDefaultSubobjects(NewActor);
-						bNeedFinishSpawn = true;
-					}
-					//add actor before FinishSpawing, so it's good for component (or other default subobject) to check if actor is processing by prefab system
-					LPrefabManager->AddActorForPrefabSystem(NewActor, DeserializationSessionId);
-					if (bNeedFinishSpawn)
-					{
-						NewActor->FinishSpawning(FTransform::Identity, true);
-					}
-
-					if (auto RootComp = NewActor->GetRootComponent())
-					{
-						if (!MapGuidToObject.Contains(InActorData.RootComponentGuid))
-						{
-							MapGuidToObject.Add(InActorData.RootComponentGuid, RootComp);
-							MapObjectToOriginGuid.Add(RootComp, InActorData.RootComponentGuid);
-						}
-
-						if (ParentGuid.IsValid())
-						{
-							FComponentDataStruct CompData;
-							CompData.Component = RootComp;
-							CompData.SceneComponentParentGuid = ParentGuid;
-							ComponentsInThisPrefab.Add(CompData);
-						}
-					}
-
-					AllActors.Add(NewActor);
+				NewActor->FinishSpawning(FTransform::Identity, true);
+			}
 
-					if (i == 0)
-					{
-						RootActor = NewActor;
-					}
+			if (auto RootComp = NewActor->GetRootComponent())
+			{
+				if (!MapGuidToObject.Contains(InActorData.RootComponentGuid))
+				{
+					MapGuidToObject.Add(InActorData.RootComponentGuid, RootComp);
+					MapObjectToOriginGuid.Add(RootComp, InActorData.RootComponentGuid);
 				}
-				else
+
+				if (ParentGuid.IsValid())
 				{
-					UE_LOG(LPrefab, Warning, TEXT("[%s].%d Actor Class of index:%d not found! Prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, (InActorData.ObjectClass), *PrefabAssetPath);
+					FComponentDataStruct CompData;
+					CompData.Component = RootComp;
+					CompData.SceneComponentParentGuid = ParentGuid;
+					ComponentsInThisPrefab.Add(CompData);
 				}
 			}
+
+			AllActors.Add(NewActor);
+
+			if (InActorIndex == 0)
+			{
+				DeserializeState.CreatedRootActor = NewActor;
+			}
+		}
+		else
+		{
+			UE_LOG(LPrefab, Warning, TEXT("[%s].%d Actor Class of index:%d not found! Prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, (InActorData.ObjectClass), *PrefabAssetPath);
 		}
-		return RootActor;
 	}
 }
 
@@ -0,0 +1,106 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "PrefabSystem/ActorSerializer8.h"
+#include "Engine/World.h"
+#include "Containers/Ticker.h"
+#include "UObject/GCObject.h"
+#include "LPrefabModule.h"
+
+#if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
+PRAGMA_DISABLE_OPTIMIZATION
+#endif
+
+namespace LPrefabSystem8
+{
+	/** Hold the serializer and run deserialize steps every frame with limited time, until finish. */
+	class ActorSerializer::FAsyncLoadTask : public FGCObject
+	{
+	public:
+		TSharedPtr<ActorSerializer> Serializer;
+		TWeakObjectPtr<UWorld> World;
+		double FrameBudgetSeconds = 0;
+		TFunction<void(AActor*)> OnComplete;
+
+		virtual void AddReferencedObjects(FReferenceCollector& Collector)override
+		{
+			Serializer->AddReferencedObjects(Collector);
+		}
+		virtual FString GetReferencerName()const override
+		{
+			return TEXT("LPrefabSystem8::ActorSerializer::FAsyncLoadTask");
+		}
+
+		/** @return true if need to continue in next frame */
+		bool Tick()
+		{
+			if (!World.IsValid() || World->bIsTearingDown)
+			{
+				UE_LOG(LPrefab, Warning, TEXT("[%s].%d World is destroyed when loading prefab: '%s', load is cancelled."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *Serializer->PrefabAssetPath);
+				Complete(nullptr);
+				return false;
+			}
+			TRACE_CPUPROFILER_EVENT_SCOPE(LPrefab.LoadPrefabAsync.Tick);
+			auto Deadline = FPlatformTime::Seconds() + FrameBudgetSeconds;
+			if (!Serializer->StepDeserialize(Deadline))
+			{
+				return true;
+			}
+			Complete(Serializer->DeserializeState.CreatedRootActor);
+			return false;
+		}
+	private:
+		void Complete(AActor* InRootActor)
+		{
+			if (OnComplete != nullptr)
+			{
+				OnComplete(InRootActor);
+				OnComplete = nullptr;
+			}
+		}
+	};
+
+	void ActorSerializer::LoadPrefabAsync(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent, float InFrameBudgetMs, const TFunction<void(AActor*)>& InOnComplete)
+	{
+		if (!IsValid(InWorld))
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Not valid world!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			if (InOnComplete != nullptr)InOnComplete(nullptr);
+			return;
+		}
+		if (!IsValid(InPrefab))
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d InPrefab is null!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			if (InOnComplete != nullptr)InOnComplete(nullptr);
+			return;
+		}
+
+		auto Task = MakeShared<FAsyncLoadTask>();
+		Task->World = InWorld;
+		Task->FrameBudgetSeconds = FMath::Max(InFrameBudgetMs, 0.0f) * 0.001;
+		Task->OnComplete = InOnComplete;
+
+		auto serializer = MakeShared<ActorSerializer>();
+		serializer->TargetWorld = InWorld;
+#if !WITH_EDITOR
+		serializer->bIsEditorOrRuntime = false;
+#endif
+		serializer->bOverrideVersions = true;
+		serializer->bCanDeferSubPrefab = CanDeferSubPrefab(InWorld);
+		serializer->SetupReaderFunctions();
+		Task->Serializer = serializer;
+		serializer->BeginDeserializeActor(Parent, InPrefab, nullptr, false, FVector::ZeroVector, FQuat::Identity, FVector::OneVector);
+
+		//first step in this frame, small prefab may finish right now
+		if (!Task->Tick())
+		{
+			return;
+		}
+		FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([Task](float DeltaTime) {
+			return Task->Tick();
+			}));
+	}
+}
+
+#if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
+PRAGMA_ENABLE_OPTIMIZATION
+#endif
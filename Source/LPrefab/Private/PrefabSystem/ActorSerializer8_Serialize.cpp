@@ -9,19 +9,460 @@
 #include "LPrefabModule.h"
 #include "Misc/NetworkVersion.h"
 #include "Runtime/Launch/Resources/Version.h"
+#include "HAL/IConsoleManager.h"
+#include "PrefabSystem/ILPrefabInterface.h"
 #if WITH_EDITOR
 #include "Tools/UEdMode.h"
 #include "LPrefabUtils.h"
+#include "Misc/TransactionObjectEvent.h"
 #endif
 
 #if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
 PRAGMA_DISABLE_OPTIMIZATION
 #endif
+static TAutoConsoleVariable<int32> CVarLPrefabCompactBuildData(
+	TEXT("LPrefab.CompactBuildData"),
+	1,
+	TEXT("1- Save prefab's build data with compact layout (object referenced by int32 index instead of FGuid). 0- Use the same layout as editor data."),
+	ECVF_Default);
+static TAutoConsoleVariable<int32> CVarLPrefabTargetedOverrideParameter(
+	TEXT("LPrefab.TargetedOverrideParameter"),
+	1,
+	TEXT("1- When save compact build data, sub prefab's override parameter data only store the override properties, and is read without walking every property. 0- Use the same override parameter data as editor data."),
+	ECVF_Default);
+static TAutoConsoleVariable<int32> CVarLPrefabIncrementalSaveCheck(
+	TEXT("LPrefab.IncrementalSaveCheck"),
+	0,
+	TEXT("1- (dev) After incremental save, do a full save too and compare the data byte for byte, use full save's data and log warning if different. For finding changes that are not tracked, slower than full save. 0- No check."),
+	ECVF_Default);
+
 namespace LPrefabSystem8
 {
+	/** Optional parts of compact build data, since ELPrefabVersion::FlagsBuildData. */
+	enum class ELPrefabBuildDataFlags : uint8
+	{
+		None = 0,
+		DeltaAgainstArchetype = 1 << 0,
+		TargetedOverrideParameter = 1 << 1,
+		AwakeObjectIndices = 1 << 2,
+		TaggedPropertyData = 1 << 3,
+		/** AwakeObjectCounts and AwakeComponentCounts follow AwakeObjectIndices. */
+		AwakeActorCounts = 1 << 4,
+	};
+	ENUM_CLASS_FLAGS(ELPrefabBuildDataFlags);
+
+	void FLPrefabSaveData::SerializeCompact(FArchive& Ar, uint16 InBuildDataVersion)
+	{
+		if (Ar.IsSaving())
+		{
+			InBuildDataVersion = LPREFAB_CURRENT_BUILD_DATA_VERSION;
+		}
+		bool bHasFlags = InBuildDataVersion >= (uint16)ELPrefabVersion::FlagsBuildData;
+		bool bHasAwakeActorCounts = false;
+
+		TMap<FGuid, int32> MapGuidToIndex;
+		auto ToIndex = [this, &MapGuidToIndex](const FGuid& InGuid) {
+			if (!InGuid.IsValid())return (int32)INDEX_NONE;
+			if (auto IndexPtr = MapGuidToIndex.Find(InGuid))
+			{
+				return *IndexPtr;
+			}
+			auto Index = ObjectGuids.Add(InGuid);
+			MapGuidToIndex.Add(InGuid, Index);
+			return Index;
+		};
+		auto ToGuid = [this](int32 InIndex) {
+			return ObjectGuids.IsValidIndex(InIndex) ? ObjectGuids[InIndex] : FGuid();
+		};
+		auto SerializeGuid = [&Ar, &ToIndex, &ToGuid](FGuid& InOutGuid) {
+			int32 Index = Ar.IsSaving() ? ToIndex(InOutGuid) : INDEX_NONE;
+			Ar << Index;
+			if (Ar.IsLoading())
+			{
+				InOutGuid = ToGuid(Index);
+			}
+		};
+		auto SerializeGuidArray = [&Ar, &SerializeGuid](TArray<FGuid>& InOutGuids) {
+			int32 Count = InOutGuids.Num();
+			Ar << Count;
+			if (Ar.IsLoading())
+			{
+				InOutGuids.SetNum(Count);
+			}
+			for (auto& Guid : InOutGuids)
+			{
+				SerializeGuid(Guid);
+			}
+		};
+
+		if (Ar.IsSaving())
+		{
+			//guid table must be complete before write, so collect all guids first
+			MapGuidToIndex.Reserve(ObjectGuids.Num());
+			for (int i = 0; i < ObjectGuids.Num(); i++)
+			{
+				MapGuidToIndex.Add(ObjectGuids[i], i);
+			}
+			for (auto& ActorData : SavedActors)
+			{
+				ToIndex(ActorData.ActorGuid);
+				ToIndex(ActorData.RootComponentGuid);
+				ToIndex(ActorData.RootComponentParentGuid);
+				for (auto& Guid : ActorData.DefaultSubObjectGuidArray)ToIndex(Guid);
+			}
+			for (auto& ObjectData : SavedObjects)
+			{
+				ToIndex(ObjectData.ObjectGuid);
+				ToIndex(ObjectData.OuterObjectGuid);
+				ToIndex(ObjectData.SceneComponentParentGuid);
+				for (auto& Guid : ObjectData.DefaultSubObjectGuidArray)ToIndex(Guid);
+			}
+			for (auto& Item : SavedObjectData)
+			{
+				ToIndex(Item.ObjectGuid);
+			}
+		}
+		Ar << ObjectGuids;
+
+		if (bHasFlags)
+		{
+			ELPrefabBuildDataFlags Flags = ELPrefabBuildDataFlags::None;
+			if (bDeltaAgainstArchetype)Flags |= ELPrefabBuildDataFlags::DeltaAgainstArchetype;
+			if (bTargetedOverrideParameter)Flags |= ELPrefabBuildDataFlags::TargetedOverrideParameter;
+			if (bHasAwakeObjectIndices)Flags |= ELPrefabBuildDataFlags::AwakeObjectIndices;
+			if (bTaggedPropertyData)Flags |= ELPrefabBuildDataFlags::TaggedPropertyData;
+			if (bHasAwakeObjectIndices && AwakeObjectCounts.Num() > 0)Flags |= ELPrefabBuildDataFlags::AwakeActorCounts;
+			Ar << Flags;
+			bDeltaAgainstArchetype = EnumHasAnyFlags(Flags, ELPrefabBuildDataFlags::DeltaAgainstArchetype);
+			bTargetedOverrideParameter = EnumHasAnyFlags(Flags, ELPrefabBuildDataFlags::TargetedOverrideParameter);
+			bHasAwakeObjectIndices = EnumHasAnyFlags(Flags, ELPrefabBuildDataFlags::AwakeObjectIndices);
+			bTaggedPropertyData = EnumHasAnyFlags(Flags, ELPrefabBuildDataFlags::TaggedPropertyData);
+			bHasAwakeActorCounts = EnumHasAnyFlags(Flags, ELPrefabBuildDataFlags::AwakeActorCounts);
+		}
+		else
+		{
+			//old delta data is written with binary property serialization, which always store every property, so read it as full data
+			bDeltaAgainstArchetype = false;
+			bTargetedOverrideParameter = InBuildDataVersion >= (uint16)ELPrefabVersion::TargetedOverrideParameter;
+		}
+
+		int32 ActorCount = SavedActors.Num();
+		Ar << ActorCount;
+		if (Ar.IsLoading())
+		{
+			SavedActors.SetNum(ActorCount);
+		}
+		for (auto& ActorData : SavedActors)
+		{
+			Ar << ActorData.bIsPrefab;
+			SerializeGuid(ActorData.ActorGuid);
+			if (ActorData.bIsPrefab)
+			{
+				//these guids are in sub prefab's space, keep them as it is
+				Ar << ActorData.PrefabAssetIndex;
+				Ar << ActorData.MapObjectGuidToSubPrefabOverrideParameter;
+				Ar << ActorData.MapObjectIdToNewlyCreatedId;
+				Ar << ActorData.MapObjectGuidFromParentPrefabToSubPrefab;
+				if (bHasFlags)
+				{
+					Ar << ActorData.bDeferLoad;
+					SerializeGuid(ActorData.RootComponentGuid);
+					SerializeGuid(ActorData.RootComponentParentGuid);
+				}
+			}
+			else
+			{
+				Ar << ActorData.ObjectClass;
+				Ar << ActorData.ObjectFlags;
+				SerializeGuid(ActorData.RootComponentGuid);
+				SerializeGuidArray(ActorData.DefaultSubObjectGuidArray);
+				Ar << ActorData.DefaultSubObjectNameArray;
+			}
+		}
+
+		int32 ObjectCount = SavedObjects.Num();
+		Ar << ObjectCount;
+		if (Ar.IsLoading())
+		{
+			SavedObjects.SetNum(ObjectCount);
+		}
+		for (auto& ObjectData : SavedObjects)
+		{
+			SerializeGuid(ObjectData.ObjectGuid);
+			Ar << ObjectData.ObjectClass;
+			Ar << ObjectData.ObjectFlags;
+			SerializeGuidArray(ObjectData.DefaultSubObjectGuidArray);
+			Ar << ObjectData.DefaultSubObjectNameArray;
+			Ar << ObjectData.ObjectName;
+			SerializeGuid(ObjectData.OuterObjectGuid);
+			if (bHasFlags)
+			{
+				SerializeGuid(ObjectData.SceneComponentParentGuid);
+			}
+		}
+
+		if (!bHasFlags)
+		{
+			//old layout: child-to-parent map as guid index pairs
+			int32 ParentCount = 0;
+			Ar << ParentCount;
+			TMap<FGuid, FGuid> MapSceneComponentToParent;
+			MapSceneComponentToParent.Reserve(ParentCount);
+			for (int i = 0; i < ParentCount; i++)
+			{
+				FGuid Child, Parent;
+				SerializeGuid(Child);
+				SerializeGuid(Parent);
+				MapSceneComponentToParent.Add(Child, Parent);
+			}
+			SetSceneComponentParents(MapSceneComponentToParent);
+		}
+
+		int32 DataCount = SavedObjectData.Num();
+		Ar << DataCount;
+		if (Ar.IsLoading())
+		{
+			SavedObjectData.SetNum(DataCount);
+		}
+		for (auto& Item : SavedObjectData)
+		{
+			if (Ar.IsSaving())
+			{
+				Item.ObjectIndex = ToIndex(Item.ObjectGuid);
+			}
+			Ar << Item.ObjectIndex;
+			if (Ar.IsLoading())
+			{
+				Item.ObjectGuid = ToGuid(Item.ObjectIndex);
+			}
+			Ar << Item.Data;
+		}
+
+		if (bHasFlags)
+		{
+			if (bHasAwakeObjectIndices)
+			{
+				Ar << AwakeObjectIndices;
+				if (bHasAwakeActorCounts)
+				{
+					Ar << AwakeObjectCounts;
+					Ar << AwakeComponentCounts;
+				}
+			}
+		}
+		else
+		{
+			//old layout has no flags, optional parts are detected by the end of data
+			SerializeDeferredSubPrefabsLegacy(Ar);
+			if (!Ar.AtEnd())
+			{
+				Ar << AwakeObjectIndices;
+				bHasAwakeObjectIndices = true;
+			}
+		}
+	}
+
+	void FLPrefabSaveData::SerializeDeferredSubPrefabsLegacy(FArchive& Ar)
+	{
+		check(Ar.IsLoading());
+		if (Ar.AtEnd())return;
+		TArray<FLPrefabDeferredSubPrefabSaveData> DeferredSubPrefabs;
+		Ar << DeferredSubPrefabs;
+		SetDeferredSubPrefabs(DeferredSubPrefabs);
+	}
+	void FLPrefabSaveData::GetDeferredSubPrefabs(TArray<FLPrefabDeferredSubPrefabSaveData>& OutDeferredSubPrefabs)const
+	{
+		for (int i = 0; i < SavedActors.Num(); i++)
+		{
+			auto& ActorData = SavedActors[i];
+			if (ActorData.bIsPrefab && ActorData.bDeferLoad)
+			{
+				auto& Item = OutDeferredSubPrefabs.AddDefaulted_GetRef();
+				Item.ActorIndex = i;
+				Item.RootComponentGuid = ActorData.RootComponentGuid;
+			}
+		}
+	}
+	void FLPrefabSaveData::SetDeferredSubPrefabs(const TArray<FLPrefabDeferredSubPrefabSaveData>& InDeferredSubPrefabs)
+	{
+		for (auto& Item : InDeferredSubPrefabs)
+		{
+			if (SavedActors.IsValidIndex(Item.ActorIndex) && SavedActors[Item.ActorIndex].bIsPrefab)
+			{
+				auto& ActorData = SavedActors[Item.ActorIndex];
+				ActorData.bDeferLoad = true;
+				ActorData.RootComponentGuid = Item.RootComponentGuid;
+			}
+		}
+	}
+	void FLPrefabSaveData::GetSceneComponentParents(TMap<FGuid, FGuid>& OutMapSceneComponentToParent)const
+	{
+		for (auto& ActorData : SavedActors)
+		{
+			if (ActorData.bIsPrefab && ActorData.RootComponentParentGuid.IsValid())
+			{
+				OutMapSceneComponentToParent.Add(ActorData.RootComponentGuid, ActorData.RootComponentParentGuid);
+			}
+		}
+		for (auto& ObjectData : SavedObjects)
+		{
+			if (ObjectData.SceneComponentParentGuid.IsValid())
+			{
+				OutMapSceneComponentToParent.Add(ObjectData.ObjectGuid, ObjectData.SceneComponentParentGuid);
+			}
+		}
+	}
+	void FLPrefabSaveData::SetSceneComponentParents(const TMap<FGuid, FGuid>& InMapSceneComponentToParent)
+	{
+		if (InMapSceneComponentToParent.Num() == 0)return;
+		int32 FoundCount = 0;
+		for (auto& ObjectData : SavedObjects)
+		{
+			if (auto ParentGuidPtr = InMapSceneComponentToParent.Find(ObjectData.ObjectGuid))
+			{
+				ObjectData.SceneComponentParentGuid = *ParentGuidPtr;
+				FoundCount++;
+			}
+		}
+		if (FoundCount == InMapSceneComponentToParent.Num())return;
+		//the rest are sub prefab's root components. Old data only store sub prefab's root component guid if deferred, so find it in sub prefab's guid map
+		for (auto& ActorData : SavedActors)
+		{
+			if (!ActorData.bIsPrefab)continue;
+			if (ActorData.RootComponentGuid.IsValid())
+			{
+				ActorData.RootComponentParentGuid = InMapSceneComponentToParent.FindRef(ActorData.RootComponentGuid);
+				continue;
+			}
+			for (auto& KeyValue : InMapSceneComponentToParent)
+			{
+				if (ActorData.MapObjectGuidFromParentPrefabToSubPrefab.Contains(KeyValue.Key))
+				{
+					ActorData.RootComponentGuid = KeyValue.Key;
+					ActorData.RootComponentParentGuid = KeyValue.Value;
+					break;
+				}
+			}
+		}
+	}
+
+	uint32 FLPrefabIncrementalSaveCache::CurrentGeneration = 0;
+	FLPrefabIncrementalSaveCache::FLPrefabIncrementalSaveCache()
+	{
+#if WITH_EDITOR
+		OnObjectModifiedHandle = FCoreUObjectDelegates::OnObjectModified.AddRaw(this, &FLPrefabIncrementalSaveCache::OnObjectModified);
+		OnObjectPropertyChangedHandle = FCoreUObjectDelegates::OnObjectPropertyChanged.AddRaw(this, &FLPrefabIncrementalSaveCache::OnObjectPropertyChanged);
+		OnObjectTransactedHandle = FCoreUObjectDelegates::OnObjectTransacted.AddRaw(this, &FLPrefabIncrementalSaveCache::OnObjectTransacted);
+#endif
+	}
+	FLPrefabIncrementalSaveCache::~FLPrefabIncrementalSaveCache()
+	{
+#if WITH_EDITOR
+		FCoreUObjectDelegates::OnObjectModified.Remove(OnObjectModifiedHandle);
+		FCoreUObjectDelegates::OnObjectPropertyChanged.Remove(OnObjectPropertyChangedHandle);
+		FCoreUObjectDelegates::OnObjectTransacted.Remove(OnObjectTransactedHandle);
+#endif
+	}
+#if WITH_EDITOR
+	void FLPrefabIncrementalSaveCache::OnObjectModified(UObject* InObject)
+	{
+		MarkDirty(InObject);
+	}
+	void FLPrefabIncrementalSaveCache::OnObjectPropertyChanged(UObject* InObject, FPropertyChangedEvent& InPropertyChangedEvent)
+	{
+		MarkDirty(InObject);
+		//PostEditChangeProperty of actor or component run construction script, which can change any component of the actor
+		if (auto Component = Cast<UActorComponent>(InObject))
+		{
+			MarkDirty(Component->GetOwner());
+		}
+	}
+	void FLPrefabIncrementalSaveCache::OnObjectTransacted(UObject* InObject, const FTransactionObjectEvent& InTransactionObjectEvent)
+	{
+		MarkDirty(InObject);//undo/redo change object without property change notification
+	}
+#endif
+	void FLPrefabIncrementalSaveCache::MarkDirty(UObject* InObject)
+	{
+		if (Entries.Num() == 0 || InObject == nullptr)return;
+		DirtyObjects.Add(FObjectKey(InObject));
+	}
+	void FLPrefabIncrementalSaveCache::Reset()
+	{
+		Entries.Empty();
+		DirtyObjects.Empty();
+		Prefab.Reset();
+	}
+	void FLPrefabIncrementalSaveCache::InvalidateAll()
+	{
+		CurrentGeneration++;
+	}
+	bool FLPrefabIncrementalSaveCache::IsDirty(UObject* InObject)const
+	{
+		if (DirtyObjects.Num() == 0)return false;
+		//property of inner object can be edited through outer object, eg: instanced object edited in outer's detail panel
+		for (auto Object = InObject; Object != nullptr; Object = Object->GetOuter())
+		{
+			if (DirtyObjects.Contains(FObjectKey(Object)))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
 	void ActorSerializer::SavePrefab(AActor* OriginRootActor, ULPrefab* InPrefab
 		, TMap<UObject*, FGuid>& InOutMapObjectToGuid, TMap<TObjectPtr<AActor>, FLSubPrefabData>& InSubPrefabMap
 		, bool InForEditorOrRuntimeUse
+		, bool InDeltaAgainstArchetype
+	)
+	{
+		SavePrefabInternal(OriginRootActor, InPrefab, InOutMapObjectToGuid, InSubPrefabMap, InForEditorOrRuntimeUse, InDeltaAgainstArchetype, nullptr);
+	}
+
+#if WITH_EDITOR
+	void ActorSerializer::SavePrefabIncremental(AActor* OriginRootActor, ULPrefab* InPrefab
+		, TMap<UObject*, FGuid>& InOutMapObjectToGuid, TMap<TObjectPtr<AActor>, FLSubPrefabData>& InSubPrefabMap
+		, FLPrefabIncrementalSaveCache& InOutCache
+	)
+	{
+		if (InOutCache.Prefab.Get() != InPrefab || InOutCache.Generation != FLPrefabIncrementalSaveCache::CurrentGeneration)
+		{
+			InOutCache.Reset();
+		}
+		SavePrefabInternal(OriginRootActor, InPrefab, InOutMapObjectToGuid, InSubPrefabMap, true, false, &InOutCache);
+		if (CVarLPrefabIncrementalSaveCheck.GetValueOnGameThread() == 0)return;
+		if (!IsValid(InPrefab))return;
+
+		//full save with the same guids, then the result should be exactly the same
+		auto CheckMapObjectToGuid = InOutMapObjectToGuid;
+		auto CheckPrefab = NewObject<ULPrefab>(GetTransientPackage(), NAME_None, RF_Transient);
+		SavePrefabInternal(OriginRootActor, CheckPrefab, CheckMapObjectToGuid, InSubPrefabMap, true, false, nullptr);
+		bool bSame = CheckPrefab->BinaryData == InPrefab->BinaryData
+			&& CheckPrefab->ReferenceAssetList == InPrefab->ReferenceAssetList
+			&& CheckPrefab->ReferenceClassList == InPrefab->ReferenceClassList
+			&& CheckPrefab->ReferenceNameList == InPrefab->ReferenceNameList
+			;
+		if (bSame)
+		{
+			UE_LOG(LPrefab, Log, TEXT("[%s].%d Incremental save of prefab '%s' is same as full save."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *InPrefab->GetPathName());
+		}
+		else
+		{
+			UE_LOG(LPrefab, Warning, TEXT("[%s].%d Incremental save of prefab '%s' is different from full save (data size: %d, full: %d), use full save instead. Maybe some object is changed without dirty notification.")
+				, ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *InPrefab->GetPathName(), InPrefab->BinaryData.Num(), CheckPrefab->BinaryData.Num());
+			InOutCache.Reset();
+			SavePrefabInternal(OriginRootActor, InPrefab, InOutMapObjectToGuid, InSubPrefabMap, true, false, &InOutCache);
+		}
+		CheckPrefab->MarkAsGarbage();
+	}
+#endif
+
+	void ActorSerializer::SavePrefabInternal(AActor* OriginRootActor, ULPrefab* InPrefab
+		, TMap<UObject*, FGuid>& InOutMapObjectToGuid, TMap<TObjectPtr<AActor>, FLSubPrefabData>& InSubPrefabMap
+		, bool InForEditorOrRuntimeUse
+		, bool InDeltaAgainstArchetype
+		, FLPrefabIncrementalSaveCache* InIncrementalSaveCache
 	)
 	{
 		if (!OriginRootActor || !InPrefab)
@@ -49,6 +490,8 @@ namespace LPrefabSystem8
 			UE_LOG(LPrefab, Error, TEXT("[%s].%d OriginRootActor is editor only!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
 			return;
 		}
+		SCOPE_CYCLE_COUNTER(STAT_LPrefab_Serialize);
+		LPREFAB_TRACE_SCOPE_TEXT(TEXT("LPrefab.SavePrefab %s"), *InPrefab->GetName());
 		ActorSerializer serializer;
 		serializer.TargetWorld = OriginRootActor->GetWorld();
 		for (auto& KeyValue : InOutMapObjectToGuid)//Preprocess the map, ignore invalid object
@@ -70,21 +513,147 @@ namespace LPrefabSystem8
 			}
 		}
 		serializer.bIsEditorOrRuntime = InForEditorOrRuntimeUse;
+		serializer.bWriteObjectIndex = !InForEditorOrRuntimeUse && CVarLPrefabCompactBuildData.GetValueOnAnyThread() != 0;
+		serializer.bDeltaAgainstArchetype = serializer.bWriteObjectIndex && InDeltaAgainstArchetype;
+		serializer.bTargetedOverrideParameter = serializer.bWriteObjectIndex && CVarLPrefabTargetedOverrideParameter.GetValueOnAnyThread() != 0;
+		if (serializer.bWriteObjectIndex)
+		{
+			//properties that reference deferred sub prefab are read again by name after realize
+			for (auto& SubPrefabKeyValue : InSubPrefabMap)
+			{
+				if (SubPrefabKeyValue.Value.bDeferLoad)
+				{
+					serializer.bTaggedPropertyData = true;
+					break;
+				}
+			}
+		}
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabObjectWriter Writer(InOutBuffer, serializer, ExcludeProperties);
+			if (serializer.bDeltaAgainstArchetype)
+			{
+				if (CanDiffAgainstArchetype(InObject))
+				{
+					Writer.ArNoDelta = false;
+					Writer.ArNoIntraPropertyDelta = false;
+				}
+				else
+				{
+					serializer.DeltaFallbackObjectCount++;
+				}
+			}
 			Writer.DoSerialize(InObject);
 		};
 		serializer.WriterOrReaderFunctionForSubPrefabOverride = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, const TArray<FName>& InOverridePropertyNames) {
 			LPrefabSystem::FLPrefabOverrideParameterObjectWriter Writer(InOutBuffer, serializer, InOverridePropertyNames);
-			Writer.DoSerialize(InObject);
+			if (serializer.bTargetedOverrideParameter)
+			{
+				Writer.DoSerializeTargeted(InObject);
+			}
+			else
+			{
+				Writer.DoSerialize(InObject);
+			}
 		};
+		if (InIncrementalSaveCache != nullptr)
+		{
+			serializer.IncrementalSaveCache = InIncrementalSaveCache;
+			serializer.NewIncrementalEntries.Reserve(InIncrementalSaveCache->Entries.Num());
+		}
 		serializer.SerializeActor(OriginRootActor, InPrefab);
 		InOutMapObjectToGuid = serializer.MapObjectToGuid;
+		if (InIncrementalSaveCache != nullptr)
+		{
+			//objects not saved this time are removed from cache
+			InIncrementalSaveCache->Entries = MoveTemp(serializer.NewIncrementalEntries);
+			InIncrementalSaveCache->DirtyObjects.Empty();
+			InIncrementalSaveCache->Prefab = InPrefab;
+			InIncrementalSaveCache->Generation = FLPrefabIncrementalSaveCache::CurrentGeneration;
+			UE_LOG(LPrefab, Log, TEXT("Incremental save prefab: %s, reused object data: %d, written object data: %d")
+				, *InPrefab->GetName(), serializer.IncrementalReusedCount, InIncrementalSaveCache->Entries.Num() - serializer.IncrementalReusedCount);
+		}
+	}
+
+	void ActorSerializer::WriteObjectData(UObject* InObject, const FGuid& InGuid, bool InIsSceneComponent, FLPrefabSaveData& OutData)
+	{
+		auto& Data = OutData.AddObjectData(InGuid);
+		if (IncrementalSaveCache == nullptr)
+		{
+			WriterOrReaderFunction(InObject, Data, InIsSceneComponent);
+			return;
+		}
+		auto& NewEntry = NewIncrementalEntries.Add(InGuid);
+		NewEntry.Object = InObject;
+		if (auto EntryPtr = IncrementalSaveCache->Entries.Find(InGuid))
+		{
+			if (EntryPtr->Object.Get() == InObject
+				&& !IncrementalSaveCache->IsDirty(InObject)
+				&& ReplayWriteRecord(EntryPtr->Record)//if index is different, writer do the same lookups again and get the new index
+				)
+			{
+				Data = EntryPtr->Data;
+				NewEntry.Data = MoveTemp(EntryPtr->Data);
+				NewEntry.Record = MoveTemp(EntryPtr->Record);
+				IncrementalReusedCount++;
+				return;
+			}
+		}
+		WriteRecord = &NewEntry.Record;
+		WriterOrReaderFunction(InObject, Data, InIsSceneComponent);
+		WriteRecord = nullptr;
+		NewEntry.Data = Data;
 	}
 
-	void ActorSerializer::SerializeActorArray(TMap<FGuid, FGuid>& MapSceneComponentToParent, TArray<FLGUIActorSaveData>& SavedActors, TMap<FGuid, TArray<uint8>>& SavedObjectData)
+	uint32 ActorSerializer::ComputeArchetypeHash(const TArray<UClass*>& InClasses)
 	{
+		//only hash reflected property values as text, native data written in Serialize can be different between editor and cooked game
+		uint32 Hash = 0;
+		FString ValueText;
+		auto HashObject = [&Hash, &ValueText](UObject* InObject) {
+			for (TFieldIterator<FProperty> PropertyItr(InObject->GetClass()); PropertyItr; ++PropertyItr)
+			{
+				auto Property = *PropertyItr;
+				if (Property->IsEditorOnlyProperty() || LPrefabSystem::LPrefab_ShouldSkipProperty(Property))continue;//not in build data
+				for (int i = 0; i < Property->ArrayDim; i++)
+				{
+					ValueText.Reset();
+					Property->ExportText_InContainer(i, ValueText, InObject, nullptr, nullptr, PPF_None);
+					Hash = FCrc::StrCrc32(*ValueText, Hash);
+				}
+			}
+		};
+		for (auto Class : InClasses)
+		{
+			if (Class == nullptr)continue;
+			auto CDO = Class->GetDefaultObject();
+			HashObject(CDO);
+			TArray<UObject*> DefaultSubObjects;
+			CDO->GetDefaultSubobjects(DefaultSubObjects);
+			for (auto DefaultSubObject : DefaultSubObjects)
+			{
+				HashObject(DefaultSubObject);
+			}
+		}
+		return Hash;
+	}
+
+	bool ActorSerializer::CanDiffAgainstArchetype(UObject* InObject)
+	{
+		auto Archetype = InObject->GetArchetype();
+		if (Archetype == nullptr || Archetype->GetClass() != InObject->GetClass())return false;
+		//archetype must be class default object (actor and normal object), or default sub object of the outer's archetype (component created in constructor), because that is what runtime created object will get
+		if (!Archetype->HasAnyFlags(RF_ClassDefaultObject | RF_DefaultSubObject | RF_ArchetypeObject))return false;
+		//archetype is out of date if class is recompiling, or not fully loaded
+		if (Archetype->GetClass()->HasAnyClassFlags(CLASS_NewerVersionExists))return false;
+		if (Archetype->HasAnyFlags(RF_NeedLoad | RF_NeedPostLoad))return false;
+		return true;
+	}
+
+	void ActorSerializer::SerializeActorArray(FLPrefabSaveData& OutData)
+	{
+		LPREFAB_TRACE_SCOPE_TEXT(TEXT("LPrefab.SerializeActorArray actor: %d"), TrySerializeActorArray.Num());
+		auto& SavedActors = OutData.SavedActors;
 		for (int i = 0; i < TrySerializeActorArray.Num(); i++)
 		{
 			auto& Actor = TrySerializeActorArray[i];
@@ -95,6 +664,9 @@ namespace LPrefabSystem8
 				ActorSaveData.PrefabAssetIndex = FindOrAddAssetIdFromList(SubPrefabDataPtr->PrefabAsset);
 				ActorSaveData.ActorGuid = MapObjectToGuid[Actor];
 				ActorSaveData.MapObjectGuidFromParentPrefabToSubPrefab = SubPrefabDataPtr->MapObjectGuidFromParentPrefabToSubPrefab;
+#if WITH_EDITOR
+				ActorSaveData.bDeferLoad = SubPrefabDataPtr->bDeferLoad && i != 0;//root actor can't be deferred
+#endif
 
 				//serialize override parameter data
 				for (auto& DataItem : SubPrefabDataPtr->ObjectOverrideParameterArray)
@@ -116,11 +688,15 @@ namespace LPrefabSystem8
 
 				if (auto RootComp = Actor->GetRootComponent())
 				{
+					if (auto RootCompGuidPtr = MapObjectToGuid.Find(RootComp))
+					{
+						ActorSaveData.RootComponentGuid = *RootCompGuidPtr;
+					}
 					if (auto ParentComp = RootComp->GetAttachParent())
 					{
-						if (MapObjectToGuid.Contains(ParentComp))//check if parent component belongs to this prefab
+						if (auto ParentGuidPtr = MapObjectToGuid.Find(ParentComp))//check if parent component belongs to this prefab
 						{
-							MapSceneComponentToParent.Add(MapObjectToGuid[RootComp], MapObjectToGuid[ParentComp]);
+							ActorSaveData.RootComponentParentGuid = *ParentGuidPtr;
 						}
 					}
 				}
@@ -132,7 +708,7 @@ namespace LPrefabSystem8
 				ActorSaveData.ObjectClass = FindOrAddClassFromList(Actor->GetClass());
 				ActorSaveData.ActorGuid = ActorGuid;
 				ActorSaveData.ObjectFlags = (uint32)Actor->GetFlags();
-				WriterOrReaderFunction(Actor, SavedObjectData.Add(ActorGuid), false);
+				WriteObjectData(Actor, ActorGuid, false, OutData);
 				if (auto RootComp = Actor->GetRootComponent())
 				{
 					ActorSaveData.RootComponentGuid = MapObjectToGuid[RootComp];
@@ -150,17 +726,100 @@ namespace LPrefabSystem8
 			SavedActors.Add(ActorSaveData);
 		}
 	}
+	void ActorSerializer::CollectAwakeObjectIndices(FLPrefabSaveData& OutData)
+	{
+		OutData.AwakeObjectIndices.Reset();
+		OutData.AwakeObjectCounts.Reset();
+		OutData.AwakeComponentCounts.Reset();
+		OutData.bHasAwakeObjectIndices = false;
+		auto AddObject = [this, &OutData](UObject* InObject) {
+			auto GuidPtr = MapObjectToGuid.Find(InObject);
+			if (GuidPtr == nullptr)return false;
+			OutData.AwakeObjectIndices.Add(FindOrAddObjectIndex(*GuidPtr));
+			return true;
+		};
+		//same order as DispatchAwake: actor in generate order, actor first then its components
+		check(TrySerializeActorArray.Num() == OutData.SavedActors.Num());
+		for (int i = 0; i < TrySerializeActorArray.Num(); i++)
+		{
+			auto& ActorData = OutData.SavedActors[i];
+			auto AwakeStart = OutData.AwakeObjectIndices.Num();
+			if (ActorData.bIsPrefab)
+			{
+				if (ActorData.bDeferLoad)//deferred sub prefab call Awake when realize
+				{
+					OutData.AwakeObjectCounts.Add(0);
+					continue;
+				}
+				//sub prefab is loaded by it's own data, objects in it are not indexed here
+				OutData.AwakeObjectIndices.Reset();
+				OutData.AwakeObjectCounts.Reset();
+				return;
+			}
+			auto Actor = TrySerializeActorArray[i];
+			if (Actor->GetClass()->ImplementsInterface(ULPrefabInterface::StaticClass()))
+			{
+				if (!AddObject(Actor))
+				{
+					OutData.AwakeObjectIndices.Reset();
+					OutData.AwakeObjectCounts.Reset();
+					return;
+				}
+			}
+			for (auto Comp : Actor->GetComponents())
+			{
+				if (Comp->IsEditorOnly())continue;
+				if (Comp->GetClass()->ImplementsInterface(ULPrefabInterface::StaticClass()))
+				{
+					if (!AddObject(Comp))
+					{
+						OutData.AwakeObjectIndices.Reset();
+						OutData.AwakeObjectCounts.Reset();
+						return;
+					}
+				}
+			}
+			OutData.AwakeObjectCounts.Add(OutData.AwakeObjectIndices.Num() - AwakeStart);
+		}
+		//count from saved data instead of Actor->GetComponents, so it is the same as TranscodeBuildData
+		CollectAwakeComponentCounts(*this, OutData);
+		OutData.bHasAwakeObjectIndices = true;
+	}
+	void ActorSerializer::CollectAwakeComponentCounts(LPrefabSystem::ActorSerializerBase& InSerializer, FLPrefabSaveData& InOutData)
+	{
+		TMap<FGuid, int32> MapActorGuidToIndex;
+		MapActorGuidToIndex.Reserve(InOutData.SavedActors.Num());
+		for (int i = 0; i < InOutData.SavedActors.Num(); i++)
+		{
+			MapActorGuidToIndex.Add(InOutData.SavedActors[i].ActorGuid, i);
+		}
+		InOutData.AwakeComponentCounts.Reset();
+		InOutData.AwakeComponentCounts.SetNumZeroed(InOutData.SavedActors.Num());
+		for (auto& ObjectData : InOutData.SavedObjects)
+		{
+			auto ActorIndexPtr = MapActorGuidToIndex.Find(ObjectData.OuterObjectGuid);
+			if (ActorIndexPtr == nullptr)continue;
+			auto Class = InSerializer.FindClassFromListByIndex(ObjectData.ObjectClass);
+			if (Class != nullptr && Class->IsChildOf(UActorComponent::StaticClass()))
+			{
+				InOutData.AwakeComponentCounts[*ActorIndexPtr]++;
+			}
+		}
+	}
 	void ActorSerializer::SerializeActorToData(AActor* OriginRootActor, FLPrefabSaveData& OutData)
 	{
 		if (LPrefabManager == nullptr)
 		{
 			LPrefabManager = ULPrefabWorldSubsystem::GetInstance(OriginRootActor->GetWorld());
 		}
-		CollectActorRecursive(OriginRootActor);
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(LPrefab.CollectActorRecursive);
+			CollectActorRecursive(OriginRootActor);
+		}
 		//serailize actor
-		SerializeActorArray(OutData.MapSceneComponentToParent, OutData.SavedActors, OutData.SavedObjectData);
+		SerializeActorArray(OutData);
 		//serialize objects and components
-		SerializeObjectArray(OutData.SavedObjects, OutData.SavedObjectData, OutData.MapSceneComponentToParent);
+		SerializeObjectArray(OutData);
 	}
 	void ActorSerializer::SerializeActor(AActor* OriginRootActor, ULPrefab* InPrefab)
 	{
@@ -178,6 +837,16 @@ namespace LPrefabSystem8
 		}
 		else
 #endif
+		if (bWriteObjectIndex)
+		{
+			CollectAwakeObjectIndices(SaveData);
+			SaveData.bDeltaAgainstArchetype = bDeltaAgainstArchetype;
+			SaveData.bTargetedOverrideParameter = bTargetedOverrideParameter;
+			SaveData.bTaggedPropertyData = bTaggedPropertyData;
+			SaveData.ObjectGuids = ObjectIndexToGuid;//index already used by object reference in property data
+			SaveData.SerializeCompact(ToBinary);
+		}
+		else
 		{
 			ToBinary << SaveData;
 		}
@@ -204,12 +873,22 @@ namespace LPrefabSystem8
 			InPrefab->ReferenceAssetList = this->ReferenceAssetList;
 			InPrefab->ReferenceClassList = this->ReferenceClassList;
 			InPrefab->ReferenceNameList = this->ReferenceNameList;
+			//parent prefab tell sub prefab if its runtime data is loaded, without load parent prefab. see ULPrefab::CanMergeStaticMeshesWhenCook
+			InPrefab->SubPrefabDeferLoadRecord.Empty();
+			for (auto& KeyValue : this->SubPrefabMap)
+			{
+				if (!IsValid(KeyValue.Value.PrefabAsset))continue;
+				auto& bDeferLoad = InPrefab->SubPrefabDeferLoadRecord.FindOrAdd(FSoftObjectPath(KeyValue.Value.PrefabAsset));
+				bDeferLoad = bDeferLoad || KeyValue.Value.bDeferLoad;
+			}
+			InPrefab->bHasSubPrefabDeferLoadRecord = true;
 
 			InPrefab->ArchiveVersion = GPackageFileUEVersion.FileVersionUE4;
 			InPrefab->ArchiveVersionUE5 = GPackageFileUEVersion.FileVersionUE5;
 			InPrefab->ArchiveLicenseeVer = GPackageFileLicenseeUEVersion;
 			InPrefab->ArEngineNetVer = FNetworkVersion::GetEngineNetworkProtocolVersion();
 			InPrefab->ArGameNetVer = FNetworkVersion::GetGameNetworkProtocolVersion();
+			InPrefab->PrefabVersion = LPREFAB_CURRENT_VERSION;//editor data layout, build data layout is recorded by BuildDataVersion
 
 			InPrefab->MarkPackageDirty();
 		}
@@ -217,6 +896,12 @@ namespace LPrefabSystem8
 #endif
 		{
 			InPrefab->BinaryDataForBuild = ToBinary;
+			InPrefab->BuildDataVersion = bWriteObjectIndex ? LPREFAB_CURRENT_BUILD_DATA_VERSION : LPREFAB_CURRENT_VERSION;
+			InPrefab->ArchetypeHashForBuild = bDeltaAgainstArchetype ? ComputeArchetypeHash(this->ReferenceClassList) : 0;
+			if (DeltaFallbackObjectCount > 0)
+			{
+				UE_LOG(LPrefab, Warning, TEXT("[%s].%d %d object(s) in prefab '%s' can't diff against archetype, store full data for them."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, DeltaFallbackObjectCount, *InPrefab->GetPathName());
+			}
 
 			//fill new reference data
 			InPrefab->ReferenceAssetListForBuild = this->ReferenceAssetList;
@@ -232,7 +917,7 @@ namespace LPrefabSystem8
 
 		InPrefab->EngineMajorVersion = ENGINE_MAJOR_VERSION;
 		InPrefab->EngineMinorVersion = ENGINE_MINOR_VERSION;
-		InPrefab->PrefabVersion = LPREFAB_CURRENT_VERSION;
+		InPrefab->ClearParsedSaveData();//binary data changed, so cached data is out of date
 
 		auto TimeSpan = FDateTime::Now() - StartTime;
 		UE_LOG(LPrefab, Log, TEXT("Take %fs saving prefab: %s"), TimeSpan.GetTotalSeconds(), *InPrefab->GetName());
@@ -268,7 +953,7 @@ namespace LPrefabSystem8
 		bool bIsSubprefabActor = SubPrefabActorArray.Contains(Actor);
 		if (!bIsSubprefabActor)//sub prefab's actor should not put to the list
 		{
-			WillSerializeActorArray.Add(Actor);//sub-prefab just keep a reference, no need to serialize
+			AddWillSerializeActor(Actor);//sub-prefab just keep a reference, no need to serialize
 			TrySerializeActorArray.Add(Actor);
 		}
 		else
@@ -302,8 +987,10 @@ namespace LPrefabSystem8
 		}
 	}
 
-	void ActorSerializer::SerializeObjectArray(TMap<FGuid, FLGUIObjectSaveData>& ObjectSaveDataArray, TMap<FGuid, TArray<uint8>>& SavedObjectData, TMap<FGuid, FGuid>& MapSceneComponentToParent)
+	void ActorSerializer::SerializeObjectArray(FLPrefabSaveData& OutData)
 	{
+		LPREFAB_TRACE_SCOPE_TEXT(TEXT("LPrefab.SerializeObjectArray object: %d"), WillSerializeObjectArray.Num());
+		OutData.SavedObjects.Reserve(OutData.SavedObjects.Num() + WillSerializeObjectArray.Num());
 		for (int i = 0; i < WillSerializeObjectArray.Num(); i++)
 		{
 			auto Object = WillSerializeObjectArray[i];
@@ -318,13 +1005,13 @@ namespace LPrefabSystem8
 			{
 				if (auto ParentComp = SceneComp->GetAttachParent())
 				{
-					if (MapObjectToGuid.Contains(ParentComp))//check if parent component belongs to this prefab
+					if (auto ParentGuidPtr = MapObjectToGuid.Find(ParentComp))//check if parent component belongs to this prefab
 					{
-						MapSceneComponentToParent.Add(MapObjectToGuid[Object], MapObjectToGuid[ParentComp]);
+						ObjectSaveDataItem.SceneComponentParentGuid = *ParentGuidPtr;
 					}
 				}
 			}
-			WriterOrReaderFunction(Object, SavedObjectData.Add(MapObjectToGuid[Object]), SceneComp != nullptr);
+			WriteObjectData(Object, MapObjectToGuid[Object], SceneComp != nullptr, OutData);
 			TArray<UObject*> DefaultSubObjects;
 			Object->CollectDefaultSubobjects(DefaultSubObjects);
 			for (auto DefaultSubObject : DefaultSubObjects)
@@ -334,7 +1021,8 @@ namespace LPrefabSystem8
 				ObjectSaveDataItem.DefaultSubObjectGuidArray.Add(MapObjectToGuid[DefaultSubObject]);
 				ObjectSaveDataItem.DefaultSubObjectNameArray.Add(DefaultSubObject->GetFName());
 			}
-			ObjectSaveDataArray.Add(MapObjectToGuid[Object], ObjectSaveDataItem);
+			ObjectSaveDataItem.ObjectGuid = MapObjectToGuid[Object];
+			OutData.SavedObjects.Add(ObjectSaveDataItem);
 		}
 	}
 }
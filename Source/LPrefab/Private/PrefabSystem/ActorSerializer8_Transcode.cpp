@@ -0,0 +1,525 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "PrefabSystem/ActorSerializer8.h"
+#include "PrefabSystem/LPrefabObjectReaderAndWriter.h"
+#include "PrefabSystem/ILPrefabInterface.h"
+#include "GameFramework/Actor.h"
+#include "Components/SceneComponent.h"
+#include "LPrefabModule.h"
+#include "Misc/NetworkVersion.h"
+#include "Misc/ScopeRWLock.h"
+#include "HAL/IConsoleManager.h"
+#include "Serialization/MemoryReader.h"
+#include "UObject/ObjectKey.h"
+#include "UObject/UObjectGlobals.h"
+#include "UObject/GarbageCollection.h"
+
+#if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
+PRAGMA_DISABLE_OPTIMIZATION
+#endif
+
+#if WITH_EDITOR
+namespace LPrefabSystem8
+{
+	/** Classes that write native data in Serialize (after or before script properties), property data of them can only be transcoded by agent objects. */
+	static TSet<FObjectKey> TranscodeNativeDataClasses;
+	static FRWLock TranscodeNativeDataClassesLock;
+	/**
+	 * Objects of every class that stand for objects in prefab: reference to an object in prefab is read as a stand-in of the same class, so object property get a valid object to check type, and writer map it back to guid.
+	 * Stand-ins are never changed after created, so transcodes in any thread share them. They are only created in game thread.
+	 */
+	static TMap<FObjectKey, TArray<UObject*>> TranscodeStandIns;
+	static FRWLock TranscodeStandInsLock;
+
+	void ActorSerializer::ClearTranscodeClassCache()
+	{
+		check(IsInGameThread());
+		{
+			FRWScopeLock ScopeLock(TranscodeNativeDataClassesLock, SLT_Write);
+			TranscodeNativeDataClasses.Empty();
+		}
+		FRWScopeLock ScopeLock(TranscodeStandInsLock, SLT_Write);
+		for (auto& KeyValue : TranscodeStandIns)
+		{
+			for (auto StandIn : KeyValue.Value)
+			{
+				StandIn->RemoveFromRoot();
+				StandIn->MarkAsGarbage();
+			}
+		}
+		TranscodeStandIns.Empty();
+	}
+
+	/** Get InIndex-th stand-in of InClass, create it if in game thread. Return nullptr if not created yet in other thread. */
+	static UObject* GetTranscodeStandIn(UClass* InClass, int32 InIndex)
+	{
+		{
+			FRWScopeLock ScopeLock(TranscodeStandInsLock, SLT_ReadOnly);
+			if (auto StandInsPtr = TranscodeStandIns.Find(FObjectKey(InClass)))
+			{
+				if (StandInsPtr->IsValidIndex(InIndex))
+				{
+					return (*StandInsPtr)[InIndex];
+				}
+			}
+		}
+		if (!IsInGameThread())return nullptr;
+		FRWScopeLock ScopeLock(TranscodeStandInsLock, SLT_Write);
+		auto& StandIns = TranscodeStandIns.FindOrAdd(FObjectKey(InClass));
+		while (StandIns.Num() <= InIndex)
+		{
+			auto StandIn = NewObject<UObject>(GetTransientPackage(), InClass, NAME_None, RF_Transient);
+			StandIn->AddToRoot();
+			StandIns.Add(StandIn);
+		}
+		return StandIns[InIndex];
+	}
+
+	/**
+	 * Property values of one object in prefab, laid out as the object's class, but never constructed as UObject (header is zero) or seen by UObject system, so it is safe in any thread.
+	 * Values start from archetype, as the agent object does before its data is applied. Reference to this object is read as StandIn.
+	 */
+	class FLPrefabTranscodeContainer
+	{
+	public:
+		FLPrefabTranscodeContainer(UClass* InClass, UObject* InArchetype)
+			: Class(InClass)
+			, Archetype(InArchetype)
+		{
+			Memory = (uint8*)FMemory::Malloc(Class->GetStructureSize(), Class->GetMinAlignment());
+			Class->InitializeStruct(Memory);
+			for (FProperty* Property = Class->PropertyLink; Property != nullptr; Property = Property->PropertyLinkNext)
+			{
+				Property->CopyCompleteValue_InContainer(Memory, Archetype);
+			}
+		}
+		~FLPrefabTranscodeContainer()
+		{
+			Class->DestroyStruct(Memory);
+			FMemory::Free(Memory);
+		}
+		FLPrefabTranscodeContainer(const FLPrefabTranscodeContainer&) = delete;
+		FLPrefabTranscodeContainer& operator=(const FLPrefabTranscodeContainer&) = delete;
+
+		UClass* Class = nullptr;
+		UObject* Archetype = nullptr;
+		uint8* Memory = nullptr;
+		/** Assigned when this object is referenced the first time. */
+		UObject* StandIn = nullptr;
+	};
+
+	/** Serializer that only hold reference lists and object maps for reader/writer, objects in the maps are stand-ins. */
+	class FLPrefabTranscodeSerializer : public LPrefabSystem::ActorSerializerBase
+	{
+	public:
+		FLPrefabTranscodeSerializer(bool InIsEditorOrRuntime)
+		{
+			bIsEditorOrRuntime = InIsEditorOrRuntime;
+		}
+	};
+
+	class FLPrefabTranscodeObjectReader : public LPrefabSystem::FLPrefabObjectReader
+	{
+	public:
+		FLPrefabTranscodeObjectReader(TArray<uint8>& Bytes, LPrefabSystem::ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames, TFunctionRef<bool(const FGuid&, UObject*&)> InResolveReference)
+			: FLPrefabObjectReader(Bytes, InSerializer, InSkipPropertyNames)
+			, ResolveReference(InResolveReference)
+		{
+		}
+		virtual bool SerializeObject(UObject*& Object, bool CanSerializeClass) override
+		{
+			//object in prefab is resolved to stand-in when first referenced, other types go normal way
+			auto Offset = Tell();
+			uint8 type = 0;
+			*this << type;
+			if (type == (uint8)LPrefabSystem::EObjectType::ObjectReference)
+			{
+				FGuid Guid;
+				*this << Guid;
+				if (ResolveReference(Guid, Object))
+				{
+					return Object != nullptr;
+				}
+			}
+			Seek(Offset);
+			return FLPrefabObjectReader::SerializeObject(Object, CanSerializeClass);
+		}
+		virtual FArchive& operator<<(FWeakObjectPtr& Value) override
+		{
+			UObject* Res = nullptr;
+			SerializeObject(Res, false);
+			if (Res)
+			{
+				if (Serializer.MapObjectToGuid.Contains(Res))
+				{
+					bHasWeakReferenceToStandIn = true;//weak pointer is tracked by object index, which stand-in don't have
+				}
+				else
+				{
+					Value = Res;
+				}
+			}
+			return *this;
+		}
+		virtual FString GetArchiveName() const override
+		{
+			return TEXT("FLPrefabTranscodeObjectReader");
+		}
+		bool bHasWeakReferenceToStandIn = false;
+	private:
+		/** Return false if guid is not an object in prefab, Object is nullptr if stand-in is not available. */
+		TFunctionRef<bool(const FGuid&, UObject*&)> ResolveReference;
+	};
+
+	class FLPrefabTranscodeObjectWriter : public LPrefabSystem::FLPrefabObjectWriter
+	{
+	public:
+		FLPrefabTranscodeObjectWriter(TArray<uint8>& Bytes, LPrefabSystem::ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames)
+			: FLPrefabObjectWriter(Bytes, InSerializer, InSkipPropertyNames)
+		{
+		}
+		virtual bool SerializeObject(UObject* Object) override
+		{
+			if (auto GuidPtr = Serializer.MapObjectToGuid.Find(Object))
+			{
+				if (Serializer.bWriteObjectIndex)
+				{
+					auto type = (uint8)LPrefabSystem::EObjectType::ObjectIndex;
+					auto index = Serializer.FindOrAddObjectIndex(*GuidPtr);
+					*this << type;
+					*this << index;
+					return true;
+				}
+				auto type = (uint8)LPrefabSystem::EObjectType::ObjectReference;
+				*this << type;
+				*this << *GuidPtr;
+				return true;
+			}
+			if (Object->IsA<UFunction>()
+				|| Object->GetName().StartsWith(TEXT("K2Node_"))
+				|| (Object->IsAsset() && !Object->GetClass()->IsChildOf(AActor::StaticClass()))
+				)
+			{
+				return FLPrefabObjectWriter::SerializeObject(Object);
+			}
+			//not created by this prefab, eg: default sub object of class default object. agent object will reference it's own instance
+			UnknownObject = Object;
+			return false;
+		}
+		virtual FString GetArchiveName() const override
+		{
+			return TEXT("FLPrefabTranscodeObjectWriter");
+		}
+		UObject* UnknownObject = nullptr;
+	};
+
+	bool ActorSerializer::TranscodeBuildData(ULPrefab* InPrefab, bool InDeltaAgainstArchetype, FLPrefabTranscodedBuildData& OutData, FString& OutFailReason)
+	{
+		//archetype lookup and stand-in reference need objects alive, keep GC out when in other thread
+		TOptional<FGCScopeGuard> GCGuard;
+		if (!IsInGameThread())
+		{
+			GCGuard.Emplace();
+		}
+		SCOPE_CYCLE_COUNTER(STAT_LPrefab_TranscodeBuildData);
+		LPREFAB_TRACE_SCOPE_TEXT(TEXT("LPrefab.TranscodeBuildData %s"), *InPrefab->GetName());
+		if (InPrefab->PrefabVersion < LPREFAB_SERIALIZER_NEWEST_MIN_VERSION)
+		{
+			OutFailReason = FString::Printf(TEXT("editor data is saved with old version %d"), InPrefab->PrefabVersion);
+			return false;
+		}
+		if (InPrefab->BinaryData.Num() == 0)
+		{
+			OutFailReason = TEXT("editor data is empty");
+			return false;
+		}
+
+		FLPrefabSaveData SaveData;
+		{
+			auto FromBinary = FMemoryReader(InPrefab->BinaryData, false);
+			SaveData.Serialize(FStructuredArchiveFromArchive(FromBinary).GetSlot(), InPrefab->PrefabVersion);
+			if (FromBinary.IsError())
+			{
+				OutFailReason = TEXT("editor data is corrupted");
+				return false;
+			}
+		}
+		for (auto& ActorData : SaveData.SavedActors)
+		{
+			if (ActorData.bIsPrefab)
+			{
+				OutFailReason = TEXT("sub prefab need to be loaded to apply override parameters");
+				return false;
+			}
+		}
+
+		//editor side, same as ActorSerializer::SetupForPrefab
+		FLPrefabTranscodeSerializer EditorSerializer(true);
+		EditorSerializer.ReferenceAssetList = InPrefab->ReferenceAssetList;
+		EditorSerializer.ReferenceClassList = InPrefab->ReferenceClassList;
+		EditorSerializer.ReferenceNameList = InPrefab->ReferenceNameList;
+		EditorSerializer.bOverrideVersions = true;
+		EditorSerializer.ArchiveVersion = FPackageFileVersion(InPrefab->ArchiveVersion, (EUnrealEngineObjectUE5Version)InPrefab->ArchiveVersionUE5);
+		EditorSerializer.ArchiveLicenseeVer = InPrefab->ArchiveLicenseeVer;
+		EditorSerializer.ArEngineNetVer = InPrefab->ArEngineNetVer;
+		EditorSerializer.ArGameNetVer = InPrefab->ArGameNetVer;
+		EditorSerializer.PrefabVersion = InPrefab->PrefabVersion;
+		EditorSerializer.ArEngineVer = FEngineVersionBase(InPrefab->EngineMajorVersion, InPrefab->EngineMinorVersion, InPrefab->EnginePatchVersion);
+		TArray<FName> UnresolvedProperties;
+		EditorSerializer.UnresolvedObjectReferenceProperties = &UnresolvedProperties;
+
+		//build side, same as ActorSerializer::SavePrefab
+		static const auto CompactCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("LPrefab.CompactBuildData"));
+		FLPrefabTranscodeSerializer BuildSerializer(false);
+		BuildSerializer.bWriteObjectIndex = CompactCVar == nullptr || CompactCVar->GetInt() != 0;
+		bool bDelta = BuildSerializer.bWriteObjectIndex && InDeltaAgainstArchetype;
+		BuildSerializer.bDeltaAgainstArchetype = bDelta;
+
+		TMap<FGuid, int32> MapGuidToDataIndex;
+		MapGuidToDataIndex.Reserve(SaveData.SavedObjectData.Num());
+		for (int i = 0; i < SaveData.SavedObjectData.Num(); i++)
+		{
+			MapGuidToDataIndex.Add(SaveData.SavedObjectData[i].ObjectGuid, i);
+		}
+
+		//create containers, actors first then objects, outer is always before sub object in SavedObjects
+		struct FContainerItem
+		{
+			FGuid Guid;
+			int32* ObjectClass = nullptr;
+			TUniquePtr<FLPrefabTranscodeContainer> Container;
+		};
+		TArray<FContainerItem> ContainerItems;
+		ContainerItems.Reserve(SaveData.SavedActors.Num() + SaveData.SavedObjects.Num());
+		TMap<FGuid, int32> MapGuidToItemIndex;
+		MapGuidToItemIndex.Reserve(ContainerItems.Max());
+		auto CreateContainer = [&](const FGuid& InGuid, int32& InOutObjectClass, const FGuid& InOuterGuid, FName InObjectName) {
+			auto Class = EditorSerializer.FindClassFromListByIndex(InOutObjectClass);
+			if (Class == nullptr)
+			{
+				OutFailReason = FString::Printf(TEXT("missing class at index %d"), InOutObjectClass);
+				return false;
+			}
+			if (Class->HasAnyClassFlags(CLASS_NewerVersionExists | CLASS_Abstract))
+			{
+				OutFailReason = FString::Printf(TEXT("class '%s' is out of date or abstract"), *Class->GetPathName());
+				return false;
+			}
+			{
+				FRWScopeLock ScopeLock(TranscodeNativeDataClassesLock, SLT_ReadOnly);
+				if (TranscodeNativeDataClasses.Contains(FObjectKey(Class)))
+				{
+					OutFailReason = FString::Printf(TEXT("class '%s' write native data in Serialize"), *Class->GetPathName());
+					return false;
+				}
+			}
+			//same as UObject::GetArchetype: default sub object use the one in outer's archetype, otherwise class default object
+			UObject* Archetype = nullptr;
+			if (auto OuterItemIndexPtr = MapGuidToItemIndex.Find(InOuterGuid))
+			{
+				Archetype = StaticFindObjectFast(Class, ContainerItems[*OuterItemIndexPtr].Container->Archetype, InObjectName, true);
+			}
+			if (Archetype == nullptr)
+			{
+				Archetype = Class->GetDefaultObject(false);
+			}
+			if (Archetype == nullptr || Archetype->HasAnyFlags(RF_NeedLoad | RF_NeedPostLoad))
+			{
+				OutFailReason = FString::Printf(TEXT("archetype of class '%s' is not loaded"), *Class->GetPathName());
+				return false;
+			}
+			MapGuidToItemIndex.Add(InGuid, ContainerItems.Num());
+			auto& Item = ContainerItems.AddDefaulted_GetRef();
+			Item.Guid = InGuid;
+			Item.ObjectClass = &InOutObjectClass;
+			Item.Container = MakeUnique<FLPrefabTranscodeContainer>(Class, Archetype);
+			return true;
+		};
+		for (auto& ActorData : SaveData.SavedActors)
+		{
+			if (!CreateContainer(ActorData.ActorGuid, ActorData.ObjectClass, FGuid(), NAME_None))return false;
+		}
+		for (auto& ObjectData : SaveData.SavedObjects)
+		{
+			if (!CreateContainer(ObjectData.ObjectGuid, ObjectData.ObjectClass, ObjectData.OuterObjectGuid, ObjectData.ObjectName))return false;
+		}
+
+		//only referenced objects get stand-in, n-th referenced object of a class use n-th stand-in of the class
+		TMap<FObjectKey, int32> StandInCountOfClass;
+		UClass* MissingStandInClass = nullptr;
+		auto ResolveReference = [&](const FGuid& InGuid, UObject*& OutObject) {
+			auto ItemIndexPtr = MapGuidToItemIndex.Find(InGuid);
+			if (ItemIndexPtr == nullptr)return false;
+			auto& Container = *ContainerItems[*ItemIndexPtr].Container;
+			if (Container.StandIn == nullptr)
+			{
+				auto& Count = StandInCountOfClass.FindOrAdd(FObjectKey(Container.Class));
+				Container.StandIn = GetTranscodeStandIn(Container.Class, Count);
+				if (Container.StandIn == nullptr)
+				{
+					MissingStandInClass = Container.Class;
+					OutObject = nullptr;
+					return true;
+				}
+				Count++;
+				EditorSerializer.MapObjectToGuid.Add(Container.StandIn, InGuid);
+				BuildSerializer.MapObjectToGuid.Add(Container.StandIn, InGuid);
+			}
+			OutObject = Container.StandIn;
+			return true;
+		};
+
+		static const auto ActorEditorOnlyProperty = FindFProperty<FBoolProperty>(AActor::StaticClass(), TEXT("bIsEditorOnlyActor"));
+		static const auto ComponentEditorOnlyProperty = FindFProperty<FBoolProperty>(UActorComponent::StaticClass(), TEXT("bIsEditorOnly"));
+		bool bHasAwakeComponent = false;
+		TArray<FLPrefabObjectPropertySaveData> BuildObjectData;
+		BuildObjectData.Reserve(ContainerItems.Num());
+		for (auto& Item : ContainerItems)
+		{
+			auto& Container = *Item.Container;
+			auto Class = Container.Class;
+			auto DataIndexPtr = MapGuidToDataIndex.Find(Item.Guid);
+			if (DataIndexPtr == nullptr)
+			{
+				OutFailReason = FString::Printf(TEXT("missing property data of object with class '%s'"), *Class->GetName());
+				return false;
+			}
+			const auto& ExcludeProperties = EditorSerializer.GetExcludeProperties(Class->IsChildOf(USceneComponent::StaticClass()));
+
+			//read editor data, same as UObject::Serialize with tagged property
+			{
+				FLPrefabTranscodeObjectReader Reader(SaveData.SavedObjectData[*DataIndexPtr].Data, EditorSerializer, ExcludeProperties, ResolveReference);
+				Class->SerializeTaggedProperties(Reader, Container.Memory, Class, (uint8*)Container.Archetype);
+				bool bHasGuid = false;
+				Reader << bHasGuid;
+				if (MissingStandInClass != nullptr)
+				{
+					OutFailReason = FString::Printf(TEXT("stand-in of class '%s' is only created in game thread"), *MissingStandInClass->GetName());
+					return false;
+				}
+				if (Reader.IsError() || bHasGuid || !Reader.AtEnd())
+				{
+					FRWScopeLock ScopeLock(TranscodeNativeDataClassesLock, SLT_Write);
+					TranscodeNativeDataClasses.Add(FObjectKey(Class));
+					OutFailReason = FString::Printf(TEXT("class '%s' write native data in Serialize"), *Class->GetPathName());
+					return false;
+				}
+				if (Reader.bHasWeakReferenceToStandIn)
+				{
+					OutFailReason = FString::Printf(TEXT("class '%s' has weak reference to object in prefab"), *Class->GetName());
+					return false;
+				}
+				if (UnresolvedProperties.Num() > 0)
+				{
+					OutFailReason = FString::Printf(TEXT("property '%s' of class '%s' reference object that not exist"), *UnresolvedProperties[0].ToString(), *Class->GetName());
+					return false;
+				}
+			}
+			//editor only object is skipped in build data, and reference to it become null. leave it to agent objects
+			bool bIsEditorOnly = Container.Archetype->IsEditorOnly();
+			if (Class->IsChildOf(AActor::StaticClass()))
+			{
+				bIsEditorOnly |= ActorEditorOnlyProperty != nullptr && ActorEditorOnlyProperty->GetPropertyValue_InContainer(Container.Memory);
+			}
+			else if (Class->IsChildOf(UActorComponent::StaticClass()))
+			{
+				bIsEditorOnly |= ComponentEditorOnlyProperty != nullptr && ComponentEditorOnlyProperty->GetPropertyValue_InContainer(Container.Memory);
+				bHasAwakeComponent |= Class->ImplementsInterface(ULPrefabInterface::StaticClass());
+			}
+			if (bIsEditorOnly)
+			{
+				OutFailReason = FString::Printf(TEXT("object with class '%s' is editor only"), *Class->GetName());
+				return false;
+			}
+
+			//write build data, same as UObject::Serialize in SavePrefab: tagged property diffed against archetype for delta, otherwise binary property. class is added before property data, same order as SavePrefab
+			*Item.ObjectClass = BuildSerializer.FindOrAddClassFromList(Class);
+			auto& BuildItem = BuildObjectData.AddDefaulted_GetRef();
+			BuildItem.ObjectGuid = Item.Guid;
+			{
+				FLPrefabTranscodeObjectWriter Writer(BuildItem.Data, BuildSerializer, ExcludeProperties);
+				if (bDelta)
+				{
+					Writer.ArNoDelta = false;
+					Writer.ArNoIntraPropertyDelta = false;
+					Class->SerializeTaggedProperties(Writer, Container.Memory, Class, (uint8*)Container.Archetype);
+				}
+				else
+				{
+					Class->SerializeBin(Writer, Container.Memory);
+				}
+				bool bHasGuid = false;
+				Writer << bHasGuid;
+				if (Writer.UnknownObject != nullptr)
+				{
+					OutFailReason = FString::Printf(TEXT("class '%s' reference object '%s' which is not in prefab"), *Class->GetName(), *Writer.UnknownObject->GetPathName());
+					return false;
+				}
+			}
+		}
+		SaveData.SavedObjectData = MoveTemp(BuildObjectData);
+
+		FBufferArchive ToBinary;
+		if (BuildSerializer.bWriteObjectIndex)
+		{
+			//same as CollectAwakeObjectIndices. component's order is from Actor->GetComponents which need the real actor, so leave it to runtime if any component need Awake
+			SaveData.AwakeObjectIndices.Reset();
+			SaveData.AwakeObjectCounts.Reset();
+			SaveData.AwakeComponentCounts.Reset();
+			SaveData.bHasAwakeObjectIndices = !bHasAwakeComponent;
+			if (SaveData.bHasAwakeObjectIndices)
+			{
+				for (auto& ActorData : SaveData.SavedActors)
+				{
+					bool bNeedAwake = BuildSerializer.FindClassFromListByIndex(ActorData.ObjectClass)->ImplementsInterface(ULPrefabInterface::StaticClass());
+					if (bNeedAwake)
+					{
+						SaveData.AwakeObjectIndices.Add(BuildSerializer.FindOrAddObjectIndex(ActorData.ActorGuid));
+					}
+					SaveData.AwakeObjectCounts.Add(bNeedAwake ? 1 : 0);
+				}
+				CollectAwakeComponentCounts(BuildSerializer, SaveData);
+			}
+			SaveData.bDeltaAgainstArchetype = bDelta;
+			static const auto TargetedCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("LPrefab.TargetedOverrideParameter"));
+			SaveData.bTargetedOverrideParameter = TargetedCVar == nullptr || TargetedCVar->GetInt() != 0;//no sub prefab here, but keep same as SavePrefab
+			SaveData.ObjectGuids = BuildSerializer.ObjectIndexToGuid;//index already used by object reference in property data
+			SaveData.SerializeCompact(ToBinary);
+		}
+		else
+		{
+			ToBinary << SaveData;
+		}
+
+		OutData.BinaryDataForBuild = ToBinary;
+		OutData.BuildDataVersion = BuildSerializer.bWriteObjectIndex ? LPREFAB_CURRENT_BUILD_DATA_VERSION : LPREFAB_CURRENT_VERSION;
+		OutData.ArchetypeHashForBuild = bDelta ? ComputeArchetypeHash(BuildSerializer.ReferenceClassList) : 0;
+		OutData.ReferenceAssetList = BuildSerializer.ReferenceAssetList;
+		OutData.ReferenceClassList = BuildSerializer.ReferenceClassList;
+		OutData.ReferenceNameList = BuildSerializer.ReferenceNameList;
+		return true;
+	}
+
+	void ActorSerializer::ApplyTranscodedBuildData(ULPrefab* InPrefab, FLPrefabTranscodedBuildData& InData)
+	{
+		InPrefab->BinaryDataForBuild = MoveTemp(InData.BinaryDataForBuild);
+		InPrefab->BuildDataVersion = InData.BuildDataVersion;
+		InPrefab->ArchetypeHashForBuild = InData.ArchetypeHashForBuild;
+
+		InPrefab->ReferenceAssetListForBuild = InData.ReferenceAssetList;
+		InPrefab->ReferenceClassListForBuild = InData.ReferenceClassList;
+		InPrefab->ReferenceNameListForBuild = InData.ReferenceNameList;
+
+		InPrefab->ArchiveVersion_ForBuild = GPackageFileUEVersion.FileVersionUE4;
+		InPrefab->ArchiveVersionUE5_ForBuild = GPackageFileUEVersion.FileVersionUE5;
+		InPrefab->ArchiveLicenseeVer_ForBuild = GPackageFileLicenseeUEVersion;
+		InPrefab->ArEngineNetVer_ForBuild = FNetworkVersion::GetEngineNetworkProtocolVersion();
+		InPrefab->ArGameNetVer_ForBuild = FNetworkVersion::GetGameNetworkProtocolVersion();
+		InPrefab->ClearParsedSaveData();//binary data changed, so cached data is out of date
+	}
+}
+#endif
+
+#if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
+PRAGMA_ENABLE_OPTIMIZATION
+#endif
@@ -5,6 +5,7 @@
 #include "PrefabSystem/LPrefabObjectReaderAndWriter.h"
 #include "LPrefabModule.h"
 #include "Misc/ConfigCacheIni.h"
+#include "Serialization/ArchiveSerializedPropertyChain.h"
 #if WITH_EDITOR
 #include "Tools/UEdMode.h"
 #include "LPrefabUtils.h"
@@ -17,19 +18,41 @@ namespace LPrefabSystem
 		UObject* Outer = InObject;
 		while (Outer != nullptr)
 		{
-			if (Outer->GetName().StartsWith(TEXT("TRASH_")))
+			if (!IsValid(Outer) || Outer->HasAnyFlags(EObjectFlags::RF_NewerVersionExists))
 			{
 				return true;
 			}
+#if WITH_EDITOR
+			//component destroyed by construction script is renamed to "TRASH_" before mark as garbage, check name with stack buffer so no string is allocated
+			TCHAR NameBuffer[NAME_SIZE];
+			Outer->GetFName().GetPlainNameString(NameBuffer);
+			if (FCString::Strncmp(NameBuffer, TEXT("TRASH_"), 6) == 0)
+			{
+				return true;
+			}
+#endif
 			Outer = Outer->GetOuter();
 		}
 		return false;
 	}
 
+	void ActorSerializerBase::AddWillSerializeActor(AActor* InActor)
+	{
+		WillSerializeActorArray.Add(InActor);
+		WillSerializeActorSet.Add(InActor);
+	}
+
+	void ActorSerializerBase::EmptyWillSerializeArray()
+	{
+		WillSerializeActorArray.Empty();
+		WillSerializeObjectArray.Empty();
+		WillSerializeActorSet.Empty();
+		WillSerializeObjectSet.Empty();
+	}
 
 	bool ActorSerializerBase::ObjectBelongsToThisPrefab(UObject* InObject)
 	{
-		if (WillSerializeActorArray.Contains(InObject))
+		if (IsWillSerializeActor(InObject))
 		{
 			return true;
 		}
@@ -39,7 +62,7 @@ namespace LPrefabSystem
 			&& !Outer->HasAnyFlags(EObjectFlags::RF_Transient)
 			)
 		{
-			if (WillSerializeActorArray.Contains(Outer))
+			if (IsWillSerializeActor(Outer))
 			{
 				return true;
 			}
@@ -57,6 +80,20 @@ namespace LPrefabSystem
 	}
 
 	bool ActorSerializerBase::CollectObjectToSerailize(UObject* Object, FGuid& OutGuid)
+	{
+		auto bCollected = CollectObjectToSerailizeInternal(Object, OutGuid);
+		if (WriteRecord != nullptr)
+		{
+			auto& Item = WriteRecord->AddDefaulted_GetRef();
+			Item.Type = FLPrefabWriteRecordItem::EType::CollectObject;
+			Item.Index = bCollected ? 1 : 0;
+			Item.Object = Object;
+			Item.Guid = bCollected ? OutGuid : FGuid();
+		}
+		return bCollected;
+	}
+
+	bool ActorSerializerBase::CollectObjectToSerailizeInternal(UObject* Object, FGuid& OutGuid)
 	{
 #if WITH_EDITOR
 		if (Object->GetClass()->IsChildOf(UEdMode::StaticClass()))return false;
@@ -68,12 +105,12 @@ namespace LPrefabSystem
 			&& Object->GetWorld() == TargetWorld
 			&& IsValid(Object)
 			&& !Object->HasAnyFlags(EObjectFlags::RF_Transient)
-			&& !WillSerializeActorArray.Contains(Object)
+			&& !IsWillSerializeActor(Object)
 			&& !Object->GetClass()->IsChildOf(AActor::StaticClass())//skip actor
 			&& ObjectBelongsToThisPrefab(Object)
 			)
 		{
-			if (WillSerializeObjectArray.Contains(Object))
+			if (IsWillSerializeObject(Object))
 			{
 				auto GuidPtr = MapObjectToGuid.Find(Object);
 				check(GuidPtr != nullptr);
@@ -84,9 +121,10 @@ namespace LPrefabSystem
 			auto Outer = Object->GetOuter();
 			check(Outer != nullptr);
 
-			if (WillSerializeActorArray.Contains(Outer))//outer is actor
+			if (IsWillSerializeActor(Outer))//outer is actor
 			{
 				WillSerializeObjectArray.Add(Object);
+				WillSerializeObjectSet.Add(Object);
 				if (auto GuidPtr = MapObjectToGuid.Find(Object))
 				{
 					OutGuid = *GuidPtr;
@@ -110,12 +148,14 @@ namespace LPrefabSystem
 					MapObjectToGuid.Add(Object, OutGuid);
 				}
 				auto Index = WillSerializeObjectArray.Add(Object);
+				WillSerializeObjectSet.Add(Object);
 				while (Outer != nullptr
-					&& !WillSerializeActorArray.Contains(Outer)//Make sure Outer is not actor, because actor is created before any other objects, they will be stored in actor's data
-					&& !WillSerializeObjectArray.Contains(Outer)//Make sure Outer is not inside array
+					&& !IsWillSerializeActor(Outer)//Make sure Outer is not actor, because actor is created before any other objects, they will be stored in actor's data
+					&& !IsWillSerializeObject(Outer)//Make sure Outer is not inside array
 					)
 				{
 					WillSerializeObjectArray.Insert(Outer, Index);//insert before object
+					WillSerializeObjectSet.Add(Outer);
 					if (!MapObjectToGuid.Contains(Outer))
 					{
 						MapObjectToGuid.Add(Outer, FGuid::NewGuid());
@@ -160,47 +200,132 @@ namespace LPrefabSystem
 	}
 
 
-	int32 ActorSerializerBase::FindOrAddAssetIdFromList(UObject* AssetObject)
+	namespace
 	{
-		if (!AssetObject)return -1;
-		int32 resultIndex;
-		if (ReferenceAssetList.Find(AssetObject, resultIndex))
+		template<typename T>
+		int32 FindOrAddFromIndexedList(TArray<T>& InOutList, TMap<T, int32>& InOutIndexMap, int32& InOutIndexedCount, const T& InItem)
 		{
-			return resultIndex;//return index if found
+			if (InOutIndexedCount > InOutList.Num())//list is replaced by a shorter one, index again
+			{
+				InOutIndexMap.Reset();
+				InOutIndexedCount = 0;
+			}
+			for (; InOutIndexedCount < InOutList.Num(); InOutIndexedCount++)//items assigned to list directly, FindOrAdd keep the first index same as TArray::Find
+			{
+				InOutIndexMap.FindOrAdd(InOutList[InOutIndexedCount], InOutIndexedCount);
+			}
+			if (auto IndexPtr = InOutIndexMap.Find(InItem))
+			{
+				return *IndexPtr;//return index if found
+			}
+			auto ResultIndex = InOutList.Add(InItem);//add to list if not found, append only so the list order is same as before
+			InOutIndexMap.Add(InItem, ResultIndex);
+			InOutIndexedCount = InOutList.Num();
+			return ResultIndex;
 		}
-		else//add to list if not found
+	}
+
+	int32 ActorSerializerBase::FindOrAddAssetIdFromList(UObject* AssetObject)
+	{
+		if (!AssetObject)return -1;
+		auto ResultIndex = FindOrAddFromIndexedList(ReferenceAssetList, MapAssetToIndex, IndexedAssetCount, AssetObject);
+		if (WriteRecord != nullptr)
 		{
-			ReferenceAssetList.Add(AssetObject);
-			return ReferenceAssetList.Num() - 1;
+			auto& Item = WriteRecord->AddDefaulted_GetRef();
+			Item.Type = FLPrefabWriteRecordItem::EType::Asset;
+			Item.Index = ResultIndex;
+			Item.Object = AssetObject;
 		}
+		return ResultIndex;
 	}
 
 	int32 ActorSerializerBase::FindOrAddClassFromList(UClass* Class)
 	{
 		if (!Class)return -1;
-		int32 resultIndex;
-		if (ReferenceClassList.Find(Class, resultIndex))
-		{
-			return resultIndex;
-		}
-		else
+		auto ResultIndex = FindOrAddFromIndexedList(ReferenceClassList, MapClassToIndex, IndexedClassCount, Class);
+		if (WriteRecord != nullptr)
 		{
-			ReferenceClassList.Add(Class);
-			return ReferenceClassList.Num() - 1;
+			auto& Item = WriteRecord->AddDefaulted_GetRef();
+			Item.Type = FLPrefabWriteRecordItem::EType::Class;
+			Item.Index = ResultIndex;
+			Item.Object = Class;
 		}
+		return ResultIndex;
 	}
 	int32 ActorSerializerBase::FindOrAddNameFromList(const FName& Name)
 	{
 		if (!Name.IsValid())return -1;
-		int32 resultIndex;
-		if (ReferenceNameList.Find(Name, resultIndex))
+		auto ResultIndex = FindOrAddFromIndexedList(ReferenceNameList, MapNameToIndex, IndexedNameCount, Name);
+		if (WriteRecord != nullptr)
+		{
+			auto& Item = WriteRecord->AddDefaulted_GetRef();
+			Item.Type = FLPrefabWriteRecordItem::EType::Name;
+			Item.Index = ResultIndex;
+			Item.Name = Name;
+		}
+		return ResultIndex;
+	}
+	bool ActorSerializerBase::ReplayWriteRecord(const TArray<FLPrefabWriteRecordItem>& InRecord)
+	{
+		for (auto& Item : InRecord)
 		{
-			return resultIndex;
+			if (Item.Type != FLPrefabWriteRecordItem::EType::Name && !Item.Object.IsValid())
+			{
+				return false;//referenced object is destroyed, property that reference it must be changed
+			}
 		}
-		else
+		check(WriteRecord == nullptr);
+		//keep going when result is different, so reference lists get the same order as writing this object. the object need to be written again, and that will get the same lookups
+		bool bSameAsRecord = true;
+		for (auto& Item : InRecord)
 		{
-			ReferenceNameList.Add(Name);
-			return ReferenceNameList.Num() - 1;
+			switch (Item.Type)
+			{
+			case FLPrefabWriteRecordItem::EType::Asset:
+				bSameAsRecord &= FindOrAddAssetIdFromList(Item.Object.Get()) == Item.Index;
+				break;
+			case FLPrefabWriteRecordItem::EType::Class:
+				bSameAsRecord &= FindOrAddClassFromList((UClass*)Item.Object.Get()) == Item.Index;
+				break;
+			case FLPrefabWriteRecordItem::EType::Name:
+				bSameAsRecord &= FindOrAddNameFromList(Item.Name) == Item.Index;
+				break;
+			case FLPrefabWriteRecordItem::EType::CollectObject:
+			{
+				FGuid Guid;
+				auto bCollected = CollectObjectToSerailize(Item.Object.Get(), Guid);
+				bSameAsRecord &= bCollected == (Item.Index != 0) && (!bCollected || Guid == Item.Guid);
+			}
+			break;
+			}
+		}
+		return bSameAsRecord;
+	}
+	int32 ActorSerializerBase::FindOrAddObjectIndex(const FGuid& Guid)
+	{
+		if (auto IndexPtr = MapGuidToObjectIndex.Find(Guid))
+		{
+			return *IndexPtr;
+		}
+		auto resultIndex = ObjectIndexToGuid.Add(Guid);
+		MapGuidToObjectIndex.Add(Guid, resultIndex);
+		return resultIndex;
+	}
+	void ActorSerializerBase::CollectUnresolvedObjectReference(const FArchive& InReader)
+	{
+		if (UnresolvedObjectReferenceProperties == nullptr)return;
+		//member property is the root of property chain, if not inside struct or container then it is the current property
+		const FProperty* Property = InReader.GetSerializedProperty();
+		if (auto PropertyChain = InReader.GetSerializedPropertyChain())
+		{
+			if (PropertyChain->GetNumProperties() > 0)
+			{
+				Property = PropertyChain->GetPropertyFromRoot(0);
+			}
+		}
+		if (Property != nullptr)
+		{
+			UnresolvedObjectReferenceProperties->AddUnique(Property->GetFName());
 		}
 	}
 	FName ActorSerializerBase::FindNameFromListByIndex(int32 Id)
@@ -225,6 +350,11 @@ namespace LPrefabSystem
 		};
 		return result;
 	}
+	const TSet<FName>& ActorSerializerBase::GetExcludeProperties(bool InIsSceneComponent)
+	{
+		static const TSet<FName> Empty;
+		return InIsSceneComponent ? GetSceneComponentExcludeProperties() : Empty;
+	}
 
 	bool ActorSerializerBase::CanUseUnversionedPropertySerialization()
 	{
@@ -235,12 +365,12 @@ namespace LPrefabSystem
 
 	void ActorSerializerBase::SetupArchive(FArchive& InArchive)
 	{
-		if (!bIsEditorOrRuntime && CanUseUnversionedPropertySerialization())
+		if (!bIsEditorOrRuntime && !bTaggedPropertyData && CanUseUnversionedPropertySerialization())//unversioned data can't skip property when load
 		{
 			InArchive.SetUseUnversionedPropertySerialization(true);
 		}
 		InArchive.SetFilterEditorOnly(!bIsEditorOrRuntime);
-		InArchive.SetWantBinaryPropertySerialization(!bIsEditorOrRuntime);
+		InArchive.SetWantBinaryPropertySerialization(!bIsEditorOrRuntime && !bDeltaAgainstArchetype && !bTaggedPropertyData);
 
 		InArchive.ArNoDelta = true;
 		InArchive.ArNoIntraPropertyDelta = true;
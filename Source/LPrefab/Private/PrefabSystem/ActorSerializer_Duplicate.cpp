@@ -11,6 +11,8 @@
 #include "PrefabSystem/LPrefabManager.h"
 #include "LPrefabModule.h"
 #include "PrefabSystem/LPrefabSettings.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/ObjectKey.h"
 #if WITH_EDITOR
 #include "Tools/UEdMode.h"
 #include "LPrefabUtils.h"
@@ -19,8 +21,139 @@
 #if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
 PRAGMA_DISABLE_OPTIMIZATION
 #endif
+static TAutoConsoleVariable<int32> CVarLPrefabDirectDuplicate(
+	TEXT("LPrefab.DirectDuplicate"),
+	1,
+	TEXT("1- DuplicateActor copy property values from source objects to created objects directly, only classes that write native data in Serialize go through byte data. 0- Always write source objects to byte data and read it back."),
+	ECVF_Default);
+
 namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
 {
+	/** Whether objects of the class can be duplicated by copy property values, false if class write native data in Serialize. Checked when first object of the class is duplicated. */
+	static TMap<FObjectKey, bool> DirectDuplicateClasses;
+
+	/** Only visit properties that contain object reference, to collect objects in the hierarchy without write property values. */
+	class FLPrefabDuplicateReferenceCollector : public LPrefabSystem::FLPrefabDuplicateObjectWriter
+	{
+	public:
+		FLPrefabDuplicateReferenceCollector(TArray<uint8>& Bytes, LPrefabSystem::ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames)
+			: FLPrefabDuplicateObjectWriter(Bytes, InSerializer, InSkipPropertyNames)
+		{
+			ArIsObjectReferenceCollector = true;
+		}
+		virtual void DoSerialize(UObject* Object) override
+		{
+			SkipMemberProperties = &LPrefabSystem::FLPrefabSkipPropertyCache::Find(Object->GetClass(), SkipPropertyNames);
+			Object->GetClass()->SerializeBin(*this, Object);
+			SkipMemberProperties = nullptr;
+		}
+		virtual FString GetArchiveName() const override
+		{
+			return TEXT("FLPrefabDuplicateReferenceCollector");
+		}
+	};
+	/** Replace copied reference to source object with the created object. Use the same property filter as duplicate writer, so only copied properties are touched. */
+	class FLPrefabDuplicateReferenceFixup : public FLPrefabDuplicateReferenceCollector
+	{
+	public:
+		FLPrefabDuplicateReferenceFixup(TArray<uint8>& Bytes, LPrefabSystem::ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames, const TMap<UObject*, UObject*>& InMapSourceToTarget)
+			: FLPrefabDuplicateReferenceCollector(Bytes, InSerializer, InSkipPropertyNames)
+			, MapSourceToTarget(InMapSourceToTarget)
+		{
+		}
+		virtual FArchive& operator<<(UObject*& Res) override
+		{
+			if (auto TargetPtr = MapSourceToTarget.Find(Res))
+			{
+				Res = *TargetPtr;
+			}
+			return *this;
+		}
+		virtual FArchive& operator<<(FObjectPtr& Value) override
+		{
+			UObject* Res = Value.Get();
+			*this << Res;
+			Value = Res;
+			return *this;
+		}
+		virtual FArchive& operator<<(FWeakObjectPtr& Value) override
+		{
+			if (auto TargetPtr = MapSourceToTarget.Find(Value.Get()))
+			{
+				Value = *TargetPtr;
+			}
+			return *this;
+		}
+		virtual FString GetArchiveName() const override
+		{
+			return TEXT("FLPrefabDuplicateReferenceFixup");
+		}
+	private:
+		const TMap<UObject*, UObject*>& MapSourceToTarget;
+	};
+
+	void ActorSerializer::WriteObjectForDirectDuplicate(UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent)
+	{
+		const auto& ExcludeProperties = GetExcludeProperties(InIsSceneComponent);
+		auto ClassKey = FObjectKey(InObject->GetClass());
+		auto CanDirectPtr = DirectDuplicateClasses.Find(ClassKey);
+		if (CanDirectPtr != nullptr && *CanDirectPtr)
+		{
+			//buffer stay empty, which tell reader to copy from source object
+			TArray<uint8> ScratchBuffer;
+			FLPrefabDuplicateReferenceCollector Collector(ScratchBuffer, *this, ExcludeProperties);
+			Collector.DoSerialize(InObject);
+			return;
+		}
+
+		LPrefabSystem::FLPrefabDuplicateObjectWriter Writer(InOutBuffer, *this, ExcludeProperties);
+		Writer.DoSerialize(InObject);
+		if (CanDirectPtr == nullptr)
+		{
+			//if Serialize only write script properties (and the guid flag), then the same result can be get by copy properties
+			TArray<uint8> ScriptData;
+			LPrefabSystem::FLPrefabDuplicateObjectWriter ScriptWriter(ScriptData, *this, ExcludeProperties);
+			InObject->SerializeScriptProperties(ScriptWriter);
+			bool bHasGuid = false;
+			ScriptWriter << bHasGuid;
+			DirectDuplicateClasses.Add(ClassKey, ScriptData == InOutBuffer);
+		}
+	}
+	void ActorSerializer::ReadObjectForDirectDuplicate(UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent)
+	{
+		const auto& ExcludeProperties = GetExcludeProperties(InIsSceneComponent);
+		if (InOutBuffer.Num() > 0)//fallback to byte data
+		{
+			LPrefabSystem::FLPrefabDuplicateObjectReader Reader(InOutBuffer, *this, ExcludeProperties);
+			Reader.DoSerialize(InObject);
+			return;
+		}
+		if (MapDirectDuplicateTargetToSource.Num() == 0)
+		{
+			//all objects are created before apply properties, so the remap table is complete now
+			for (auto& KeyValue : MapObjectToGuid)
+			{
+				if (auto TargetPtr = MapGuidToObject.Find(KeyValue.Value))
+				{
+					MapDirectDuplicateSourceToTarget.Add(KeyValue.Key, *TargetPtr);
+					MapDirectDuplicateTargetToSource.Add(*TargetPtr, KeyValue.Key);
+				}
+			}
+		}
+		auto Source = MapDirectDuplicateTargetToSource.FindRef(InObject);
+		if (Source == nullptr || Source->GetClass() != InObject->GetClass())return;
+
+		TArray<uint8> ScratchBuffer;
+		FLPrefabDuplicateReferenceFixup Fixup(ScratchBuffer, *this, ExcludeProperties, MapDirectDuplicateSourceToTarget);
+		for (FProperty* Property = InObject->GetClass()->PropertyLink; Property != nullptr; Property = Property->PropertyLinkNext)
+		{
+			if (!Property->ShouldSerializeValue(Fixup))continue;//same filter as byte data
+			Property->CopyCompleteValue_InContainer(InObject, Source);
+		}
+		//copied reference still point to source hierarchy
+		Fixup.DoSerialize(InObject);
+	}
+
 	AActor* ActorSerializer::DuplicateActor(AActor* OriginRootActor, USceneComponent* Parent)
 	{
 		if (!OriginRootActor)
@@ -46,11 +179,37 @@ namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
 #else
 			OriginRootActor->GetPathName();
 #endif
+		SCOPE_CYCLE_COUNTER(STAT_LPrefab_DuplicateActor);
+		LPREFAB_TRACE_SCOPE_TEXT(TEXT("LPrefab.DuplicateActor %s"), *Name);
 		auto StartTime = FDateTime::Now();
 
+		if (CVarLPrefabDirectDuplicate.GetValueOnGameThread() != 0)
+		{
+			//collect objects and create them same as byte data, but property values are copied from source objects
+			serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
+				serializer.WriteObjectForDirectDuplicate(InObject, InOutBuffer, InIsSceneComponent);
+			};
+			FLPrefabSaveData SaveData;
+			serializer.SerializeActorToData(OriginRootActor, SaveData);
+
+			serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
+				serializer.ReadObjectForDirectDuplicate(InObject, InOutBuffer, InIsSceneComponent);
+			};
+			auto CreatedRootActor = serializer.DeserializeActorFromData(SaveData, Parent, false, FVector::ZeroVector, FQuat::Identity, FVector::OneVector);
+			if (ULPrefabSettings::GetLogPrefabLoadTime())
+			{
+				auto TimeSpan = FDateTime::Now() - StartTime;
+				UE_LOG(LPrefab, Log, TEXT("Duplicate actor directly: '%s', total time: %fms"), *Name, TimeSpan.GetTotalMilliseconds());
+			}
+#if WITH_EDITOR
+			ULPrefabManagerObject::MarkBroadcastLevelActorListChanged();
+#endif
+			return CreatedRootActor;
+		}
+
 		//serialize
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabDuplicateObjectWriter Writer(InOutBuffer, serializer, ExcludeProperties);
 			Writer.DoSerialize(InObject);
 		};
@@ -59,7 +218,7 @@ namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
 
 		//deserialize
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabDuplicateObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
@@ -95,6 +254,7 @@ namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
 #else
 			OriginRootActor->GetPathName();
 #endif
+		TRACE_CPUPROFILER_EVENT_SCOPE(LPrefab.PrepareDataForDuplicate);
 		auto StartTime = FDateTime::Now();
 
 		auto& serializer = OutData.Serializer;
@@ -106,18 +266,28 @@ namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
 
 		//serialize
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabDuplicateObjectWriter Writer(InOutBuffer, serializer, ExcludeProperties);
 			Writer.DoSerialize(InObject);
 		};
 		serializer.SerializeActorToData(OriginRootActor, OutData.ActorData);
 
-		//for deserialize, set once for all use
-		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
-			LPrefabSystem::FLPrefabDuplicateObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
-			Reader.DoSerialize(InObject);
-		};
+		//serializer is kept as template with resolved reference lists, clear data of source objects. every duplicate work on a copy of it, so the container is never changed after prepare
+		serializer.WriterOrReaderFunction = nullptr;
+		serializer.EmptyWillSerializeArray();
+		serializer.MapGuidToObject.Empty();
+		serializer.MapObjectToGuid.Empty();
+		serializer.ComponentsInThisPrefab.Empty();
+		serializer.SubPrefabMap.Empty();
+		serializer.SubPrefabRootComponents.Empty();
+		serializer.AllActors.Empty();
+		serializer.AllComponents.Empty();
+		serializer.AutoRegisterDisabledComponents.Empty();
+		serializer.ComponentsToRegister.Empty();
+		serializer.SubPrefabOverrideParameters.Empty();
+		serializer.DeserializationSessionId = FGuid();
+		serializer.bIsSubPrefab = false;
+		serializer.SubPrefabObjectOverrideData.Empty();
 
 		if (ULPrefabSettings::GetLogPrefabLoadTime())
 		{
@@ -126,26 +296,28 @@ namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
 		}
 		return true;
 	}
+	TUniquePtr<ActorSerializer> ActorSerializer::MakeDuplicateInstance(const FDuplicateActorDataContainer& InData)
+	{
+		auto Instance = MakeUnique<ActorSerializer>(InData.Serializer);
+		Instance->WriterOrReaderFunction = [Serializer = Instance.Get()](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
+			const auto& ExcludeProperties = Serializer->GetExcludeProperties(InIsSceneComponent);
+			LPrefabSystem::FLPrefabDuplicateObjectReader Reader(InOutBuffer, *Serializer, ExcludeProperties);
+			Reader.DoSerialize(InObject);
+		};
+		auto& ActorData = InData.ActorData;
+		Instance->MapGuidToObject.Reserve(ActorData.SavedActors.Num() + ActorData.SavedObjects.Num());
+		Instance->AllActors.Reserve(ActorData.SavedActors.Num());
+		Instance->AllComponents.Reserve(ActorData.SavedObjects.Num());
+		Instance->ComponentsInThisPrefab.Reserve(ActorData.SavedObjects.Num());
+		return Instance;
+	}
 	AActor* ActorSerializer::DuplicateActorWithPreparedData(FDuplicateActorDataContainer& InData, USceneComponent* InParent)
 	{
+		SCOPE_CYCLE_COUNTER(STAT_LPrefab_DuplicateActor);
+		LPREFAB_TRACE_SCOPE_TEXT(TEXT("LPrefab.DuplicateActorWithPreparedData actor: %d, object: %d"), InData.ActorData.SavedActors.Num(), InData.ActorData.SavedObjects.Num());
 		auto StartTime = FDateTime::Now();
-		auto& serializer = InData.Serializer;//use copied, incase undesired data
-		//clear these data for deserializer use
-		serializer.WillSerializeActorArray.Reset();
-		serializer.WillSerializeObjectArray.Reset();
-		serializer.MapGuidToObject.Reset();
-		serializer.MapObjectToGuid.Reset();
-		serializer.ComponentsInThisPrefab.Reset();
-		serializer.SubPrefabMap.Reset();
-		serializer.SubPrefabRootComponents.Reset();
-		serializer.AllActors.Reset();
-		serializer.AllComponents.Reset();
-		serializer.SubPrefabOverrideParameters.Reset();
-		serializer.DeserializationSessionId = FGuid();
-		serializer.bIsSubPrefab = false;
-		serializer.SubPrefabObjectOverrideData.Reset();
-
-		auto CreatedRootActor = serializer.DeserializeActorFromData(InData.ActorData, InParent, false, FVector::ZeroVector, FQuat::Identity, FVector::OneVector);
+		auto Instance = MakeDuplicateInstance(InData);
+		auto CreatedRootActor = Instance->DeserializeActorFromData(InData.ActorData, InParent, false, FVector::ZeroVector, FQuat::Identity, FVector::OneVector);
 		if (ULPrefabSettings::GetLogPrefabLoadTime())
 		{
 			auto TimeSpan = FDateTime::Now() - StartTime;
@@ -156,6 +328,51 @@ namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
 #endif
 		return CreatedRootActor;
 	}
+	void ActorSerializer::DuplicateActorWithPreparedDataBatch(FDuplicateActorDataContainer& InData, int32 InCount, TArrayView<USceneComponent* const> InParents, TArrayView<const FTransform> InTransforms, TArray<AActor*>& OutRoots)
+	{
+		OutRoots.Reset();
+		if (InParents.Num() > 1 && InParents.Num() != InCount)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d InParents count (%d) should be 0, 1 or same as InCount (%d)!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, InParents.Num(), InCount);
+			return;
+		}
+		if (InTransforms.Num() > 0 && InTransforms.Num() != InCount)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d InTransforms count (%d) should be 0 or same as InCount (%d)!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, InTransforms.Num(), InCount);
+			return;
+		}
+		if (InCount <= 0)return;
+		SCOPE_CYCLE_COUNTER(STAT_LPrefab_DuplicateActor);
+		LPREFAB_TRACE_SCOPE_TEXT(TEXT("LPrefab.DuplicateActorWithPreparedDataBatch count: %d, actor: %d, object: %d"), InCount, InData.ActorData.SavedActors.Num(), InData.ActorData.SavedObjects.Num());
+		auto StartTime = FDateTime::Now();
+
+		//every copy start from the container's serializer, which already hold resolved reference lists, and containers are pre-sized by the prepared data
+		OutRoots.Reserve(InCount);
+		for (int i = 0; i < InCount; i++)
+		{
+			auto Instance = MakeDuplicateInstance(InData);
+			auto Parent = InParents.Num() == 0 ? nullptr : InParents[InParents.Num() == 1 ? 0 : i];
+			AActor* CreatedRootActor = nullptr;
+			if (InTransforms.Num() > 0)
+			{
+				auto& Transform = InTransforms[i];
+				CreatedRootActor = Instance->DeserializeActorFromData(InData.ActorData, Parent, true, Transform.GetLocation(), Transform.GetRotation(), Transform.GetScale3D());
+			}
+			else
+			{
+				CreatedRootActor = Instance->DeserializeActorFromData(InData.ActorData, Parent, false, FVector::ZeroVector, FQuat::Identity, FVector::OneVector);
+			}
+			OutRoots.Add(CreatedRootActor);
+		}
+		if (ULPrefabSettings::GetLogPrefabLoadTime())
+		{
+			auto TimeSpan = FDateTime::Now() - StartTime;
+			UE_LOG(LPrefab, Log, TEXT("DuplicateActorWithPreparedDataBatch count: %d, total time: %fms"), InCount, TimeSpan.GetTotalMilliseconds());
+		}
+#if WITH_EDITOR
+		ULPrefabManagerObject::MarkBroadcastLevelActorListChanged();//UE5 will not auto refresh scene outliner and display actor label, so manually refresh it.
+#endif
+	}
 
 	AActor* ActorSerializer::DuplicateActorForEditor(AActor* OriginRootActor, USceneComponent* Parent
 		, const TMap<TObjectPtr<AActor>, FLSubPrefabData>& InSubPrefabMap
@@ -194,13 +411,13 @@ namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
 		//serialize
 		serializer.SubPrefabMap = InSubPrefabMap;
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabDuplicateObjectWriter Writer(InOutBuffer, serializer, ExcludeProperties);
 			Writer.DoSerialize(InObject);
 		};
 		serializer.WriterOrReaderFunctionForSubPrefabOverride = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, const TArray<FName>& InOverridePropertyNames) {
 			LPrefabSystem::FLPrefabDuplicateOverrideParameterObjectWriter Writer(InOutBuffer, serializer, InOverridePropertyNames);
-			Writer.DoSerialize(InObject);
+			Writer.DoSerializeTargeted(InObject);//data is read back right after, so only touch override properties
 		};
 		FLPrefabSaveData SaveData;
 		serializer.SerializeActorToData(OriginRootActor, SaveData);
@@ -208,13 +425,13 @@ namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
 		//deserialize
 		serializer.SubPrefabMap = {};//clear it for deserializer to fill
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabDuplicateObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
 		serializer.WriterOrReaderFunctionForSubPrefabOverride = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, const TArray<FName>& InOverridePropertyNameSet) {
 			LPrefabSystem::FLPrefabDuplicateOverrideParameterObjectReader Reader(InOutBuffer, serializer, InOverridePropertyNameSet);
-			Reader.DoSerialize(InObject);
+			Reader.DoSerializeTargeted(InObject);
 		};
 		auto CreatedRootActor = serializer.DeserializeActorFromData(SaveData, Parent, false, FVector::ZeroVector, FQuat::Identity, FVector::OneVector);
 
@@ -14,10 +14,59 @@
 #include "LPrefabUtils.h"
 #include "PrefabSystem/LPrefabManager.h"
 #include "PrefabSystem/LPrefabHelperObject.h"
+#include "PrefabSystem/LPrefabSettings.h"
+#include "PrefabSystem/LPrefabMergeStaticMesh.h"
 #include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+#include "Serialization/CustomVersion.h"
+#include "Misc/Compression.h"
+#include "UObject/UObjectIterator.h"
+#include "Engine/AssetManager.h"
+#if WITH_EDITOR
+#include "DerivedDataCacheInterface.h"
+#include "Interfaces/ITargetPlatform.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Misc/SecureHash.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#endif
 
 #define LOCTEXT_NAMESPACE "LPrefab"
 
+struct FLPrefabCustomVersion
+{
+	enum Type
+	{
+		BeforeCustomVersionWasAdded = 0,
+		/** ULPrefab serialize BuildDataBulkData after properties */
+		BuildDataBulkData = 1,
+
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+	static const FGuid GUID;
+};
+const FGuid FLPrefabCustomVersion::GUID(0x5C3F1A2D, 0x8E4B47A1, 0x9D6C0B37, 0x2F84E915);
+static FCustomVersionRegistration GRegisterLPrefabCustomVersion(FLPrefabCustomVersion::GUID, FLPrefabCustomVersion::LatestVersion, TEXT("LPrefabVer"));
+
+#if WITH_EDITOR
+static TAutoConsoleVariable<int32> CVarLPrefabDeltaBuildData(
+	TEXT("LPrefab.DeltaBuildData"),
+	1,
+	TEXT("1- When cook, prefab's build data only store properties that differ from archetype. 0- Store all properties."),
+	ECVF_Default);
+static TAutoConsoleVariable<int32> CVarLPrefabTranscodeBuildData(
+	TEXT("LPrefab.TranscodeBuildData"),
+	1,
+	TEXT("1- When cook, generate prefab's build data from editor data directly, only spawn agent objects if the prefab can't be transcoded (eg: has sub prefab). 0- Always spawn agent objects in preview world and save them."),
+	ECVF_Default);
+static TAutoConsoleVariable<int32> CVarLPrefabBuildDataDDC(
+	TEXT("LPrefab.BuildDataDDC"),
+	1,
+	TEXT("1- When cook, store prefab's build data in derived data cache, and reuse it if nothing relevant changed. 0- Always generate build data."),
+	ECVF_Default);
+#endif
+
 
 FLSubPrefabData::FLSubPrefabData()
 {
@@ -141,6 +190,427 @@ ULPrefab::ULPrefab()
 
 }
 
+TSharedPtr<const LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabSaveData, ESPMode::ThreadSafe> ULPrefab::GetParsedSaveData(bool InForEditorOrRuntimeUse)
+{
+	ParsedSaveDataLastUseTime = FPlatformTime::Seconds();
+	if (ParsedSaveData.IsValid() && bParsedSaveDataForEditorOrRuntime == InForEditorOrRuntimeUse)
+	{
+		INC_DWORD_STAT(STAT_LPrefab_ParsedSaveDataCacheHit);
+		return ParsedSaveData;
+	}
+	INC_DWORD_STAT(STAT_LPrefab_ParsedSaveDataCacheMiss);
+	TSharedPtr<const LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabSaveData, ESPMode::ThreadSafe> NewSaveData;
+	if (ParseTask.IsValid() && bParseTaskForEditorOrRuntime == InForEditorOrRuntimeUse)
+	{
+		NewSaveData = ParseTask.GetResult();//wait if not done yet
+		ParseTask = {};
+	}
+	ClearParsedSaveData();
+	if (NewSaveData.IsValid())
+	{
+		ParsedSaveData = NewSaveData;
+	}
+	else
+	{
+		SCOPE_CYCLE_COUNTER(STAT_LPrefab_ParseSaveData);
+		ParsedSaveData = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::ParseSaveData(this, InForEditorOrRuntimeUse);
+	}
+	bParsedSaveDataForEditorOrRuntime = InForEditorOrRuntimeUse;
+	ParsedSaveDataSize = ParsedSaveData->GetAllocatedSize();
+	INC_MEMORY_STAT_BY(STAT_LPrefab_ParsedSaveDataMemory, ParsedSaveDataSize);
+	return ParsedSaveData;
+}
+#if !UE_BUILD_SHIPPING
+void ULPrefab::CheckArchetypeHashForBuild(const TArray<UClass*>& InResolvedClasses)
+{
+	//delta data is only valid with the archetypes when cook. only check once for every cooked hash
+	if (CheckedArchetypeHashForBuild.IsSet() && CheckedArchetypeHashForBuild.GetValue() == ArchetypeHashForBuild)return;
+	CheckedArchetypeHashForBuild = ArchetypeHashForBuild;
+	if (LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::ComputeArchetypeHash(InResolvedClasses) != ArchetypeHashForBuild)
+	{
+		UE_LOG(LPrefab, Warning, TEXT("[%s].%d Archetype of prefab '%s' is changed after cook, properties that equal to old archetype may load wrong value, please cook it again."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(this->GetPathName()));
+	}
+}
+#endif
+void ULPrefab::ClearParsedSaveData()
+{
+	CancelParseTask();
+	if (ParsedSaveData.IsValid())
+	{
+		DEC_MEMORY_STAT_BY(STAT_LPrefab_ParsedSaveDataMemory, ParsedSaveDataSize);
+		ParsedSaveData.Reset();//loading in progress still hold a reference, so it is safe to reset here
+		ParsedSaveDataSize = 0;
+	}
+}
+
+void ULPrefab::StartParseTask(bool InForEditorOrRuntimeUse)
+{
+	check(IsInGameThread());
+	if (ParsedSaveData.IsValid() && bParsedSaveDataForEditorOrRuntime == InForEditorOrRuntimeUse)return;
+	if (ParseTask.IsValid())
+	{
+		if (bParseTaskForEditorOrRuntime == InForEditorOrRuntimeUse)return;
+		CancelParseTask();
+	}
+	bParseTaskForEditorOrRuntime = InForEditorOrRuntimeUse;
+#if WITH_EDITOR
+	if (InForEditorOrRuntimeUse)
+	{
+		//editor data can be changed in game thread, so parse a copy
+		ParseTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [Data = BinaryData, Version = PrefabVersion]() {
+			SCOPE_CYCLE_COUNTER(STAT_LPrefab_ParseSaveData);
+			return LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::ParseSaveData(Data, true, Version);
+			});
+		return;
+	}
+#endif
+	//build data is not changed after cook, so read it (load from disk and decompress if not resident) in background thread too. BeginDestroy wait for the task, so it is safe to use this
+	ParseTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [this]() {
+		SCOPE_CYCLE_COUNTER(STAT_LPrefab_ParseSaveData);
+		TArray<uint8> BuildDataStorage;
+		auto& LoadedData = GetBinaryDataForBuild(BuildDataStorage);
+		return LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::ParseSaveData(LoadedData, false, GetBuildDataLayoutVersion());
+		});
+}
+void ULPrefab::CancelParseTask()
+{
+	if (ParseTask.IsValid())
+	{
+		ParseTask.Wait();
+		ParseTask = {};
+	}
+}
+
+TSharedRef<FLPrefabLoadRequest> ULPrefab::CreateLoadRequest()
+{
+	auto Request = MakeShared<FLPrefabLoadRequest>();
+	Request->Prefab.Reset(this);
+	bool bIsEditorOrRuntime = true;
+#if !WITH_EDITOR
+	bIsEditorOrRuntime = false;
+#endif
+#if WITH_EDITOR
+	if (PrefabVersion < LPREFAB_SERIALIZER_NEWEST_MIN_VERSION)//old version serializer parse the data itself
+	{
+		Request->bUsePrefabLoad = true;
+		return Request;
+	}
+#endif
+	if (ParsedSaveData.IsValid() && bParsedSaveDataForEditorOrRuntime == bIsEditorOrRuntime)
+	{
+		ParsedSaveDataLastUseTime = FPlatformTime::Seconds();
+		Request->SaveData = ParsedSaveData;
+		return Request;
+	}
+	StartParseTask(bIsEditorOrRuntime);
+	Request->ParseTask = ParseTask;
+	return Request;
+}
+
+void FLPrefabLoadRequest::WaitParseComplete()const
+{
+	if (ParseTask.IsValid())
+	{
+		ParseTask.Wait();
+	}
+}
+AActor* FLPrefabLoadRequest::LoadPrefab(UWorld* InWorld, USceneComponent* InParent, bool SetRelativeTransformToIdentity, const TFunction<void(AActor*)>& InCallbackBeforeAwake)
+{
+	if (!Prefab.IsValid())return nullptr;
+	if (bUsePrefabLoad)
+	{
+		return Prefab->LoadPrefab(InWorld, InParent, SetRelativeTransformToIdentity, InCallbackBeforeAwake);
+	}
+	if (!SaveData.IsValid() && ParseTask.IsValid())
+	{
+		SaveData = ParseTask.GetResult();//wait if not done yet
+		ParseTask = {};
+	}
+	if (!InWorld)return nullptr;
+	return LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefabWithSaveData(InWorld, Prefab.Get(), SaveData, InParent, SetRelativeTransformToIdentity, InCallbackBeforeAwake);
+}
+
+bool ULPrefab::ReleaseIdleParsedSaveData(float DeltaTime)
+{
+	auto IdleReleaseTime = ULPrefabSettings::GetBuildDataIdleReleaseTime();
+	if (IdleReleaseTime <= 0)return true;
+	auto Now = FPlatformTime::Seconds();
+	for (TObjectIterator<ULPrefab> Itr(RF_ClassDefaultObject); Itr; ++Itr)
+	{
+		auto Prefab = *Itr;
+		if (Prefab->bKeepBuildDataResident)continue;
+		if (!Prefab->ParsedSaveData.IsValid())continue;
+		if (Prefab->bParsedSaveDataForEditorOrRuntime)continue;//editor data is always needed by prefab editor
+		if (!Prefab->HasBinaryDataForBuild())continue;//can't parse again
+		if (!Prefab->ParsedSaveData.IsUnique())continue;//loading in progress
+		if (Now - Prefab->ParsedSaveDataLastUseTime < IdleReleaseTime)continue;
+		Prefab->ClearParsedSaveData();
+	}
+	return true;
+}
+
+const TArray<uint8>& ULPrefab::GetBinaryDataForBuild(TArray<uint8>& InStorage)
+{
+	auto BulkDataSize = BuildDataBulkData.GetBulkDataSize();
+	if (BinaryDataForBuild.Num() > 0 || BulkDataSize == 0)
+	{
+		return BinaryDataForBuild;
+	}
+
+	TArray<uint8> Payload;
+	Payload.SetNumUninitialized(BulkDataSize);
+	void* PayloadPtr = Payload.GetData();
+	BuildDataBulkData.GetCopy(&PayloadPtr, true);//load from disk if not loaded yet, and don't keep it in bulk data
+	if (BuildDataCompressionFormat.IsNone())
+	{
+		InStorage = MoveTemp(Payload);
+	}
+	else
+	{
+		InStorage.SetNumUninitialized(BuildDataUncompressedSize);
+		if (!FCompression::UncompressMemory(BuildDataCompressionFormat, InStorage.GetData(), BuildDataUncompressedSize, Payload.GetData(), Payload.Num()))
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Decompress build data fail! prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(this->GetPathName()));
+			InStorage.Empty();
+		}
+	}
+	return InStorage;
+}
+
+void ULPrefab::GetReferenceListForBuild(TArray<UObject*>& OutAssets, TArray<UClass*>& OutClasses)
+{
+	int32 SyncLoadCount = 0;
+	if (ReferenceAssetListForBuild.Num() > 0 || SoftReferenceAssetListForBuild.Num() == 0)
+	{
+		OutAssets = ReferenceAssetListForBuild;
+	}
+	else
+	{
+		OutAssets.SetNumUninitialized(SoftReferenceAssetListForBuild.Num());
+		for (int i = 0; i < SoftReferenceAssetListForBuild.Num(); i++)
+		{
+			auto& SoftAsset = SoftReferenceAssetListForBuild[i];
+			OutAssets[i] = SoftAsset.Get();
+			if (OutAssets[i] == nullptr && !SoftAsset.IsNull())
+			{
+				OutAssets[i] = SoftAsset.LoadSynchronous();
+				SyncLoadCount++;
+			}
+		}
+	}
+	if (ReferenceClassListForBuild.Num() > 0 || SoftReferenceClassListForBuild.Num() == 0)
+	{
+		OutClasses = ReferenceClassListForBuild;
+	}
+	else
+	{
+		OutClasses.SetNumUninitialized(SoftReferenceClassListForBuild.Num());
+		for (int i = 0; i < SoftReferenceClassListForBuild.Num(); i++)
+		{
+			auto& SoftClass = SoftReferenceClassListForBuild[i];
+			OutClasses[i] = SoftClass.Get();
+			if (OutClasses[i] == nullptr && !SoftClass.IsNull())
+			{
+				OutClasses[i] = SoftClass.LoadSynchronous();
+				SyncLoadCount++;
+			}
+		}
+	}
+	if (SyncLoadCount > 0)
+	{
+		UE_LOG(LPrefab, Warning, TEXT("[%s].%d %d dependencies of prefab '%s' are not loaded, load them synchronously. Call RequestAsyncLoad before LoadPrefab to avoid this hitch."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, SyncLoadCount, *(this->GetPathName()));
+	}
+}
+
+float FLPrefabStreamingHandle::GetProgress()const
+{
+	if (bLoadComplete)return 1.0f;
+	if (StreamableHandles.Num() == 0)return 0.0f;
+	float Progress = 0;
+	for (auto& Handle : StreamableHandles)
+	{
+		Progress += Handle->GetProgress();
+	}
+	return Progress / StreamableHandles.Num();
+}
+void FLPrefabStreamingHandle::CancelHandle()
+{
+	bCanceled = true;
+	OnReady = nullptr;
+	for (auto& Handle : StreamableHandles)
+	{
+		Handle->CancelHandle();
+	}
+	StreamableHandles.Empty();
+}
+void FLPrefabStreamingHandle::ReleaseHandle()
+{
+	OnReady = nullptr;
+	for (auto& Handle : StreamableHandles)
+	{
+		Handle->ReleaseHandle();
+	}
+	StreamableHandles.Empty();
+}
+
+TSharedPtr<FLPrefabStreamingHandle> ULPrefab::RequestAsyncLoad(const TFunction<void()>& InOnReady, int32 InPriority)
+{
+	auto Handle = MakeShared<FLPrefabStreamingHandle>();
+	Handle->OnReady = InOnReady;
+	Handle->Priority = InPriority;
+	Handle->PendingRequestCount = 1;//hold until all requests are sent, so OnReady is not called in the middle
+	RequestAsyncLoad_Internal(Handle);
+	Handle->PendingRequestCount--;
+	CheckAsyncLoadComplete(Handle);
+	return Handle;
+}
+void ULPrefab::RequestAsyncLoad_Internal(const TSharedRef<FLPrefabStreamingHandle>& InHandle)
+{
+	if (InHandle->bCanceled)return;
+	if (InHandle->RequestedPrefabs.Contains(this))return;
+	InHandle->RequestedPrefabs.Add(this);
+
+	//sub prefab's dependencies can only be requested after the sub prefab asset is loaded
+	auto RequestSubPrefabs = [](ULPrefab* Prefab, const TSharedRef<FLPrefabStreamingHandle>& Handle) {
+		if (Handle->bCanceled)return;
+		for (auto& Asset : Prefab->ReferenceAssetListForBuild)
+		{
+			if (auto SubPrefab = Cast<ULPrefab>(Asset))
+			{
+				SubPrefab->RequestAsyncLoad_Internal(Handle);
+			}
+		}
+		for (auto& SoftAsset : Prefab->SoftReferenceAssetListForBuild)
+		{
+			if (auto SubPrefab = Cast<ULPrefab>(SoftAsset.Get()))
+			{
+				SubPrefab->RequestAsyncLoad_Internal(Handle);
+			}
+		}
+	};
+
+	TArray<FSoftObjectPath> PathsToLoad;
+	for (auto& SoftAsset : SoftReferenceAssetListForBuild)
+	{
+		if (!SoftAsset.IsNull() && SoftAsset.Get() == nullptr)
+		{
+			PathsToLoad.Add(SoftAsset.ToSoftObjectPath());
+		}
+	}
+	for (auto& SoftClass : SoftReferenceClassListForBuild)
+	{
+		if (!SoftClass.IsNull() && SoftClass.Get() == nullptr)
+		{
+			PathsToLoad.Add(SoftClass.ToSoftObjectPath());
+		}
+	}
+	if (PathsToLoad.Num() == 0)
+	{
+		RequestSubPrefabs(this, InHandle);
+		return;
+	}
+
+	InHandle->PendingRequestCount++;
+	//weak reference to handle, streamable handle is owned by it
+	auto StreamableHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(MoveTemp(PathsToLoad), FStreamableDelegate::CreateLambda([RequestSubPrefabs, WeakThis = TWeakObjectPtr<ULPrefab>(this), WeakHandle = TWeakPtr<FLPrefabStreamingHandle>(InHandle)]() {
+		auto Handle = WeakHandle.Pin();
+		if (!Handle.IsValid())return;
+		if (WeakThis.IsValid())
+		{
+			RequestSubPrefabs(WeakThis.Get(), Handle.ToSharedRef());
+		}
+		Handle->PendingRequestCount--;
+		CheckAsyncLoadComplete(Handle.ToSharedRef());
+		}), InHandle->Priority);
+	if (StreamableHandle.IsValid())
+	{
+		InHandle->StreamableHandles.Add(StreamableHandle);
+	}
+}
+void ULPrefab::CheckAsyncLoadComplete(const TSharedRef<FLPrefabStreamingHandle>& InHandle)
+{
+	if (InHandle->PendingRequestCount > 0 || InHandle->bLoadComplete || InHandle->bCanceled)return;
+	InHandle->bLoadComplete = true;
+	auto OnReady = MoveTemp(InHandle->OnReady);//callback may hold the handle, clear it to break the cycle
+	InHandle->OnReady = nullptr;
+	if (OnReady != nullptr)OnReady();
+}
+
+void ULPrefab::Serialize(FArchive& Ar)
+{
+	Ar.UsingCustomVersion(FLPrefabCustomVersion::GUID);
+#if WITH_EDITOR
+	//move build data into bulk data when cook, so the data stays on disk until it is needed
+	TArray<uint8> BinaryDataForBuildToRestore;
+	if (Ar.IsSaving() && Ar.IsCooking() && ULPrefabSettings::GetStoreBuildDataAsBulkData() && BinaryDataForBuild.Num() > 0)
+	{
+		const uint8* Payload = BinaryDataForBuild.GetData();
+		int32 PayloadSize = BinaryDataForBuild.Num();
+		TArray<uint8> CompressedData;
+		BuildDataCompressionFormat = NAME_None;
+		BuildDataUncompressedSize = BinaryDataForBuild.Num();
+		if (ULPrefabSettings::GetCompressBuildData())
+		{
+			int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Oodle, BuildDataUncompressedSize);
+			CompressedData.SetNumUninitialized(CompressedSize);
+			if (FCompression::CompressMemory(NAME_Oodle, CompressedData.GetData(), CompressedSize, BinaryDataForBuild.GetData(), BuildDataUncompressedSize)
+				&& CompressedSize < BuildDataUncompressedSize//not worth it if data is not getting smaller
+				)
+			{
+				BuildDataCompressionFormat = NAME_Oodle;
+				Payload = CompressedData.GetData();
+				PayloadSize = CompressedSize;
+			}
+		}
+		BuildDataBulkData.SetBulkDataFlags(BULKDATA_Force_NOT_InlinePayload);
+		BuildDataBulkData.Lock(LOCK_READ_WRITE);
+		FMemory::Memcpy(BuildDataBulkData.Realloc(PayloadSize), Payload, PayloadSize);
+		BuildDataBulkData.Unlock();
+		Swap(BinaryDataForBuildToRestore, BinaryDataForBuild);
+	}
+#endif
+	Super::Serialize(Ar);
+	if (Ar.CustomVer(FLPrefabCustomVersion::GUID) >= FLPrefabCustomVersion::BuildDataBulkData)
+	{
+		Ar << BuildDataCompressionFormat;
+		Ar << BuildDataUncompressedSize;
+		BuildDataBulkData.Serialize(Ar, this);
+	}
+#if WITH_EDITOR
+	if (BinaryDataForBuildToRestore.Num() > 0)
+	{
+		Swap(BinaryDataForBuildToRestore, BinaryDataForBuild);
+		BuildDataBulkData.RemoveBulkData();
+		BuildDataCompressionFormat = NAME_None;
+		BuildDataUncompressedSize = 0;
+	}
+#endif
+}
+
+void ULPrefab::PostLoad()
+{
+	Super::PostLoad();
+#if !WITH_EDITOR
+	if ((ULPrefabSettings::GetParsePrefabDataOnPostLoad() || bKeepBuildDataResident) && HasBinaryDataForBuild())
+	{
+		StartParseTask(false);
+	}
+#endif
+}
+
+void ULPrefab::BeginDestroy()
+{
+#if WITH_EDITOR
+	if (IsValid(PrefabHelperObject))
+	{
+		ClearAgentObjectsInPreviewWorld();
+		PrefabHelperObject->ConditionalBeginDestroy();
+	}
+#endif
+	ClearParsedSaveData();
+	Super::BeginDestroy();
+}
+
 #if WITH_EDITOR
 void ULPrefab::RefreshAgentObjectsInPreviewWorld()
 {
@@ -227,6 +697,38 @@ ULPrefabHelperObject* ULPrefab::GetPrefabHelperObject()
 void ULPrefab::BeginCacheForCookedPlatformData(const ITargetPlatform* TargetPlatform)
 {
 	BinaryDataForBuild.Empty();
+	//merge also depends on parent prefabs which is not in DDC key, so don't use DDC if merge is skipped
+	FString CantMergeReason;
+	if (CVarLPrefabBuildDataDDC.GetValueOnAnyThread() == 0
+		|| (bMergeStaticMeshesWhenCook && !CanMergeStaticMeshesWhenCook(CantMergeReason)))
+	{
+		GenerateBuildDataForCook();
+		return;
+	}
+
+	auto DDCKey = GetBuildDataDDCKey(TargetPlatform);
+	if (LoadBuildDataFromDDC(DDCKey))
+	{
+		INC_DWORD_STAT(STAT_LPrefab_BuildDataDDCHit);
+		UE_LOG(LPrefab, Verbose, TEXT("[%s].%d Build data DDC hit, prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(this->GetPathName()));
+		return;
+	}
+	INC_DWORD_STAT(STAT_LPrefab_BuildDataDDCMiss);
+	UE_LOG(LPrefab, Verbose, TEXT("[%s].%d Build data DDC miss, prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(this->GetPathName()));
+	GenerateBuildDataForCook();
+	if (BinaryDataForBuild.Num() > 0)
+	{
+		SaveBuildDataToDDC(DDCKey);
+	}
+}
+void ULPrefab::GenerateBuildDataForCook()
+{
+	BinaryDataForBuild.Empty();
+	//merge static meshes need to change actors, so it can only work with agent objects
+	if (!bMergeStaticMeshesWhenCook && CVarLPrefabTranscodeBuildData.GetValueOnAnyThread() != 0 && TranscodeBuildDataForRuntime())
+	{
+		return;
+	}
 	if (!IsValid(PrefabHelperObject) || !IsValid(PrefabHelperObject->LoadedRootActor))
 	{
 		UE_LOG(LPrefab, Log, TEXT("[%s].%d AgentObjects not valid, recreate it! prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(this->GetPathName()));
@@ -258,9 +760,8 @@ void ULPrefab::BeginCacheForCookedPlatformData(const ITargetPlatform* TargetPlat
 				MapObjectToGuid.Add(KeyValue.Value, KeyValue.Key);
 			}
 		}
-		this->SavePrefab(PrefabHelperObject->LoadedRootActor
+		this->SavePrefabForRuntime(PrefabHelperObject->LoadedRootActor
 			, MapObjectToGuid, PrefabHelperObject->SubPrefabMap
-			, false
 		);
 		PrefabHelperObject->MapGuidToObject.Empty();
 		for (auto KeyValue : MapObjectToGuid)
@@ -268,25 +769,36 @@ void ULPrefab::BeginCacheForCookedPlatformData(const ITargetPlatform* TargetPlat
 			PrefabHelperObject->MapGuidToObject.Add(KeyValue.Value, KeyValue.Key);
 		}
 	}
+	if (bMergeStaticMeshesWhenCook)
+	{
+		//agent objects are changed by merge, recreate them next time
+		ClearAgentObjectsInPreviewWorld();
+	}
 }
 void ULPrefab::WillNeverCacheCookedPlatformDataAgain()
 {
 	if (PrefabVersion >= (uint16)ELPrefabVersion::BuildinFArchive)
 	{
+		ClearParsedSaveData();
 		BinaryDataForBuild.Empty();
 		ReferenceAssetListForBuild.Empty();
 		ReferenceClassListForBuild.Empty();
 		ReferenceNameListForBuild.Empty();
+		SoftReferenceAssetListForBuild.Empty();
+		SoftReferenceClassListForBuild.Empty();
 	}
 }
 void ULPrefab::ClearCachedCookedPlatformData(const ITargetPlatform* TargetPlatform)
 {
 	if (PrefabVersion >= (uint16)ELPrefabVersion::BuildinFArchive)
 	{
+		ClearParsedSaveData();
 		BinaryDataForBuild.Empty();
 		ReferenceAssetListForBuild.Empty();
 		ReferenceClassListForBuild.Empty();
 		ReferenceNameListForBuild.Empty();
+		SoftReferenceAssetListForBuild.Empty();
+		SoftReferenceClassListForBuild.Empty();
 	}
 }
 
@@ -322,23 +834,6 @@ void ULPrefab::PostDuplicate(bool bDuplicateForPIE)
 	}
 }
 
-void ULPrefab::PostLoad()
-{
-	Super::PostLoad();
-}
-
-void ULPrefab::BeginDestroy()
-{
-#if WITH_EDITOR
-	if (IsValid(PrefabHelperObject))
-	{
-		ClearAgentObjectsInPreviewWorld();
-		PrefabHelperObject->ConditionalBeginDestroy();
-	}
-#endif
-	Super::BeginDestroy();
-}
-
 void ULPrefab::FinishDestroy()
 {
 	Super::FinishDestroy();
@@ -347,6 +842,7 @@ void ULPrefab::FinishDestroy()
 void ULPrefab::PostEditUndo()
 {
 	Super::PostEditUndo();
+	ClearParsedSaveData();
 	RefreshAgentObjectsInPreviewWorld();
 }
 bool ULPrefab::IsEditorOnly()const
@@ -371,6 +867,7 @@ AActor* ULPrefab::LoadPrefab(UWorld* InWorld, USceneComponent* InParent, bool Se
 #if WITH_EDITOR
 		switch ((ELPrefabVersion)PrefabVersion)
 		{
+		case ELPrefabVersion::DeferredSubPrefab:
 		case ELPrefabVersion::NewObjectOnNestedPrefab:
 		{
 			LoadedRootActor = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefab(InWorld, this, InParent, SetRelativeTransformToIdentity, InCallbackBeforeAwake);
@@ -413,6 +910,53 @@ AActor* ULPrefab::LoadPrefab(UWorld* InWorld, USceneComponent* InParent, bool Se
 	}
 	return LoadedRootActor;
 }
+void ULPrefab::LoadPrefabAsync(UWorld* InWorld, USceneComponent* InParent, float InFrameBudgetMs, const TFunction<void(AActor*)>& InOnComplete)
+{
+#if WITH_EDITOR
+	if (InWorld && PrefabVersion < LPREFAB_SERIALIZER_NEWEST_MIN_VERSION)//old version serializer only support load in one frame
+	{
+		auto LoadedRootActor = LoadPrefab(InWorld, InParent);
+		if (InOnComplete != nullptr)InOnComplete(LoadedRootActor);
+		return;
+	}
+#endif
+	if (IsSoftReferenceForBuild())
+	{
+		//stream in dependencies first, so the load will not stall on disk IO. Handle is kept until load complete.
+		auto StreamingHandleHolder = MakeShared<TSharedPtr<FLPrefabStreamingHandle>>();
+		*StreamingHandleHolder = RequestAsyncLoad([WeakThis = TWeakObjectPtr<ULPrefab>(this), WeakWorld = TWeakObjectPtr<UWorld>(InWorld), WeakParent = TWeakObjectPtr<USceneComponent>(InParent), InFrameBudgetMs, InOnComplete, StreamingHandleHolder]() {
+			if (!WeakThis.IsValid() || !WeakWorld.IsValid())
+			{
+				if (InOnComplete != nullptr)InOnComplete(nullptr);
+				StreamingHandleHolder->Reset();
+				return;
+			}
+			LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefabAsync(WeakWorld.Get(), WeakThis.Get(), WeakParent.Get(), InFrameBudgetMs, [InOnComplete, StreamingHandleHolder](AActor* LoadedRootActor) {
+				if (InOnComplete != nullptr)InOnComplete(LoadedRootActor);
+				StreamingHandleHolder->Reset();
+				});
+			});
+		return;
+	}
+	LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefabAsync(InWorld, this, InParent, InFrameBudgetMs, InOnComplete);
+}
+void ULPrefab::LoadPrefabBatch(UWorld* InWorld, TArrayView<const FTransform> InTransforms, TArrayView<USceneComponent* const> InParents, TArray<AActor*>& OutRoots)
+{
+#if WITH_EDITOR
+	if (InWorld && PrefabVersion < LPREFAB_SERIALIZER_NEWEST_MIN_VERSION)//old version serializer can only load one by one
+	{
+		OutRoots.Reset(InTransforms.Num());
+		for (int i = 0; i < InTransforms.Num(); i++)
+		{
+			auto Parent = InParents.Num() == 0 ? nullptr : InParents[InParents.Num() == 1 ? 0 : i];
+			auto& Transform = InTransforms[i];
+			OutRoots.Add(LoadPrefabWithTransform(InWorld, Parent, Transform.GetLocation(), Transform.GetRotation(), Transform.GetScale3D(), nullptr));
+		}
+		return;
+	}
+#endif
+	LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefabBatch(InWorld, this, InTransforms, InParents, OutRoots);
+}
 
 AActor* ULPrefab::LoadPrefab(UObject* WorldContextObject, USceneComponent* InParent, const FLPrefab_LoadPrefabCallback& InCallbackBeforeAwake, bool SetRelativeTransformToIdentity)
 {
@@ -437,6 +981,7 @@ AActor* ULPrefab::LoadPrefabWithTransform(UObject* WorldContextObject, USceneCom
 #if WITH_EDITOR
 		switch ((ELPrefabVersion)PrefabVersion)
 		{
+		case ELPrefabVersion::DeferredSubPrefab:
 		case ELPrefabVersion::NewObjectOnNestedPrefab:
 		{
 			LoadedRootActor = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefab(World, this, InParent, Location, Rotation.Quaternion(), Scale, CallbackBeforeAwake);
@@ -485,113 +1030,80 @@ AActor* ULPrefab::LoadPrefabWithReplacement(UObject* WorldContextObject, USceneC
 	auto World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
 	if (World)
 	{
-		TSet<TTuple<int, UObject*>> ReplacedAssets;
-		TSet<TTuple<int, UClass*>> ReplacedClasses;
-		if (InReplaceAssetMap.Num() > 0)
-		{
-			auto& List =
+		auto CallbackBeforeAwake = [&InCallbackBeforeAwake](AActor* RootActor) {
+			InCallbackBeforeAwake.ExecuteIfBound(RootActor);
+			};
 #if WITH_EDITOR
-				ReferenceAssetList;
-#else
-				ReferenceAssetListForBuild;
-#endif
-			for (int i = 0; i < List.Num(); i++)
+		if (PrefabVersion >= LPREFAB_SERIALIZER_NEWEST_MIN_VERSION)
+		{
+			LoadedRootActor = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefabWithReplacement(World, this, InParent, InReplaceAssetMap, InReplaceClassMap, CallbackBeforeAwake);
+		}
+		else
+		{
+			//old serializers read reference list from prefab directly, so replace it during load and restore after
+			TSet<TTuple<int, UObject*>> ReplacedAssets;
+			TSet<TTuple<int, UClass*>> ReplacedClasses;
+			for (int i = 0; i < ReferenceAssetList.Num(); i++)
 			{
-				if (auto ReplaceAssetPtr = InReplaceAssetMap.Find(List[i]))
+				if (auto ReplaceAssetPtr = InReplaceAssetMap.Find(ReferenceAssetList[i]))
 				{
-					ReplacedAssets.Add({ i, List[i] });
-					List[i] = *ReplaceAssetPtr;
+					ReplacedAssets.Add({ i, ReferenceAssetList[i] });
+					ReferenceAssetList[i] = *ReplaceAssetPtr;
 				}
 			}
-		}
-		if (InReplaceClassMap.Num() > 0)
-		{
-			auto& List =
-#if WITH_EDITOR
-				ReferenceClassList;
-#else
-				ReferenceClassListForBuild;
-#endif
-			for (int i = 0; i < List.Num(); i++)
+			for (int i = 0; i < ReferenceClassList.Num(); i++)
 			{
-				if (auto ReplaceClassPtr = InReplaceClassMap.Find(List[i]))
+				if (auto ReplaceClassPtr = InReplaceClassMap.Find(ReferenceClassList[i]))
 				{
-					ReplacedClasses.Add({ i, List[i] });
-					List[i] = *ReplaceClassPtr;
+					ReplacedClasses.Add({ i, ReferenceClassList[i] });
+					ReferenceClassList[i] = *ReplaceClassPtr;
 				}
 			}
-		}
-		auto CallbackBeforeAwake = [&InCallbackBeforeAwake](AActor* RootActor) {
-			InCallbackBeforeAwake.ExecuteIfBound(RootActor);
-			};
-#if WITH_EDITOR
-		switch ((ELPrefabVersion)PrefabVersion)
-		{
-		case ELPrefabVersion::NewObjectOnNestedPrefab:
-		{
-			LoadedRootActor = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
-		}
-		break;
-		case ELPrefabVersion::ActorAttachToSubPrefab:
-		{
-			LoadedRootActor = LPrefabSystem7::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
-		}
-		break;
-		case ELPrefabVersion::CommonActor:
-		{
-			LoadedRootActor = LPrefabSystem6::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
-		}
-		break;
-		case ELPrefabVersion::ObjectName:
-		{
-			LoadedRootActor = LPrefabSystem5::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
-		}
-		break;
-		case ELPrefabVersion::NestedDefaultSubObject:
-		{
-			LoadedRootActor = LPrefabSystem4::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
-		}
-		break;
-		case ELPrefabVersion::BuildinFArchive:
-		{
-			LoadedRootActor = LPrefabSystem3::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
-		}
-		break;
-		default:
-		{
-			UE_LOG(LPrefab, Error, TEXT("[%s].%d This prefab version is too old to support this function, open this prefab and hit \"Apply\" button to fix it. Prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *this->GetPathName());
-		}
-		break;
-		}
-#else
-		LoadedRootActor = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
-#endif
-		if (ReplacedAssets.Num() > 0)
-		{
-			auto& List =
-#if WITH_EDITOR
-				ReferenceAssetList;
-#else
-				ReferenceAssetListForBuild;
-#endif
+			switch ((ELPrefabVersion)PrefabVersion)
+			{
+			case ELPrefabVersion::ActorAttachToSubPrefab:
+			{
+				LoadedRootActor = LPrefabSystem7::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
+			}
+			break;
+			case ELPrefabVersion::CommonActor:
+			{
+				LoadedRootActor = LPrefabSystem6::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
+			}
+			break;
+			case ELPrefabVersion::ObjectName:
+			{
+				LoadedRootActor = LPrefabSystem5::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
+			}
+			break;
+			case ELPrefabVersion::NestedDefaultSubObject:
+			{
+				LoadedRootActor = LPrefabSystem4::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
+			}
+			break;
+			case ELPrefabVersion::BuildinFArchive:
+			{
+				LoadedRootActor = LPrefabSystem3::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
+			}
+			break;
+			default:
+			{
+				UE_LOG(LPrefab, Error, TEXT("[%s].%d This prefab version is too old to support this function, open this prefab and hit \"Apply\" button to fix it. Prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *this->GetPathName());
+			}
+			break;
+			}
 			for (auto& Item : ReplacedAssets)
 			{
-				List[Item.Key] = Item.Value;
+				ReferenceAssetList[Item.Key] = Item.Value;
 			}
-		}
-		if (ReplacedClasses.Num() > 0)
-		{
-			auto& List =
-#if WITH_EDITOR
-				ReferenceClassList;
-#else
-				ReferenceClassListForBuild;
-#endif
 			for (auto& Item : ReplacedClasses)
 			{
-				List[Item.Key] = Item.Value;
+				ReferenceClassList[Item.Key] = Item.Value;
 			}
 		}
+#else
+		LoadedRootActor = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefabWithReplacement(World, this, InParent, InReplaceAssetMap, InReplaceClassMap, CallbackBeforeAwake);
+#endif
 	}
 	return LoadedRootActor;
 }
@@ -604,6 +1116,7 @@ AActor* ULPrefab::LoadPrefabWithTransform(UObject* WorldContextObject, USceneCom
 #if WITH_EDITOR
 		switch ((ELPrefabVersion)PrefabVersion)
 		{
+		case ELPrefabVersion::DeferredSubPrefab:
 		case ELPrefabVersion::NewObjectOnNestedPrefab:
 		{
 			LoadedRootActor = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefab(World, this, InParent, Location, Rotation, Scale, InCallbackBeforeAwake);
@@ -655,6 +1168,7 @@ AActor* ULPrefab::LoadPrefabWithExistingObjects(UWorld* InWorld, USceneComponent
 	AActor* LoadedRootActor = nullptr;
 	switch ((ELPrefabVersion)PrefabVersion)
 	{
+	case ELPrefabVersion::DeferredSubPrefab:
 	case ELPrefabVersion::NewObjectOnNestedPrefab:
 	{
 		LoadedRootActor = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefabWithExistingObjects(InWorld, this, InParent
@@ -755,6 +1269,7 @@ void ULPrefab::CopyDataTo(ULPrefab* TargetPrefab)
 	TargetPrefab->ArEngineNetVer = this->ArEngineNetVer;
 	TargetPrefab->ArGameNetVer = this->ArGameNetVer;
 	TargetPrefab->PrefabDataForPrefabEditor = this->PrefabDataForPrefabEditor;
+	TargetPrefab->ClearParsedSaveData();
 }
 
 FString ULPrefab::GenerateOverallVersionMD5()
@@ -790,12 +1305,370 @@ FString ULPrefab::GenerateOverallVersionMD5()
 void ULPrefab::SavePrefab(AActor* RootActor
 	, TMap<UObject*, FGuid>& InOutMapObjectToGuid, TMap<TObjectPtr<AActor>, FLSubPrefabData>& InSubPrefabMap
 	, bool InForEditorOrRuntimeUse
+	, bool InDeltaAgainstArchetype
 )
 {
 	LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::SavePrefab(RootActor, this
 		, InOutMapObjectToGuid, InSubPrefabMap
 		, InForEditorOrRuntimeUse
+		, InDeltaAgainstArchetype
+	);
+}
+
+void ULPrefab::SavePrefabForRuntime(AActor* RootActor
+	, TMap<UObject*, FGuid>& InOutMapObjectToGuid, TMap<TObjectPtr<AActor>, FLSubPrefabData>& InSubPrefabMap
+)
+{
+	bool bFlatten = bFlattenSubPrefabsWhenCook && InSubPrefabMap.Num() > 0;
+	bool bDelta = CVarLPrefabDeltaBuildData.GetValueOnAnyThread() != 0;
+	//Sub prefab's actors are already loaded with override parameters applied, so just serialize them as normal actors: only keep deferred sub prefabs in SubPrefabMap, others are collected as this prefab's own actors.
+	TMap<TObjectPtr<AActor>, FLSubPrefabData> DeferredSubPrefabMap;
+	if (bFlatten)
+	{
+		for (auto& KeyValue : InSubPrefabMap)
+		{
+			if (KeyValue.Value.bDeferLoad)
+			{
+				DeferredSubPrefabMap.Add(KeyValue.Key, KeyValue.Value);
+			}
+		}
+	}
+	FString CantMergeReason;
+	if (bMergeStaticMeshesWhenCook && !CanMergeStaticMeshesWhenCook(CantMergeReason))
+	{
+		UE_LOG(LPrefab, Warning, TEXT("[%s].%d Skip merge static meshes of prefab '%s', because %s."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(this->GetPathName()), *CantMergeReason);
+	}
+	else if (bMergeStaticMeshesWhenCook)
+	{
+		auto Report = LPrefabMergeStaticMesh::Merge(RootActor, bFlatten ? DeferredSubPrefabMap : InSubPrefabMap, bMergeUseHierarchicalInstances, InOutMapObjectToGuid);
+		UE_LOG(LPrefab, Log, TEXT("[%s].%d Merge static meshes of prefab '%s': %s."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(this->GetPathName()), *Report.ToString());
+	}
+	if (bFlatten)
+	{
+		//Sub prefab's objects are not in guid map (except those referenced by parent prefab), SavePrefab give them new random guids.
+		//Save with a copy, so these guids only live in runtime data and are not written back to agent objects' guid map.
+		auto FlattenMapObjectToGuid = InOutMapObjectToGuid;
+		this->SavePrefab(RootActor, FlattenMapObjectToGuid, DeferredSubPrefabMap, false, bDelta);
+		UE_LOG(LPrefab, Log, TEXT("[%s].%d Flatten %d sub prefab(s) into runtime data of prefab: '%s', %d deferred sub prefab(s) are kept."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, InSubPrefabMap.Num() - DeferredSubPrefabMap.Num(), *(this->GetPathName()), DeferredSubPrefabMap.Num());
+	}
+	else
+	{
+		this->SavePrefab(RootActor, InOutMapObjectToGuid, InSubPrefabMap, false, bDelta);
+	}
+	ApplySoftReferenceWhenCook();
+}
+
+static const FName LPrefabRuntimeSubPrefabsTagName(TEXT("LPrefabRuntimeSubPrefabs"));
+void ULPrefab::GetAssetRegistryTags(TArray<FAssetRegistryTag>& OutTags)const
+{
+	Super::GetAssetRegistryTags(OutTags);
+	if (!bHasSubPrefabDeferLoadRecord)return;//no tag means unknown
+	//sub prefabs that find objects in their own runtime data when this prefab load: not flattened, or defer load
+	FString RuntimeSubPrefabs;
+	for (auto& KeyValue : SubPrefabDeferLoadRecord)
+	{
+		if (bFlattenSubPrefabsWhenCook && !KeyValue.Value)continue;
+		if (RuntimeSubPrefabs.Len() > 0)RuntimeSubPrefabs.AppendChar(TEXT(','));
+		RuntimeSubPrefabs.Append(KeyValue.Key.ToString());
+	}
+	OutTags.Add(FAssetRegistryTag(LPrefabRuntimeSubPrefabsTagName, RuntimeSubPrefabs, FAssetRegistryTag::TT_Hidden));
+}
+
+bool ULPrefab::CanMergeStaticMeshesWhenCook(FString& OutReason)
+{
+	if (!bMergeStaticMeshesWhenCook)return false;
+	//parent prefab store guids of all sub prefab's objects, and find them in sub prefab's runtime data when load, unless the sub prefab is flattened into parent
+	FAssetRegistryModule& AssetRegistryModule = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(FName("AssetRegistry"));
+	IAssetRegistry& AssetRegistry = AssetRegistryModule.Get();
+	auto ThisPackageName = this->GetOutermost()->GetFName();
+	TArray<FName> ReferencerPackageNames;
+	AssetRegistry.GetReferencers(ThisPackageName, ReferencerPackageNames);
+	auto PrefabClassName = ULPrefab::StaticClass()->GetClassPathName();
+	auto ThisPath = this->GetPathName();
+	for (auto& PackageName : ReferencerPackageNames)
+	{
+		if (PackageName == ThisPackageName)continue;
+		TArray<FAssetData> AssetList;
+		AssetRegistry.GetAssetsByPackageName(PackageName, AssetList);
+		for (auto& Asset : AssetList)
+		{
+			if (Asset.AssetClassPath != PrefabClassName)continue;
+			FString RuntimeSubPrefabs;
+			if (!Asset.GetTagValue(LPrefabRuntimeSubPrefabsTagName, RuntimeSubPrefabs))
+			{
+				OutReason = FString::Printf(TEXT("prefab '%s' is saved by old version which don't record how it use sub prefab, please save it again"), *PackageName.ToString());
+				return false;
+			}
+			TArray<FString> RuntimeSubPrefabArray;
+			RuntimeSubPrefabs.ParseIntoArray(RuntimeSubPrefabArray, TEXT(","));
+			if (RuntimeSubPrefabArray.Contains(ThisPath))
+			{
+				OutReason = FString::Printf(TEXT("prefab '%s' use it as sub prefab without bFlattenSubPrefabsWhenCook, or defer load it"), *PackageName.ToString());
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool ULPrefab::TranscodeBuildDataForRuntime()
+{
+	LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabTranscodedBuildData Data;
+	FString FailReason;
+	if (!LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::TranscodeBuildData(this, CVarLPrefabDeltaBuildData.GetValueOnAnyThread() != 0, Data, FailReason))
+	{
+		UE_LOG(LPrefab, Log, TEXT("[%s].%d Can't transcode build data of prefab: '%s', because %s. Use agent objects instead."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(this->GetPathName()), *FailReason);
+		return false;
+	}
+	LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::ApplyTranscodedBuildData(this, Data);
+	ApplySoftReferenceWhenCook();
+	return true;
+}
+
+void ULPrefab::ApplySoftReferenceWhenCook()
+{
+	SoftReferenceAssetListForBuild.Empty();
+	SoftReferenceClassListForBuild.Empty();
+	if (bSoftReferenceWhenCook)
+	{
+		//move to soft reference, so dependencies are not loaded together with prefab asset
+		for (auto& Asset : ReferenceAssetListForBuild)
+		{
+			SoftReferenceAssetListForBuild.Add(TSoftObjectPtr<UObject>(Asset.Get()));
+		}
+		for (auto& Class : ReferenceClassListForBuild)
+		{
+			SoftReferenceClassListForBuild.Add(TSoftClassPtr<UObject>(Class.Get()));
+		}
+		ReferenceAssetListForBuild.Empty();
+		ReferenceClassListForBuild.Empty();
+	}
+}
+
+//change this guid to invalidate all prefab build data stored in DDC
+#define LPREFAB_BUILD_DATA_DDC_VERSION TEXT("4F0C27B9E61A4D3B8A52C7E9D1B06F38")
+namespace
+{
+	void HashStructSchema(FSHA1& Hash, const UStruct* InStruct, TSet<const UStruct*>& Visited);
+	void HashPropertySchema(FSHA1& Hash, const FProperty* InProperty, TSet<const UStruct*>& Visited)
+	{
+		auto Name = InProperty->GetName();
+		Hash.UpdateWithString(*Name, Name.Len());
+		auto CPPType = InProperty->GetCPPType();
+		Hash.UpdateWithString(*CPPType, CPPType.Len());
+		int32 Offset = InProperty->GetOffset_ForInternal();
+		int32 ArrayDim = InProperty->ArrayDim;
+		uint64 PropertyFlags = (uint64)InProperty->PropertyFlags;
+		Hash.Update((const uint8*)&Offset, sizeof(Offset));
+		Hash.Update((const uint8*)&ArrayDim, sizeof(ArrayDim));
+		Hash.Update((const uint8*)&PropertyFlags, sizeof(PropertyFlags));
+		if (auto StructProperty = CastField<FStructProperty>(InProperty))
+		{
+			HashStructSchema(Hash, StructProperty->Struct, Visited);
+		}
+		else if (auto ArrayProperty = CastField<FArrayProperty>(InProperty))
+		{
+			HashPropertySchema(Hash, ArrayProperty->Inner, Visited);
+		}
+		else if (auto SetProperty = CastField<FSetProperty>(InProperty))
+		{
+			HashPropertySchema(Hash, SetProperty->ElementProp, Visited);
+		}
+		else if (auto MapProperty = CastField<FMapProperty>(InProperty))
+		{
+			HashPropertySchema(Hash, MapProperty->KeyProp, Visited);
+			HashPropertySchema(Hash, MapProperty->ValueProp, Visited);
+		}
+	}
+	void HashStructSchema(FSHA1& Hash, const UStruct* InStruct, TSet<const UStruct*>& Visited)
+	{
+		if (InStruct == nullptr)return;
+		bool bAlreadyVisited = false;
+		Visited.Add(InStruct, &bAlreadyVisited);
+		auto PathName = InStruct->GetPathName();
+		Hash.UpdateWithString(*PathName, PathName.Len());
+		if (bAlreadyVisited)return;//only path name for struct that already hashed, also break recursion
+		for (TFieldIterator<FProperty> PropertyItr(InStruct); PropertyItr; ++PropertyItr)
+		{
+			HashPropertySchema(Hash, *PropertyItr, Visited);
+		}
+	}
+}
+
+FString ULPrefab::GetBuildDataDDCKey(const ITargetPlatform* TargetPlatform)
+{
+	LPREFAB_TRACE_SCOPE_TEXT(TEXT("LPrefab.GetBuildDataDDCKey %s"), *this->GetName());
+	//this prefab and all nested sub prefabs, build data of flattened prefab contains sub prefab's data
+	TArray<ULPrefab*> OverallPrefabs;
+	OverallPrefabs.Add(this);
+	for (int i = 0; i < OverallPrefabs.Num(); i++)
+	{
+		for (auto& Item : OverallPrefabs[i]->ReferenceAssetList)
+		{
+			if (auto SubPrefab = Cast<ULPrefab>(Item))
+			{
+				OverallPrefabs.AddUnique(SubPrefab);
+			}
+		}
+	}
+
+	FSHA1 Hash;
+	TSet<const UStruct*> VisitedStructs;
+	TArray<UClass*> OverallClasses;
+	for (auto Prefab : OverallPrefabs)
+	{
+		Hash.Update(Prefab->BinaryData.GetData(), Prefab->BinaryData.Num());
+		for (auto Class : Prefab->ReferenceClassList)
+		{
+			if (Class == nullptr || OverallClasses.Contains(Class))continue;
+			OverallClasses.Add(Class);
+			HashStructSchema(Hash, Class, VisitedStructs);
+		}
+	}
+	//default values of referenced classes, build data may only store delta against archetype
+	uint32 ArchetypeHash = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::ComputeArchetypeHash(OverallClasses);
+	Hash.Update((const uint8*)&ArchetypeHash, sizeof(ArchetypeHash));
+
+	static const auto CompactCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("LPrefab.CompactBuildData"));
+	static const auto TargetedCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("LPrefab.TargetedOverrideParameter"));
+	auto Settings = FString::Printf(TEXT("%s_%d_%d_%s_%d%d%d%d%d%d%d%d")
+		, *GenerateOverallVersionMD5()
+		, LPREFAB_CURRENT_VERSION
+		, LPREFAB_CURRENT_BUILD_DATA_VERSION
+		, TargetPlatform != nullptr ? *TargetPlatform->PlatformName() : TEXT("None")
+		, CompactCVar != nullptr ? CompactCVar->GetInt() : 0
+		, TargetedCVar != nullptr ? TargetedCVar->GetInt() : 0
+		, CVarLPrefabDeltaBuildData.GetValueOnAnyThread()
+		, CVarLPrefabTranscodeBuildData.GetValueOnAnyThread()
+		, bFlattenSubPrefabsWhenCook ? 1 : 0
+		, bSoftReferenceWhenCook ? 1 : 0
+		, bMergeStaticMeshesWhenCook ? 1 : 0
+		, bMergeUseHierarchicalInstances ? 1 : 0
 	);
+	Hash.UpdateWithString(*Settings, Settings.Len());
+	Hash.Final();
+	FSHAHash Digest;
+	Hash.GetHash(Digest.Hash);
+	return FDerivedDataCacheInterface::BuildCacheKey(TEXT("LPREFAB"), LPREFAB_BUILD_DATA_DDC_VERSION, *Digest.ToString());
+}
+
+bool ULPrefab::LoadBuildDataFromDDC(const FString& InKey)
+{
+	LPREFAB_TRACE_SCOPE_TEXT(TEXT("LPrefab.LoadBuildDataFromDDC %s"), *this->GetName());
+	TArray<uint8> Data;
+	if (!GetDerivedDataCacheRef().GetSynchronous(*InKey, Data, GetPathName()))
+	{
+		return false;
+	}
+	FMemoryReader Reader(Data);
+	TArray<uint8> CachedBinaryData;
+	uint16 CachedBuildDataVersion = 0;
+	uint32 CachedArchetypeHash = 0;
+	int32 CachedArchiveVersion = 0, CachedArchiveVersionUE5 = 0, CachedArchiveLicenseeVer = 0;
+	uint32 CachedArEngineNetVer = 0, CachedArGameNetVer = 0;
+	TArray<FString> AssetPaths, ClassPaths, SoftAssetPaths, SoftClassPaths;
+	TArray<FName> Names;
+	Reader << CachedBinaryData;
+	Reader << CachedBuildDataVersion;
+	Reader << CachedArchetypeHash;
+	Reader << CachedArchiveVersion;
+	Reader << CachedArchiveVersionUE5;
+	Reader << CachedArchiveLicenseeVer;
+	Reader << CachedArEngineNetVer;
+	Reader << CachedArGameNetVer;
+	Reader << AssetPaths;
+	Reader << ClassPaths;
+	Reader << Names;
+	Reader << SoftAssetPaths;
+	Reader << SoftClassPaths;
+	if (Reader.IsError() || CachedBinaryData.Num() == 0)
+	{
+		return false;
+	}
+
+	//every hard reference must be resolved, otherwise object index in build data is wrong
+	TArray<TObjectPtr<UObject>> Assets;
+	for (auto& Path : AssetPaths)
+	{
+		UObject* Asset = nullptr;
+		if (!Path.IsEmpty())
+		{
+			Asset = FSoftObjectPath(Path).TryLoad();
+			if (Asset == nullptr)return false;
+		}
+		Assets.Add(Asset);
+	}
+	TArray<TObjectPtr<UClass>> Classes;
+	for (auto& Path : ClassPaths)
+	{
+		auto Class = Cast<UClass>(FSoftObjectPath(Path).TryLoad());
+		if (Class == nullptr)return false;
+		Classes.Add(Class);
+	}
+
+	BinaryDataForBuild = MoveTemp(CachedBinaryData);
+	BuildDataVersion = CachedBuildDataVersion;
+	ArchetypeHashForBuild = CachedArchetypeHash;
+	ArchiveVersion_ForBuild = CachedArchiveVersion;
+	ArchiveVersionUE5_ForBuild = CachedArchiveVersionUE5;
+	ArchiveLicenseeVer_ForBuild = CachedArchiveLicenseeVer;
+	ArEngineNetVer_ForBuild = CachedArEngineNetVer;
+	ArGameNetVer_ForBuild = CachedArGameNetVer;
+	ReferenceAssetListForBuild = MoveTemp(Assets);
+	ReferenceClassListForBuild = MoveTemp(Classes);
+	ReferenceNameListForBuild = MoveTemp(Names);
+	SoftReferenceAssetListForBuild.Empty();
+	for (auto& Path : SoftAssetPaths)
+	{
+		SoftReferenceAssetListForBuild.Add(TSoftObjectPtr<UObject>(FSoftObjectPath(Path)));
+	}
+	SoftReferenceClassListForBuild.Empty();
+	for (auto& Path : SoftClassPaths)
+	{
+		SoftReferenceClassListForBuild.Add(TSoftClassPtr<UObject>(FSoftObjectPath(Path)));
+	}
+	ClearParsedSaveData();
+	return true;
+}
+
+void ULPrefab::SaveBuildDataToDDC(const FString& InKey)
+{
+	LPREFAB_TRACE_SCOPE_TEXT(TEXT("LPrefab.SaveBuildDataToDDC %s"), *this->GetName());
+	TArray<FString> AssetPaths, ClassPaths, SoftAssetPaths, SoftClassPaths;
+	for (auto& Asset : ReferenceAssetListForBuild)
+	{
+		AssetPaths.Add(Asset != nullptr ? Asset->GetPathName() : FString());
+	}
+	for (auto& Class : ReferenceClassListForBuild)
+	{
+		if (Class == nullptr)return;//can't restore, don't cache it
+		ClassPaths.Add(Class->GetPathName());
+	}
+	for (auto& Asset : SoftReferenceAssetListForBuild)
+	{
+		SoftAssetPaths.Add(Asset.ToSoftObjectPath().ToString());
+	}
+	for (auto& Class : SoftReferenceClassListForBuild)
+	{
+		SoftClassPaths.Add(Class.ToSoftObjectPath().ToString());
+	}
+
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+	Writer << BinaryDataForBuild;
+	Writer << BuildDataVersion;
+	Writer << ArchetypeHashForBuild;
+	Writer << ArchiveVersion_ForBuild;
+	Writer << ArchiveVersionUE5_ForBuild;
+	Writer << ArchiveLicenseeVer_ForBuild;
+	Writer << ArEngineNetVer_ForBuild;
+	Writer << ArGameNetVer_ForBuild;
+	Writer << AssetPaths;
+	Writer << ClassPaths;
+	Writer << ReferenceNameListForBuild;
+	Writer << SoftAssetPaths;
+	Writer << SoftClassPaths;
+	GetDerivedDataCacheRef().Put(*InKey, Data, GetPathName());
 }
 
 void ULPrefab::RecreatePrefab()
@@ -821,6 +1694,7 @@ AActor* ULPrefab::LoadPrefabInEditor(UWorld* InWorld, USceneComponent* InParent,
 	AActor* LoadedRootActor = nullptr;
 	switch ((ELPrefabVersion)PrefabVersion)
 	{
+	case ELPrefabVersion::DeferredSubPrefab:
 	case ELPrefabVersion::NewObjectOnNestedPrefab:
 	{
 		TMap<FGuid, TObjectPtr<UObject>> MapGuidToObject;
@@ -890,6 +1764,7 @@ AActor* ULPrefab::LoadPrefabInEditor(UWorld* InWorld, USceneComponent* InParent,
 	AActor* LoadedRootActor = nullptr;
 	switch ((ELPrefabVersion)PrefabVersion)
 	{
+	case ELPrefabVersion::DeferredSubPrefab:
 	case ELPrefabVersion::NewObjectOnNestedPrefab:
 	{
 		LoadedRootActor = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefabWithExistingObjects(InWorld, this
@@ -0,0 +1,1048 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "PrefabSystem/LPrefabBenchmark.h"
+#if !UE_BUILD_SHIPPING//benchmark and its console commands are for development only
+#include "PrefabSystem/LPrefab.h"
+#include "PrefabSystem/LPrefabDeferredSubPrefabComponent.h"
+#include "LPrefabModule.h"
+#include "LPrefabUtils.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectIterator.h"
+#include LPREFAB_SERIALIZER_NEWEST_INCLUDE
+#if WITH_EDITOR
+#include "EngineUtils.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/MemoryBase.h"
+#include "UObject/StrongObjectPtr.h"
+#include "Async/ParallelFor.h"
+#include <atomic>
+#endif
+
+#if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
+PRAGMA_DISABLE_OPTIMIZATION
+#endif
+
+static FAutoConsoleCommandWithWorldAndArgs CCmdLPrefabBenchmarkLoadPrefabBatch(
+	TEXT("LPrefab.Benchmark.LoadPrefabBatch"),
+	TEXT("Compare N times LoadPrefab with LoadPrefabBatch in current world. Usage: LPrefab.Benchmark.LoadPrefabBatch <PrefabPath> [Count0 Count1 ...], default counts are 10 100 1000."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& InArgs, UWorld* InWorld) {
+		if (InArgs.Num() == 0)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Need prefab path!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return;
+		}
+		auto Prefab = LoadObject<ULPrefab>(nullptr, *InArgs[0]);
+		if (Prefab == nullptr)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Can't load prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *InArgs[0]);
+			return;
+		}
+		TArray<int32> Counts;
+		for (int i = 1; i < InArgs.Num(); i++)
+		{
+			Counts.Add(FCString::Atoi(*InArgs[i]));
+		}
+		if (Counts.Num() == 0)
+		{
+			Counts = { 10, 100, 1000 };
+		}
+		LPrefabBenchmark::LoadPrefabBatch(InWorld, Prefab, Counts);
+		})
+);
+
+static FAutoConsoleCommandWithWorldAndArgs CCmdLPrefabBenchmarkDeferredSubPrefab(
+	TEXT("LPrefab.Benchmark.DeferredSubPrefab"),
+	TEXT("Compare N times LoadPrefab with eager and deferred sub prefabs in current world (game world only). Usage: LPrefab.Benchmark.DeferredSubPrefab <PrefabPath> [Count], default count is 100."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& InArgs, UWorld* InWorld) {
+		if (InArgs.Num() == 0)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Need prefab path!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return;
+		}
+		auto Prefab = LoadObject<ULPrefab>(nullptr, *InArgs[0]);
+		if (Prefab == nullptr)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Can't load prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *InArgs[0]);
+			return;
+		}
+		LPrefabBenchmark::DeferredSubPrefab(InWorld, Prefab, InArgs.Num() > 1 ? FCString::Atoi(*InArgs[1]) : 100);
+		})
+);
+
+static FAutoConsoleCommandWithWorldAndArgs CCmdLPrefabBenchmarkBackgroundParse(
+	TEXT("LPrefab.Benchmark.BackgroundParse"),
+	TEXT("Compare game thread time of LoadPrefab with inline parse and with background parse (FLPrefabLoadRequest). Usage: LPrefab.Benchmark.BackgroundParse <PrefabPath> [Count], default count is 20."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& InArgs, UWorld* InWorld) {
+		if (InArgs.Num() == 0)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Need prefab path!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return;
+		}
+		auto Prefab = LoadObject<ULPrefab>(nullptr, *InArgs[0]);
+		if (Prefab == nullptr)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Can't load prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *InArgs[0]);
+			return;
+		}
+		LPrefabBenchmark::BackgroundParse(InWorld, Prefab, InArgs.Num() > 1 ? FCString::Atoi(*InArgs[1]) : 20);
+		})
+);
+
+static FAutoConsoleCommand CCmdLPrefabMemReport(
+	TEXT("LPrefab.MemReport"),
+	TEXT("List build data memory of all loaded prefabs: size on disk, uncompressed size, resident raw data and parsed data."),
+	FConsoleCommandDelegate::CreateLambda([]() {
+		LPrefabBenchmark::MemoryReport();
+		})
+);
+
+#if WITH_EDITOR
+/** Load prefab by path, or all prefabs in folder. */
+static bool LoadPrefabsByPathOrFolder(const FString& InPath, TArray<ULPrefab*>& OutPrefabs)
+{
+	if (auto Prefab = LoadObject<ULPrefab>(nullptr, *InPath, nullptr, LOAD_Quiet | LOAD_NoWarn))
+	{
+		OutPrefabs.Add(Prefab);
+	}
+	else
+	{
+		TArray<UObject*> Objects;
+		EngineUtils::FindOrLoadAssetsByPath(InPath, Objects, EngineUtils::ATL_Regular);
+		for (auto Object : Objects)
+		{
+			if (auto PrefabInFolder = Cast<ULPrefab>(Object))
+			{
+				OutPrefabs.Add(PrefabInFolder);
+			}
+		}
+	}
+	if (OutPrefabs.Num() == 0)
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d Can't find any prefab in: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *InPath);
+		return false;
+	}
+	return true;
+}
+
+static FAutoConsoleCommandWithWorldAndArgs CCmdLPrefabBenchmarkBuildDataFormat(
+	TEXT("LPrefab.Benchmark.BuildDataFormat"),
+	TEXT("Compare build data size and parse time between legacy (FGuid) and compact (int32 index) layout. Usage: LPrefab.Benchmark.BuildDataFormat <PrefabPathOrFolder> [ParseCount], default parse count is 100."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& InArgs, UWorld* InWorld) {
+		if (InArgs.Num() == 0)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Need prefab path or folder!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return;
+		}
+		TArray<ULPrefab*> Prefabs;
+		if (!LoadPrefabsByPathOrFolder(InArgs[0], Prefabs))return;
+		LPrefabBenchmark::BuildDataFormat(Prefabs, InArgs.Num() > 1 ? FCString::Atoi(*InArgs[1]) : 100);
+		})
+);
+
+static FAutoConsoleCommandWithWorldAndArgs CCmdLPrefabBenchmarkCookTranscode(
+	TEXT("LPrefab.Benchmark.CookTranscode"),
+	TEXT("Compare cook time of prefabs between agent objects and transcode editor data (in game thread and in parallel), and check if build data are the same. Usage: LPrefab.Benchmark.CookTranscode [PrefabPathOrFolder or SyntheticPrefabCount], default is 2000 synthetic prefabs."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& InArgs, UWorld* InWorld) {
+		TArray<ULPrefab*> Prefabs;
+		if (InArgs.Num() > 0 && !InArgs[0].IsNumeric())
+		{
+			if (!LoadPrefabsByPathOrFolder(InArgs[0], Prefabs))return;
+			LPrefabBenchmark::CookTranscode(Prefabs);
+			return;
+		}
+		if (InWorld == nullptr)return;
+		//sub prefab is not transcoded, so generate flat prefabs
+		LPrefabBenchmark::FSyntheticPrefabParams Params;
+		Params.Depth = 0;
+		auto Count = InArgs.Num() > 0 ? FCString::Atoi(*InArgs[0]) : 2000;
+		TArray<TStrongObjectPtr<ULPrefab>> SyntheticPrefabs;
+		for (int i = 0; i < Count; i++)
+		{
+			if (auto Prefab = LPrefabBenchmark::GenerateSyntheticPrefab(InWorld, Params))
+			{
+				SyntheticPrefabs.Add(TStrongObjectPtr<ULPrefab>(Prefab));
+				Prefabs.Add(Prefab);
+			}
+		}
+		LPrefabBenchmark::CookTranscode(Prefabs);
+		SyntheticPrefabs.Empty();
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+		})
+);
+
+static FAutoConsoleCommandWithWorldAndArgs CCmdLPrefabBenchmarkSerializer(
+	TEXT("LPrefab.Benchmark.Serializer"),
+	TEXT("Generate synthetic prefab, measure load, duplicate and save with median/p95 time and allocation count. Usage: LPrefab.Benchmark.Serializer [ActorCount] [ComponentCount] [Depth] [FanOut] [OverrideDensity] [Iterations], default is 16 4 1 2 0.25 50. Use commandlet LPrefabBenchmark to run headless and write csv."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& InArgs, UWorld* InWorld) {
+		LPrefabBenchmark::FSyntheticPrefabParams Params;
+		if (InArgs.Num() > 0)Params.ActorCount = FCString::Atoi(*InArgs[0]);
+		if (InArgs.Num() > 1)Params.ComponentCount = FCString::Atoi(*InArgs[1]);
+		if (InArgs.Num() > 2)Params.Depth = FCString::Atoi(*InArgs[2]);
+		if (InArgs.Num() > 3)Params.FanOut = FCString::Atoi(*InArgs[3]);
+		if (InArgs.Num() > 4)Params.OverrideDensity = FCString::Atof(*InArgs[4]);
+		LPrefabBenchmark::Serializer(InWorld, Params, InArgs.Num() > 5 ? FCString::Atoi(*InArgs[5]) : 50, FString(), FString());
+		})
+);
+
+static FAutoConsoleCommandWithWorldAndArgs CCmdLPrefabBenchmarkDuplicateActor(
+	TEXT("LPrefab.Benchmark.DuplicateActor"),
+	TEXT("Compare DuplicateActor through byte data and with direct copy on synthetic hierarchy. Usage: LPrefab.Benchmark.DuplicateActor [ActorCount0 ActorCount1 ...], default counts are 10 100 1000."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& InArgs, UWorld* InWorld) {
+		TArray<int32> ActorCounts;
+		for (auto& Arg : InArgs)
+		{
+			ActorCounts.Add(FCString::Atoi(*Arg));
+		}
+		if (ActorCounts.Num() == 0)
+		{
+			ActorCounts = { 10, 100, 1000 };
+		}
+		LPrefabBenchmark::DuplicateActor(InWorld, ActorCounts, 20);
+		})
+);
+
+static FAutoConsoleCommandWithWorldAndArgs CCmdLPrefabBenchmarkSavePrefabScaling(
+	TEXT("LPrefab.Benchmark.SavePrefabScaling"),
+	TEXT("Measure SavePrefab on synthetic hierarchy, to check save time scale linearly with actor count. Usage: LPrefab.Benchmark.SavePrefabScaling [ActorCount0 ActorCount1 ...], default counts are 1000 10000 50000."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& InArgs, UWorld* InWorld) {
+		TArray<int32> ActorCounts;
+		for (auto& Arg : InArgs)
+		{
+			ActorCounts.Add(FCString::Atoi(*Arg));
+		}
+		if (ActorCounts.Num() == 0)
+		{
+			ActorCounts = { 1000, 10000, 50000 };
+		}
+		LPrefabBenchmark::SavePrefabScaling(InWorld, ActorCounts, 3);
+		})
+);
+
+static FAutoConsoleCommandWithWorldAndArgs CCmdLPrefabBenchmarkIncrementalSave(
+	TEXT("LPrefab.Benchmark.IncrementalSave"),
+	TEXT("Change one component of synthetic hierarchy, compare time and data of incremental save and full save. Usage: LPrefab.Benchmark.IncrementalSave [ActorCount0 ActorCount1 ...], default counts are 100 1000 5000."),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& InArgs, UWorld* InWorld) {
+		TArray<int32> ActorCounts;
+		for (auto& Arg : InArgs)
+		{
+			ActorCounts.Add(FCString::Atoi(*Arg));
+		}
+		if (ActorCounts.Num() == 0)
+		{
+			ActorCounts = { 100, 1000, 5000 };
+		}
+		LPrefabBenchmark::IncrementalSave(InWorld, ActorCounts, 5);
+		})
+);
+#endif
+
+void LPrefabBenchmark::LoadPrefabBatch(UWorld* InWorld, ULPrefab* InPrefab, const TArray<int32>& InCounts)
+{
+	if (InWorld == nullptr || InPrefab == nullptr)return;
+	//warm up, so parse and asset load is not counted
+	LPrefabUtils::DestroyActorWithHierarchy(InPrefab->LoadPrefab(InWorld, nullptr));
+
+	for (auto Count : InCounts)
+	{
+		if (Count <= 0)continue;
+		TArray<FTransform> Transforms;
+		Transforms.Reserve(Count);
+		for (int i = 0; i < Count; i++)
+		{
+			Transforms.Add(FTransform(FVector(i * 100.0f, 0, 0)));
+		}
+		TArray<AActor*> Roots;
+		Roots.Reserve(Count);
+
+		auto StartTime = FPlatformTime::Seconds();
+		for (auto& Transform : Transforms)
+		{
+			Roots.Add(InPrefab->LoadPrefabWithTransform(InWorld, nullptr, Transform.GetLocation(), Transform.GetRotation(), Transform.GetScale3D(), nullptr));
+		}
+		auto LoadPrefabTime = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		for (auto& Root : Roots)
+		{
+			LPrefabUtils::DestroyActorWithHierarchy(Root);
+		}
+
+		StartTime = FPlatformTime::Seconds();
+		InPrefab->LoadPrefabBatch(InWorld, Transforms, {}, Roots);
+		auto LoadPrefabBatchTime = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		for (auto& Root : Roots)
+		{
+			LPrefabUtils::DestroyActorWithHierarchy(Root);
+		}
+
+		UE_LOG(LPrefab, Log, TEXT("LoadPrefabBatch benchmark, prefab: '%s', N: %d, N x LoadPrefab: %fms, LoadPrefabBatch: %fms, speedup: %.2fx")
+			, *InPrefab->GetName(), Count, LoadPrefabTime, LoadPrefabBatchTime, LoadPrefabBatchTime > 0 ? LoadPrefabTime / LoadPrefabBatchTime : 0.0);
+	}
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
+
+void LPrefabBenchmark::DeferredSubPrefab(UWorld* InWorld, ULPrefab* InPrefab, int32 InCount)
+{
+	if (InWorld == nullptr || InPrefab == nullptr || InCount <= 0)return;
+	if (!InWorld->IsGameWorld())
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d Sub prefab is only deferred in game world!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+		return;
+	}
+	auto DeferCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("LPrefab.DeferSubPrefab"));
+	if (DeferCVar == nullptr)return;
+	auto OriginDeferValue = DeferCVar->GetInt();
+	//warm up, so parse and asset load is not counted
+	LPrefabUtils::DestroyActorWithHierarchy(InPrefab->LoadPrefab(InWorld, nullptr));
+
+	TArray<AActor*> Roots;
+	Roots.Reserve(InCount);
+	double LoadTime[2] = { 0, 0 };
+	double RealizeTime = 0;
+	int32 RealizeCount = 0;
+	for (int Defer = 0; Defer < 2; Defer++)
+	{
+		DeferCVar->Set(Defer, ECVF_SetByCode);
+		auto StartTime = FPlatformTime::Seconds();
+		for (int i = 0; i < InCount; i++)
+		{
+			Roots.Add(InPrefab->LoadPrefab(InWorld, nullptr));
+		}
+		LoadTime[Defer] = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		if (Defer == 1)
+		{
+			StartTime = FPlatformTime::Seconds();
+			for (auto& Root : Roots)
+			{
+				RealizeCount += ULPrefabDeferredSubPrefabComponent::RealizeAll(Root);
+			}
+			RealizeTime = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+		}
+		for (auto& Root : Roots)
+		{
+			LPrefabUtils::DestroyActorWithHierarchy(Root);
+		}
+		Roots.Reset();
+	}
+	DeferCVar->Set(OriginDeferValue, ECVF_SetByCode);
+
+	UE_LOG(LPrefab, Log, TEXT("DeferredSubPrefab benchmark, prefab: '%s', N: %d, deferred sub prefab per instance: %d, N x LoadPrefab eager: %fms, deferred: %fms (saved %fms), realize all deferred: %fms")
+		, *InPrefab->GetName(), InCount, RealizeCount / InCount, LoadTime[0], LoadTime[1], LoadTime[0] - LoadTime[1], RealizeTime);
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
+
+void LPrefabBenchmark::BackgroundParse(UWorld* InWorld, ULPrefab* InPrefab, int32 InCount)
+{
+	if (InWorld == nullptr || InPrefab == nullptr || InCount <= 0)return;
+	bool bIsEditorOrRuntime = true;
+#if !WITH_EDITOR
+	bIsEditorOrRuntime = false;
+#endif
+	//warm up, so asset load is not counted
+	LPrefabUtils::DestroyActorWithHierarchy(InPrefab->LoadPrefab(InWorld, nullptr));
+
+	double ParseTime = 0, InlineGameThreadTime = 0, RequestGameThreadTime = 0;
+	for (int i = 0; i < InCount; i++)
+	{
+		//parse only
+		InPrefab->ClearParsedSaveData();
+		auto StartTime = FPlatformTime::Seconds();
+		LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::ParseSaveData(InPrefab, bIsEditorOrRuntime);
+		ParseTime += FPlatformTime::Seconds() - StartTime;
+
+		//before: parse inside LoadPrefab
+		InPrefab->ClearParsedSaveData();
+		StartTime = FPlatformTime::Seconds();
+		auto Root = InPrefab->LoadPrefab(InWorld, nullptr);
+		InlineGameThreadTime += FPlatformTime::Seconds() - StartTime;
+		LPrefabUtils::DestroyActorWithHierarchy(Root);
+
+		//after: parse in background, game thread only start the request and spawn actors
+		InPrefab->ClearParsedSaveData();
+		StartTime = FPlatformTime::Seconds();
+		auto Request = InPrefab->CreateLoadRequest();
+		RequestGameThreadTime += FPlatformTime::Seconds() - StartTime;
+		Request->WaitParseComplete();//stand for the frames between request and load, not counted
+		StartTime = FPlatformTime::Seconds();
+		Root = Request->LoadPrefab(InWorld, nullptr);
+		RequestGameThreadTime += FPlatformTime::Seconds() - StartTime;
+		LPrefabUtils::DestroyActorWithHierarchy(Root);
+	}
+	ParseTime = ParseTime * 1000.0 / InCount;
+	InlineGameThreadTime = InlineGameThreadTime * 1000.0 / InCount;
+	RequestGameThreadTime = RequestGameThreadTime * 1000.0 / InCount;
+	UE_LOG(LPrefab, Log, TEXT("BackgroundParse benchmark, prefab: '%s', N: %d, parse: %fms, game thread of LoadPrefab inline parse: %fms (parse share %.1f%%), with FLPrefabLoadRequest: %fms")
+		, *InPrefab->GetName(), InCount, ParseTime, InlineGameThreadTime, InlineGameThreadTime > 0 ? ParseTime * 100.0 / InlineGameThreadTime : 0.0, RequestGameThreadTime);
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
+
+void LPrefabBenchmark::MemoryReport()
+{
+	int32 PrefabCount = 0, HotCount = 0, ParsedCount = 0;
+	int64 TotalOnDisk = 0, TotalUncompressed = 0, TotalResidentRaw = 0, TotalParsed = 0;
+	UE_LOG(LPrefab, Log, TEXT("LPrefab memory report, columns: OnDisk, Uncompressed, ResidentRaw, Parsed (bytes), IdleTime (s), Hot, Prefab"));
+	for (TObjectIterator<ULPrefab> Itr; Itr; ++Itr)
+	{
+		auto Prefab = *Itr;
+		auto OnDisk = Prefab->GetBinaryDataForBuildSizeOnDisk();
+		auto Uncompressed = (int64)Prefab->GetBinaryDataForBuildUncompressedSize();
+		auto ResidentRaw = (int64)Prefab->BinaryDataForBuild.GetAllocatedSize();
+		auto Parsed = (int64)Prefab->GetParsedSaveDataSize();
+		auto IdleTime = Prefab->GetParsedSaveDataIdleTime();
+		UE_LOG(LPrefab, Log, TEXT("%10lld, %10lld, %10lld, %10lld, %8.1f, %d, %s")
+			, OnDisk, Uncompressed, ResidentRaw, Parsed, IdleTime, Prefab->bKeepBuildDataResident ? 1 : 0, *Prefab->GetPathName());
+		PrefabCount++;
+		if (Prefab->bKeepBuildDataResident)HotCount++;
+		if (IdleTime >= 0)ParsedCount++;
+		TotalOnDisk += OnDisk;
+		TotalUncompressed += Uncompressed;
+		TotalResidentRaw += ResidentRaw;
+		TotalParsed += Parsed;
+	}
+	UE_LOG(LPrefab, Log, TEXT("LPrefab memory report, prefab count: %d (hot: %d, parsed: %d), on disk: %lld bytes, uncompressed: %lld bytes, resident raw: %lld bytes, parsed: %lld bytes, total resident: %lld bytes")
+		, PrefabCount, HotCount, ParsedCount, TotalOnDisk, TotalUncompressed, TotalResidentRaw, TotalParsed, TotalResidentRaw + TotalParsed);
+}
+
+#if WITH_EDITOR
+void LPrefabBenchmark::BuildDataFormat(const TArray<ULPrefab*>& InPrefabs, int32 InParseCount)
+{
+	auto CompactCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("LPrefab.CompactBuildData"));
+	if (CompactCVar == nullptr)return;
+	auto OriginCompactValue = CompactCVar->GetInt();
+	InParseCount = FMath::Max(InParseCount, 1);
+
+	int64 TotalSize[2] = { 0, 0 };
+	double TotalParseTime[2] = { 0, 0 };
+	for (auto Prefab : InPrefabs)
+	{
+		if (!IsValid(Prefab))continue;
+		int64 Size[2] = { 0, 0 };
+		double ParseTime[2] = { 0, 0 };
+		for (int Compact = 0; Compact < 2; Compact++)
+		{
+			CompactCVar->Set(Compact, ECVF_SetByCode);
+			Prefab->BeginCacheForCookedPlatformData(nullptr);
+			Size[Compact] = Prefab->BinaryDataForBuild.Num();
+
+			auto StartTime = FPlatformTime::Seconds();
+			for (int i = 0; i < InParseCount; i++)
+			{
+				LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::ParseSaveData(Prefab, false);
+			}
+			ParseTime[Compact] = (FPlatformTime::Seconds() - StartTime) * 1000.0 / InParseCount;
+			TotalSize[Compact] += Size[Compact];
+			TotalParseTime[Compact] += ParseTime[Compact];
+		}
+		Prefab->WillNeverCacheCookedPlatformDataAgain();
+		UE_LOG(LPrefab, Log, TEXT("BuildDataFormat benchmark, prefab: '%s', size: %lld -> %lld bytes (%.1f%%), parse: %fms -> %fms")
+			, *Prefab->GetName(), Size[0], Size[1], Size[0] > 0 ? Size[1] * 100.0 / Size[0] : 0.0, ParseTime[0], ParseTime[1]);
+	}
+	CompactCVar->Set(OriginCompactValue, ECVF_SetByCode);
+	UE_LOG(LPrefab, Log, TEXT("BuildDataFormat benchmark, prefab count: %d, total size: %lld -> %lld bytes (%.1f%%), total parse: %fms -> %fms")
+		, InPrefabs.Num(), TotalSize[0], TotalSize[1], TotalSize[0] > 0 ? TotalSize[1] * 100.0 / TotalSize[0] : 0.0, TotalParseTime[0], TotalParseTime[1]);
+}
+
+/**
+ * Forward everything to the engine allocator, and count allocations of all threads.
+ * Only installed as GMalloc while a benchmark case is measured, blocks allocated before or after are freed by the same inner allocator.
+ */
+class FLPrefabBenchmarkCountingMalloc : public FMalloc
+{
+public:
+	static FLPrefabBenchmarkCountingMalloc& Get()
+	{
+		static auto Instance = new FLPrefabBenchmarkCountingMalloc();//never deleted, other threads may still hold it after uninstall
+		return *Instance;
+	}
+	void Install()
+	{
+		check(IsInGameThread());
+		if (bInstalled)return;
+		AllocCount = 0;
+		Inner = GMalloc;
+		FPlatformMisc::MemoryBarrier();
+		GMalloc = this;
+		bInstalled = true;
+	}
+	/** @return allocation count since Install */
+	int64 Uninstall()
+	{
+		check(IsInGameThread());
+		if (!bInstalled)return 0;
+		GMalloc = Inner;//keep Inner, late call from other thread still forward to it
+		bInstalled = false;
+		return AllocCount.load();
+	}
+
+	virtual void* Malloc(SIZE_T Count, uint32 Alignment)override
+	{
+		AllocCount++;
+		return Inner->Malloc(Count, Alignment);
+	}
+	virtual void* TryMalloc(SIZE_T Count, uint32 Alignment)override
+	{
+		AllocCount++;
+		return Inner->TryMalloc(Count, Alignment);
+	}
+	virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment)override
+	{
+		if (Count > 0)AllocCount++;
+		return Inner->Realloc(Original, Count, Alignment);
+	}
+	virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment)override
+	{
+		if (Count > 0)AllocCount++;
+		return Inner->TryRealloc(Original, Count, Alignment);
+	}
+	virtual void Free(void* Original)override { Inner->Free(Original); }
+	virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment)override { return Inner->QuantizeSize(Count, Alignment); }
+	virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut)override { return Inner->GetAllocationSize(Original, SizeOut); }
+	virtual void Trim(bool bTrimThreadCaches)override { Inner->Trim(bTrimThreadCaches); }
+	virtual void SetupTLSCachesOnCurrentThread()override { Inner->SetupTLSCachesOnCurrentThread(); }
+	virtual void ClearAndDisableTLSCachesOnCurrentThread()override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+	virtual void UpdateStats()override { Inner->UpdateStats(); }
+	virtual void GetAllocatorStats(FGenericMemoryStats& OutStats)override { Inner->GetAllocatorStats(OutStats); }
+	virtual void DumpAllocatorStats(FOutputDevice& Ar)override { Inner->DumpAllocatorStats(Ar); }
+	virtual bool IsInternallyThreadSafe()const override { return Inner->IsInternallyThreadSafe(); }
+	virtual bool ValidateHeap()override { return Inner->ValidateHeap(); }
+	virtual const TCHAR* GetDescriptiveName()override { return TEXT("LPrefabBenchmarkCountingMalloc"); }
+private:
+	FMalloc* Inner = nullptr;
+	bool bInstalled = false;
+	std::atomic<int64> AllocCount = 0;
+};
+
+FString LPrefabBenchmark::FSyntheticPrefabParams::ToString()const
+{
+	return FString::Printf(TEXT("actor: %d, component: %d, depth: %d, fan out: %d, override density: %.2f"), ActorCount, ComponentCount, Depth, FanOut, OverrideDensity);
+}
+
+ULPrefab* LPrefabBenchmark::GenerateSyntheticPrefab(UWorld* InWorld, const FSyntheticPrefabParams& InParams)
+{
+	if (InWorld == nullptr)return nullptr;
+	auto ActorCount = FMath::Max(InParams.ActorCount, 1);
+	auto ComponentCount = FMath::Max(InParams.ComponentCount, 1);
+	auto OverrideDensity = FMath::Clamp(InParams.OverrideDensity, 0.0f, 1.0f);
+	//build from the deepest level, so every level can use the previous one as sub prefab
+	ULPrefab* SubPrefab = nullptr;
+	for (int Level = FMath::Max(InParams.Depth, 0); Level >= 0; Level--)
+	{
+		TArray<AActor*> Actors;
+		Actors.Reserve(ActorCount);
+		for (int i = 0; i < ActorCount; i++)
+		{
+			auto Actor = InWorld->SpawnActor<AActor>();
+			USceneComponent* RootComp = nullptr;
+			for (int c = 0; c < ComponentCount; c++)
+			{
+				auto Comp = NewObject<USceneComponent>(Actor);
+				Actor->AddInstanceComponent(Comp);
+				Comp->SetRelativeLocation(FVector(i * 100.0f, c * 10.0f, Level * 1000.0f));
+				if (c == 0)
+				{
+					Actor->SetRootComponent(Comp);
+					RootComp = Comp;
+					if (i > 0)
+					{
+						Comp->SetupAttachment(Actors[(i - 1) / 2]->GetRootComponent());
+					}
+				}
+				else
+				{
+					Comp->SetupAttachment(RootComp);
+				}
+				Comp->RegisterComponent();
+			}
+			Actors.Add(Actor);
+		}
+
+		TMap<UObject*, FGuid> MapObjectToGuid;
+		TMap<TObjectPtr<AActor>, FLSubPrefabData> SubPrefabMap;
+		if (SubPrefab != nullptr)
+		{
+			for (int f = 0; f < InParams.FanOut; f++)
+			{
+				TMap<FGuid, TObjectPtr<UObject>> SubMapGuidToObject;
+				TMap<TObjectPtr<AActor>, FLSubPrefabData> NestedSubPrefabMap;
+				auto SubRootActor = SubPrefab->LoadPrefabWithExistingObjects(InWorld, Actors[f % ActorCount]->GetRootComponent(), SubMapGuidToObject, NestedSubPrefabMap);
+				if (SubRootActor == nullptr)continue;
+				//same as ULPrefabHelperObject::MakePrefabAsSubPrefab, sub prefab's objects get new guid in parent prefab
+				FLSubPrefabData SubPrefabData;
+				SubPrefabData.PrefabAsset = SubPrefab;
+				SubPrefabData.OverallVersionMD5 = SubPrefab->GenerateOverallVersionMD5();
+				SubPrefabData.MapGuidToObject = SubMapGuidToObject;
+				auto SubRootComp = SubRootActor->GetRootComponent();
+				SubRootComp->SetRelativeLocation(FVector(0, f * 100.0f, 0));
+				SubPrefabData.AddMemberProperty(SubRootComp, { USceneComponent::GetRelativeLocationPropertyName(), USceneComponent::GetRelativeRotationPropertyName(), USceneComponent::GetRelativeScale3DPropertyName() });
+				int32 SceneComponentIndex = 0;
+				for (auto& KeyValue : SubMapGuidToObject)
+				{
+					auto GuidInParentPrefab = FGuid::NewGuid();
+					MapObjectToGuid.Add(KeyValue.Value, GuidInParentPrefab);
+					SubPrefabData.MapObjectGuidFromParentPrefabToSubPrefab.Add(GuidInParentPrefab, KeyValue.Key);
+					auto SceneComp = Cast<USceneComponent>(KeyValue.Value);
+					if (SceneComp == nullptr || SceneComp == SubRootComp)continue;
+					//evenly pick OverrideDensity of scene components
+					if (FMath::FloorToInt((SceneComponentIndex + 1) * OverrideDensity) > FMath::FloorToInt(SceneComponentIndex * OverrideDensity))
+					{
+						SceneComp->SetRelativeLocation(SceneComp->GetRelativeLocation() + FVector(0, 0, 100));
+						SubPrefabData.AddMemberProperty(SceneComp, USceneComponent::GetRelativeLocationPropertyName());
+					}
+					SceneComponentIndex++;
+				}
+				SubPrefabMap.Add(SubRootActor, SubPrefabData);
+			}
+		}
+
+		auto Prefab = NewObject<ULPrefab>(GetTransientPackage(), NAME_None, RF_Transient);
+		LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::SavePrefab(Actors[0], Prefab, MapObjectToGuid, SubPrefabMap, true);
+		LPrefabUtils::DestroyActorWithHierarchy(Actors[0]);
+		SubPrefab = Prefab;
+	}
+	return SubPrefab;
+}
+
+void LPrefabBenchmark::Serializer(UWorld* InWorld, const FSyntheticPrefabParams& InParams, int32 InIterations, const FString& InCsvPath, const FString& InLabel)
+{
+	if (InWorld == nullptr)return;
+	InIterations = FMath::Max(InIterations, 1);
+	TStrongObjectPtr<ULPrefab> Prefab(GenerateSyntheticPrefab(InWorld, InParams));//sub prefabs are referenced by it
+	if (!Prefab.IsValid())return;
+	//warm up, so parse is not counted. this instance is also the source of duplicate and save
+	TMap<FGuid, TObjectPtr<UObject>> SourceMapGuidToObject;
+	TMap<TObjectPtr<AActor>, FLSubPrefabData> SourceSubPrefabMap;
+	auto SourceActor = Prefab->LoadPrefabWithExistingObjects(InWorld, nullptr, SourceMapGuidToObject, SourceSubPrefabMap);
+	if (SourceActor == nullptr)
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d Load synthetic prefab fail!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+		return;
+	}
+	TMap<UObject*, FGuid> SourceMapObjectToGuid;
+	for (auto& KeyValue : SourceMapGuidToObject)
+	{
+		SourceMapObjectToGuid.Add(KeyValue.Value, KeyValue.Key);
+	}
+	TArray<AActor*> InstanceActors;
+	LPrefabUtils::CollectChildrenActors(SourceActor, InstanceActors, true);
+	int32 InstanceComponentCount = 0;
+	for (auto Actor : InstanceActors)
+	{
+		InstanceComponentCount += Actor->GetComponents().Num();
+	}
+	TStrongObjectPtr<ULPrefab> SaveTargetPrefab(NewObject<ULPrefab>(GetTransientPackage(), NAME_None, RF_Transient));
+
+	FString Csv;
+	if (!InCsvPath.IsEmpty() && !FPaths::FileExists(InCsvPath))
+	{
+		Csv += TEXT("Label,Case,ActorCount,ComponentCount,Depth,FanOut,OverrideDensity,InstanceActors,InstanceComponents,Iterations,MedianMs,P95Ms,AllocsPerIteration\n");
+	}
+	UE_LOG(LPrefab, Log, TEXT("Serializer benchmark, %s, actors per instance: %d, components per instance: %d, iterations: %d")
+		, *InParams.ToString(), InstanceActors.Num(), InstanceComponentCount, InIterations);
+	//InPrepare is not measured and called before every iteration, InRun is measured and return created actor which is destroyed after measure
+	auto RunCase = [&](const TCHAR* InCaseName, const TFunctionRef<void()>& InPrepare, const TFunctionRef<AActor*()>& InRun) {
+		TArray<double> Times;
+		Times.Reserve(InIterations);
+		int64 AllocCount = 0;
+		for (int i = 0; i < InIterations; i++)
+		{
+			InPrepare();
+			FLPrefabBenchmarkCountingMalloc::Get().Install();
+			auto StartTime = FPlatformTime::Seconds();
+			auto CreatedActor = InRun();
+			Times.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+			AllocCount += FLPrefabBenchmarkCountingMalloc::Get().Uninstall();
+			if (CreatedActor != nullptr)
+			{
+				LPrefabUtils::DestroyActorWithHierarchy(CreatedActor);
+			}
+		}
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+		Times.Sort();
+		auto Median = Times[Times.Num() / 2];
+		auto P95 = Times[FMath::Clamp(FMath::CeilToInt(Times.Num() * 0.95) - 1, 0, Times.Num() - 1)];
+		auto AllocsPerIteration = AllocCount / InIterations;
+		auto AllocsPerObject = (double)AllocsPerIteration / FMath::Max(InstanceActors.Num() + InstanceComponentCount, 1);
+		UE_LOG(LPrefab, Log, TEXT("Serializer benchmark, %s, median: %fms, p95: %fms, allocations: %lld, allocations per object: %.2f"), InCaseName, Median, P95, AllocsPerIteration, AllocsPerObject);
+		Csv += FString::Printf(TEXT("%s,%s,%d,%d,%d,%d,%.2f,%d,%d,%d,%f,%f,%lld\n")
+			, *InLabel, InCaseName, InParams.ActorCount, InParams.ComponentCount, InParams.Depth, InParams.FanOut, InParams.OverrideDensity
+			, InstanceActors.Num(), InstanceComponentCount, InIterations, Median, P95, AllocsPerIteration);
+	};
+
+	RunCase(TEXT("LoadPrefab"), [] {}, [&] {
+		return Prefab->LoadPrefab(InWorld, nullptr);
+		});
+	TMap<FGuid, TObjectPtr<UObject>> MapGuidToObject;
+	TMap<TObjectPtr<AActor>, FLSubPrefabData> SubPrefabMap;
+	RunCase(TEXT("LoadPrefabWithExistingObjects"), [&] {
+		MapGuidToObject.Reset();
+		SubPrefabMap.Reset();
+		}, [&] {
+		return Prefab->LoadPrefabWithExistingObjects(InWorld, nullptr, MapGuidToObject, SubPrefabMap);
+		});
+	RunCase(TEXT("DuplicateActor"), [] {}, [&] {
+		return LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::DuplicateActor(SourceActor, nullptr);
+		});
+	RunCase(TEXT("PrepareDataForDuplicate+DuplicateActorWithPreparedData"), [] {}, [&] {
+		LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FDuplicateActorDataContainer Container;
+		if (!LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::PrepareDataForDuplicate(SourceActor, Container))return (AActor*)nullptr;
+		return LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::DuplicateActorWithPreparedData(Container, nullptr);
+		});
+	TMap<UObject*, FGuid> MapObjectToGuid;
+	RunCase(TEXT("SavePrefab"), [&] {
+		MapObjectToGuid = SourceMapObjectToGuid;
+		SubPrefabMap = SourceSubPrefabMap;
+		}, [&] {
+		LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::SavePrefab(SourceActor, SaveTargetPrefab.Get(), MapObjectToGuid, SubPrefabMap, true);
+		return (AActor*)nullptr;
+		});
+
+	LPrefabUtils::DestroyActorWithHierarchy(SourceActor);
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	if (!InCsvPath.IsEmpty())
+	{
+		if (FFileHelper::SaveStringToFile(Csv, *InCsvPath, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append))
+		{
+			UE_LOG(LPrefab, Log, TEXT("Serializer benchmark, result is appended to: '%s'"), *InCsvPath);
+		}
+		else
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Can't write file: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *InCsvPath);
+		}
+	}
+}
+
+bool LPrefabBenchmark::CookTranscode(const TArray<ULPrefab*>& InPrefabs)
+{
+	auto TranscodeCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("LPrefab.TranscodeBuildData"));
+	auto DeltaCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("LPrefab.DeltaBuildData"));
+	if (TranscodeCVar == nullptr || DeltaCVar == nullptr)return false;
+	auto OriginTranscodeValue = TranscodeCVar->GetInt();
+	bool bDelta = DeltaCVar->GetInt() != 0;
+	TArray<ULPrefab*> Prefabs;
+	for (auto Prefab : InPrefabs)
+	{
+		if (IsValid(Prefab))
+		{
+			Prefabs.Add(Prefab);
+		}
+	}
+	auto Count = Prefabs.Num();
+
+	//agent objects, same as cook a prefab that is not opened
+	TranscodeCVar->Set(0, ECVF_SetByCode);
+	TArray<TArray<uint8>> AgentData;
+	AgentData.SetNum(Count);
+	double AgentTime = 0;
+	for (int i = 0; i < Count; i++)
+	{
+		Prefabs[i]->ClearAgentObjectsInPreviewWorld();
+		auto StartTime = FPlatformTime::Seconds();
+		Prefabs[i]->BeginCacheForCookedPlatformData(nullptr);
+		AgentTime += FPlatformTime::Seconds() - StartTime;
+		AgentData[i] = Prefabs[i]->BinaryDataForBuild;
+		Prefabs[i]->ClearAgentObjectsInPreviewWorld();
+	}
+	TranscodeCVar->Set(OriginTranscodeValue, ECVF_SetByCode);
+
+	//transcode in game thread, stand-ins are created here
+	TArray<LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabTranscodedBuildData> Results;
+	Results.SetNum(Count);
+	TArray<FString> FailReasons;
+	FailReasons.SetNum(Count);
+	TArray<bool> Succeeded;
+	Succeeded.SetNumZeroed(Count);
+	auto StartTime = FPlatformTime::Seconds();
+	for (int i = 0; i < Count; i++)
+	{
+		Succeeded[i] = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::TranscodeBuildData(Prefabs[i], bDelta, Results[i], FailReasons[i]);
+	}
+	auto TranscodeTime = FPlatformTime::Seconds() - StartTime;
+
+	//transcode in parallel, as cook workers do for independent prefabs
+	TArray<LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabTranscodedBuildData> ParallelResults;
+	ParallelResults.SetNum(Count);
+	TArray<FString> ParallelFailReasons;
+	ParallelFailReasons.SetNum(Count);
+	StartTime = FPlatformTime::Seconds();
+	ParallelFor(Count, [&](int32 Index) {
+		LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::TranscodeBuildData(Prefabs[Index], bDelta, ParallelResults[Index], ParallelFailReasons[Index]);
+		}, EParallelForFlags::BackgroundPriority);
+	auto ParallelTime = FPlatformTime::Seconds() - StartTime;
+
+	int32 TranscodedCount = 0;
+	int32 IdenticalCount = 0;
+	for (int i = 0; i < Count; i++)
+	{
+		Prefabs[i]->WillNeverCacheCookedPlatformDataAgain();
+		if (!Succeeded[i])
+		{
+			UE_LOG(LPrefab, Log, TEXT("CookTranscode benchmark, prefab: '%s' use agent objects, because %s"), *Prefabs[i]->GetPathName(), *FailReasons[i]);
+			continue;
+		}
+		TranscodedCount++;
+		if (Results[i].BinaryDataForBuild != AgentData[i])
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d CookTranscode benchmark, prefab: '%s' transcoded build data is different from agent objects, size: %d -> %d bytes")
+				, ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *Prefabs[i]->GetPathName(), AgentData[i].Num(), Results[i].BinaryDataForBuild.Num());
+		}
+		else if (ParallelResults[i].BinaryDataForBuild != AgentData[i])
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d CookTranscode benchmark, prefab: '%s' build data transcoded in parallel is different from agent objects, size: %d -> %d bytes, fail reason: %s")
+				, ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *Prefabs[i]->GetPathName(), AgentData[i].Num(), ParallelResults[i].BinaryDataForBuild.Num(), *ParallelFailReasons[i]);
+		}
+		else
+		{
+			IdenticalCount++;
+		}
+	}
+	UE_LOG(LPrefab, Log, TEXT("CookTranscode benchmark, prefab count: %d, transcoded: %d (identical to agent objects: %d), agent objects: %fms, transcode: %fms (%.1fx), transcode in parallel: %fms (%.1fx)")
+		, Count, TranscodedCount, IdenticalCount
+		, AgentTime * 1000.0, TranscodeTime * 1000.0, TranscodeTime > 0 ? AgentTime / TranscodeTime : 0.0
+		, ParallelTime * 1000.0, ParallelTime > 0 ? AgentTime / ParallelTime : 0.0);
+	return IdenticalCount == TranscodedCount;
+}
+
+bool LPrefabBenchmark::DuplicateActor(UWorld* InWorld, const TArray<int32>& InActorCounts, int32 InIterations)
+{
+	if (InWorld == nullptr)return false;
+	auto DirectCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("LPrefab.DirectDuplicate"));
+	if (DirectCVar == nullptr)return false;
+	auto OriginDirectValue = DirectCVar->GetInt();
+	InIterations = FMath::Max(InIterations, 1);
+
+	//actor and component count, and every component's relative transform, in hierarchy order
+	auto CollectState = [](AActor* InRootActor, TArray<FTransform>& OutTransforms) {
+		TArray<AActor*> Actors;
+		LPrefabUtils::CollectChildrenActors(InRootActor, Actors, true);
+		OutTransforms.Reset();
+		for (auto Actor : Actors)
+		{
+			TArray<USceneComponent*> Components;
+			Actor->GetComponents(Components);
+			for (auto Comp : Components)
+			{
+				OutTransforms.Add(Comp->GetRelativeTransform());
+			}
+		}
+		return Actors.Num();
+	};
+
+	bool bAllSameResult = true;
+	for (auto ActorCount : InActorCounts)
+	{
+		FSyntheticPrefabParams Params;
+		Params.ActorCount = FMath::Max(ActorCount, 1);
+		Params.Depth = 0;
+		TStrongObjectPtr<ULPrefab> Prefab(GenerateSyntheticPrefab(InWorld, Params));
+		if (!Prefab.IsValid())return false;
+		auto SourceActor = Prefab->LoadPrefab(InWorld, nullptr);
+		if (SourceActor == nullptr)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Load synthetic prefab fail!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return false;
+		}
+
+		double Medians[2] = { 0, 0 };
+		int64 Allocations[2] = { 0, 0 };
+		int32 ResultActorCounts[2] = { 0, 0 };
+		TArray<FTransform> ResultTransforms[2];
+		for (int Mode = 0; Mode < 2; Mode++)
+		{
+			DirectCVar->Set(Mode, ECVF_SetByCode);
+			TArray<double> Times;
+			Times.Reserve(InIterations);
+			int64 AllocCount = 0;
+			for (int i = 0; i < InIterations; i++)
+			{
+				FLPrefabBenchmarkCountingMalloc::Get().Install();
+				auto StartTime = FPlatformTime::Seconds();
+				auto CreatedActor = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::DuplicateActor(SourceActor, nullptr);
+				Times.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+				AllocCount += FLPrefabBenchmarkCountingMalloc::Get().Uninstall();
+				if (CreatedActor != nullptr)
+				{
+					if (i == 0)
+					{
+						ResultActorCounts[Mode] = CollectState(CreatedActor, ResultTransforms[Mode]);
+					}
+					LPrefabUtils::DestroyActorWithHierarchy(CreatedActor);
+				}
+			}
+			CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+			Times.Sort();
+			Medians[Mode] = Times[Times.Num() / 2];
+			Allocations[Mode] = AllocCount / InIterations;
+		}
+		DirectCVar->Set(OriginDirectValue, ECVF_SetByCode);
+
+		bool bSameResult = ResultActorCounts[0] == ResultActorCounts[1] && ResultTransforms[0].Num() == ResultTransforms[1].Num();
+		for (int i = 0; bSameResult && i < ResultTransforms[0].Num(); i++)
+		{
+			bSameResult = ResultTransforms[0][i].Equals(ResultTransforms[1][i]);
+		}
+		if (!bSameResult)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d DuplicateActor benchmark, actor: %d, direct duplicate result is different from byte data, actor: %d -> %d, component: %d -> %d")
+				, ANSI_TO_TCHAR(__FUNCTION__), __LINE__, Params.ActorCount, ResultActorCounts[0], ResultActorCounts[1], ResultTransforms[0].Num(), ResultTransforms[1].Num());
+			bAllSameResult = false;
+		}
+		UE_LOG(LPrefab, Log, TEXT("DuplicateActor benchmark, actor: %d, component: %d, byte data median: %fms (allocations: %lld), direct median: %fms (allocations: %lld), %.1fx")
+			, Params.ActorCount, ResultTransforms[0].Num(), Medians[0], Allocations[0], Medians[1], Allocations[1], Medians[1] > 0 ? Medians[0] / Medians[1] : 0.0);
+
+		LPrefabUtils::DestroyActorWithHierarchy(SourceActor);
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+	return bAllSameResult;
+}
+
+void LPrefabBenchmark::SavePrefabScaling(UWorld* InWorld, const TArray<int32>& InActorCounts, int32 InIterations)
+{
+	if (InWorld == nullptr)return;
+	InIterations = FMath::Max(InIterations, 1);
+	double FirstMsPerActor = 0;
+	for (auto ActorCount : InActorCounts)
+	{
+		FSyntheticPrefabParams Params;
+		Params.ActorCount = FMath::Max(ActorCount, 1);
+		Params.ComponentCount = 2;
+		Params.Depth = 0;
+		TStrongObjectPtr<ULPrefab> Prefab(GenerateSyntheticPrefab(InWorld, Params));
+		if (!Prefab.IsValid())continue;
+		TMap<FGuid, TObjectPtr<UObject>> SourceMapGuidToObject;
+		TMap<TObjectPtr<AActor>, FLSubPrefabData> SourceSubPrefabMap;
+		auto SourceActor = Prefab->LoadPrefabWithExistingObjects(InWorld, nullptr, SourceMapGuidToObject, SourceSubPrefabMap);
+		if (SourceActor == nullptr)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Load synthetic prefab fail!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			continue;
+		}
+		TMap<UObject*, FGuid> SourceMapObjectToGuid;
+		for (auto& KeyValue : SourceMapGuidToObject)
+		{
+			SourceMapObjectToGuid.Add(KeyValue.Value, KeyValue.Key);
+		}
+		TStrongObjectPtr<ULPrefab> SaveTargetPrefab(NewObject<ULPrefab>(GetTransientPackage(), NAME_None, RF_Transient));
+
+		TArray<double> Times;
+		Times.Reserve(InIterations);
+		for (int i = 0; i < InIterations; i++)
+		{
+			auto MapObjectToGuid = SourceMapObjectToGuid;
+			auto SubPrefabMap = SourceSubPrefabMap;
+			auto StartTime = FPlatformTime::Seconds();
+			LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::SavePrefab(SourceActor, SaveTargetPrefab.Get(), MapObjectToGuid, SubPrefabMap, true);
+			Times.Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+		}
+		Times.Sort();
+		auto Median = Times[Times.Num() / 2];
+		auto MsPerActor = Median / Params.ActorCount;
+		if (FirstMsPerActor <= 0)
+		{
+			FirstMsPerActor = MsPerActor;
+		}
+		auto Growth = FirstMsPerActor > 0 ? MsPerActor / FirstMsPerActor : 1.0;
+		UE_LOG(LPrefab, Log, TEXT("SavePrefabScaling benchmark, actor: %d, object: %d, median: %fms, per actor: %fus, per actor growth from first count: %.2fx, reference asset: %d, class: %d, name: %d")
+			, Params.ActorCount, SourceMapObjectToGuid.Num(), Median, MsPerActor * 1000.0, Growth
+			, SaveTargetPrefab->ReferenceAssetList.Num(), SaveTargetPrefab->ReferenceClassList.Num(), SaveTargetPrefab->ReferenceNameList.Num());
+		if (Growth > 2.0)
+		{
+			UE_LOG(LPrefab, Warning, TEXT("SavePrefabScaling benchmark, actor: %d, time per actor is %.2fx of the first count, save time is not linear"), Params.ActorCount, Growth);
+		}
+
+		LPrefabUtils::DestroyActorWithHierarchy(SourceActor);
+		SaveTargetPrefab.Reset();
+		Prefab.Reset();
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+}
+
+bool LPrefabBenchmark::IncrementalSave(UWorld* InWorld, const TArray<int32>& InActorCounts, int32 InIterations)
+{
+	if (InWorld == nullptr)return false;
+	InIterations = FMath::Max(InIterations, 1);
+	//measure incremental save itself, the full save check would double its time and hide data mismatch
+	auto CheckCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("LPrefab.IncrementalSaveCheck"));
+	if (CheckCVar == nullptr)return false;
+	auto OriginCheckValue = CheckCVar->GetInt();
+	CheckCVar->Set(0, ECVF_SetByCode);
+	bool bAllSameData = true;
+	for (auto ActorCount : InActorCounts)
+	{
+		FSyntheticPrefabParams Params;
+		Params.ActorCount = FMath::Max(ActorCount, 1);
+		Params.Depth = 0;
+		TStrongObjectPtr<ULPrefab> Prefab(GenerateSyntheticPrefab(InWorld, Params));
+		if (!Prefab.IsValid())
+		{
+			bAllSameData = false;
+			break;
+		}
+		TMap<FGuid, TObjectPtr<UObject>> SourceMapGuidToObject;
+		TMap<TObjectPtr<AActor>, FLSubPrefabData> SubPrefabMap;
+		auto SourceActor = Prefab->LoadPrefabWithExistingObjects(InWorld, nullptr, SourceMapGuidToObject, SubPrefabMap);
+		if (SourceActor == nullptr)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Load synthetic prefab fail!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			bAllSameData = false;
+			break;
+		}
+		TMap<UObject*, FGuid> MapObjectToGuid;
+		for (auto& KeyValue : SourceMapGuidToObject)
+		{
+			MapObjectToGuid.Add(KeyValue.Value, KeyValue.Key);
+		}
+		TArray<AActor*> Actors;
+		LPrefabUtils::CollectChildrenActors(SourceActor, Actors, true);
+		TStrongObjectPtr<ULPrefab> IncrementalPrefab(NewObject<ULPrefab>(GetTransientPackage(), NAME_None, RF_Transient));
+		TStrongObjectPtr<ULPrefab> FullPrefab(NewObject<ULPrefab>(GetTransientPackage(), NAME_None, RF_Transient));
+		LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabIncrementalSaveCache Cache;
+		LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::SavePrefabIncremental(SourceActor, IncrementalPrefab.Get(), MapObjectToGuid, SubPrefabMap, Cache);//fill cache
+
+		TArray<double> Times[2];
+		bool bSameData = true;
+		for (int i = 0; i < InIterations; i++)
+		{
+			//change one component of a different actor every time, like a property tweak in prefab editor
+			auto Comp = Actors[(i * 7919) % Actors.Num()]->GetRootComponent();
+			Comp->SetRelativeLocation(Comp->GetRelativeLocation() + FVector(1, 0, 0));
+			Cache.MarkDirty(Comp);
+
+			auto StartTime = FPlatformTime::Seconds();
+			LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::SavePrefabIncremental(SourceActor, IncrementalPrefab.Get(), MapObjectToGuid, SubPrefabMap, Cache);
+			Times[0].Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+
+			auto FullMapObjectToGuid = MapObjectToGuid;
+			StartTime = FPlatformTime::Seconds();
+			LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::SavePrefab(SourceActor, FullPrefab.Get(), FullMapObjectToGuid, SubPrefabMap, true);
+			Times[1].Add((FPlatformTime::Seconds() - StartTime) * 1000.0);
+
+			bSameData = bSameData
+				&& IncrementalPrefab->BinaryData == FullPrefab->BinaryData
+				&& IncrementalPrefab->ReferenceAssetList == FullPrefab->ReferenceAssetList
+				&& IncrementalPrefab->ReferenceClassList == FullPrefab->ReferenceClassList
+				&& IncrementalPrefab->ReferenceNameList == FullPrefab->ReferenceNameList;
+		}
+		Times[0].Sort();
+		Times[1].Sort();
+		auto IncrementalMedian = Times[0][Times[0].Num() / 2];
+		auto FullMedian = Times[1][Times[1].Num() / 2];
+		if (!bSameData)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d IncrementalSave benchmark, actor: %d, incremental save data is different from full save!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, Params.ActorCount);
+			bAllSameData = false;
+		}
+		UE_LOG(LPrefab, Log, TEXT("IncrementalSave benchmark, actor: %d, data size: %d, incremental median: %fms, full median: %fms, %.1fx, same data: %s")
+			, Params.ActorCount, FullPrefab->BinaryData.Num(), IncrementalMedian, FullMedian, IncrementalMedian > 0 ? FullMedian / IncrementalMedian : 0.0, bSameData ? TEXT("true") : TEXT("false"));
+
+		LPrefabUtils::DestroyActorWithHierarchy(SourceActor);
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+	CheckCVar->Set(OriginCheckValue, ECVF_SetByCode);
+	return bAllSameData;
+}
+#endif
+
+#if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
+PRAGMA_ENABLE_OPTIMIZATION
+#endif
+#endif
@@ -0,0 +1,51 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "PrefabSystem/LPrefabDeferredSubPrefabComponent.h"
+#include "GameFramework/Actor.h"
+#include "LPrefabModule.h"
+#include LPREFAB_SERIALIZER_NEWEST_INCLUDE
+
+#if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
+PRAGMA_DISABLE_OPTIMIZATION
+#endif
+
+ULPrefabDeferredSubPrefabComponent::ULPrefabDeferredSubPrefabComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+}
+
+AActor* ULPrefabDeferredSubPrefabComponent::Realize()
+{
+	if (bRealized)return RealizedActor.Get();
+	AActor* RootActor = nullptr;
+	if (!LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::RealizeDeferredSubPrefab(this, RootActor))
+	{
+		UE_LOG(LPrefab, Warning, TEXT("[%s].%d Parent prefab is not finish load yet, try it later. Placeholder: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *this->GetPathName());
+		return nullptr;
+	}
+	bRealized = true;
+	RealizedActor = RootActor;
+	Scope.Reset();
+	return RootActor;
+}
+
+int32 ULPrefabDeferredSubPrefabComponent::RealizeAll(AActor* InPrefabRootActor)
+{
+	if (!IsValid(InPrefabRootActor))return 0;
+	TArray<ULPrefabDeferredSubPrefabComponent*> Placeholders;
+	InPrefabRootActor->GetComponents(Placeholders);
+	int32 Count = 0;
+	for (auto Placeholder : Placeholders)
+	{
+		if (Placeholder->IsRealized())continue;
+		if (Placeholder->Realize() != nullptr)
+		{
+			Count++;
+		}
+	}
+	return Count;
+}
+
+#if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
+PRAGMA_ENABLE_OPTIMIZATION
+#endif
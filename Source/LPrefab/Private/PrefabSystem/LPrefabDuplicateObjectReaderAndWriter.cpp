@@ -11,7 +11,7 @@
 
 namespace LPrefabSystem
 {
-	FLPrefabDuplicateObjectWriter::FLPrefabDuplicateObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, TSet<FName> InSkipPropertyNames)
+	FLPrefabDuplicateObjectWriter::FLPrefabDuplicateObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames)
 		: FLPrefabObjectWriter(Bytes, InSerializer, InSkipPropertyNames)
 	{
 		
@@ -25,9 +25,7 @@ namespace LPrefabSystem
 		{
 			return true;
 		}
-		if (SkipPropertyNames.Contains(InProperty->GetFName())
-			&& CurrentIsMemberProperty(*this)//Skip property only support UObject's member property
-			)
+		if (ShouldSkipPropertyByName(InProperty))
 		{
 			return true;
 		}
@@ -121,7 +119,7 @@ namespace LPrefabSystem
 
 
 
-	FLPrefabDuplicateObjectReader::FLPrefabDuplicateObjectReader(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, TSet<FName> InSkipPropertyNames)
+	FLPrefabDuplicateObjectReader::FLPrefabDuplicateObjectReader(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames)
 		: FLPrefabObjectReader(Bytes, InSerializer, InSkipPropertyNames)
 	{
 
@@ -135,9 +133,7 @@ namespace LPrefabSystem
 		{
 			return true;
 		}
-		if (SkipPropertyNames.Contains(InProperty->GetFName())
-			&& CurrentIsMemberProperty(*this)//Skip property only support UObject's member property
-			)
+		if (ShouldSkipPropertyByName(InProperty))
 		{
 			return true;
 		}
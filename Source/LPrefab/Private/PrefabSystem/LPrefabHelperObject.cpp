@@ -11,6 +11,7 @@
 #if WITH_EDITOR
 #include "Editor.h"
 #include "Misc/MessageDialog.h"
+#include "HAL/IConsoleManager.h"
 #endif
 
 #define LOCTEXT_NAMESPACE "LPrefabManager"
@@ -18,6 +19,14 @@
 PRAGMA_DISABLE_OPTIMIZATION
 #endif
 
+#if WITH_EDITOR
+static TAutoConsoleVariable<int32> CVarLPrefabIncrementalSave(
+	TEXT("LPrefab.IncrementalSave"),
+	1,
+	TEXT("1- When save prefab in prefab editor, only write data of changed objects (tracked by Modify, PostEditChangeProperty and undo/redo), reuse other objects' data from last save. 0- Always write all objects."),
+	ECVF_Default);
+#endif
+
 ULPrefabHelperObject::ULPrefabHelperObject()
 {
 	
@@ -65,6 +74,7 @@ void ULPrefabHelperObject::LoadPrefab(UWorld* InWorld, USceneComponent* InParent
 	}
 	if (!IsValid(LoadedRootActor))
 	{
+		IncrementalSaveCache.Reset();
 		LoadedRootActor = PrefabAsset->LoadPrefabWithExistingObjects(InWorld
 			, InParent
 			, MapGuidToObject, SubPrefabMap
@@ -323,9 +333,24 @@ void ULPrefabHelperObject::SavePrefab()
 				MapObjectToGuid.Add(KeyValue.Value, KeyValue.Key);
 			}
 		}
-		PrefabAsset->SavePrefab(LoadedRootActor
-			, MapObjectToGuid, SubPrefabMap
-		);
+		if (bIsMarkedAsManagerObject && CVarLPrefabIncrementalSave.GetValueOnGameThread() != 0)
+		{
+			if (!IncrementalSaveCache.IsValid())
+			{
+				IncrementalSaveCache = MakeShared<LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabIncrementalSaveCache>();
+			}
+			LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::SavePrefabIncremental(LoadedRootActor, PrefabAsset
+				, MapObjectToGuid, SubPrefabMap
+				, *IncrementalSaveCache
+			);
+		}
+		else
+		{
+			IncrementalSaveCache.Reset();
+			PrefabAsset->SavePrefab(LoadedRootActor
+				, MapObjectToGuid, SubPrefabMap
+			);
+		}
 		MapGuidToObject.Empty();
 		for (auto KeyValue : MapObjectToGuid)
 		{
@@ -418,6 +443,8 @@ void ULPrefabHelperObject::MarkOverrideParameterFromParentPrefab(UObject* InObje
 
 bool ULPrefabHelperObject::RefreshOnSubPrefabDirty(ULPrefab* InSubPrefab, AActor* InSubPrefabRootActor)
 {
+	SCOPE_CYCLE_COUNTER(STAT_LPrefab_RefreshOnSubPrefabDirty);
+	LPREFAB_TRACE_SCOPE_TEXT(TEXT("LPrefab.RefreshOnSubPrefabDirty %s, sub prefab: %d"), *GetNameSafe(InSubPrefab), SubPrefabMap.Num());
 	CleanupInvalidSubPrefab();
 
 	//temporary disable these, so restore prefab data goes silently
@@ -484,6 +511,10 @@ bool ULPrefabHelperObject::RefreshOnSubPrefabDirty(ULPrefab* InSubPrefab, AActor
 				, AttachParentActor == nullptr ? nullptr : AttachParentActor->GetRootComponent()
 				, SubPrefabMapGuidToObject, TempSubSubPrefabMap
 			);
+			for (auto& KeyValue : SubPrefabMapGuidToObject)//data is read into existing objects without Modify
+			{
+				MarkDirtyForIncrementalSave(KeyValue.Value);
+			}
 
 			//collect newly added object and guid
 			auto ObjectExist = [&](UObject* InObject) {
@@ -595,6 +626,14 @@ bool ULPrefabHelperObject::RefreshOnSubPrefabDirty(ULPrefab* InSubPrefab, AActor
 	return AnythingChange;
 }
 
+void ULPrefabHelperObject::MarkDirtyForIncrementalSave(UObject* InObject)
+{
+	if (IncrementalSaveCache.IsValid())
+	{
+		IncrementalSaveCache->MarkDirty(InObject);
+	}
+}
+
 void ULPrefabHelperObject::OnObjectPropertyChanged(UObject* InObject, struct FPropertyChangedEvent& InPropertyChangedEvent)
 {
 	if (!IsValid(InObject))return;
@@ -11,6 +11,8 @@
 #include "EditorViewportClient.h"
 #include "PrefabSystem/LPrefab.h"
 #include "EngineUtils.h"
+#include LPREFAB_SERIALIZER_NEWEST_INCLUDE
+#include "PrefabSystem/LPrefabObjectReaderAndWriter.h"
 #endif
 
 #define LOCTEXT_NAMESPACE "LPrefabManagerObject"
@@ -221,6 +223,12 @@ void ULPrefabManagerObject::OnBlueprintPreCompile(UBlueprint* InBlueprint)
 void ULPrefabManagerObject::OnBlueprintCompiled()
 {
 	bIsBlueprintCompiling = true;
+	//blueprint may add or remove interface or property
+	LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::ClearPrefabInterfaceCache();
+	LPrefabSystem::FLPrefabSkipPropertyCache::Clear();
+	LPrefabSystem::FLPrefabMemberPropertyCache::Clear();
+	LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabIncrementalSaveCache::InvalidateAll();
+	LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::ClearTranscodeClassCache();
 	AddOneShotTickFunction([this] {
 		bIsBlueprintCompiling = false; 
 		}, 2);
@@ -0,0 +1,325 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "PrefabSystem/LPrefabMergeStaticMesh.h"
+#if WITH_EDITOR
+#include "PrefabSystem/LPrefab.h"
+#include "PrefabSystem/LPrefabObjectReaderAndWriter.h"
+#include "PrefabAnimation/LPrefabSequenceComponent.h"
+#include "PrefabAnimation/LPrefabSequence.h"
+#include "LPrefabModule.h"
+#include "LPrefabUtils.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Components/HierarchicalInstancedStaticMeshComponent.h"
+#include "Materials/MaterialInterface.h"
+#include "Serialization/ArchiveUObject.h"
+#include "UObject/UObjectHash.h"
+#endif
+
+#if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
+PRAGMA_DISABLE_OPTIMIZATION
+#endif
+
+#if WITH_EDITOR
+FString FLPrefabMergeStaticMeshReport::ToString()const
+{
+	return FString::Printf(TEXT("%d group(s), actors: %d -> %d, components: %d -> %d, %d actor(s) kept because referenced by other objects")
+		, GroupCount, ActorCountBefore, ActorCountAfter, ComponentCountBefore, ComponentCountAfter, ReferencedActorCount);
+}
+
+namespace
+{
+	/** Collect object references which will be saved by prefab, same skip rule as prefab's writer. */
+	class FLPrefabMergeReferenceCollector : public FArchiveUObject
+	{
+	public:
+		FLPrefabMergeReferenceCollector(TSet<UObject*>& InReferences) :References(InReferences)
+		{
+			ArIsObjectReferenceCollector = true;
+			this->SetIsPersistent(true);
+		}
+		virtual FArchive& operator<<(UObject*& Value)override
+		{
+			if (Value != nullptr)
+			{
+				References.Add(Value);
+			}
+			return *this;
+		}
+		virtual bool ShouldSkipProperty(const FProperty* InProperty)const override
+		{
+			return LPrefabSystem::LPrefab_ShouldSkipProperty(InProperty);
+		}
+		virtual FString GetArchiveName()const override { return TEXT("FLPrefabMergeReferenceCollector"); }
+	private:
+		TSet<UObject*>& References;
+	};
+
+	/** Properties of UStaticMeshComponent that should be same in a group, and copied to instanced static mesh component. Transform and attachment are per instance, mesh and materials are group key. */
+	const TArray<FProperty*>& GetSharedProperties()
+	{
+		static TArray<FProperty*> Result;
+		static bool bInitialized = false;
+		if (!bInitialized)
+		{
+			bInitialized = true;
+			static const TSet<FName> ExcludeNames = {
+				FName("RelativeLocation"),
+				FName("RelativeRotation"),
+				FName("RelativeScale3D"),
+				FName("AttachParent"),
+				FName("AttachSocketName"),
+				FName("StaticMesh"),
+				FName("OverrideMaterials"),
+			};
+			for (TFieldIterator<FProperty> PropertyItr(UStaticMeshComponent::StaticClass()); PropertyItr; ++PropertyItr)
+			{
+				auto Property = *PropertyItr;
+				if (LPrefabSystem::LPrefab_ShouldSkipProperty(Property))continue;
+				if (!Property->HasAnyPropertyFlags(CPF_Edit))continue;
+				if (Property->HasAnyPropertyFlags(CPF_InstancedReference | CPF_ContainsInstancedReference))continue;//instanced object can't be shared, candidate need it to be same as archetype
+				if (ExcludeNames.Contains(Property->GetFName()))continue;
+				Result.Add(Property);
+			}
+		}
+		return Result;
+	}
+
+	bool IsSharedPropertiesIdentical(const UStaticMeshComponent* A, const UStaticMeshComponent* B)
+	{
+		for (auto Property : GetSharedProperties())
+		{
+			if (!Property->Identical_InContainer(A, B))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/** Return the static mesh component if the actor can be merged into instances. */
+	UStaticMeshComponent* GetMergeCandidateComponent(AActor* InActor, AActor* InRootActor, const TMap<TObjectPtr<AActor>, FLSubPrefabData>& InSubPrefabMap)
+	{
+		if (InActor == InRootActor)return nullptr;
+		if (InActor->HasAnyFlags(RF_Transient) || InActor->bIsEditorOnlyActor)return nullptr;
+		//other actor class may have logic or properties that instance can't keep
+		auto ActorClass = InActor->GetClass();
+		if (ActorClass != AStaticMeshActor::StaticClass() && ActorClass != AActor::StaticClass())return nullptr;
+		if (InActor->Tags.Num() > 0 || InActor->IsHidden() || !InActor->GetActorEnableCollision())return nullptr;
+
+		TArray<AActor*> ChildrenActors;
+		InActor->GetAttachedActors(ChildrenActors);
+		if (ChildrenActors.Num() > 0)return nullptr;
+		if (InActor->GetComponents().Num() != 1)return nullptr;
+		auto Comp = Cast<UStaticMeshComponent>(InActor->GetRootComponent());
+		if (Comp == nullptr || Comp->GetClass() != UStaticMeshComponent::StaticClass())return nullptr;
+		if (Comp->HasAnyFlags(RF_Transient) || Comp->IsEditorOnly())return nullptr;
+		if (Comp->Mobility != EComponentMobility::Static)return nullptr;
+		if (Comp->GetStaticMesh() == nullptr)return nullptr;
+		if (Comp->GetAttachParent() == nullptr || Comp->GetAttachSocketName() != NAME_None || Comp->GetAttachChildren().Num() > 0)return nullptr;
+		if (auto Archetype = Comp->GetArchetype())
+		{
+			for (TFieldIterator<FProperty> PropertyItr(UStaticMeshComponent::StaticClass()); PropertyItr; ++PropertyItr)
+			{
+				auto Property = *PropertyItr;
+				if (!Property->HasAnyPropertyFlags(CPF_InstancedReference | CPF_ContainsInstancedReference))continue;
+				if (LPrefabSystem::LPrefab_ShouldSkipProperty(Property))continue;
+				if (!Property->Identical_InContainer(Comp, Archetype))return nullptr;
+			}
+		}
+		//sub prefab's actor is saved by sub prefab's data
+		for (auto Actor = InActor; Actor != nullptr; Actor = Actor->GetAttachParentActor())
+		{
+			if (InSubPrefabMap.Contains(Actor))return nullptr;
+			if (Actor == InRootActor)break;
+		}
+		return Comp;
+	}
+
+	struct FMergeGroup
+	{
+		AActor* ParentActor = nullptr;
+		UStaticMesh* StaticMesh = nullptr;
+		TArray<UMaterialInterface*> Materials;
+		TArray<UStaticMeshComponent*> Components;
+	};
+
+	void CountActorsAndComponents(AActor* InRootActor, int32& OutActorCount, int32& OutComponentCount)
+	{
+		TArray<AActor*> AllActors;
+		LPrefabUtils::CollectChildrenActors(InRootActor, AllActors);
+		OutActorCount = AllActors.Num();
+		OutComponentCount = 0;
+		for (auto Actor : AllActors)
+		{
+			OutComponentCount += Actor->GetComponents().Num();
+		}
+	}
+}
+
+FLPrefabMergeStaticMeshReport LPrefabMergeStaticMesh::Merge(AActor* InRootActor, const TMap<TObjectPtr<AActor>, FLSubPrefabData>& InSubPrefabMap, bool InUseHierarchicalInstances, TMap<UObject*, FGuid>& InOutMapObjectToGuid)
+{
+	FLPrefabMergeStaticMeshReport Report;
+	if (!IsValid(InRootActor))return Report;
+	CountActorsAndComponents(InRootActor, Report.ActorCountBefore, Report.ComponentCountBefore);
+	Report.ActorCountAfter = Report.ActorCountBefore;
+	Report.ComponentCountAfter = Report.ComponentCountBefore;
+
+	TArray<AActor*> AllActors;
+	LPrefabUtils::CollectChildrenActors(InRootActor, AllActors);
+	TMap<AActor*, UStaticMeshComponent*> Candidates;
+	for (auto Actor : AllActors)
+	{
+		if (auto Comp = GetMergeCandidateComponent(Actor, InRootActor, InSubPrefabMap))
+		{
+			Candidates.Add(Actor, Comp);
+		}
+	}
+	if (Candidates.Num() < 2)return Report;
+
+	//actor referenced by other object must keep it's guid, include sequence's binding (LPrefabSequence's object reference store the bound actor)
+	TSet<AActor*> ReferencedActors;
+	{
+		TSet<UObject*> References;
+		FLPrefabMergeReferenceCollector Collector(References);
+		TArray<UObject*> Objects;
+		TSet<UObject*> VisitedObjects;
+		for (auto Actor : AllActors)
+		{
+			Objects.Reset();
+			Objects.Add(Actor);
+			GetObjectsWithOuter(Actor, Objects, true);
+			for (auto Comp : Actor->GetComponents())
+			{
+				if (auto SequenceComp = Cast<ULPrefabSequenceComponent>(Comp))
+				{
+					for (auto Sequence : SequenceComp->GetSequenceArray())
+					{
+						if (Sequence == nullptr)continue;
+						Objects.Add(Sequence);
+						GetObjectsWithOuter(Sequence, Objects, true);
+					}
+				}
+			}
+			for (auto Object : Objects)
+			{
+				if (Object->HasAnyFlags(RF_Transient))continue;
+				bool bAlreadyVisited = false;
+				VisitedObjects.Add(Object, &bAlreadyVisited);
+				if (bAlreadyVisited)continue;
+				References.Reset();
+				Object->Serialize(Collector);
+				for (auto Reference : References)
+				{
+					auto ReferencedActor = Cast<AActor>(Reference);
+					if (ReferencedActor == nullptr)
+					{
+						ReferencedActor = Reference->GetTypedOuter<AActor>();
+					}
+					if (ReferencedActor != nullptr && ReferencedActor != Actor && Candidates.Contains(ReferencedActor))
+					{
+						ReferencedActors.Add(ReferencedActor);
+					}
+				}
+			}
+		}
+	}
+	Report.ReferencedActorCount = ReferencedActors.Num();
+
+	//group by parent actor and mesh, then by materials and other properties
+	TArray<FMergeGroup> Groups;
+	TMap<TPair<AActor*, UStaticMesh*>, TArray<int32>> MapKeyToGroupIndices;
+	for (auto& KeyValue : Candidates)
+	{
+		if (ReferencedActors.Contains(KeyValue.Key))continue;
+		auto Comp = KeyValue.Value;
+		auto ParentActor = KeyValue.Key->GetAttachParentActor();
+		auto StaticMesh = Comp->GetStaticMesh();
+		TArray<UMaterialInterface*> Materials;
+		int32 MaterialCount = Comp->GetNumMaterials();
+		Materials.Reserve(MaterialCount);
+		for (int i = 0; i < MaterialCount; i++)
+		{
+			Materials.Add(Comp->GetMaterial(i));
+		}
+
+		auto& GroupIndices = MapKeyToGroupIndices.FindOrAdd(TPair<AActor*, UStaticMesh*>(ParentActor, StaticMesh));
+		int32 FoundGroupIndex = INDEX_NONE;
+		for (auto GroupIndex : GroupIndices)
+		{
+			auto& Group = Groups[GroupIndex];
+			if (Group.Materials == Materials && IsSharedPropertiesIdentical(Group.Components[0], Comp))
+			{
+				FoundGroupIndex = GroupIndex;
+				break;
+			}
+		}
+		if (FoundGroupIndex == INDEX_NONE)
+		{
+			FoundGroupIndex = Groups.AddDefaulted();
+			auto& Group = Groups[FoundGroupIndex];
+			Group.ParentActor = ParentActor;
+			Group.StaticMesh = StaticMesh;
+			Group.Materials = MoveTemp(Materials);
+			GroupIndices.Add(FoundGroupIndex);
+		}
+		Groups[FoundGroupIndex].Components.Add(Comp);
+	}
+
+	UClass* InstancedComponentClass = InUseHierarchicalInstances ? UHierarchicalInstancedStaticMeshComponent::StaticClass() : UInstancedStaticMeshComponent::StaticClass();
+	TArray<FTransform> InstanceTransforms;
+	for (auto& Group : Groups)
+	{
+		if (Group.Components.Num() < 2)continue;
+		auto ParentActor = Group.ParentActor;
+		auto ParentComp = ParentActor->GetRootComponent();
+		auto SourceComp = Group.Components[0];
+		auto InstancedComp = NewObject<UInstancedStaticMeshComponent>(ParentActor, InstancedComponentClass, MakeUniqueObjectName(ParentActor, InstancedComponentClass, TEXT("MergedStaticMesh")), RF_Transactional);
+		for (auto Property : GetSharedProperties())
+		{
+			Property->CopyCompleteValue_InContainer(InstancedComp, SourceComp);
+		}
+		InstancedComp->SetStaticMesh(Group.StaticMesh);
+		for (int i = 0; i < Group.Materials.Num(); i++)
+		{
+			InstancedComp->SetMaterial(i, Group.Materials[i]);
+		}
+		InstancedComp->SetupAttachment(ParentComp);
+		ParentActor->AddInstanceComponent(InstancedComp);
+		InstancedComp->RegisterComponent();
+
+		//instance transform is relative to instanced component
+		auto InstancedCompTransform = InstancedComp->GetComponentTransform();
+		InstanceTransforms.Reset(Group.Components.Num());
+		for (auto Comp : Group.Components)
+		{
+			InstanceTransforms.Add(Comp->GetComponentTransform().GetRelativeTransform(InstancedCompTransform));
+		}
+		InstancedComp->AddInstances(InstanceTransforms, false, false);
+		if (auto HierarchicalComp = Cast<UHierarchicalInstancedStaticMeshComponent>(InstancedComp))
+		{
+			HierarchicalComp->BuildTreeIfOutdated(false, true);
+		}
+
+		for (auto Comp : Group.Components)
+		{
+			auto Actor = Comp->GetOwner();
+			InOutMapObjectToGuid.Remove(Comp);
+			InOutMapObjectToGuid.Remove(Actor);
+			LPrefabUtils::DestroyActorWithHierarchy(Actor, false);
+		}
+		Report.GroupCount++;
+	}
+
+	if (Report.GroupCount > 0)
+	{
+		CountActorsAndComponents(InRootActor, Report.ActorCountAfter, Report.ComponentCountAfter);
+	}
+	return Report;
+}
+#endif
+
+#if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
+PRAGMA_ENABLE_OPTIMIZATION
+#endif
@@ -8,6 +8,9 @@
 #include "Engine/Blueprint.h"
 #include "GameFramework/Actor.h"
 #include "LPrefabModule.h"
+#include "UObject/ObjectKey.h"
+#include "Algo/BinarySearch.h"
+#include "Misc/ScopeLock.h"
 
 namespace LPrefabSystem
 {
@@ -20,7 +23,70 @@ namespace LPrefabSystem
 			;
 	}
 
-	FLPrefabObjectWriter::FLPrefabObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, TSet<FName> InSkipPropertyNames)
+	/** Key is class and skip name set. Value is allocated on heap, so the pointer hold by archive is still valid when map grows. */
+	static TMap<TPair<FObjectKey, const TSet<FName>*>, TUniquePtr<TArray<const FProperty*>>> SkipPropertyCache;
+	static FCriticalSection SkipPropertyCacheLock;
+
+	const TArray<const FProperty*>& FLPrefabSkipPropertyCache::Find(const UClass* InClass, const TSet<FName>& InSkipPropertyNames)
+	{
+		static const TArray<const FProperty*> Empty;
+		if (InSkipPropertyNames.Num() == 0)return Empty;
+
+		FScopeLock Lock(&SkipPropertyCacheLock);
+		//FObjectKey is not reused by new class even if old class is garbage collected
+		auto Key = TPair<FObjectKey, const TSet<FName>*>(FObjectKey(InClass), &InSkipPropertyNames);
+		if (auto ResultPtr = SkipPropertyCache.Find(Key))
+		{
+			return **ResultPtr;
+		}
+		auto Result = MakeUnique<TArray<const FProperty*>>();
+		for (TFieldIterator<FProperty> PropertyItr(InClass, EFieldIteratorFlags::IncludeSuper); PropertyItr; ++PropertyItr)
+		{
+			if (InSkipPropertyNames.Contains(PropertyItr->GetFName()))
+			{
+				Result->Add(*PropertyItr);
+			}
+		}
+		Result->Sort();
+		return *SkipPropertyCache.Add(Key, MoveTemp(Result));
+	}
+	void FLPrefabSkipPropertyCache::Clear()
+	{
+		FScopeLock Lock(&SkipPropertyCacheLock);
+		SkipPropertyCache.Empty();
+	}
+
+	/** Key is class, value is all member properties of the class by name. Game thread only, override parameters are only read and written in game thread. */
+	static TMap<FObjectKey, TMap<FName, FProperty*>> MemberPropertyCache;
+
+	FProperty* FLPrefabMemberPropertyCache::Find(const UClass* InClass, FName InPropertyName)
+	{
+		check(IsInGameThread());
+		auto& PropertyMap = MemberPropertyCache.FindOrAdd(FObjectKey(InClass));
+		if (PropertyMap.Num() == 0)
+		{
+			for (TFieldIterator<FProperty> PropertyItr(InClass, EFieldIteratorFlags::IncludeSuper); PropertyItr; ++PropertyItr)
+			{
+				//child class first, same as FindFProperty
+				if (!PropertyMap.Contains(PropertyItr->GetFName()))
+				{
+					PropertyMap.Add(PropertyItr->GetFName(), *PropertyItr);
+				}
+			}
+		}
+		if (auto PropertyPtr = PropertyMap.Find(InPropertyName))
+		{
+			return *PropertyPtr;
+		}
+		return nullptr;
+	}
+	void FLPrefabMemberPropertyCache::Clear()
+	{
+		check(IsInGameThread());
+		MemberPropertyCache.Empty();
+	}
+
+	FLPrefabObjectWriter::FLPrefabObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames)
 		: FObjectWriter(Bytes)
 		, Serializer(InSerializer)
 		, SkipPropertyNames(InSkipPropertyNames)
@@ -32,7 +98,20 @@ namespace LPrefabSystem
 	}
 	void FLPrefabObjectWriter::DoSerialize(UObject* Object)
 	{
+		SkipMemberProperties = &FLPrefabSkipPropertyCache::Find(Object->GetClass(), SkipPropertyNames);
 		Object->Serialize(*this);
+		SkipMemberProperties = nullptr;
+	}
+	bool FLPrefabObjectWriter::ShouldSkipPropertyByName(const FProperty* InProperty) const
+	{
+		if (SkipMemberProperties != nullptr)
+		{
+			//cached properties are object's member properties, property in struct or container will not match the pointer, so no need to check property chain
+			return SkipMemberProperties->Num() > 0 && Algo::BinarySearch(*SkipMemberProperties, InProperty) != INDEX_NONE;
+		}
+		return SkipPropertyNames.Contains(InProperty->GetFName())
+			&& CurrentIsMemberProperty(*this)//Skip property only support UObject's member property
+			;
 	}
 	bool FLPrefabObjectWriter::ShouldSkipProperty(const FProperty* InProperty) const
 	{
@@ -40,9 +119,7 @@ namespace LPrefabSystem
 		{
 			return true;
 		}
-		if (SkipPropertyNames.Contains(InProperty->GetFName())
-			&& CurrentIsMemberProperty(*this)//Skip property only support UObject's member property
-			)
+		if (ShouldSkipPropertyByName(InProperty))
 		{
 			return true;
 		}
@@ -122,6 +199,14 @@ namespace LPrefabSystem
 
 			if (canSerializeObject)//object belongs to this actor hierarchy
 			{
+				if (Serializer.bWriteObjectIndex)
+				{
+					auto type = (uint8)EObjectType::ObjectIndex;
+					auto index = Serializer.FindOrAddObjectIndex(*guidPtr);
+					*this << type;
+					*this << index;
+					return true;
+				}
 				auto type = (uint8)EObjectType::ObjectReference;
 				*this << type;
 				*this << *guidPtr;
@@ -221,10 +306,11 @@ namespace LPrefabSystem
 	}
 
 
-	FLPrefabObjectReader::FLPrefabObjectReader(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, TSet<FName> InSkipPropertyNames)
+	FLPrefabObjectReader::FLPrefabObjectReader(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames)
 		: FObjectReader(Bytes)
 		, Serializer(InSerializer)
-		, SkipPropertyNames(InSkipPropertyNames)
+		, Buffer(Bytes)
+		, SkipPropertyNames(&InSkipPropertyNames)
 	{
 		SetIsLoading(true);
 		SetIsSaving(false);
@@ -233,7 +319,28 @@ namespace LPrefabSystem
 	}
 	void FLPrefabObjectReader::DoSerialize(UObject* Object)
 	{
+		SkipMemberProperties = &FLPrefabSkipPropertyCache::Find(Object->GetClass(), *SkipPropertyNames);
 		Object->Serialize(*this);
+		SkipMemberProperties = nullptr;
+	}
+	void FLPrefabObjectReader::ResetForObject(const TArray<uint8>& InBytes, const TSet<FName>& InSkipPropertyNames)
+	{
+		Buffer.Reset();
+		Buffer.Append(InBytes);
+		Seek(0);
+		ClearError();
+		SkipPropertyNames = &InSkipPropertyNames;
+	}
+	bool FLPrefabObjectReader::ShouldSkipPropertyByName(const FProperty* InProperty) const
+	{
+		if (SkipMemberProperties != nullptr)
+		{
+			//cached properties are object's member properties, property in struct or container will not match the pointer, so no need to check property chain
+			return SkipMemberProperties->Num() > 0 && Algo::BinarySearch(*SkipMemberProperties, InProperty) != INDEX_NONE;
+		}
+		return SkipPropertyNames->Contains(InProperty->GetFName())
+			&& CurrentIsMemberProperty(*this)//Skip property only support UObject's member property
+			;
 	}
 	bool FLPrefabObjectReader::ShouldSkipProperty(const FProperty* InProperty) const
 	{
@@ -241,9 +348,13 @@ namespace LPrefabSystem
 		{
 			return true;
 		}
-		if (SkipPropertyNames.Contains(InProperty->GetFName())
-			&& CurrentIsMemberProperty(*this)//Skip property only support UObject's member property
-			)
+		if (ShouldSkipPropertyByName(InProperty))
+		{
+			return true;
+		}
+		if (Serializer.OnlyReadPropertyNames != nullptr
+			&& CurrentIsMemberProperty(*this)
+			&& !Serializer.OnlyReadPropertyNames->Contains(InProperty->GetFName()))
 		{
 			return true;
 		}
@@ -328,6 +439,19 @@ namespace LPrefabSystem
 				Object = *ObjectPtr;
 				return true;
 			}
+			Serializer.CollectUnresolvedObjectReference(*this);
+		}
+		break;
+		case LPrefabSystem::EObjectType::ObjectIndex:
+		{
+			int32 index = -1;
+			*this << index;
+			if (Serializer.ObjectsByIndex.IsValidIndex(index) && Serializer.ObjectsByIndex[index] != nullptr)
+			{
+				Object = Serializer.ObjectsByIndex[index];
+				return true;
+			}
+			Serializer.CollectUnresolvedObjectReference(*this);
 		}
 		break;
 		}
@@ -10,8 +10,55 @@
 
 namespace LPrefabSystem
 {
+	/** Write override properties one by one: name, data size, data. End with NAME_None. */
+	static void WriteOverrideProperties(FArchive& Ar, UObject* Object, const TSet<FName>& InPropertyNames)
+	{
+		auto Class = Object->GetClass();
+		for (auto& PropertyName : InPropertyNames)
+		{
+			auto Property = FLPrefabMemberPropertyCache::Find(Class, PropertyName);
+			if (Property == nullptr || LPrefab_ShouldSkipProperty(Property))continue;
+			auto Name = PropertyName;
+			Ar << Name;
+			auto SizeOffset = Ar.Tell();
+			int32 Size = 0;
+			Ar << Size;
+			auto DataOffset = Ar.Tell();
+			Property->SerializeBinProperty(FStructuredArchiveFromArchive(Ar).GetSlot(), Object);
+			auto EndOffset = Ar.Tell();
+			//go back and fill data size, so reader can skip property that not exist anymore
+			Size = (int32)(EndOffset - DataOffset);
+			Ar.Seek(SizeOffset);
+			Ar << Size;
+			Ar.Seek(EndOffset);
+		}
+		FName EndName = NAME_None;
+		Ar << EndName;
+	}
+	/** @param InOnlyPropertyNames	If valid, only read these properties. */
+	static void ReadOverrideProperties(FArchive& Ar, UObject* Object, const TArray<FName>* InOnlyPropertyNames = nullptr)
+	{
+		auto Class = Object->GetClass();
+		while (!Ar.AtEnd() && !Ar.IsError())
+		{
+			FName Name;
+			Ar << Name;
+			if (Name.IsNone())break;
+			int32 Size = 0;
+			Ar << Size;
+			auto DataOffset = Ar.Tell();
+			auto Property = FLPrefabMemberPropertyCache::Find(Class, Name);
+			if (Property != nullptr && !LPrefab_ShouldSkipProperty(Property)
+				&& (InOnlyPropertyNames == nullptr || InOnlyPropertyNames->Contains(Name)))
+			{
+				Property->SerializeBinProperty(FStructuredArchiveFromArchive(Ar).GetSlot(), Object);
+			}
+			Ar.Seek(DataOffset + Size);
+		}
+	}
+
 	FLPrefabOverrideParameterObjectWriter::FLPrefabOverrideParameterObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TArray<FName>& InOverridePropertyNames)
-		: FLPrefabObjectWriter(Bytes, InSerializer, {})
+		: FLPrefabObjectWriter(Bytes, InSerializer, InSerializer.GetExcludeProperties(false))
 		, OverridePropertyNames(InOverridePropertyNames)
 	{
 		
@@ -96,6 +143,10 @@ namespace LPrefabSystem
 			}
 		}
 	}
+	void FLPrefabOverrideParameterObjectWriter::DoSerializeTargeted(UObject* Object)
+	{
+		WriteOverrideProperties(*this, Object, OverridePropertyNames);
+	}
 	FString FLPrefabOverrideParameterObjectWriter::GetArchiveName() const
 	{
 		return TEXT("FLPrefabOverrideParameterObjectWriter");
@@ -103,7 +154,7 @@ namespace LPrefabSystem
 
 
 	FLPrefabOverrideParameterObjectReader::FLPrefabOverrideParameterObjectReader(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TArray<FName>& InOverridePropertyNames)
-		: FLPrefabObjectReader(Bytes, InSerializer, {})
+		: FLPrefabObjectReader(Bytes, InSerializer, InSerializer.GetExcludeProperties(false))
 		, OverridePropertyNames(InOverridePropertyNames)
 	{
 		
@@ -117,7 +168,8 @@ namespace LPrefabSystem
 
 		if (CurrentIsMemberProperty(*this))
 		{
-			if (OverridePropertyNames.Contains(InProperty->GetFName()))
+			if (OverridePropertyNames.Contains(InProperty->GetFName())
+				&& (Serializer.OnlyReadPropertyNames == nullptr || Serializer.OnlyReadPropertyNames->Contains(InProperty->GetFName())))
 			{
 				return false;
 			}
@@ -199,11 +251,16 @@ namespace LPrefabSystem
 				Object = *ObjectPtr;
 				return true;
 			}
+			Serializer.CollectUnresolvedObjectReference(*this);
 		}
 		break;
 		}
 		return false;
 	}
+	void FLPrefabOverrideParameterObjectReader::DoSerializeTargeted(UObject* Object)
+	{
+		ReadOverrideProperties(*this, Object, Serializer.OnlyReadPropertyNames);
+	}
 	FString FLPrefabOverrideParameterObjectReader::GetArchiveName() const
 	{
 		return TEXT("FLPrefabOverrideParameterObjectReader");
@@ -222,7 +279,8 @@ namespace LPrefabSystem
 
 		Serializer.SetupArchive(*this);
 
-		Object->Serialize(*this);
+		//data is read back in the same session, so only touch override properties
+		WriteOverrideProperties(*this, Object, OverridePropertyNames);
 	}
 	bool FLPrefabImmediateOverrideParameterObjectWriter::ShouldSkipProperty(const FProperty* InProperty) const
 	{
@@ -260,7 +318,7 @@ namespace LPrefabSystem
 
 		Serializer.SetupArchive(*this);
 
-		Object->Serialize(*this);
+		ReadOverrideProperties(*this, Object);
 	}
 	bool FLPrefabImmediateOverrideParameterObjectReader::ShouldSkipProperty(const FProperty* InProperty) const
 	{
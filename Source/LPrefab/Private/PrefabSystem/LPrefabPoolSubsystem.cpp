@@ -0,0 +1,413 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "PrefabSystem/LPrefabPoolSubsystem.h"
+#include "LPrefabModule.h"
+#include "PrefabSystem/LPrefabManager.h"
+#include "PrefabSystem/ILPrefabInterface.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Components/SceneComponent.h"
+#include "HAL/IConsoleManager.h"
+
+#if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
+PRAGMA_DISABLE_OPTIMIZATION
+#endif
+
+static FAutoConsoleCommandWithWorld CCmdLPrefabPoolDump(
+	TEXT("LPrefab.Pool.Dump"),
+	TEXT("Print high-water mark and instance count of every prefab pool in current world."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* InWorld) {
+		if (auto PoolSubsystem = ULPrefabPoolSubsystem::GetInstance(InWorld))
+		{
+			PoolSubsystem->LogPoolStats();
+		}
+		})
+);
+
+bool FLPrefabPooledInstance::IsValidInstance()const
+{
+	if (!IsValid(RootActor) || !ApplyRecord.IsValid())return false;
+	for (auto& Actor : Actors)
+	{
+		if (!IsValid(Actor))return false;
+	}
+	for (auto& Comp : Components)
+	{
+		if (!IsValid(Comp))return false;
+	}
+	return true;
+}
+
+ULPrefabPoolSubsystem* ULPrefabPoolSubsystem::GetInstance(UWorld* World)
+{
+	if (World == nullptr)return nullptr;
+	return World->GetSubsystem<ULPrefabPoolSubsystem>();
+}
+
+void ULPrefabPoolSubsystem::Deinitialize()
+{
+	for (auto& KeyValue : Pools)
+	{
+		for (auto& Instance : KeyValue.Value.FreeInstances)
+		{
+			DestroyInstance(Instance);
+		}
+	}
+	Pools.Empty();
+	ActiveInstances.Empty();//acquired instance is owned by user, just forget them
+	Super::Deinitialize();
+}
+
+bool ULPrefabPoolSubsystem::CanPool(ULPrefab* InPrefab)const
+{
+	if (!IsValid(InPrefab))
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d InPrefab is null!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+		return false;
+	}
+#if WITH_EDITOR
+	if (InPrefab->PrefabVersion < LPREFAB_SERIALIZER_NEWEST_MIN_VERSION)
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d Prefab '%s' is saved with old version, need to re-save it before use prefab pool."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *InPrefab->GetPathName());
+		return false;
+	}
+#endif
+	return true;
+}
+
+bool ULPrefabPoolSubsystem::CreateInstance(ULPrefab* InPrefab, USceneComponent* InParent, const FTransform& InTransform, bool InDispatchAwake, FLPrefabPooledInstance& OutInstance)
+{
+	auto ApplyRecord = MakeShared<LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabApplyRecord>();
+	TArray<AActor*> CreatedActors;
+	auto RootActor = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefabWithApplyRecord(GetWorld(), InPrefab, InParent, InTransform, *ApplyRecord, CreatedActors, InDispatchAwake);
+	if (RootActor == nullptr)
+	{
+		return false;
+	}
+	OutInstance.Prefab = InPrefab;
+	OutInstance.RootActor = RootActor;
+	OutInstance.Actors.Reset(CreatedActors.Num());
+	OutInstance.Components.Reset();
+	OutInstance.Attachments.Reset();
+	auto RootComp = RootActor->GetRootComponent();
+	for (auto& Actor : CreatedActors)
+	{
+		OutInstance.Actors.Add(Actor);
+		for (auto& Comp : Actor->GetComponents())
+		{
+			OutInstance.Components.Add(Comp);
+			auto SceneComp = Cast<USceneComponent>(Comp);
+			if (SceneComp != nullptr && SceneComp != RootComp)//root is attached to the parent of Acquire
+			{
+				FLPrefabPooledAttachment Attachment;
+				Attachment.Component = SceneComp;
+				Attachment.Parent = SceneComp->GetAttachParent();
+				Attachment.SocketName = SceneComp->GetAttachSocketName();
+				OutInstance.Attachments.Add(Attachment);
+			}
+		}
+	}
+	OutInstance.ApplyRecord = ApplyRecord;
+	OutInstance.bAwakeDispatched = InDispatchAwake;
+	Pools.FindOrAdd(InPrefab).CreatedCount++;
+	return true;
+}
+
+void ULPrefabPoolSubsystem::DeactivateInstance(const FLPrefabPooledInstance& InInstance)
+{
+	if (auto RootComp = InInstance.RootActor->GetRootComponent())
+	{
+		RootComp->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+	}
+	//actor that not belongs to the instance should not be pooled together
+	TSet<AActor*> InstanceActors;
+	InstanceActors.Reserve(InInstance.Actors.Num());
+	for (auto& Actor : InInstance.Actors)
+	{
+		InstanceActors.Add(Actor);
+	}
+	TArray<AActor*> AttachedActors;
+	for (auto& Actor : InInstance.Actors)
+	{
+		AttachedActors.Reset();
+		Actor->GetAttachedActors(AttachedActors, false);
+		for (auto& AttachedActor : AttachedActors)
+		{
+			if (!InstanceActors.Contains(AttachedActor))
+			{
+				AttachedActor->DetachFromActor(FDetachmentTransformRules::KeepWorldTransform);
+			}
+		}
+	}
+	for (auto& Actor : InInstance.Actors)
+	{
+		Actor->SetActorHiddenInGame(true);
+		Actor->SetActorEnableCollision(false);
+		Actor->SetActorTickEnabled(false);
+		for (auto& Comp : Actor->GetComponents())
+		{
+			Comp->Deactivate();
+			Comp->SetComponentTickEnabled(false);
+		}
+	}
+}
+
+void ULPrefabPoolSubsystem::RestoreComponents(const FLPrefabPooledInstance& InInstance)
+{
+	TSet<UActorComponent*> InstanceComponents;
+	InstanceComponents.Reserve(InInstance.Components.Num());
+	for (auto& Comp : InInstance.Components)
+	{
+		InstanceComponents.Add(Comp);
+	}
+	TArray<UActorComponent*> ComponentsToDestroy;
+	for (auto& Actor : InInstance.Actors)
+	{
+		for (auto& Comp : Actor->GetComponents())
+		{
+			if (!InstanceComponents.Contains(Comp))
+			{
+				ComponentsToDestroy.Add(Comp);
+			}
+		}
+	}
+	for (auto& Comp : ComponentsToDestroy)
+	{
+		Comp->DestroyComponent();
+	}
+	for (auto& Attachment : InInstance.Attachments)
+	{
+		auto SceneComp = Attachment.Component.Get();
+		if (SceneComp->GetAttachParent() != Attachment.Parent || SceneComp->GetAttachSocketName() != Attachment.SocketName)
+		{
+			if (Attachment.Parent != nullptr)
+			{
+				SceneComp->AttachToComponent(Attachment.Parent, FAttachmentTransformRules::KeepRelativeTransform, Attachment.SocketName);
+			}
+			else
+			{
+				SceneComp->DetachFromComponent(FDetachmentTransformRules::KeepRelativeTransform);
+			}
+		}
+	}
+}
+
+void ULPrefabPoolSubsystem::DispatchReuse(const TArray<AActor*>& InActors)
+{
+	for (auto& Actor : InActors)
+	{
+		if (LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::ImplementsPrefabInterface(Actor->GetClass()))
+		{
+			ILPrefabInterface::Execute_OnReuse(Actor);
+		}
+		auto Components = Actor->GetComponents();
+		for (auto& Comp : Components)
+		{
+			if (LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::ImplementsPrefabInterface(Comp->GetClass()))
+			{
+				ILPrefabInterface::Execute_OnReuse(Comp);
+			}
+		}
+	}
+}
+
+void ULPrefabPoolSubsystem::ActivateInstance(FLPrefabPooledInstance& InInstance, USceneComponent* InParent, const FTransform& InTransform)
+{
+	auto World = GetWorld();
+	auto LPrefabManager = ULPrefabWorldSubsystem::GetInstance(World);
+	auto SessionId = FGuid::NewGuid();
+	LPrefabManager->BeginPrefabSystemProcessingActor(SessionId);
+	for (auto& Actor : InInstance.Actors)
+	{
+		LPrefabManager->AddActorForPrefabSystem(Actor, SessionId);
+	}
+
+	RestoreComponents(InInstance);
+	//restore all properties to prefab state, this will also restore actor's hidden and collision flag
+	TSet<UObject*> ChangedObjects;
+	LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::ReapplyPrefabState(World, *InInstance.ApplyRecord, &ChangedObjects);
+
+	if (auto RootComp = InInstance.RootActor->GetRootComponent())
+	{
+		if (InParent)
+		{
+			RootComp->AttachToComponent(InParent, FAttachmentTransformRules::KeepRelativeTransform);
+		}
+		RootComp->SetRelativeLocationAndRotation(InTransform.GetLocation(), InTransform.GetRotation());
+		RootComp->SetRelativeScale3D(InTransform.GetScale3D());
+	}
+	for (auto& Actor : InInstance.Actors)
+	{
+		//hidden and collision flag are restored without setter, update components same as the setter do
+		const bool bEnableCollision = Actor->GetActorEnableCollision();
+		for (auto& Comp : Actor->GetComponents())
+		{
+			if (ChangedObjects.Contains(Comp))//only re-register component that is changed since it is created, eg: property set by gameplay
+			{
+				LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::PostSetPropertiesOnActor(Comp);
+			}
+			else if (bEnableCollision)
+			{
+				Comp->OnActorEnableCollisionChanged();
+			}
+		}
+		if (!Actor->IsHidden())
+		{
+			Actor->MarkComponentsRenderStateDirty();
+		}
+	}
+	for (auto& Actor : InInstance.Actors)
+	{
+		Actor->SetActorTickEnabled(Actor->PrimaryActorTick.bStartWithTickEnabled);
+		for (auto& Comp : Actor->GetComponents())
+		{
+			if (Comp->bAutoActivate)
+			{
+				Comp->Activate(true);
+			}
+			Comp->SetComponentTickEnabled(Comp->PrimaryComponentTick.bStartWithTickEnabled);
+		}
+	}
+
+	for (auto& Actor : InInstance.Actors)
+	{
+		LPrefabManager->RemoveActorForPrefabSystem(Actor, SessionId);
+	}
+	LPrefabManager->EndPrefabSystemProcessingActor(SessionId);
+
+	TArray<AActor*> Actors;
+	Actors.Reserve(InInstance.Actors.Num());
+	for (auto& Actor : InInstance.Actors)
+	{
+		Actors.Add(Actor);
+	}
+	//same Awake as fresh load, OnReuse before it so runtime state can be reset first
+	if (InInstance.bAwakeDispatched)
+	{
+		DispatchReuse(Actors);
+	}
+	InInstance.bAwakeDispatched = true;
+	LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::DispatchAwake(World, Actors);
+}
+
+void ULPrefabPoolSubsystem::DestroyInstance(const FLPrefabPooledInstance& InInstance)
+{
+	for (auto& Actor : InInstance.Actors)
+	{
+		if (IsValid(Actor))
+		{
+			Actor->Destroy();
+		}
+	}
+}
+
+void ULPrefabPoolSubsystem::Prewarm(ULPrefab* InPrefab, int32 InCount)
+{
+	if (!CanPool(InPrefab))return;
+	auto& Pool = Pools.FindOrAdd(InPrefab);
+	Pool.FreeInstances.Reserve(InCount);
+	for (int i = Pool.FreeInstances.Num(); i < InCount; i++)
+	{
+		FLPrefabPooledInstance Instance;
+		if (!CreateInstance(InPrefab, nullptr, FTransform::Identity, false, Instance))
+		{
+			break;
+		}
+		DeactivateInstance(Instance);
+		Pool.FreeInstances.Add(Instance);
+	}
+}
+
+AActor* ULPrefabPoolSubsystem::Acquire(ULPrefab* InPrefab, USceneComponent* InParent, const FTransform& InTransform)
+{
+	if (!CanPool(InPrefab))return nullptr;
+	FLPrefabPooledInstance Instance;
+	bool bFound = false;
+	{
+		auto& Pool = Pools.FindOrAdd(InPrefab);
+		while (Pool.FreeInstances.Num() > 0)
+		{
+			Instance = Pool.FreeInstances.Pop(false);
+			if (Instance.IsValidInstance())
+			{
+				bFound = true;
+				break;
+			}
+			DestroyInstance(Instance);//some actor is destroyed outside, could not use it anymore
+		}
+	}
+	if (bFound)
+	{
+		ActivateInstance(Instance, InParent, InTransform);
+	}
+	else
+	{
+		if (!CreateInstance(InPrefab, InParent, InTransform, true, Instance))
+		{
+			return nullptr;
+		}
+	}
+
+	auto& Pool = Pools.FindChecked(InPrefab);
+	Pool.ActiveCount++;
+	Pool.HighWaterMark = FMath::Max(Pool.HighWaterMark, Pool.ActiveCount);
+	ActiveInstances.Add(Instance.RootActor, Instance);
+	return Instance.RootActor;
+}
+
+bool ULPrefabPoolSubsystem::Release(AActor* InRootActor)
+{
+	FLPrefabPooledInstance Instance;
+	if (!ActiveInstances.RemoveAndCopyValue(InRootActor, Instance))
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d Actor '%s' is not acquired from prefab pool!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *GetNameSafe(InRootActor));
+		return false;
+	}
+	auto Pool = Pools.Find(Instance.Prefab);
+	if (Pool != nullptr)
+	{
+		Pool->ActiveCount--;
+	}
+	if (Pool == nullptr || !IsValid(Instance.Prefab) || !Instance.IsValidInstance())
+	{
+		UE_LOG(LPrefab, Warning, TEXT("[%s].%d Some actor of instance '%s' is destroyed, could not put it back to pool."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *GetNameSafe(InRootActor));
+		DestroyInstance(Instance);
+		return false;
+	}
+	DeactivateInstance(Instance);
+	Pool->FreeInstances.Add(Instance);
+	return true;
+}
+
+int32 ULPrefabPoolSubsystem::GetHighWaterMark(ULPrefab* InPrefab)const
+{
+	if (auto Pool = Pools.Find(InPrefab))
+	{
+		return Pool->HighWaterMark;
+	}
+	return 0;
+}
+
+int32 ULPrefabPoolSubsystem::GetFreeCount(ULPrefab* InPrefab)const
+{
+	if (auto Pool = Pools.Find(InPrefab))
+	{
+		return Pool->FreeInstances.Num();
+	}
+	return 0;
+}
+
+void ULPrefabPoolSubsystem::LogPoolStats()const
+{
+	UE_LOG(LPrefab, Log, TEXT("Prefab pool stats of world: '%s', pool count: %d"), *GetNameSafe(GetWorld()), Pools.Num());
+	for (auto& KeyValue : Pools)
+	{
+		auto& Pool = KeyValue.Value;
+		UE_LOG(LPrefab, Log, TEXT("    '%s': high-water mark: %d, active: %d, free: %d, created: %d")
+			, *GetPathNameSafe(KeyValue.Key), Pool.HighWaterMark, Pool.ActiveCount, Pool.FreeInstances.Num(), Pool.CreatedCount);
+	}
+}
+
+#if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
+PRAGMA_ENABLE_OPTIMIZATION
+#endif
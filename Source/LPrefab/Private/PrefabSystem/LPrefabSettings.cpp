@@ -39,3 +39,23 @@ bool ULPrefabSettings::GetLogPrefabLoadTime()
 {
 	return GetDefault<ULPrefabSettings>()->bLogPrefabLoadTime;
 }
+
+bool ULPrefabSettings::GetParsePrefabDataOnPostLoad()
+{
+	return GetDefault<ULPrefabSettings>()->bParsePrefabDataOnPostLoad;
+}
+
+bool ULPrefabSettings::GetStoreBuildDataAsBulkData()
+{
+	return GetDefault<ULPrefabSettings>()->bStoreBuildDataAsBulkData;
+}
+
+bool ULPrefabSettings::GetCompressBuildData()
+{
+	return GetDefault<ULPrefabSettings>()->bCompressBuildData;
+}
+
+float ULPrefabSettings::GetBuildDataIdleReleaseTime()
+{
+	return GetDefault<ULPrefabSettings>()->BuildDataIdleReleaseTime;
+}
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
+#include "Engine/LatentActionManager.h"
 #include "PrefabSystem/LPrefab.h"
 #include LPREFAB_SERIALIZER_NEWEST_INCLUDE
 #include "LPrefabBPLibrary.generated.h"
@@ -65,6 +66,15 @@ public:
 	 */
 	UFUNCTION(BlueprintCallable, meta = (AdvancedDisplay = "", UnsafeDuringActorConstruction = "true", WorldContext = "WorldContextObject", AutoCreateRefTerm = "InCallbackBeforeAwake"), Category = LPrefab)
 		static AActor* LoadPrefabWithReplacement(UObject* WorldContextObject, ULPrefab* InPrefab, USceneComponent* InParent, const TMap<UObject*, UObject*>& InReplaceAssetMap, const TMap<UClass*, UClass*>& InReplaceClassMap, const FLPrefab_LoadPrefabCallback& InCallbackBeforeAwake);
+	/**
+	 * LoadPrefab across multiple frames, to avoid hitch when load big prefab.
+	 * Awake function in LGUILifeCycleBehaviour and LPrefabInterface will be called after the whole hierarchy is loaded.
+	 * @param InParent Parent scene component that the created root actor will be attached to. Can be null so the created root actor will not attach to anyone.
+	 * @param FrameBudgetMs Max time in milliseconds to spend on the load in one frame.
+	 * @param LoadedRootActor The loaded root actor, null if fail.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (Latent, LatentInfo = "LatentInfo", UnsafeDuringActorConstruction = "true", WorldContext = "WorldContextObject"), Category = LPrefab)
+		static void LoadPrefabAsync(UObject* WorldContextObject, ULPrefab* InPrefab, USceneComponent* InParent, float FrameBudgetMs, AActor*& LoadedRootActor, FLatentActionInfo LatentInfo);
 
 	/**
 	 * Duplicate actor and all it's children actors
@@ -82,6 +92,15 @@ public:
 	 */
 	UFUNCTION(BlueprintCallable, meta = (DeterminesOutputType = "Target", UnsafeDuringActorConstruction = "true"), Category = LPrefab)
 		static AActor* DuplicateActorWithPreparedData(UPARAM(Ref) FLPrefabDuplicateDataContainer& Data, USceneComponent* Parent);
+	/**
+	 * Create multiple copies with PrepareDuplicateData node's data in one call, eg: rows of a list view.
+	 * @param Count	Number of copies.
+	 * @param Parents	Parent of every copy. Can be empty (no parent), or only one (all copies use the same parent), or same count as Count.
+	 * @param Transforms	Relative transform of every copy. Can be empty (keep source actor's transform), or same count as Count.
+	 * @return Root actor of every copy.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (UnsafeDuringActorConstruction = "true", AutoCreateRefTerm = "Parents,Transforms"), Category = LPrefab)
+		static TArray<AActor*> DuplicateActorWithPreparedDataBatch(UPARAM(Ref) FLPrefabDuplicateDataContainer& Data, int32 Count, const TArray<USceneComponent*>& Parents, const TArray<FTransform>& Transforms);
 	template<class T>
 	static T* DuplicateActorT(T* Target, USceneComponent* Parent)
 	{
@@ -1,10 +1,12 @@
-// Copyright 2019-Present LexLiu. All Rights Reserved.
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
 
 #pragma once
 
 #include "PrefabSystem/LPrefab.h"
 #include "PrefabSystem/LPrefabLevelManagerActor.h"
 #include "PrefabSystem/LPrefabManager.h"
+#include "PrefabSystem/LPrefabPoolSubsystem.h"
+#include "PrefabSystem/LPrefabDeferredSubPrefabComponent.h"
 #include "PrefabSystem/LPrefabSettings.h"
 #include "PrefabSystem/LPrefabHelperObject.h"
 #include "PrefabSystem/ILPrefabInterface.h"
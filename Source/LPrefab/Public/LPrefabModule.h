@@ -2,11 +2,39 @@
 
 #pragma once
 #include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
 #include "Modules/ModuleInterface.h"
+#include "Containers/Ticker.h"
 
 LPREFAB_API DECLARE_LOG_CATEGORY_EXTERN(LPrefab, Log, All);
 DECLARE_STATS_GROUP(TEXT("LPrefab"), STATGROUP_LexPrefab, STATCAT_Advanced);
 
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Parse SaveData"), STAT_LPrefab_ParseSaveData, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Deserialize"), STAT_LPrefab_Deserialize, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Deserialize GenerateActors"), STAT_LPrefab_GenerateActors, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Deserialize GenerateObjects"), STAT_LPrefab_GenerateObjects, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Deserialize ApplyProperties"), STAT_LPrefab_ApplyProperties, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Deserialize ApplyOverrideParameters"), STAT_LPrefab_ApplyOverrideParameters, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Deserialize AttachComponents"), STAT_LPrefab_AttachComponents, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Deserialize PostSetProperties"), STAT_LPrefab_PostSetProperties, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Deserialize RegisterComponents"), STAT_LPrefab_RegisterComponents, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Deserialize Finish"), STAT_LPrefab_FinishDeserialize, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Awake"), STAT_LPrefab_Awake, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("LoadPrefabBatch"), STAT_LPrefab_LoadPrefabBatch, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Serialize"), STAT_LPrefab_Serialize, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("DuplicateActor"), STAT_LPrefab_DuplicateActor, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("RefreshOnSubPrefabDirty"), STAT_LPrefab_RefreshOnSubPrefabDirty, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("GetAllPrefabArray"), STAT_LPrefab_GetAllPrefabArray, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("TranscodeBuildData"), STAT_LPrefab_TranscodeBuildData, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Parsed SaveData Cache Hit"), STAT_LPrefab_ParsedSaveDataCacheHit, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Parsed SaveData Cache Miss"), STAT_LPrefab_ParsedSaveDataCacheMiss, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Build Data DDC Hit"), STAT_LPrefab_BuildDataDDCHit, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Build Data DDC Miss"), STAT_LPrefab_BuildDataDDCMiss, STATGROUP_LexPrefab, LPREFAB_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Parsed SaveData Memory"), STAT_LPrefab_ParsedSaveDataMemory, STATGROUP_LexPrefab, LPREFAB_API);
+
+//cpu trace scope with dynamic name, eg. prefab asset name and object count. the name is only formatted when cpu channel is enabled
+#define LPREFAB_TRACE_SCOPE_TEXT(Format, ...) TRACE_CPUPROFILER_EVENT_SCOPE_TEXT(UE_TRACE_CHANNELEXPR_IS_ENABLED(CpuChannel) ? *FString::Printf(Format, ##__VA_ARGS__) : TEXT(""))
+
 //prevent compile optimization for easier code debug
 #define LEXPREFAB_CAN_DISABLE_OPTIMIZATION 0
 
@@ -17,4 +45,7 @@ public:
 	/** IModuleInterface implementation */
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
+private:
+	FTSTicker::FDelegateHandle ReleaseIdleParsedSaveDataTickerHandle;
+	FDelegateHandle ReloadCompleteDelegateHandle;
 };
@@ -9,6 +9,13 @@
 #include "Serialization/BufferArchive.h"
 #include "Serialization/ObjectWriter.h"
 #include "Serialization/ObjectReader.h"
+#include "UObject/ObjectKey.h"
+
+class ULPrefabDeferredSubPrefabComponent;
+namespace LPrefabSystem
+{
+	class FLPrefabObjectReader;
+}
 
 namespace LPrefabSystem8
 {
@@ -28,6 +35,8 @@ namespace LPrefabSystem8
 	public:
 		FName ObjectName;
 		FGuid OuterObjectGuid;//outer object
+		FGuid ObjectGuid;//not serialized here, it is the key when serialize FLPrefabSaveData
+		FGuid SceneComponentParentGuid;//not serialized here, stored in FLPrefabSaveData. Invalid if not scene component or parent is not in this prefab
 
 		friend FArchive& operator<<(FArchive& Ar, FLGUIObjectSaveData& ObjectData)
 		{
@@ -118,6 +127,13 @@ namespace LPrefabSystem8
 
 		FGuid ActorGuid;
 		FGuid RootComponentGuid;
+		/** Sub prefab only, parent of sub prefab's root component if the parent is in this prefab. Not serialized here, stored in FLPrefabSaveData. */
+		FGuid RootComponentParentGuid;
+		/**
+		 * Sub prefab is not loaded together with parent prefab, a ULPrefabDeferredSubPrefabComponent placeholder is created instead, and load it when call Realize.
+		 * Not serialized here, see FLPrefabDeferredSubPrefabSaveData.
+		 */
+		bool bDeferLoad = false;
 
 		friend FArchive& operator<<(FArchive& Ar, FLGUIActorSaveData& ActorData)
 		{
@@ -167,38 +183,365 @@ namespace LPrefabSystem8
 				Record << SA_VALUE(TEXT("DefaultSubObjectNameArray"), Data.DefaultSubObjectNameArray);
 			}
 		}
+		SIZE_T GetAllocatedSize()const
+		{
+			SIZE_T Result = DefaultSubObjectGuidArray.GetAllocatedSize() + DefaultSubObjectNameArray.GetAllocatedSize()
+				+ MapObjectGuidToSubPrefabOverrideParameter.GetAllocatedSize() + MapObjectIdToNewlyCreatedId.GetAllocatedSize() + MapObjectGuidFromParentPrefabToSubPrefab.GetAllocatedSize();
+			for (auto& KeyValue : MapObjectGuidToSubPrefabOverrideParameter)
+			{
+				Result += KeyValue.Value.OverrideParameterData.GetAllocatedSize() + KeyValue.Value.OverrideParameterNames.GetAllocatedSize();
+			}
+			return Result;
+		}
+	};
+
+	/** Sub prefab which is marked as deferred load. Stored after object data, since ELPrefabVersion::DeferredSubPrefab. */
+	struct FLPrefabDeferredSubPrefabSaveData
+	{
+	public:
+		/** Index in FLPrefabSaveData::SavedActors */
+		int32 ActorIndex = INDEX_NONE;
+		/** Sub prefab's root component guid in parent prefab, to find the parent of placeholder */
+		FGuid RootComponentGuid;
+
+		friend FArchive& operator<<(FArchive& Ar, FLPrefabDeferredSubPrefabSaveData& Data)
+		{
+			Ar << Data.ActorIndex;
+			Ar << Data.RootComponentGuid;
+			return Ar;
+		}
+		friend void operator<<(FStructuredArchive::FSlot Slot, FLPrefabDeferredSubPrefabSaveData& Data)
+		{
+			FStructuredArchive::FRecord Record = Slot.EnterRecord();
+			Record << SA_VALUE(TEXT("ActorIndex"), Data.ActorIndex);
+			Record << SA_VALUE(TEXT("RootComponentGuid"), Data.RootComponentGuid);
+		}
+	};
+
+	/** Serialized property data of one object */
+	struct FLPrefabObjectPropertySaveData
+	{
+	public:
+		FGuid ObjectGuid;
+		/** Index in FLPrefabSaveData::ObjectGuids, only valid if parsed from compact build data. */
+		int32 ObjectIndex = INDEX_NONE;
+		TArray<uint8> Data;
 	};
 
 	struct FLPrefabSaveData
 	{
 	public:
 		TArray<FLGUIActorSaveData> SavedActors;
-		TMap<FGuid, FLGUIObjectSaveData> SavedObjects;
-		/** Key as child, value as parent. */
-		TMap<FGuid, FGuid> MapSceneComponentToParent;
-		/** Map guid to parameter data */
-		TMap<FGuid, TArray<uint8>> SavedObjectData;
+		/** Flat array in save order, serialized with the same layout as TMap<FGuid, FLGUIObjectSaveData>. */
+		TArray<FLGUIObjectSaveData> SavedObjects;
+		/** Parameter data of objects. Flat array in save order, serialized with the same layout as TMap<FGuid, TArray<uint8>>. */
+		TArray<FLPrefabObjectPropertySaveData> SavedObjectData;
+		/**
+		 * Dense index to object guid, only valid for compact build data (ELPrefabVersion::CompactBuildData).
+		 * Object reference inside property data is stored as index of this array, and every guid in compact data is stored as index too.
+		 */
+		TArray<FGuid> ObjectGuids;
+		/**
+		 * Index (in ObjectGuids) of actors and components that implement ILPrefabInterface, in the order of Awake. Only generated for compact build data when every sub prefab is flattened or deferred.
+		 * Only valid if bHasAwakeObjectIndices, otherwise Awake is dispatched by checking every actor and component.
+		 */
+		TArray<int32> AwakeObjectIndices;
+		bool bHasAwakeObjectIndices = false;
+		/**
+		 * One per SavedActors item: how many items of AwakeObjectIndices belong to the actor, and how many components the actor has in this data.
+		 * Runtime use AwakeObjectIndices of an actor only if it still has the same component count, otherwise it got components that are not in the list.
+		 * Empty if the data is cooked without them, then AwakeObjectIndices is not used.
+		 */
+		TArray<int32> AwakeObjectCounts;
+		TArray<int32> AwakeComponentCounts;
+		/** Build data only, property data is diffed against archetype, see ELPrefabVersion::DeltaBuildData. */
+		bool bDeltaAgainstArchetype = false;
+		/** Build data only, sub prefab's override parameter data only store the override properties, see ELPrefabVersion::TargetedOverrideParameter. */
+		bool bTargetedOverrideParameter = false;
+		/** Build data only, property data use versioned tagged property serialization, see ActorSerializerBase::bTaggedPropertyData. */
+		bool bTaggedPropertyData = false;
+
+		TArray<uint8>& AddObjectData(const FGuid& InObjectGuid)
+		{
+			auto& Item = SavedObjectData.AddDefaulted_GetRef();
+			Item.ObjectGuid = InObjectGuid;
+			return Item.Data;
+		}
 
 		friend FArchive& operator<<(FArchive& Ar, FLPrefabSaveData& GameData)
 		{
-			Ar << GameData.SavedActors;
-			Ar << GameData.SavedObjects;
-			Ar << GameData.MapSceneComponentToParent;
-			Ar << GameData.SavedObjectData;
+			GameData.Serialize(Ar);
 			return Ar;
 		}
 		friend void operator<<(FStructuredArchive::FSlot Slot, FLPrefabSaveData& Data)
 		{
+			Data.Serialize(Slot);
+		}
+		/**
+		 * Layout for non-compact BinaryDataForBuild.
+		 * @param InPrefabVersion	Layout version of the data (ELPrefabVersion, below BuildDataVersionStart), only used when loading.
+		 */
+		void Serialize(FArchive& Ar, uint16 InPrefabVersion = LPREFAB_CURRENT_VERSION)
+		{
+			Ar << SavedActors;
+			int32 ObjectCount = SavedObjects.Num();
+			Ar << ObjectCount;
+			if (Ar.IsLoading())
+			{
+				SavedObjects.SetNum(ObjectCount);
+			}
+			for (auto& Item : SavedObjects)
+			{
+				Ar << Item.ObjectGuid;
+				Ar << Item;
+			}
+			//keep the child-to-parent map layout
+			TMap<FGuid, FGuid> MapSceneComponentToParent;
+			if (!Ar.IsLoading())
+			{
+				GetSceneComponentParents(MapSceneComponentToParent);
+			}
+			Ar << MapSceneComponentToParent;
+			if (Ar.IsLoading())
+			{
+				SetSceneComponentParents(MapSceneComponentToParent);
+			}
+			int32 DataCount = SavedObjectData.Num();
+			Ar << DataCount;
+			if (Ar.IsLoading())
+			{
+				SavedObjectData.SetNum(DataCount);
+			}
+			for (auto& Item : SavedObjectData)
+			{
+				Ar << Item.ObjectGuid;
+				Ar << Item.Data;
+			}
+			if (Ar.IsSaving() || InPrefabVersion >= (uint16)ELPrefabVersion::DeferredSubPrefab)
+			{
+				TArray<FLPrefabDeferredSubPrefabSaveData> DeferredSubPrefabs;
+				if (!Ar.IsLoading())
+				{
+					GetDeferredSubPrefabs(DeferredSubPrefabs);
+				}
+				Ar << DeferredSubPrefabs;
+				if (Ar.IsLoading())
+				{
+					SetDeferredSubPrefabs(DeferredSubPrefabs);
+				}
+			}
+		}
+		/**
+		 * Layout for editor data (BinaryData).
+		 * @param InPrefabVersion	ULPrefab::PrefabVersion of the data, only used when loading.
+		 */
+		void Serialize(FStructuredArchive::FSlot Slot, uint16 InPrefabVersion = LPREFAB_CURRENT_VERSION)
+		{
+			//editor data keep the map layout
+			TMap<FGuid, FLGUIObjectSaveData> SavedObjectMap;
+			TMap<FGuid, TArray<uint8>> SavedObjectDataMap;
+			TMap<FGuid, FGuid> MapSceneComponentToParent;
+			TArray<FLPrefabDeferredSubPrefabSaveData> DeferredSubPrefabs;
+			bool bIsLoading = Slot.GetUnderlyingArchive().IsLoading();
+			if (!bIsLoading)
+			{
+				GetSceneComponentParents(MapSceneComponentToParent);
+				GetDeferredSubPrefabs(DeferredSubPrefabs);
+				SavedObjectMap.Reserve(SavedObjects.Num());
+				for (auto& Item : SavedObjects)
+				{
+					SavedObjectMap.Add(Item.ObjectGuid, Item);
+				}
+				SavedObjectDataMap.Reserve(SavedObjectData.Num());
+				for (auto& Item : SavedObjectData)
+				{
+					SavedObjectDataMap.Add(Item.ObjectGuid, Item.Data);
+				}
+			}
 			FStructuredArchive::FRecord Record = Slot.EnterRecord();
-			Record << SA_VALUE(TEXT("SavedActor"), Data.SavedActors);
-			Record << SA_VALUE(TEXT("SavedObjects"), Data.SavedObjects);
-			Record << SA_VALUE(TEXT("MapSceneComponentToParent"), Data.MapSceneComponentToParent);
-			Record << SA_VALUE(TEXT("SavedObjectReferences"), Data.SavedObjectData);
+			Record << SA_VALUE(TEXT("SavedActor"), SavedActors);
+			Record << SA_VALUE(TEXT("SavedObjects"), SavedObjectMap);
+			Record << SA_VALUE(TEXT("MapSceneComponentToParent"), MapSceneComponentToParent);
+			Record << SA_VALUE(TEXT("SavedObjectReferences"), SavedObjectDataMap);
+			if (!bIsLoading || InPrefabVersion >= (uint16)ELPrefabVersion::DeferredSubPrefab)
+			{
+				Record << SA_VALUE(TEXT("DeferredSubPrefabs"), DeferredSubPrefabs);
+			}
+			if (bIsLoading)
+			{
+				SavedObjects.Reset(SavedObjectMap.Num());
+				for (auto& KeyValue : SavedObjectMap)
+				{
+					auto& Item = SavedObjects.Add_GetRef(MoveTemp(KeyValue.Value));
+					Item.ObjectGuid = KeyValue.Key;
+				}
+				SavedObjectData.Reset(SavedObjectDataMap.Num());
+				for (auto& KeyValue : SavedObjectDataMap)
+				{
+					AddObjectData(KeyValue.Key) = MoveTemp(KeyValue.Value);
+				}
+				SetSceneComponentParents(MapSceneComponentToParent);
+				SetDeferredSubPrefabs(DeferredSubPrefabs);
+			}
+		}
+		/**
+		 * Compact layout for BinaryDataForBuild (ELPrefabVersion::CompactBuildData): guids are stored once in ObjectGuids, everywhere else use int32 index.
+		 * When saving, guid which is not in ObjectGuids yet will be added to it, and always write the newest layout.
+		 * @param InBuildDataVersion	ULPrefab::BuildDataVersion of the data, only used when loading.
+		 */
+		void SerializeCompact(FArchive& Ar, uint16 InBuildDataVersion = LPREFAB_CURRENT_BUILD_DATA_VERSION);
+		/** Deferred flag of sub prefabs in compact data before ELPrefabVersion::FlagsBuildData, at the end of data and only exist when not reach the end. */
+		void SerializeDeferredSubPrefabsLegacy(FArchive& Ar);
+		/** Collect scene component's parent from actor and object records, as child-to-parent map. */
+		void GetSceneComponentParents(TMap<FGuid, FGuid>& OutMapSceneComponentToParent)const;
+		/** Fill scene component's parent to actor and object records from child-to-parent map. */
+		void SetSceneComponentParents(const TMap<FGuid, FGuid>& InMapSceneComponentToParent);
+		void GetDeferredSubPrefabs(TArray<FLPrefabDeferredSubPrefabSaveData>& OutDeferredSubPrefabs)const;
+		void SetDeferredSubPrefabs(const TArray<FLPrefabDeferredSubPrefabSaveData>& InDeferredSubPrefabs);
+		/** Memory taken by this data, for stat. */
+		SIZE_T GetAllocatedSize()const
+		{
+			SIZE_T Result = SavedActors.GetAllocatedSize() + SavedObjects.GetAllocatedSize() + SavedObjectData.GetAllocatedSize() + ObjectGuids.GetAllocatedSize()
+				+ AwakeObjectIndices.GetAllocatedSize() + AwakeObjectCounts.GetAllocatedSize() + AwakeComponentCounts.GetAllocatedSize();
+			for (auto& Item : SavedActors)
+			{
+				Result += Item.GetAllocatedSize();
+			}
+			for (auto& Item : SavedObjects)
+			{
+				Result += Item.DefaultSubObjectGuidArray.GetAllocatedSize() + Item.DefaultSubObjectNameArray.GetAllocatedSize();
+			}
+			for (auto& Item : SavedObjectData)
+			{
+				Result += Item.Data.GetAllocatedSize();
+			}
+			return Result;
 		}
 	};
 
 	struct FDuplicateActorDataContainer;
 
+#if WITH_EDITOR
+	/** Build data generated by ActorSerializer::TranscodeBuildData, not applied to prefab yet. */
+	struct FLPrefabTranscodedBuildData
+	{
+	public:
+		TArray<uint8> BinaryDataForBuild;
+		uint16 BuildDataVersion = 0;
+		uint32 ArchetypeHashForBuild = 0;
+		TArray<UObject*> ReferenceAssetList;
+		TArray<UClass*> ReferenceClassList;
+		TArray<FName> ReferenceNameList;
+	};
+#endif
+
+	/**
+	 * Record of every property data that applied to objects during a load, include sub prefabs.
+	 * Use it to apply the same data again to the created objects, so they are restored to prefab state (eg: reuse instance from prefab pool).
+	 */
+	struct FLPrefabApplyRecord
+	{
+		/** One scope for one prefab load (root prefab or sub prefab), object reference inside data is resolved by scope's guid map. */
+		struct FScope
+		{
+			TWeakObjectPtr<ULPrefab> Prefab;
+			/** Keep the parsed data alive, because FObjectData reference buffer inside it. */
+			TSharedPtr<const FLPrefabSaveData, ESPMode::ThreadSafe> SaveData;
+			TMap<FGuid, TWeakObjectPtr<UObject>> MapGuidToObject;
+		};
+		struct FObjectData
+		{
+			int32 ScopeIndex = INDEX_NONE;
+			TWeakObjectPtr<UObject> Object;
+			/** Object's data, point to buffer inside scope's SaveData. */
+			const TArray<uint8>* Data = nullptr;
+			/** Override parameter data, valid if this is sub prefab's override parameter. */
+			TArray<uint8> OverrideData;
+			TArray<FName> OverrideNames;
+			bool bIsOverrideParameter = false;
+		};
+		TArray<FScope> Scopes;
+		/** Data in apply order. */
+		TArray<FObjectData> ObjectDatas;
+	};
+
+	/**
+	 * Shared by all deferred sub prefabs of one load. Keep what need to load a deferred sub prefab later, and to resolve object reference between it and parent prefab.
+	 */
+	struct FDeferredSubPrefabScope
+	{
+		TWeakObjectPtr<ULPrefab> Prefab;
+		bool bIsEditorOrRuntime = true;
+		/** Hold a reference, because actor data and property data inside it are used when realize. */
+		TSharedPtr<const FLPrefabSaveData, ESPMode::ThreadSafe> SaveData;
+		/** Valid after parent prefab finish load. Realized sub prefab's objects are added too, so they can be referenced by other deferred sub prefabs. */
+		TMap<FGuid, TWeakObjectPtr<UObject>> MapGuidToObject;
+		bool bLoadFinished = false;
+		/** Parent prefab's data which have object reference can't be resolved when load (may point to deferred sub prefab), read these properties again after realize. */
+		struct FUnresolvedObjectData
+		{
+			TWeakObjectPtr<UObject> Object;
+			/** Point to buffer inside SaveData, valid if not override parameter */
+			const TArray<uint8>* Data = nullptr;
+			TArray<uint8> OverrideData;
+			TArray<FName> OverrideNames;
+			bool bIsOverrideParameter = false;
+			/** Member properties that have unresolved object reference */
+			TArray<FName> PropertyNames;
+		};
+		TArray<FUnresolvedObjectData> UnresolvedObjectDatas;
+		/** Parent prefab's scene component whose parent is inside deferred sub prefab, it is attached to root actor when load, and attached to the right parent after realize. */
+		struct FPendingAttachment
+		{
+			TWeakObjectPtr<USceneComponent> Component;
+			FGuid ParentGuid;
+		};
+		TArray<FPendingAttachment> PendingAttachments;
+	};
+
+	/**
+	 * Property data of every object from last editor save of a prefab, so next save only run writer for dirty objects.
+	 * Actor and object tables are always collected again, only the per-object data is reused.
+	 * Changes are recorded from editor notifications (Modify, PostEditChangeProperty, undo/redo), code that write object without them should call MarkDirty or Reset. LPrefab.IncrementalSaveCheck can verify the result against full save.
+	 */
+	struct LPREFAB_API FLPrefabIncrementalSaveCache
+	{
+		FLPrefabIncrementalSaveCache();
+		~FLPrefabIncrementalSaveCache();
+		FLPrefabIncrementalSaveCache(const FLPrefabIncrementalSaveCache&) = delete;
+		FLPrefabIncrementalSaveCache& operator=(const FLPrefabIncrementalSaveCache&) = delete;
+		/** Object is changed, its data and its inner objects' data will be written again when next save. */
+		void MarkDirty(UObject* InObject);
+		/** Clear all data, next save will write every object. */
+		void Reset();
+		/** Drop data of all caches when class layout may change, eg: blueprint compile or hot reload. */
+		static void InvalidateAll();
+	private:
+		friend class ActorSerializer;
+		struct FEntry
+		{
+			TWeakObjectPtr<UObject> Object;
+			TArray<uint8> Data;
+			/** Reference lookups when write Data, do them again when reuse Data, so reference lists are same as full save. */
+			TArray<LPrefabSystem::FLPrefabWriteRecordItem> Record;
+		};
+		TMap<FGuid, FEntry> Entries;
+		TSet<FObjectKey> DirtyObjects;
+		/** Prefab that Entries is saved to, data is dropped when save to another prefab. */
+		TWeakObjectPtr<ULPrefab> Prefab;
+		uint32 Generation = 0;
+		static uint32 CurrentGeneration;
+		bool IsDirty(UObject* InObject)const;
+#if WITH_EDITOR
+		void OnObjectModified(UObject* InObject);
+		void OnObjectPropertyChanged(UObject* InObject, struct FPropertyChangedEvent& InPropertyChangedEvent);
+		void OnObjectTransacted(UObject* InObject, const class FTransactionObjectEvent& InTransactionObjectEvent);
+		FDelegateHandle OnObjectModifiedHandle;
+		FDelegateHandle OnObjectPropertyChangedHandle;
+		FDelegateHandle OnObjectTransactedHandle;
+#endif
+	};
+
 	/*
 	 * serialize/deserialize actor with hierarchy.
 	 */
@@ -213,6 +556,23 @@ namespace LPrefabSystem8
 		 * @param CallbackBeforeAwake	This callback function will execute before Awake event, parameter "Actor" is the loaded root actor.
 		 */
 		static AActor* LoadPrefab(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent, FVector RelativeLocation, FQuat RelativeRotation, FVector RelativeScale, TFunction<void(AActor*)> CallbackBeforeAwake = nullptr);
+		/**
+		 * LoadPrefab with data that is already parsed from InPrefab (eg: by FLPrefabLoadRequest), so prefab's parsed data cache is not used.
+		 * @param InSaveData	Parsed data of InPrefab, if null then same as LoadPrefab.
+		 */
+		static AActor* LoadPrefabWithSaveData(UWorld* InWorld, ULPrefab* InPrefab, const TSharedPtr<const FLPrefabSaveData, ESPMode::ThreadSafe>& InSaveData, USceneComponent* Parent, bool SetRelativeTransformToIdentity, TFunction<void(AActor*)> CallbackBeforeAwake = nullptr);
+		/**
+		 * LoadPrefab with some reference assets and classes replaced. Replacement is applied to the resolved reference lists of this load, prefab asset is not modified.
+		 * Only apply to the prefab itself, not sub prefabs.
+		 */
+		static AActor* LoadPrefabWithReplacement(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent, const TMap<UObject*, UObject*>& InReplaceAssetMap, const TMap<UClass*, UClass*>& InReplaceClassMap, TFunction<void(AActor*)> CallbackBeforeAwake = nullptr);
+		/**
+		 * Load multiple instances of the same prefab in one pass. Prefab data is parsed and resolved once, and actors/objects are created slot by slot for all instances.
+		 * @param InTransforms	Relative transform of every instance's root actor, instance count is InTransforms.Num().
+		 * @param InParents	Parent of every instance's root actor. Can be empty (no parent), or only one (all instances use the same parent), or same count as InTransforms.
+		 * @param OutRoots	Root actor of every instance, same order as InTransforms. Null if the instance fail to load.
+		 */
+		static void LoadPrefabBatch(UWorld* InWorld, ULPrefab* InPrefab, TArrayView<const FTransform> InTransforms, TArrayView<USceneComponent* const> InParents, TArray<AActor*>& OutRoots);
 		/**
 		 * LoadPrefab and keep reference of objects.
 		 */
@@ -220,19 +580,54 @@ namespace LPrefabSystem8
 			, TMap<FGuid, TObjectPtr<UObject>>& InOutMapGuidToObjects, TMap<TObjectPtr<AActor>, FLSubPrefabData>& OutSubPrefabMap
 		);
 
-		/** Save prefab data for editor use. */
+		/**
+		 * Save prefab data for editor use.
+		 * @param InDeltaAgainstArchetype	Only for build data (InForEditorOrRuntimeUse = false) with compact layout, property same as archetype will not be stored.
+		 */
 		static void SavePrefab(AActor* RootActor, ULPrefab* InPrefab
 			, TMap<UObject*, FGuid>& OutMapObjectToGuid, TMap<TObjectPtr<AActor>, FLSubPrefabData>& InSubPrefabMap
 			, bool InForEditorOrRuntimeUse
+			, bool InDeltaAgainstArchetype = false
 		);
+#if WITH_EDITOR
+		/**
+		 * Save prefab data for editor use, reuse data of clean objects from InOutCache, and fill InOutCache with this save's data.
+		 * If LPrefab.IncrementalSaveCheck is 1, do a full save too and compare the result, use full save's data if different.
+		 */
+		static void SavePrefabIncremental(AActor* RootActor, ULPrefab* InPrefab
+			, TMap<UObject*, FGuid>& OutMapObjectToGuid, TMap<TObjectPtr<AActor>, FLSubPrefabData>& InSubPrefabMap
+			, FLPrefabIncrementalSaveCache& InOutCache
+		);
+#endif
+		/** Hash of reflected property values of classes' default objects and their default sub objects, to check if archetypes are changed since build data is diffed against them. */
+		static uint32 ComputeArchetypeHash(const TArray<UClass*>& InClasses);
+#if WITH_EDITOR
+		/**
+		 * Generate build data from prefab's editor data directly, without spawn agent actors: property data of every object is read into a block of memory laid out as the object's class (not an UObject), then written with build archive.
+		 * Reference to object in prefab is read as a shared stand-in object of the same class. Stand-ins are created in game thread, so call it in game thread first for a kind of prefab, after that it is safe in any thread for different prefabs, as long as InPrefab and it's referenced assets are kept alive.
+		 * @param OutFailReason	Why the prefab can't be transcoded, eg: has sub prefab or editor only object, or class write native data in Serialize. Use SavePrefab with agent actors for it.
+		 */
+		static bool TranscodeBuildData(ULPrefab* InPrefab, bool InDeltaAgainstArchetype, FLPrefabTranscodedBuildData& OutData, FString& OutFailReason);
+		/** Copy transcoded data to prefab's build data. */
+		static void ApplyTranscodedBuildData(ULPrefab* InPrefab, FLPrefabTranscodedBuildData& InData);
+		/** Forget classes that are found to write native data in Serialize, call it when class may change. */
+		static void ClearTranscodeClassCache();
+#endif
 		
 		/**
-		 * Duplicate actor with hierarchy
+		 * Duplicate actor with hierarchy. If LPrefab.DirectDuplicate is on, property values are copied from source objects directly instead of through byte data.
 		 */
 		static AActor* DuplicateActor(AActor* OriginRootActor, USceneComponent* Parent);
-		/** Prepare one data and duplicate multiple times */
+		/** Prepare one data and duplicate multiple times. Prepared data is not changed by duplicate, so it is safe to duplicate with it inside another duplicate (eg: in Awake). */
 		static bool PrepareDataForDuplicate(AActor* RootActor, FDuplicateActorDataContainer& OutData);
 		static AActor* DuplicateActorWithPreparedData(FDuplicateActorDataContainer& InData, USceneComponent* InParent);
+		/**
+		 * Create InCount copies with prepared data in one call.
+		 * @param InParents	Parent of every copy's root actor. Can be empty (no parent), or only one (all copies use the same parent), or InCount.
+		 * @param InTransforms	Relative transform of every copy's root actor. Can be empty (keep source's transform), or InCount.
+		 * @param OutRoots	Root actor of every copy, null if the copy fail.
+		 */
+		static void DuplicateActorWithPreparedDataBatch(FDuplicateActorDataContainer& InData, int32 InCount, TArrayView<USceneComponent* const> InParents, TArrayView<const FTransform> InTransforms, TArray<AActor*>& OutRoots);
 		/**
 		 * Editor version, duplicate actor with hierarchy, will also concern sub prefab.
 		 */
@@ -248,9 +643,54 @@ namespace LPrefabSystem8
 			, const FGuid& InParentDeserializationSessionId
 			, TMap<FGuid, TObjectPtr<UObject>>& InMapGuidToObject
 			, const TFunction<void(AActor*, const TMap<FGuid, TObjectPtr<UObject>>&, const TMap<TObjectPtr<UObject>, FGuid>&, const TArray<AActor*>&, const TArray<UActorComponent*>&)>& InOnSubPrefabFinishDeserializeFunction
+			, FLPrefabApplyRecord* InApplyRecord = nullptr
 		);
+		/**
+		 * LoadPrefab and record all applied property data, so the same data can be applied again with ReapplyPrefabState.
+		 * @param OutCreatedActors	All created actors, include sub prefab's actors.
+		 * @param InDispatchAwake	false to skip Awake, eg: pre-warm pool instance, Awake will be called when acquire it.
+		 */
+		static AActor* LoadPrefabWithApplyRecord(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent, const FTransform& InTransform
+			, FLPrefabApplyRecord& OutApplyRecord, TArray<AActor*>& OutCreatedActors, bool InDispatchAwake = true);
+		/**
+		 * Apply recorded property data to objects again, will not create or destroy any object, will not call PostSetPropertiesOnActor and Awake.
+		 * @param OutChangedObjects	If not null, collect objects that any property value is different after apply, so only they need PostSetPropertiesOnActor.
+		 */
+		static void ReapplyPrefabState(UWorld* InWorld, const FLPrefabApplyRecord& InApplyRecord, TSet<UObject*>* OutChangedObjects = nullptr);
+		/** Call ILPrefabInterface's Awake (or EditorAwake if not game world) on actors and their components. */
+		static void DispatchAwake(UWorld* InWorld, const TArray<AActor*>& InActors);
+		/** Same as InClass->ImplementsInterface(ULPrefabInterface::StaticClass()), but cached per class. Game thread only. */
+		static bool ImplementsPrefabInterface(const UClass* InClass);
+		/** Clear the cache of ImplementsPrefabInterface, call it when class may change, eg: hot reload, blueprint compile. */
+		static void ClearPrefabInterfaceCache();
 
 		static void PostSetPropertiesOnActor(UActorComponent* InComp);
+		/** Same fixup as PostSetPropertiesOnActor, but for component that is not registered yet, so no need to re-register it. */
+		static void PostSetPropertiesBeforeRegister(UActorComponent* InComp);
+		/**
+		 * Parse prefab's binary data to FLPrefabSaveData. Result is immutable and shared, use ULPrefab::GetParsedSaveData to get the cached one.
+		 * @param InForEditorOrRuntimeUse true- parse BinaryData (editor only), false- parse BinaryDataForBuild
+		 */
+		static TSharedPtr<const FLPrefabSaveData, ESPMode::ThreadSafe> ParseSaveData(ULPrefab* InPrefab, bool InForEditorOrRuntimeUse);
+		/**
+		 * Parse binary data to FLPrefabSaveData, only touch the bytes, so it is safe to call in any thread.
+		 * @param InDataVersion	Layout version of the data, ULPrefab::PrefabVersion for editor data, ULPrefab::GetBuildDataLayoutVersion for build data.
+		 */
+		static TSharedPtr<const FLPrefabSaveData, ESPMode::ThreadSafe> ParseSaveData(const TArray<uint8>& InData, bool InForEditorOrRuntimeUse, uint16 InDataVersion);
+		/**
+		 * Load prefab across multiple frames, every frame only spend limited time on it. Awake is called after the whole hierarchy is loaded.
+		 * @param InFrameBudgetMs	Max time in milliseconds to spend on the load in one frame, at least one actor or object is processed in one frame.
+		 * @param InOnComplete	Called after load is complete (after Awake), parameter is the loaded root actor, or null if fail.
+		 */
+		static void LoadPrefabAsync(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent, float InFrameBudgetMs, const TFunction<void(AActor*)>& InOnComplete);
+		/** Add objects created during deserialize to reference collector, so they will not be garbage collected while loading across frames. */
+		void AddReferencedObjects(FReferenceCollector& Collector);
+		/**
+		 * Load the sub prefab which is deferred by the placeholder, apply override parameters, and read parent prefab's properties which reference it.
+		 * @param OutRootActor	Sub prefab's root actor, null if fail.
+		 * @return false if the placeholder's prefab is not finish load yet, can try it later.
+		 */
+		static bool RealizeDeferredSubPrefab(ULPrefabDeferredSubPrefabComponent* InPlaceholder, AActor*& OutRootActor);
 	private:
 		struct FComponentDataStruct
 		{
@@ -264,7 +704,7 @@ namespace LPrefabSystem8
 		TArray<AActor*> AllActors;
 
 		TMap<TObjectPtr<AActor>, FLSubPrefabData> SubPrefabMap;
-		TArray<AActor*> SubPrefabActorArray;
+		TSet<AActor*> SubPrefabActorArray;
 		TArray<FComponentDataStruct> SubPrefabRootComponents;
 		//this collection will collect all actors of this prefab, and root actor of sub prefab
 		TArray<AActor*> TrySerializeActorArray;
@@ -283,14 +723,110 @@ namespace LPrefabSystem8
 
 		//serialize actor
 		void SerializeActor(AActor* RootActor, ULPrefab* InPrefab);
-		void SerializeActorArray(TMap<FGuid, FGuid>& MapSceneComponentToParent, TArray<FLGUIActorSaveData>& SavedActors, TMap<FGuid, TArray<uint8>>& SavedObjectData);
-		void SerializeObjectArray(TMap<FGuid, FLGUIObjectSaveData>& ObjectSaveDataArray, TMap<FGuid, TArray<uint8>>& SavedObjectData, TMap<FGuid, FGuid>& MapSceneComponentToParent);
+		void SerializeActorArray(FLPrefabSaveData& OutData);
+		void SerializeObjectArray(FLPrefabSaveData& OutData);
 		void SerializeActorToData(AActor* RootActor, FLPrefabSaveData& OutData);
+		/** Fill AwakeObjectIndices for compact build data, leave it invalid if any object need Awake can't be indexed. */
+		void CollectAwakeObjectIndices(FLPrefabSaveData& OutData);
+		/** Fill AwakeComponentCounts from saved objects: components whose outer is the actor. InSerializer is the one that write InOutData's class index. */
+		static void CollectAwakeComponentCounts(LPrefabSystem::ActorSerializerBase& InSerializer, FLPrefabSaveData& InOutData);
+		/** Write object data with WriterOrReaderFunction, or reuse data from IncrementalSaveCache if object is clean. */
+		void WriteObjectData(UObject* InObject, const FGuid& InGuid, bool InIsSceneComponent, FLPrefabSaveData& OutData);
+		/** Valid when save incremental. Entries of this save are collected in NewIncrementalEntries. */
+		FLPrefabIncrementalSaveCache* IncrementalSaveCache = nullptr;
+		TMap<FGuid, FLPrefabIncrementalSaveCache::FEntry> NewIncrementalEntries;
+		int32 IncrementalReusedCount = 0;
+		static void SavePrefabInternal(AActor* RootActor, ULPrefab* InPrefab
+			, TMap<UObject*, FGuid>& OutMapObjectToGuid, TMap<TObjectPtr<AActor>, FLSubPrefabData>& InSubPrefabMap
+			, bool InForEditorOrRuntimeUse
+			, bool InDeltaAgainstArchetype
+			, FLPrefabIncrementalSaveCache* InIncrementalSaveCache
+		);
 		//deserialize actor
+		void SetupForPrefab(ULPrefab* InPrefab);
+		/** Clear writer/reader functions, so ApplyObjectData/ApplyOverrideParameterData use the default reader without allocating a TFunction for every load. */
+		void SetupReaderFunctions();
+		/** Read object data with WriterOrReaderFunction if set, or with default reader. */
+		void ApplyObjectData(UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent);
+		/** Read override parameter data with WriterOrReaderFunctionForSubPrefabOverride if set, or with default reader. */
+		void ApplyOverrideParameterData(UObject* InObject, TArray<uint8>& InOutBuffer, const TArray<FName>& InOverridePropertyNames);
 		AActor* DeserializeActor(USceneComponent* Parent, ULPrefab* InPrefab, const TFunction<void()>& InCallbackBeforeDeserialize, bool ReplaceTransform = false, FVector InLocation = FVector::ZeroVector, FQuat InRotation = FQuat::Identity, FVector InScale = FVector::OneVector);
-		AActor* DeserializeActorFromData(FLPrefabSaveData& SaveData, USceneComponent* Parent, bool ReplaceTransform, FVector InLocation, FQuat InRotation, FVector InScale);
-		AActor* GenerateActorArray(TArray<FLGUIActorSaveData>& SavedActors, TMap<FGuid, FLGUIObjectSaveData>& InSavedObjects, TMap<FGuid, FGuid>& MapSceneComponentToParent, FGuid ParentGuid);
-		void GenerateObjectArray(TMap<FGuid, FLGUIObjectSaveData>& SavedObjects, TMap<FGuid, FGuid>& MapSceneComponentToParent);
+		AActor* DeserializeActorFromData(const FLPrefabSaveData& SaveData, USceneComponent* Parent, bool ReplaceTransform, FVector InLocation, FQuat InRotation, FVector InScale);
+		/** Deserialize is split into steps, use StepDeserialize to run them. DeserializeActor and DeserializeActorFromData just run all steps at once. */
+		void BeginDeserializeActor(USceneComponent* Parent, ULPrefab* InPrefab, const TFunction<void()>& InCallbackBeforeDeserialize, bool ReplaceTransform, FVector InLocation, FQuat InRotation, FVector InScale);
+		void BeginDeserializeActorFromData(const FLPrefabSaveData& SaveData, USceneComponent* Parent, bool ReplaceTransform, FVector InLocation, FQuat InRotation, FVector InScale);
+		/**
+		 * Run deserialize steps until all finished or reach the deadline.
+		 * @param InDeadline	Deadline in FPlatformTime::Seconds, MAX_dbl for no limit.
+		 * @return true if all steps are finished.
+		 */
+		bool StepDeserialize(double InDeadline);
+		void EndDeserializeActor();
+		void GenerateActor(const FLGUIActorSaveData& InActorData, int32 InActorIndex, FGuid ParentGuid);
+		void BeginGenerateSubPrefab(const FLGUIActorSaveData& InActorData, int32 InActorIndex);
+		void FinishGenerateSubPrefab(const FLGUIActorSaveData& InActorData);
+		/** Create placeholder for sub prefab which is marked as deferred load. */
+		void GenerateDeferredSubPrefab(const FLGUIActorSaveData& InActorData, int32 InActorIndex);
+		void GenerateObject(const FGuid& ObjectGuid, const FLGUIObjectSaveData& ObjectData);
+		void AttachComponent(const FComponentDataStruct& CompData);
+		/** Fill ObjectsByIndex from save data's ObjectGuids, so object reference in compact data can be resolved by index. */
+		void BuildObjectIndexTable(const FLPrefabSaveData& InSaveData);
+		void FinishDeserialize();
+		/** Dispatch Awake with save data's AwakeObjectIndices, return false if it is not available. */
+		bool DispatchAwakeFromSaveData();
+		/** Awake of actor and its components, game world only. */
+		static void DispatchActorAwake(AActor* InActor);
+
+		enum class EDeserializeStep : uint8
+		{
+			GenerateActors,
+			GenerateObjects,
+			ApplyProperties,
+			ApplyOverrideParameters,
+			AttachComponents,
+			PostSetProperties,
+			/** Replace PostSetProperties when bRegisterComponentsOnce */
+			RegisterComponents,
+			Finish,
+			Done,
+		};
+		/** Sub prefab that is being loaded by steps. */
+		struct FSubPrefabLoadContext
+		{
+			const FLGUIActorSaveData* ActorData = nullptr;
+			int32 ActorIndex = INDEX_NONE;
+			FLSubPrefabData SubPrefabData;
+			TMap<FGuid, FGuid> MapObjectGuidFromSubPrefabToParentPrefab;
+			TMap<FLGUISubPrefabObjectUniqueIdSaveData, FGuid> MapObjectIdToNewlyCreatedId;
+			bool bAnyGuidFrom_MapObjectIdToNewlyCreatedId = false;
+			TSharedPtr<ActorSerializer> Serializer;
+		};
+		struct FDeserializeState
+		{
+			/** Hold a reference, so the data is still valid even if prefab's cache is cleared during load */
+			TSharedPtr<const FLPrefabSaveData, ESPMode::ThreadSafe> SharedSaveData;
+			const FLPrefabSaveData* SaveData = nullptr;
+			/** Valid if deserialize from prefab asset */
+			ULPrefab* Prefab = nullptr;
+			USceneComponent* Parent = nullptr;
+			bool ReplaceTransform = false;
+			FVector Location = FVector::ZeroVector;
+			FQuat Rotation = FQuat::Identity;
+			FVector Scale = FVector::OneVector;
+
+			EDeserializeStep Step = EDeserializeStep::Done;
+			/** Index of actor/component/parameter in current step */
+			int32 Cursor = 0;
+			TSharedPtr<FSubPrefabLoadContext> SubPrefabContext;
+
+			AActor* CreatedRootActor = nullptr;
+			FDateTime StartTime;
+			FDateTime StepStartTime;
+		};
+		FDeserializeState DeserializeState;
+		/** Parsed data of the prefab given by caller, BeginDeserializeActor use it instead of prefab's cache. */
+		TSharedPtr<const FLPrefabSaveData, ESPMode::ThreadSafe> GivenSaveData;
+		class FAsyncLoadTask;
 
 		/** Mark of this deserialization session. If nested prefab, this is still the root prefab's value. */
 		FGuid DeserializationSessionId = FGuid();
@@ -308,6 +844,57 @@ namespace LPrefabSystem8
 		TArray<FSubPrefabObjectOverideData> SubPrefabObjectOverrideData;
 
 		TFunction<void(AActor*)> CallbackBeforeAwake = nullptr;
+		/** Replace reference assets and classes after SetupForPrefab fill reference lists, for LoadPrefabWithReplacement. */
+		const TMap<UObject*, UObject*>* ReplaceAssetMap = nullptr;
+		const TMap<UClass*, UClass*>* ReplaceClassMap = nullptr;
+
+		/** Valid if need to record applied property data. */
+		FLPrefabApplyRecord* ApplyRecord = nullptr;
+		int32 ApplyRecordScopeIndex = INDEX_NONE;
+		bool bDispatchAwake = true;
+
+		/**
+		 * Components are not registered until all properties are applied and attachment tree is built with SetupAttachment, then every component is registered once in parent-to-child order.
+		 * Only for game world, sub prefab use the same value as parent.
+		 */
+		bool bRegisterComponentsOnce = false;
+		/** Default components of spawned actors, auto register is disabled before FinishSpawning, they are registered in RegisterComponents step. */
+		TArray<UActorComponent*> AutoRegisterDisabledComponents;
+		/** Components sorted parent before child, for RegisterComponents step. */
+		TArray<UActorComponent*> ComponentsToRegister;
+		/** Root actor is already attached to parent and set transform before register, no need to do it in FinishDeserialize. */
+		bool bRootTransformSetBeforeRegister = false;
+		static bool CanRegisterComponentsOnce(UWorld* InWorld);
+		void PrepareRegisterComponents();
+
+		/** Sub prefab marked as deferred load will create placeholder instead, only for LoadPrefab in game world. */
+		bool bCanDeferSubPrefab = false;
+		/** Valid if any sub prefab is deferred in this load. */
+		TSharedPtr<FDeferredSubPrefabScope> DeferredSubPrefabScope;
+		int32 DeferredSubPrefabCount = 0;
+		static bool CanDeferSubPrefab(UWorld* InWorld);
+
+		/** Override parameter data only contains override properties, see ELPrefabVersion::TargetedOverrideParameter. */
+		bool bTargetedOverrideParameter = false;
+		/** Object count that can't diff against archetype and stored with full data. */
+		int32 DeltaFallbackObjectCount = 0;
+		/** Check if runtime created object will get the same archetype as InObject, if not then InObject can't diff against it's archetype. */
+		static bool CanDiffAgainstArchetype(UObject* InObject);
+		/**
+		 * Set property values back to archetype's value, so delta data can be applied on a used object. Instanced object reference and excluded properties are kept.
+		 */
+		static void RestoreArchetypeValues(UObject* InObject, const TSet<FName>& InExcludeProperties);
+
+		/**
+		 * Direct duplicate: source objects only collect objects in hierarchy and leave buffer empty, created objects copy property values from source with FProperty::CopyCompleteValue, then reference to source hierarchy is replaced.
+		 * Class that write native data in Serialize still write and read byte data.
+		 */
+		void WriteObjectForDirectDuplicate(UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent);
+		void ReadObjectForDirectDuplicate(UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent);
+		TMap<UObject*, UObject*> MapDirectDuplicateSourceToTarget;
+		TMap<UObject*, UObject*> MapDirectDuplicateTargetToSource;
+		/** Copy of prepared data's serializer with duplicate reader, for one duplicate. */
+		static TUniquePtr<ActorSerializer> MakeDuplicateInstance(const FDuplicateActorDataContainer& InData);
 
 		/**
 		 * @param	AActor*		SubPrefab's root actor
@@ -330,8 +917,22 @@ namespace LPrefabSystem8
 		 * @param	TArray<FName>&	Member properties to filter
 		 */
 		TFunction<void(UObject*, TArray<uint8>&, const TArray<FName>&)> WriterOrReaderFunctionForSubPrefabOverride = nullptr;
+
+		/** Default reader of ApplyObjectData, created when read first object and reused for every object. Not copied with serializer, because reader hold reference to its serializer. */
+		struct FReusableObjectReader
+		{
+			TArray<uint8> Buffer;
+			TUniquePtr<LPrefabSystem::FLPrefabObjectReader> Reader;
+			bool bIsReading = false;
+			FReusableObjectReader();
+			FReusableObjectReader(const FReusableObjectReader& Other);
+			FReusableObjectReader& operator=(const FReusableObjectReader& Other);
+			~FReusableObjectReader();
+		};
+		FReusableObjectReader ReusableObjectReader;
 	};
 
+	/** Data of PrepareDataForDuplicate. Serializer only hold resolved reference lists as template, every duplicate use a copy of it, so containers are independent of each other. */
 	struct FDuplicateActorDataContainer
 	{
 		FLPrefabSaveData ActorData;
@@ -14,6 +14,25 @@ class ULPrefabWorldSubsystem;
 
 namespace LPrefabSystem
 {
+	/** Reference lookup made by writer when write an object, recorded for incremental save, so object's data can be reused if nothing changed. */
+	struct FLPrefabWriteRecordItem
+	{
+		enum class EType : uint8
+		{
+			Asset,
+			Class,
+			Name,
+			CollectObject,
+		};
+		EType Type = EType::Asset;
+		/** Index in reference list. For CollectObject, 1 if object is collected, 0 if not. */
+		int32 Index = INDEX_NONE;
+		TWeakObjectPtr<UObject> Object;
+		FName Name;
+		/** Guid of collected object */
+		FGuid Guid;
+	};
+
 	/*
 	 * serialize/deserialize actor with hierarchy
 	 */
@@ -40,16 +59,26 @@ namespace LPrefabSystem
 		TArray<AActor*> WillSerializeActorArray;
 		//Common UObjects that need to serialize. Outer object should stay at lower index then sub object, so when deserialize the outer object will created ealier, then the sub object can use the correct outer.
 		TArray<UObject*> WillSerializeObjectArray;
+		/** Add actor to WillSerializeActorArray and keep the lookup set in sync. Always use this instead of adding to the array directly. */
+		void AddWillSerializeActor(AActor* InActor);
+		bool IsWillSerializeActor(const UObject* InObject)const { return WillSerializeActorSet.Contains(InObject); }
+		bool IsWillSerializeObject(const UObject* InObject)const { return WillSerializeObjectSet.Contains(InObject); }
+		/** Empty WillSerializeActorArray and WillSerializeObjectArray with their lookup set. */
+		void EmptyWillSerializeArray();
 		bool ObjectBelongsToThisPrefab(UObject* InObject);
 
 		const TSet<FName>& GetSceneComponentExcludeProperties();
+		/** Scene component's exclude properties, or empty set for other objects. Return a static set, so no copy is needed for every object. */
+		const TSet<FName>& GetExcludeProperties(bool InIsSceneComponent);
 		bool CollectObjectToSerailize(UObject* Object, FGuid& OutGuid);
-		//Check object and it's up outer to tell if it is trash
+		//Check object and it's up outer to tell if it is trash (garbage, or replaced by newer version when blueprint recompile)
 		bool ObjectIsTrash(UObject* InObject);
-		//find id from list, if not then create
+		//find id from list, if not then create. Use hash index, so collecting reference is linear time
 		int32 FindOrAddAssetIdFromList(UObject* AssetObject);
 		int32 FindOrAddClassFromList(UClass* Class);
 		int32 FindOrAddNameFromList(const FName& Name);
+		/** find dense index of object guid, if not then create. For compact build data. */
+		int32 FindOrAddObjectIndex(const FGuid& Guid);
 		//find object by id
 		UObject* FindAssetFromListByIndex(int32 Id);
 		UClass* FindClassFromListByIndex(int32 Id);
@@ -68,6 +97,53 @@ namespace LPrefabSystem
 		uint32 ArGameNetVer = 0;
 		TMap<FGuid, TObjectPtr<UObject>> MapGuidToObject;
 		TMap<UObject*, FGuid> MapObjectToGuid;
+		/** Write object reference as dense index instead of guid, for compact build data. */
+		bool bWriteObjectIndex = false;
+		/**
+		 * Property data of build data is diffed against archetype. Archive use tagged (or unversioned) property serialization instead of binary, because only that skip properties same as archetype.
+		 * Writer still need ArNoDelta = false to do the diff, otherwise every property is written.
+		 */
+		bool bDeltaAgainstArchetype = false;
+		/**
+		 * Property data of build data use versioned tagged property serialization, so a member property can be read alone by name (see OnlyReadPropertyNames).
+		 * Build data is written this way when prefab has deferred sub prefab, because properties that reference it are read again after realize.
+		 */
+		bool bTaggedPropertyData = false;
+		/** Valid when only these member properties need to be read, other properties are skipped. Only work if CanReadPropertiesByName. */
+		const TArray<FName>* OnlyReadPropertyNames = nullptr;
+		/** Can read member property alone by name with OnlyReadPropertyNames. Binary property data can't skip properties. */
+		bool CanReadPropertiesByName()const { return bIsEditorOrRuntime || bTaggedPropertyData; }
+		TArray<FGuid> ObjectIndexToGuid;
+		TMap<FGuid, int32> MapGuidToObjectIndex;
+		/** Object by dense index, to resolve object reference in compact build data. Objects are also in MapGuidToObject, so no need to add reference for them. */
+		TArray<UObject*> ObjectsByIndex;
+		/** Valid when need to know which member property has object reference that can't be resolved when reading. */
+		TArray<FName>* UnresolvedObjectReferenceProperties = nullptr;
+		/** Called by reader when object reference can't be resolved, collect current member property into UnresolvedObjectReferenceProperties. */
+		void CollectUnresolvedObjectReference(const FArchive& InReader);
+		/** Valid when writing an object for incremental save, FindOrAdd***FromList and CollectObjectToSerailize are recorded into it. */
+		TArray<FLPrefabWriteRecordItem>* WriteRecord = nullptr;
+		/**
+		 * Do the recorded lookups again in the same order, so reference lists and collected objects are same as writing the object again.
+		 * @return false if any result is different from the record, or any recorded object is destroyed, then the recorded data is out of date and the object need to be written again.
+		 */
+		bool ReplayWriteRecord(const TArray<FLPrefabWriteRecordItem>& InRecord);
+
+	private:
+		bool CollectObjectToSerailizeInternal(UObject* Object, FGuid& OutGuid);
+		/** Lookup set of WillSerializeActorArray and WillSerializeObjectArray, so membership check is constant time */
+		TSet<const UObject*> WillSerializeActorSet;
+		TSet<const UObject*> WillSerializeObjectSet;
+		/**
+		 * Hash index of ReferenceAssetList/ReferenceClassList/ReferenceNameList, map item to it's first index in list.
+		 * The lists can be assigned directly, so items after Indexed***Count are indexed when next FindOrAdd***FromList is called.
+		 */
+		TMap<UObject*, int32> MapAssetToIndex;
+		TMap<UClass*, int32> MapClassToIndex;
+		TMap<FName, int32> MapNameToIndex;
+		int32 IndexedAssetCount = 0;
+		int32 IndexedClassCount = 0;
+		int32 IndexedNameCount = 0;
 
 	protected:
 		UWorld* TargetWorld = nullptr;//world that need to spawn actor
@@ -34,4 +34,10 @@ public:
 	 */
 	UFUNCTION(BlueprintNativeEvent, BlueprintCallable, Category = LPrefab)
 		void EditorAwake();
+	/**
+	 * Called when an instance is acquired from LPrefabPoolSubsystem again, after it's properties are restored to prefab state, before Awake.
+	 * Use this to reset state that is not restored by prefab pool.
+	 */
+	UFUNCTION(BlueprintNativeEvent, BlueprintCallable, Category = LPrefab)
+		void OnReuse();
 };
\ No newline at end of file
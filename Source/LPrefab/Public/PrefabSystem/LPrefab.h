@@ -4,6 +4,9 @@
 #include "CoreMinimal.h"
 #include "Misc/NetworkVersion.h"
 #include "Engine/EngineBaseTypes.h"
+#include "Serialization/BulkData.h"
+#include "Tasks/Task.h"
+#include "UObject/StrongObjectPtr.h"
 #include "LPrefab.generated.h"
 
 #define LPREFAB_SERIALIZER_NEWEST_INCLUDE "PrefabSystem/ActorSerializer8.h"
@@ -42,19 +45,62 @@ enum class ELPrefabVersion : uint16
 	 *		so the guid can persist.
 	 */
 	NewObjectOnNestedPrefab = 8,
+	/** Editor data store deferred load flag of sub prefabs as "DeferredSubPrefabs" record after object data. Same serializer as NewObjectOnNestedPrefab. */
+	DeferredSubPrefab = 9,
 
 	/** new version must be added before this line. */
 	MAX_NO_USE,
 	NEWEST = MAX_NO_USE - 1,
+
+	/**
+	 * Versions below only describe layout of BinaryDataForBuild (stored in ULPrefab::BuildDataVersion), editor data and PrefabVersion are not affected.
+	 * Build data is always regenerated when cook, so these versions don't need upgrade for old prefabs.
+	 */
+	BuildDataVersionStart = 1000,
+	/** Every actor/component/object is stored as dense int32 index instead of FGuid, object reference is resolved by array index. */
+	CompactBuildData = 1001,
+	/**
+	 * Property data is diffed against archetype (class default object, or default sub object's archetype), properties same as archetype are not stored.
+	 * Based on CompactBuildData layout. ULPrefab::ArchetypeHashForBuild records the archetypes it was diffed against.
+	 * Data of this version is written with binary property serialization which ignore the diff, so it is read as full data. Since FlagsBuildData delta data use tagged (or unversioned) property serialization.
+	 */
+	DeltaBuildData = 1002,
+	/**
+	 * Sub prefab's override parameter data only store the override properties, each with name and data size, instead of the whole object serialization.
+	 * Based on DeltaBuildData layout.
+	 */
+	TargetedOverrideParameter = 1003,
+	/**
+	 * Scene component's parent is stored in actor/object record instead of a separate child-to-parent map, deferred flag is stored in sub prefab's actor record.
+	 * Optional parts (Awake list, delta and targeted override parameter) are declared by a flags field after ObjectGuids, instead of checking the end of data or this version number.
+	 */
+	FlagsBuildData = 1004,
+
+	/** new build data version must be added before this line. */
+	BUILD_DATA_MAX_NO_USE,
+	BUILD_DATA_NEWEST = BUILD_DATA_MAX_NO_USE - 1,
 };
 
 /**
  * Current prefab system version
  */
 #define LPREFAB_CURRENT_VERSION (uint16)ELPrefabVersion::NEWEST
+/**
+ * Oldest prefab version that can be loaded by LPREFAB_SERIALIZER_NEWEST_NAMESPACE
+ */
+#define LPREFAB_SERIALIZER_NEWEST_MIN_VERSION (uint16)ELPrefabVersion::NewObjectOnNestedPrefab
+/**
+ * Current layout version of BinaryDataForBuild
+ */
+#define LPREFAB_CURRENT_BUILD_DATA_VERSION (uint16)ELPrefabVersion::BUILD_DATA_NEWEST
 
 class ULPrefab;
 class ULPrefabHelperObject;
+struct FStreamableHandle;
+namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
+{
+	struct FLPrefabSaveData;
+}
 
 USTRUCT(NotBlueprintType)
 struct LPREFAB_API FLPrefabOverrideParameterData
@@ -107,6 +153,8 @@ public:
 	UPROPERTY(VisibleAnywhere, Category = "LPrefab")FString OverallVersionMD5;
 	/** For level editor, true means it will not show a dialog box and do the update if detect new version. */
 	UPROPERTY(VisibleAnywhere, Category = "LPrefab")bool bAutoUpdate = true;
+	/** For prefab editor, true means this sub prefab is not loaded together with parent prefab in game, a placeholder component is created instead, call Realize on it to load the sub prefab. */
+	UPROPERTY(VisibleAnywhere, Category = "LPrefab")bool bDeferLoad = false;
 	/** Temporary color for quick identify in editor */
 	FLinearColor EditorIdentifyColor;
 #endif
@@ -147,6 +195,62 @@ public:
 
 DECLARE_DYNAMIC_DELEGATE_OneParam(FLPrefab_LoadPrefabCallback, AActor*, LoadedRootActor);
 
+/**
+ * Handle returned by ULPrefab::RequestAsyncLoad, keep it alive to keep the prefab's dependencies loaded.
+ * Dependencies are not released until both this handle and all loaded instances (which reference the assets themselves) are gone.
+ */
+struct LPREFAB_API FLPrefabStreamingHandle
+{
+public:
+	bool IsLoadComplete()const { return bLoadComplete; }
+	bool WasCanceled()const { return bCanceled; }
+	/** Loaded percentage of all dependencies, include sub prefab's. */
+	float GetProgress()const;
+	/** Cancel the load, OnReady will not be called. */
+	void CancelHandle();
+	/** Release the dependencies, so they can be unloaded when no instance is alive. */
+	void ReleaseHandle();
+private:
+	friend class ULPrefab;
+	TArray<TSharedPtr<FStreamableHandle>> StreamableHandles;
+	/** Prefabs (include sub prefabs) already requested by this handle */
+	TSet<TWeakObjectPtr<ULPrefab>> RequestedPrefabs;
+	TFunction<void()> OnReady;
+	int32 PendingRequestCount = 0;
+	int32 Priority = 0;
+	bool bLoadComplete = false;
+	bool bCanceled = false;
+};
+
+/**
+ * Handle returned by ULPrefab::CreateLoadRequest. Prefab's data is parsed in background thread since the request is created,
+ * then LoadPrefab only do the game thread work (spawn actors and apply properties) with the parsed data.
+ * Keep the request alive to keep the prefab and its parsed data. Must be released in game thread.
+ */
+struct LPREFAB_API FLPrefabLoadRequest
+{
+public:
+	ULPrefab* GetPrefab()const { return Prefab.Get(); }
+	/** Is background parse done, LoadPrefab will not wait for it. */
+	bool IsParseComplete()const { return SaveData.IsValid() || !ParseTask.IsValid() || ParseTask.IsCompleted(); }
+	/** Block until background parse is done. */
+	void WaitParseComplete()const;
+	/**
+	 * LoadPrefab with the parsed data, wait for the parse if not done yet. Can be called multiple times.
+	 * Same as ULPrefab::LoadPrefab.
+	 */
+	AActor* LoadPrefab(UWorld* InWorld, USceneComponent* InParent, bool SetRelativeTransformToIdentity = false, const TFunction<void(AActor*)>& InCallbackBeforeAwake = nullptr);
+private:
+	friend class ULPrefab;
+	TStrongObjectPtr<ULPrefab> Prefab;
+	/** Parse in progress when the request is created. Its result is moved to SaveData when LoadPrefab. */
+	UE::Tasks::TTask<TSharedPtr<const LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabSaveData, ESPMode::ThreadSafe>> ParseTask;
+	/** Parsed data that LoadPrefab use, hold by the request, so it is not released as idle before LoadPrefab. */
+	TSharedPtr<const LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabSaveData, ESPMode::ThreadSafe> SaveData;
+	/** Old version prefab is parsed by its own serializer, LoadPrefab just call ULPrefab::LoadPrefab. */
+	bool bUsePrefabLoad = false;
+};
+
 /**
  * Similar to Unity3D's Prefab. Store actor and it's hierarchy and serailize to asset, deserialize and restore when needed.
  * If you don't want to package the prefab for runtime (only use in editor), you can put the prefab in a folder named "EditorOnly".
@@ -193,6 +297,36 @@ public:
 	/** The time point when create/save this prefab. Use UtcNow from prefab version 6. */
 	UPROPERTY(VisibleAnywhere, Category = "LPrefab")
 		FDateTime CreateTime;
+	/**
+	 * When cooking, break all nested sub prefabs and store their actors (with override parameters already applied) directly in this prefab's runtime data, so loading at runtime don't need to recurse into sub prefabs.
+	 * Editor data always keep the nested structure. Uncheck this if you need sub prefab's own data at runtime for this prefab.
+	 * Sub prefab marked as deferred load is not flattened, because it is loaded later from its own data.
+	 * This changes runtime structure of the loaded prefab: flattened sub prefab's objects get new guids, and the loaded prefab has no sub prefab in it's sub prefab map, so runtime code that look up sub prefab or it's override parameter will not find it.
+	 */
+	UPROPERTY(EditAnywhere, Category = "LPrefab", AdvancedDisplay)
+		bool bFlattenSubPrefabsWhenCook = false;
+	/**
+	 * When cooking, store reference assets and classes of runtime data as soft references, so loading this prefab asset don't load all its dependencies synchronously.
+	 * Use RequestAsyncLoad to stream the dependencies in before LoadPrefab, otherwise not loaded dependencies will be loaded synchronously in LoadPrefab.
+	 */
+	UPROPERTY(EditAnywhere, Category = "LPrefab", AdvancedDisplay)
+		bool bSoftReferenceWhenCook = false;
+	/**
+	 * When cooking, replace leaf actors that only have a static mobility StaticMeshComponent with instances: actors with same parent, mesh, materials and component properties are merged into one InstancedStaticMeshComponent on the parent actor.
+	 * Actors referenced by other objects (include sequence binding) and sub prefab's actors (if not flattened) are kept. Merged actors don't exist at runtime, so don't use this if you need to find them by name or tag.
+	 * Only work when this prefab is always flattened: a parent prefab that use this prefab as sub prefab without flatten it (or defer load it) find this prefab's objects by guid at runtime, then merge is skipped with a warning. This is checked with asset registry, parent prefab saved by old version need to be saved again.
+	 */
+	UPROPERTY(EditAnywhere, Category = "LPrefab", AdvancedDisplay)
+		bool bMergeStaticMeshesWhenCook = false;
+	/** Use HierarchicalInstancedStaticMeshComponent instead of InstancedStaticMeshComponent for merged static meshes, for culling and LOD per cluster of instances. */
+	UPROPERTY(EditAnywhere, Category = "LPrefab", AdvancedDisplay, meta = (EditCondition = "bMergeStaticMeshesWhenCook"))
+		bool bMergeUseHierarchicalInstances = false;
+	/** Sub prefabs in editor data, value is true if any instance of it is defer load. Recorded when save, for asset registry tag of sub prefabs that this prefab load runtime data of. */
+	UPROPERTY()
+		TMap<FSoftObjectPath, bool> SubPrefabDeferLoadRecord;
+	/** False if saved before SubPrefabDeferLoadRecord exist. */
+	UPROPERTY()
+		bool bHasSubPrefabDeferLoadRecord = false;
 #endif
 	/** Prefab system's version when creating this prefab */
 	UPROPERTY()
@@ -227,11 +361,36 @@ public:
 	/** build version for ReferenceNameList */
 	UPROPERTY()
 		TArray<FName> ReferenceNameListForBuild;
+	/** soft reference version of ReferenceAssetListForBuild, used when bSoftReferenceWhenCook */
+	UPROPERTY()
+		TArray<TSoftObjectPtr<UObject>> SoftReferenceAssetListForBuild;
+	/** soft reference version of ReferenceClassListForBuild, used when bSoftReferenceWhenCook */
+	UPROPERTY()
+		TArray<TSoftClassPtr<UObject>> SoftReferenceClassListForBuild;
 	/**
 	 * serialized data for publish, not contain property name and editor only property. much more faster than BinaryData when deserialize
 	 */
 	UPROPERTY()
 		TArray<uint8> BinaryDataForBuild;
+	/** Layout version of BinaryDataForBuild, ELPrefabVersion::CompactBuildData or newer, or prefab version if it is not compact. 0 means same layout as PrefabVersion. */
+	UPROPERTY()
+		uint16 BuildDataVersion = 0;
+	/** Hash of archetypes that BinaryDataForBuild is diffed against, valid if build data is diffed against archetype (ELPrefabVersion::DeltaBuildData). */
+	UPROPERTY()
+		uint32 ArchetypeHashForBuild = 0;
+	/**
+	 * Keep parsed build data resident after the first load, and parse it right after the prefab asset is loaded. Use it for prefabs that are loaded frequently.
+	 * If not checked, parsed build data is released after it is not used for a while (ULPrefabSettings::BuildDataIdleReleaseTime), and loaded from disk again when needed.
+	 */
+	UPROPERTY(EditAnywhere, Category = "LPrefab", AdvancedDisplay)
+		bool bKeepBuildDataResident = false;
+private:
+	/** Cooked BinaryDataForBuild, stay on disk and only load when parse it. */
+	FByteBulkData BuildDataBulkData;
+	/** Compression format of BuildDataBulkData, NAME_None if not compressed. */
+	FName BuildDataCompressionFormat;
+	int32 BuildDataUncompressedSize = 0;
+public:
 #if WITH_EDITORONLY_DATA
 	UPROPERTY(Instanced, Transient)
 		TObjectPtr<class UThumbnailInfo> ThumbnailInfo;
@@ -243,6 +402,83 @@ private:
 	UPROPERTY(VisibleAnywhere, Transient, Category = "LPrefab")
 		TObjectPtr<ULPrefabHelperObject> PrefabHelperObject = nullptr;
 #endif
+private:
+	/** Parsed BinaryDataForBuild (or BinaryData in editor), shared by all LoadPrefab/LoadSubPrefab of this prefab. Immutable after created. */
+	TSharedPtr<const LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabSaveData, ESPMode::ThreadSafe> ParsedSaveData;
+	bool bParsedSaveDataForEditorOrRuntime = false;
+	SIZE_T ParsedSaveDataSize = 0;
+	/** FPlatformTime::Seconds() when ParsedSaveData is last used */
+	double ParsedSaveDataLastUseTime = 0;
+#if !UE_BUILD_SHIPPING
+	/** ArchetypeHashForBuild that is already checked by CheckArchetypeHashForBuild. */
+	TOptional<uint32> CheckedArchetypeHashForBuild;
+#endif
+	/** Background parse started by CreateLoadRequest (or PostLoad), GetParsedSaveData take its result instead of parse again. */
+	UE::Tasks::TTask<TSharedPtr<const LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabSaveData, ESPMode::ThreadSafe>> ParseTask;
+	bool bParseTaskForEditorOrRuntime = false;
+	/** Start ParseTask if data is not parsed or parsing yet. */
+	void StartParseTask(bool InForEditorOrRuntimeUse);
+	/** Wait for ParseTask and drop its result. */
+	void CancelParseTask();
+public:
+	/** Layout version of build data, BuildDataVersion or PrefabVersion if it is not set. */
+	uint16 GetBuildDataLayoutVersion()const { return BuildDataVersion != 0 ? BuildDataVersion : PrefabVersion; }
+	/** Is there any build data, either resident in BinaryDataForBuild or on disk. */
+	bool HasBinaryDataForBuild()const { return BinaryDataForBuild.Num() > 0 || BuildDataBulkData.GetBulkDataSize() > 0; }
+	/**
+	 * Get BinaryDataForBuild. If build data is not resident, load it from disk (and decompress) into InStorage, and return InStorage.
+	 * Returned data is only valid when InStorage is alive.
+	 */
+	const TArray<uint8>& GetBinaryDataForBuild(TArray<uint8>& InStorage);
+	/** Size of build data on disk (compressed size if compressed), 0 if build data is resident. */
+	int64 GetBinaryDataForBuildSizeOnDisk()const { return BuildDataBulkData.GetBulkDataSize(); }
+	/** Size of build data after decompress. */
+	int32 GetBinaryDataForBuildUncompressedSize()const { return BinaryDataForBuild.Num() > 0 ? BinaryDataForBuild.Num() : BuildDataUncompressedSize; }
+	/** Memory size of resident parsed save data. */
+	SIZE_T GetParsedSaveDataSize()const { return ParsedSaveDataSize; }
+	/** Seconds since parsed save data is last used, negative if not parsed. */
+	double GetParsedSaveDataIdleTime()const { return ParsedSaveData.IsValid() ? FPlatformTime::Seconds() - ParsedSaveDataLastUseTime : -1; }
+	/** Release parsed build data of all prefabs that are not used for ULPrefabSettings::BuildDataIdleReleaseTime, skip prefabs marked bKeepBuildDataResident. Called by ticker. */
+	static bool ReleaseIdleParsedSaveData(float DeltaTime);
+	/**
+	 * Get parsed save data for newest prefab version, parse it if not cached yet.
+	 * @param InForEditorOrRuntimeUse true- data from BinaryData (editor only), false- data from BinaryDataForBuild
+	 */
+	TSharedPtr<const LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabSaveData, ESPMode::ThreadSafe> GetParsedSaveData(bool InForEditorOrRuntimeUse);
+	/** Release the parsed save data. Must be called when BinaryData or BinaryDataForBuild is changed. */
+	void ClearParsedSaveData();
+#if !UE_BUILD_SHIPPING
+	/**
+	 * Warn if archetypes are changed after build data is diffed against them. Only compute hash once for every ArchetypeHashForBuild.
+	 * @param InResolvedClasses	Reference classes already resolved by the loader, so no extra load is needed.
+	 */
+	void CheckArchetypeHashForBuild(const TArray<UClass*>& InResolvedClasses);
+#endif
+	/**
+	 * Start to parse prefab's data in background thread, then LoadPrefab with the returned request don't need to parse in game thread.
+	 * Call it several frames before the actors are needed. If data is already parsed, the request is ready immediately.
+	 */
+	TSharedRef<FLPrefabLoadRequest> CreateLoadRequest();
+	/** Is reference assets and classes of build data stored as soft reference. */
+	bool IsSoftReferenceForBuild()const { return SoftReferenceAssetListForBuild.Num() > 0 || SoftReferenceClassListForBuild.Num() > 0; }
+	/**
+	 * Get reference assets and classes for build data. Soft references are resolved, and loaded synchronously if not loaded yet.
+	 * Returned pointers are not referenced by this prefab in soft reference mode, caller need to keep them alive.
+	 */
+	void GetReferenceListForBuild(TArray<UObject*>& OutAssets, TArray<UClass*>& OutClasses);
+	/**
+	 * Stream in all dependencies of build data (include sub prefab's) in background, InOnReady is called when all done. Then LoadPrefab will not stall on disk IO.
+	 * If all dependencies are already loaded (or this prefab don't use soft reference), InOnReady may be called before this function return.
+	 * @return Handle to keep dependencies loaded and to query progress.
+	 */
+	TSharedPtr<FLPrefabStreamingHandle> RequestAsyncLoad(const TFunction<void()>& InOnReady, int32 InPriority = 0);
+private:
+	void RequestAsyncLoad_Internal(const TSharedRef<FLPrefabStreamingHandle>& InHandle);
+	static void CheckAsyncLoadComplete(const TSharedRef<FLPrefabStreamingHandle>& InHandle);
+public:
+	virtual void PostLoad()override;
+	virtual void BeginDestroy()override;
+	virtual void Serialize(FArchive& Ar)override;
 public:
 	/**
 	 * LoadPrefab to create actor.
@@ -281,6 +517,22 @@ public:
 	 * @param SetRelativeTransformToIdentity Set created root actor's transform to zero after load.
 	 */
 	AActor* LoadPrefab(UWorld* InWorld, USceneComponent* InParent, bool SetRelativeTransformToIdentity = false, const TFunction<void(AActor*)>& InCallbackBeforeAwake = nullptr);
+	/**
+	 * LoadPrefab across multiple frames, to avoid hitch when load big prefab.
+	 * Awake function in LGUILifeCycleBehaviour and LPrefabInterface will be called after the whole hierarchy is loaded.
+	 * @param InParent Parent scene component that the created root actor will be attached to. Can be null so the created root actor will not attach to anyone.
+	 * @param InFrameBudgetMs Max time in milliseconds to spend on the load in one frame.
+	 * @param InOnComplete Called when load is complete, parameter "Actor" is the loaded root actor, or null if fail.
+	 */
+	void LoadPrefabAsync(UWorld* InWorld, USceneComponent* InParent, float InFrameBudgetMs, const TFunction<void(AActor*)>& InOnComplete);
+	/**
+	 * Load multiple instances of this prefab in one pass, faster than call LoadPrefab multiple times.
+	 * Awake function in LGUILifeCycleBehaviour and LPrefabInterface will be called right after each instance is done.
+	 * @param InTransforms Relative transform of every instance's root actor, instance count is InTransforms.Num().
+	 * @param InParents Parent of every instance's root actor. Can be empty (no parent), or only one (all instances use the same parent), or same count as InTransforms.
+	 * @param OutRoots Root actor of every instance, same order as InTransforms.
+	 */
+	void LoadPrefabBatch(UWorld* InWorld, TArrayView<const FTransform> InTransforms, TArrayView<USceneComponent* const> InParents, TArray<AActor*>& OutRoots);
 	/**
 	 * LoadPrefab and keep reference of source objects.
 	 */
@@ -309,21 +561,44 @@ public:
 	virtual void PostRename(UObject* OldOuter, const FName OldName)override;
 	virtual void PreDuplicate(FObjectDuplicationParameters& DupParams)override;
 	virtual void PostDuplicate(bool bDuplicateForPIE)override;
-	virtual void PostLoad()override;
-	virtual void BeginDestroy()override;
 	virtual void FinishDestroy()override;
 	virtual void PostEditUndo()override;
 	virtual bool IsEditorOnly()const override;
+	virtual void GetAssetRegistryTags(TArray<FAssetRegistryTag>& OutTags)const override;
 
 	void SavePrefab(AActor* RootActor
 		, TMap<UObject*, FGuid>& InOutMapObjectToGuid, TMap<TObjectPtr<AActor>, FLSubPrefabData>& InSubPrefabMap
 		, bool InForEditorOrRuntimeUse = true
+		, bool InDeltaAgainstArchetype = false
 	);
 	void RecreatePrefab();
 	/**
-	 * @todo: There is a more efficient way for dealing with sub prefab in runtime: break sub prefab and store all actors (with override parameters) in root prefab.
+	 * Save runtime data for cook. If bFlattenSubPrefabsWhenCook is true, sub prefabs are broken and all actors (with override parameters) are stored in root prefab, so runtime load don't need to deal with nested prefab.
+	 * InOutMapObjectToGuid is only changed when not flatten, because flattened sub prefab's objects get new guid which should not go back to editor data.
+	 * If bMergeStaticMeshesWhenCook is true and CanMergeStaticMeshesWhenCook, static mesh actors are merged into instances before save (see LPrefabMergeStaticMesh), merged actors are destroyed and removed from InOutMapObjectToGuid.
+	 */
+	void SavePrefabForRuntime(AActor* RootActor, TMap<UObject*, FGuid>& InOutMapObjectToGuid, TMap<TObjectPtr<AActor>, FLSubPrefabData>& InSubPrefabMap);
+	/**
+	 * Save runtime data for cook by transcode editor data, without agent objects. Return false if the prefab can't be transcoded (eg: has sub prefab), then SavePrefabForRuntime with agent objects is needed.
+	 */
+	bool TranscodeBuildDataForRuntime();
+	/**
+	 * If bMergeStaticMeshesWhenCook, check if every prefab that use this prefab as sub prefab flatten it when cook and not defer load it, so no one load this prefab's runtime data and look up merged actors by guid.
+	 * Only read asset registry tags of referencer prefabs, they are not loaded.
+	 * @param OutReason	Why can't merge.
+	 */
+	bool CanMergeStaticMeshesWhenCook(FString& OutReason);
+	/** If bSoftReferenceWhenCook, move build data's asset and class references to soft reference list. */
+	void ApplySoftReferenceWhenCook();
+	/** Generate runtime data for cook, by transcode editor data, or by agent objects if can't transcode. */
+	void GenerateBuildDataForCook();
+	/**
+	 * Key of build data in derived data cache. Made from editor data, nested prefab's version, serializer version, target platform, and schema and default value of referenced classes.
 	 */
-	//void SavePrefabForRuntime(AActor* RootActor, TMap<AActor*, FLSubPrefabData>& InSubPrefabMap);
+	FString GetBuildDataDDCKey(const ITargetPlatform* TargetPlatform);
+	/** Fill build data and its reference lists from derived data cache, return false if not found or any reference can't be loaded. */
+	bool LoadBuildDataFromDDC(const FString& InKey);
+	void SaveBuildDataToDDC(const FString& InKey);
 	/**
 	 * LoadPrefab in editor, will not keep reference of source prefab, So we can't apply changes after modify it.
 	 */
@@ -0,0 +1,76 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+class ULPrefab;
+class UWorld;
+
+/**
+ * Benchmarks for prefab system, result is printed to log. Not compiled in shipping build.
+ * Functions that return bool also check the result, they are asserted by automation tests in LPrefabEditor module (LPrefab.*).
+ */
+class LPREFAB_API LPrefabBenchmark
+{
+public:
+	/** Compare N times LoadPrefab with one LoadPrefabBatch, for every count in InCounts. */
+	static void LoadPrefabBatch(UWorld* InWorld, ULPrefab* InPrefab, const TArray<int32>& InCounts);
+	/** List build data memory of all loaded prefabs: resident (raw and parsed) bytes versus on-disk bytes. */
+	static void MemoryReport();
+	/** Compare N times LoadPrefab with sub prefabs loaded eagerly and deferred, and the time to realize all deferred sub prefabs. */
+	static void DeferredSubPrefab(UWorld* InWorld, ULPrefab* InPrefab, int32 InCount);
+	/** Compare game thread time of LoadPrefab that parse data inline, with LoadPrefab through FLPrefabLoadRequest that parse data in background thread. */
+	static void BackgroundParse(UWorld* InWorld, ULPrefab* InPrefab, int32 InCount);
+#if WITH_EDITOR
+	/** Shape of prefab generated by GenerateSyntheticPrefab. */
+	struct FSyntheticPrefabParams
+	{
+		/** Actors in every prefab (root prefab and each level of sub prefab), parent of actor i is actor (i - 1) / 2. */
+		int32 ActorCount = 16;
+		/** Scene components on every actor, include root component. */
+		int32 ComponentCount = 4;
+		/** Levels of nested sub prefab, 0 means no sub prefab. */
+		int32 Depth = 1;
+		/** Sub prefab instances in every prefab which is not the deepest level. */
+		int32 FanOut = 2;
+		/** 0-1, ratio of sub prefab's scene components that have overridden RelativeLocation. */
+		float OverrideDensity = 0.25f;
+
+		FString ToString()const;
+	};
+	/** Generate transient prefab (and its sub prefabs) with actors spawned in InWorld, saved with the newest serializer. */
+	static ULPrefab* GenerateSyntheticPrefab(UWorld* InWorld, const FSyntheticPrefabParams& InParams);
+	/**
+	 * Measure LoadPrefab, LoadPrefabWithExistingObjects, DuplicateActor, PrepareDataForDuplicate + DuplicateActorWithPreparedData and SavePrefab on a synthetic prefab.
+	 * Median and p95 time, and allocation count per iteration, are printed to log and appended to InCsvPath if it is not empty.
+	 * @param InLabel	Written to csv's first column, to tell before/after rows apart.
+	 */
+	static void Serializer(UWorld* InWorld, const FSyntheticPrefabParams& InParams, int32 InIterations, const FString& InCsvPath, const FString& InLabel);
+	/** Generate build data with legacy (FGuid) and compact (int32 index) layout, compare data size and parse time. */
+	static void BuildDataFormat(const TArray<ULPrefab*>& InPrefabs, int32 InParseCount);
+	/**
+	 * Cook prefabs with agent objects (LPrefab.TranscodeBuildData 0), then transcode them in game thread and in parallel, compare total time.
+	 * Agent objects of these prefabs are cleared.
+	 * @return false if any transcoded build data (in game thread or in parallel) is different from the one saved by agent objects.
+	 */
+	static bool CookTranscode(const TArray<ULPrefab*>& InPrefabs);
+	/**
+	 * Compare DuplicateActor through byte data (LPrefab.DirectDuplicate 0) and with direct copy (LPrefab.DirectDuplicate 1), on synthetic hierarchy of every actor count in InActorCounts.
+	 * @return false if the two results have different actor or component count, or different component transform.
+	 */
+	static bool DuplicateActor(UWorld* InWorld, const TArray<int32>& InActorCounts, int32 InIterations);
+	/**
+	 * Measure SavePrefab on synthetic hierarchy (no sub prefab) of every actor count in InActorCounts, report median time and time per actor.
+	 * Time per actor should stay flat as actor count grows, warning if it grows more than 2x from the smallest count.
+	 */
+	static void SavePrefabScaling(UWorld* InWorld, const TArray<int32>& InActorCounts, int32 InIterations);
+	/**
+	 * On synthetic hierarchy of every actor count in InActorCounts, change one component then compare incremental save with full save.
+	 * @return false if incremental save's data is different from full save's data.
+	 */
+	static bool IncrementalSave(UWorld* InWorld, const TArray<int32>& InActorCounts, int32 InIterations);
+#endif
+};
+#endif
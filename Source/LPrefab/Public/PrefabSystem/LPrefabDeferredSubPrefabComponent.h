@@ -0,0 +1,64 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#pragma once
+
+#include "Components/SceneComponent.h"
+#include "PrefabSystem/LPrefab.h"
+#include "LPrefabDeferredSubPrefabComponent.generated.h"
+
+namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
+{
+	class ActorSerializer;
+	struct FDeferredSubPrefabScope;
+}
+
+/**
+ * Placeholder of a sub prefab which is marked as deferred load. Created when load parent prefab in game, and owned by parent prefab's root actor.
+ * The sub prefab (with override parameters) is loaded when call Realize, then this placeholder is destroyed.
+ */
+UCLASS(ClassGroup = (LPrefab), Transient, NotBlueprintable)
+class LPREFAB_API ULPrefabDeferredSubPrefabComponent : public USceneComponent
+{
+	GENERATED_BODY()
+
+public:
+	ULPrefabDeferredSubPrefabComponent();
+
+	/**
+	 * Load the sub prefab if not yet, attach it to where this placeholder is, and call Awake on it.
+	 * @return Sub prefab's root actor, null if fail.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LPrefab")
+		AActor* Realize();
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LPrefab")
+		bool IsRealized()const { return bRealized; }
+	/** Sub prefab's root actor, valid after Realize. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LPrefab")
+		AActor* GetRealizedActor()const { return RealizedActor.Get(); }
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LPrefab")
+		ULPrefab* GetSubPrefabAsset()const { return SubPrefabAsset; }
+	/**
+	 * Realize all deferred sub prefabs of a loaded prefab.
+	 * @param InPrefabRootActor	Root actor of the loaded prefab, placeholders are owned by it.
+	 * @return Count of sub prefabs realized.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LPrefab")
+		static int32 RealizeAll(AActor* InPrefabRootActor);
+private:
+	friend class LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer;
+	UPROPERTY(VisibleAnywhere, Category = "LPrefab")
+		TObjectPtr<ULPrefab> SubPrefabAsset = nullptr;
+	/** Index of sub prefab asset in parent prefab's reference asset list. */
+	UPROPERTY(VisibleAnywhere, Category = "LPrefab")
+		int32 SubPrefabAssetIndex = INDEX_NONE;
+	/** Override parameter count that will apply to sub prefab when realize. */
+	UPROPERTY(VisibleAnywhere, Category = "LPrefab")
+		int32 OverrideParameterCount = 0;
+	UPROPERTY(Transient)
+		TWeakObjectPtr<AActor> RealizedActor = nullptr;
+	bool bRealized = false;
+	/** Index of sub prefab in parent prefab's actor data. */
+	int32 ActorIndex = INDEX_NONE;
+	/** Shared with other placeholders of the same load, released after realize. */
+	TSharedPtr<LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FDeferredSubPrefabScope> Scope;
+};
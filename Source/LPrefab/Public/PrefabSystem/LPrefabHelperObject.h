@@ -8,6 +8,10 @@
 #include "LPrefabHelperObject.generated.h"
 
 class AActor;
+namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
+{
+	struct FLPrefabIncrementalSaveCache;
+}
 
 /**
  * helper object for manage prefab's load/save
@@ -118,6 +122,10 @@ private:
 
 	void OnObjectPropertyChanged(UObject* InObject, struct FPropertyChangedEvent& InPropertyChangedEvent);
 	void OnPreObjectPropertyChanged(UObject* InObject, const class FEditPropertyChain& InEditPropertyChain);
+
+	/** Object data of last SavePrefab, so next save only write changed objects. Only for manager object, because changes are tracked by editor callbacks. Call MarkDirtyForIncrementalSave when write object without Modify. */
+	TSharedPtr<LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabIncrementalSaveCache> IncrementalSaveCache;
+	void MarkDirtyForIncrementalSave(UObject* InObject);
 	void TryCollectPropertyToOverride(UObject* InObject, FProperty* InMemberProperty);
 
 	void OnLevelActorAttached(AActor* Actor, const AActor* AttachTo);
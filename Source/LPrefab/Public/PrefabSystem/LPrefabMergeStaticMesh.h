@@ -0,0 +1,41 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_EDITOR
+class AActor;
+struct FLSubPrefabData;
+
+/** Actor and component count of a prefab before and after LPrefabMergeStaticMesh::Merge. */
+struct LPREFAB_API FLPrefabMergeStaticMeshReport
+{
+	int32 ActorCountBefore = 0;
+	int32 ActorCountAfter = 0;
+	int32 ComponentCountBefore = 0;
+	int32 ComponentCountAfter = 0;
+	/** Instanced static mesh components created, one for every group. */
+	int32 GroupCount = 0;
+	/** Actors that can be merged, but kept because other objects (or sequence bindings) reference them. */
+	int32 ReferencedActorCount = 0;
+
+	FString ToString()const;
+};
+
+/**
+ * Merge static mesh actors of a prefab into instanced static mesh components, when cook.
+ */
+class LPREFAB_API LPrefabMergeStaticMesh
+{
+public:
+	/**
+	 * Find leaf actors that only have a static (mobility) UStaticMeshComponent, group them by parent actor, mesh, materials and other component properties,
+	 * then replace every group of two or more actors with one UInstancedStaticMeshComponent (or UHierarchicalInstancedStaticMeshComponent) on the parent actor, and destroy the grouped actors.
+	 * Actors inside InSubPrefabMap's sub prefab, and actors referenced by any other object in the hierarchy (include LPrefabSequence's binding), are not merged.
+	 * This changes the actors, so only use it on agent objects which are saved for runtime.
+	 * @param InOutMapObjectToGuid	Destroyed actors and components are removed from it.
+	 */
+	static FLPrefabMergeStaticMeshReport Merge(AActor* InRootActor, const TMap<TObjectPtr<AActor>, FLSubPrefabData>& InSubPrefabMap, bool InUseHierarchicalInstances, TMap<UObject*, FGuid>& InOutMapObjectToGuid);
+};
+#endif
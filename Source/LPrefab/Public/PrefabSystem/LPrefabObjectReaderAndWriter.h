@@ -27,6 +27,8 @@ namespace LPrefabSystem
 		K2Node,
 		/** Only for duplicate, use native ObjectWriter/ObjectReader serialization method */
 		NativeSerailizeForDuplicate,
+		/** UObject reference(Not asset) by dense index instead of guid, for compact build data. */
+		ObjectIndex,
 	};
 
 	/** 
@@ -45,11 +47,34 @@ namespace LPrefabSystem
 	}
 	bool LPrefab_ShouldSkipProperty(const FProperty* InProperty);
 
+	/**
+	 * Member properties to skip by name, cached for every class. So archive find skip property by pointer in a tiny sorted array, instead of name lookup and property chain check for every property.
+	 * Keyed by class and skip name set, so the set should live as long as the process (eg: ActorSerializerBase::GetExcludeProperties).
+	 */
+	struct LPREFAB_API FLPrefabSkipPropertyCache
+	{
+		/** Member properties (include super class's) that have name in InSkipPropertyNames, sorted by pointer. */
+		static const TArray<const FProperty*>& Find(const UClass* InClass, const TSet<FName>& InSkipPropertyNames);
+		/** Properties are recreated when class is compiled or reloaded, call this then. */
+		static void Clear();
+	};
+	/** Member property (include super class's) by name, cached for every class, so override parameters can find their properties without walking the property list. Game thread only. */
+	struct LPREFAB_API FLPrefabMemberPropertyCache
+	{
+		static FProperty* Find(const UClass* InClass, FName InPropertyName);
+		/** Properties are recreated when class is compiled or reloaded, call this then. */
+		static void Clear();
+	};
+
 	class LPREFAB_API FLPrefabObjectWriter : public FObjectWriter
 	{
 	public:
-		FLPrefabObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, TSet<FName> InSkipPropertyNames);
+		FLPrefabObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames);
+		/** InSkipPropertyNames is kept by reference, so temporary set is not allowed. */
+		FLPrefabObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, TSet<FName>&& InSkipPropertyNames) = delete;
 		virtual void DoSerialize(UObject* Object);
+		/** Skip member property by cached skip property of current object's class, or by name if serialize is not started from DoSerialize. */
+		bool ShouldSkipPropertyByName(const FProperty* InProperty) const;
 
 		virtual bool ShouldSkipProperty(const FProperty* InProperty) const override;
 		virtual FArchive& operator<<(class FName& N) override;
@@ -63,13 +88,26 @@ namespace LPrefabSystem
 		virtual bool SerializeObject(UObject* Object);
 	protected:
 		ActorSerializerBase& Serializer;
-		TSet<FName> SkipPropertyNames;
+		/** Not copied, caller keep it alive during serialize (eg: ActorSerializerBase::GetExcludeProperties). */
+		const TSet<FName>& SkipPropertyNames;
+		/** From FLPrefabSkipPropertyCache, valid during DoSerialize. */
+		const TArray<const FProperty*>* SkipMemberProperties = nullptr;
 	};
 	class LPREFAB_API FLPrefabObjectReader : public FObjectReader
 	{
 	public:
-		FLPrefabObjectReader(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, TSet<FName> InSkipPropertyNames);
+		FLPrefabObjectReader(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames);
+		/** InSkipPropertyNames is kept by pointer, so temporary set is not allowed. */
+		FLPrefabObjectReader(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, TSet<FName>&& InSkipPropertyNames) = delete;
 		virtual void DoSerialize(UObject* Object);
+		/**
+		 * Reuse this reader for another object, so there is no need to create and setup an archive for every object.
+		 * InBytes is copied into the buffer passed to constructor, which keep its capacity.
+		 */
+		void ResetForObject(const TArray<uint8>& InBytes, const TSet<FName>& InSkipPropertyNames);
+		void ResetForObject(const TArray<uint8>& InBytes, TSet<FName>&& InSkipPropertyNames) = delete;
+		/** Skip member property by cached skip property of current object's class, or by name if serialize is not started from DoSerialize. */
+		bool ShouldSkipPropertyByName(const FProperty* InProperty) const;
 
 		virtual bool ShouldSkipProperty(const FProperty* InProperty) const override;
 		virtual FArchive& operator<<(class FName& N) override;
@@ -83,13 +121,18 @@ namespace LPrefabSystem
 		virtual bool SerializeObject(UObject*& Object, bool CanSerializeClass);
 	protected:
 		ActorSerializerBase& Serializer;
-		TSet<FName> SkipPropertyNames;
+		/** Buffer passed to constructor, ResetForObject copy data into it. */
+		TArray<uint8>& Buffer;
+		/** Not copied, caller keep it alive during serialize (eg: ActorSerializerBase::GetExcludeProperties). */
+		const TSet<FName>* SkipPropertyNames;
+		/** From FLPrefabSkipPropertyCache, valid during DoSerialize. */
+		const TArray<const FProperty*>* SkipMemberProperties = nullptr;
 	};
 
 	class LPREFAB_API FLPrefabDuplicateObjectWriter : public FLPrefabObjectWriter
 	{
 	public:
-		FLPrefabDuplicateObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, TSet<FName> InSkipPropertyNames);
+		FLPrefabDuplicateObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames);
 
 		virtual bool ShouldSkipProperty(const FProperty* InProperty) const override;
 		virtual FString GetArchiveName() const override;
@@ -98,7 +141,7 @@ namespace LPrefabSystem
 	class LPREFAB_API FLPrefabDuplicateObjectReader : public FLPrefabObjectReader
 	{
 	public:
-		FLPrefabDuplicateObjectReader(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, TSet<FName> InSkipPropertyNames);
+		FLPrefabDuplicateObjectReader(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames);
 
 		virtual bool ShouldSkipProperty(const FProperty* InProperty) const override;
 		virtual FString GetArchiveName() const override;
@@ -111,6 +154,11 @@ namespace LPrefabSystem
 	{
 	public:
 		FLPrefabOverrideParameterObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TArray<FName>& InOverridePropertyNames);
+		/**
+		 * Only write override properties with FProperty::SerializeBinProperty, each one with name and size, other properties and native data of UObject::Serialize are not touched.
+		 * Data layout is different from DoSerialize, should read with FLPrefabOverrideParameterObjectReader::DoSerializeTargeted.
+		 */
+		void DoSerializeTargeted(UObject* Object);
 
 		virtual bool ShouldSkipProperty(const FProperty* InProperty) const override;
 		virtual FString GetArchiveName() const override;
@@ -122,6 +170,8 @@ namespace LPrefabSystem
 	{
 	public:
 		FLPrefabOverrideParameterObjectReader(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TArray<FName>& InOverridePropertyNames);
+		/** Read data written by FLPrefabOverrideParameterObjectWriter::DoSerializeTargeted. */
+		void DoSerializeTargeted(UObject* Object);
 
 		virtual bool ShouldSkipProperty(const FProperty* InProperty) const override;
 		virtual FString GetArchiveName() const override;
@@ -0,0 +1,135 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "PrefabSystem/LPrefab.h"
+#include LPREFAB_SERIALIZER_NEWEST_INCLUDE
+#include "LPrefabPoolSubsystem.generated.h"
+
+/** Attachment of a scene component when the instance is created. */
+USTRUCT()
+struct LPREFAB_API FLPrefabPooledAttachment
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+		TObjectPtr<USceneComponent> Component = nullptr;
+	UPROPERTY()
+		TObjectPtr<USceneComponent> Parent = nullptr;
+	UPROPERTY()
+		FName SocketName;
+};
+
+/** One instance of prefab that managed by prefab pool. */
+USTRUCT()
+struct LPREFAB_API FLPrefabPooledInstance
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+		TObjectPtr<ULPrefab> Prefab = nullptr;
+	UPROPERTY()
+		TObjectPtr<AActor> RootActor = nullptr;
+	/** All actors of this instance, include sub prefab's actors */
+	UPROPERTY()
+		TArray<TObjectPtr<AActor>> Actors;
+	/** All components of Actors when the instance is created, other components are destroyed when acquire it again */
+	UPROPERTY()
+		TArray<TObjectPtr<UActorComponent>> Components;
+	/** Attachment of scene components (except root actor's root component) when the instance is created, restored when acquire it again */
+	UPROPERTY()
+		TArray<FLPrefabPooledAttachment> Attachments;
+	/** Awake is called or not, OnReuse is only called on instance that is acquired before */
+	UPROPERTY()
+		bool bAwakeDispatched = false;
+	/** Applied property data when load this instance, use it to restore the instance to prefab state */
+	TSharedPtr<LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabApplyRecord> ApplyRecord;
+
+	bool IsValidInstance()const;
+};
+
+USTRUCT()
+struct LPREFAB_API FLPrefabPool
+{
+	GENERATED_BODY()
+public:
+	UPROPERTY()
+		TArray<FLPrefabPooledInstance> FreeInstances;
+	/** Instance count that currently acquired */
+	int32 ActiveCount = 0;
+	/** Max count of instances that acquired at same time */
+	int32 HighWaterMark = 0;
+	/** Total instance count that created by this pool */
+	int32 CreatedCount = 0;
+};
+
+/**
+ * Prefab instance pool. Released instance is deactivated and hidden instead of destroyed, and when acquire it again it is restored to prefab state:
+ *		Serialized property data of every object is applied again.
+ *		Components that added after the instance is created are destroyed, and scene components are attached back to where they were.
+ *		Actors that not belongs to the instance but attached to it are detached when release.
+ * What is NOT restored: transient properties and native members that not serialized by prefab, objects created at runtime other than components,
+ * and components of the instance that are destroyed (the whole instance is destroyed instead of reused then).
+ * Only components that property is changed since the instance is created are re-registered.
+ * Awake is called every time the instance is acquired, same as a new loaded one. For later acquire ILPrefabInterface's OnReuse is called before Awake, reset other runtime state there.
+ * Only support prefab that saved with newest version.
+ */
+UCLASS()
+class LPREFAB_API ULPrefabPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+public:
+	virtual void Deinitialize()override;
+
+	static ULPrefabPoolSubsystem* GetInstance(UWorld* World);
+
+	/**
+	 * Create instances of prefab and put them into pool, so later Acquire will not need to create new one.
+	 * @param InCount	Pool will have at least this count of free instances.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LPrefab")
+		void Prewarm(ULPrefab* InPrefab, int32 InCount);
+	/**
+	 * Get an instance of prefab from pool, or load a new one if pool is empty.
+	 * @param InParent	Parent of instance's root actor, can be null.
+	 * @param InTransform	Relative transform of instance's root actor.
+	 * @return Root actor of the instance.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LPrefab")
+		AActor* Acquire(ULPrefab* InPrefab, USceneComponent* InParent, const FTransform& InTransform);
+	/**
+	 * Give back an instance to pool.
+	 * @param InRootActor	Root actor of the instance, must be the one that returned by Acquire.
+	 * @return true if the instance is put into pool.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LPrefab")
+		bool Release(AActor* InRootActor);
+
+	/** Max count of instances that acquired at same time for the prefab. */
+	UFUNCTION(BlueprintCallable, Category = "LPrefab")
+		int32 GetHighWaterMark(ULPrefab* InPrefab)const;
+	/** Count of free instances in pool for the prefab. */
+	UFUNCTION(BlueprintCallable, Category = "LPrefab")
+		int32 GetFreeCount(ULPrefab* InPrefab)const;
+	/** Print high-water mark and instance count of every pool. */
+	UFUNCTION(BlueprintCallable, Category = "LPrefab")
+		void LogPoolStats()const;
+private:
+	UPROPERTY(VisibleAnywhere, Category = "LPrefab")
+		TMap<TObjectPtr<ULPrefab>, FLPrefabPool> Pools;
+	/** Map root actor to acquired instance */
+	UPROPERTY(VisibleAnywhere, Category = "LPrefab")
+		TMap<TObjectPtr<AActor>, FLPrefabPooledInstance> ActiveInstances;
+
+	bool CanPool(ULPrefab* InPrefab)const;
+	bool CreateInstance(ULPrefab* InPrefab, USceneComponent* InParent, const FTransform& InTransform, bool InDispatchAwake, FLPrefabPooledInstance& OutInstance);
+	void DeactivateInstance(const FLPrefabPooledInstance& InInstance);
+	void ActivateInstance(FLPrefabPooledInstance& InInstance, USceneComponent* InParent, const FTransform& InTransform);
+	/** Destroy components that not belongs to the instance, and attach scene components back to where they were when the instance is created. */
+	void RestoreComponents(const FLPrefabPooledInstance& InInstance);
+	/** Call ILPrefabInterface's OnReuse on actors and their components. */
+	static void DispatchReuse(const TArray<AActor*>& InActors);
+	void DestroyInstance(const FLPrefabPooledInstance& InInstance);
+};
@@ -16,6 +16,28 @@ public:
 	 */
 	UPROPERTY(EditAnywhere, config, Category = "LPrefab")
 		bool bLogPrefabLoadTime = false;
+	/**
+	 * Parse prefab data in background thread right after the prefab asset is loaded, so the first LoadPrefab don't need to do it. Only work for packaged game.
+	 * If not enabled, prefab data is parsed in the first LoadPrefab, and cached for later use.
+	 */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab")
+		bool bParsePrefabDataOnPostLoad = false;
+	/**
+	 * When cook, store prefab's build data as bulk data, which stays on disk and only loads when the prefab is going to be parsed, so loaded prefab asset don't keep the data in memory.
+	 */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab")
+		bool bStoreBuildDataAsBulkData = true;
+	/**
+	 * When cook, compress build data with Oodle. Only work when bStoreBuildDataAsBulkData is true.
+	 */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab", meta = (EditCondition = "bStoreBuildDataAsBulkData"))
+		bool bCompressBuildData = true;
+	/**
+	 * Parsed prefab data which is not used for this time (in seconds) will be released, and parsed again when needed. Prefab marked "KeepBuildDataResident" is never released.
+	 * <= 0 means never release.
+	 */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab")
+		float BuildDataIdleReleaseTime = 60.0f;
 	/**
 	 * Prefabs in these folders will appear in "LGUI Tools" menu, so we can easily create our own UI control.
 	 */
@@ -27,4 +49,8 @@ public:
 #endif
 public:
 	static bool GetLogPrefabLoadTime();
+	static bool GetParsePrefabDataOnPostLoad();
+	static bool GetStoreBuildDataAsBulkData();
+	static bool GetCompressBuildData();
+	static float GetBuildDataIdleReleaseTime();
 };
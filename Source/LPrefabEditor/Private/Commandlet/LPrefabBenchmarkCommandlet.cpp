@@ -0,0 +1,51 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "Commandlet/LPrefabBenchmarkCommandlet.h"
+#include "LPrefabEditorModule.h"
+#include "PrefabSystem/LPrefabBenchmark.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Misc/Paths.h"
+
+ULPrefabBenchmarkCommandlet::ULPrefabBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+	HelpDescription = TEXT("Generate synthetic prefabs, measure load, duplicate and save of prefab serializer, append median/p95 time and allocation count to csv.");
+	HelpUsage = TEXT("UnrealEditor-Cmd <Project> -run=LPrefabBenchmark -nullrhi [-Actors=16] [-Components=4] [-Depth=1] [-FanOut=2] [-OverrideDensity=0.25] [-Iterations=50] [-Csv=<Path>] [-Label=<Name>]");
+}
+
+int32 ULPrefabBenchmarkCommandlet::Main(const FString& Params)
+{
+	LPrefabBenchmark::FSyntheticPrefabParams SyntheticParams;
+	FParse::Value(*Params, TEXT("Actors="), SyntheticParams.ActorCount);
+	FParse::Value(*Params, TEXT("Components="), SyntheticParams.ComponentCount);
+	FParse::Value(*Params, TEXT("Depth="), SyntheticParams.Depth);
+	FParse::Value(*Params, TEXT("FanOut="), SyntheticParams.FanOut);
+	FParse::Value(*Params, TEXT("OverrideDensity="), SyntheticParams.OverrideDensity);
+	int32 Iterations = 50;
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	FString CsvPath = FPaths::ProjectSavedDir() / TEXT("LPrefabBenchmark") / TEXT("Serializer.csv");
+	FParse::Value(*Params, TEXT("Csv="), CsvPath);
+	FString Label = FDateTime::Now().ToString();
+	FParse::Value(*Params, TEXT("Label="), Label);
+
+	//game world, so load goes the same path as in game
+	auto World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("LPrefabBenchmark"));
+	if (World == nullptr)
+	{
+		UE_LOG(LPrefabEditor, Error, TEXT("[%s].%d Can't create world!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+		return 1;
+	}
+	auto& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	World->InitializeActorsForPlay(FURL());
+
+	LPrefabBenchmark::Serializer(World, SyntheticParams, Iterations, CsvPath, Label);
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	return 0;
+}
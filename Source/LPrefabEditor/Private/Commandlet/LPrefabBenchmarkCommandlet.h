@@ -0,0 +1,20 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "LPrefabBenchmarkCommandlet.generated.h"
+
+/**
+ * Run LPrefabBenchmark::Serializer without editor UI, eg. on a build machine:
+ * UnrealEditor-Cmd <Project> -run=LPrefabBenchmark -nullrhi [-Actors=16] [-Components=4] [-Depth=1] [-FanOut=2] [-OverrideDensity=0.25] [-Iterations=50] [-Csv=<Path>] [-Label=<Name>]
+ * Result rows are appended to csv, default path is <Project>/Saved/LPrefabBenchmark/Serializer.csv.
+ */
+UCLASS()
+class ULPrefabBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+public:
+	ULPrefabBenchmarkCommandlet();
+	virtual int32 Main(const FString& Params) override;
+};
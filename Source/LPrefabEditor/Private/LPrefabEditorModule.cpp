@@ -430,6 +430,35 @@ ECheckBoxState FLPrefabEditorModule::GetAutoUpdateLevelPrefab()const
 	return ECheckBoxState::Undetermined;
 }
 
+bool FLPrefabEditorModule::CanToggleSubPrefabDeferLoad()
+{
+	auto SelectedActor = LPrefabEditorTools::GetFirstSelectedActor();
+	if (SelectedActor == nullptr)return false;
+	if (auto PrefabHelperObject = LPrefabEditorTools::GetPrefabHelperObject_WhichManageThisActor(SelectedActor))
+	{
+		//deferred load only works for sub prefab inside prefab asset, and root actor can't be deferred
+		if (PrefabHelperObject->SubPrefabMap.Contains(SelectedActor) && PrefabHelperObject->IsInsidePrefabEditor() && PrefabHelperObject->LoadedRootActor != SelectedActor)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+ECheckBoxState FLPrefabEditorModule::GetSubPrefabDeferLoad()const
+{
+	auto SelectedActor = LPrefabEditorTools::GetFirstSelectedActor();
+	if (SelectedActor == nullptr)return ECheckBoxState::Undetermined;
+	if (auto PrefabHelperObject = LPrefabEditorTools::GetPrefabHelperObject_WhichManageThisActor(SelectedActor))
+	{
+		if (auto SubPrefabDataPtr = PrefabHelperObject->SubPrefabMap.Find(SelectedActor))
+		{
+			return SubPrefabDataPtr->bDeferLoad ? ECheckBoxState::Checked : ECheckBoxState::Unchecked;
+		}
+	}
+	return ECheckBoxState::Undetermined;
+}
+
 bool FLPrefabEditorModule::CanCreateActor()
 {
 	auto SelectedActor = LPrefabEditorTools::GetFirstSelectedActor();
@@ -614,6 +643,17 @@ TSharedRef<SWidget> FLPrefabEditorModule::MakeEditorToolsMenu(bool InitialSetup,
 				NAME_None,
 				EUserInterfaceActionType::ToggleButton
 			);
+			MenuBuilder.AddMenuEntry(
+				LOCTEXT("DeferLoadSubPrefab", "Deferred Load"),
+				LOCTEXT("DeferLoadSubPrefab_Tooltip", "Do not load this sub prefab together with parent prefab in game, a placeholder component (LPrefabDeferredSubPrefabComponent) is created instead, call Realize on it to load the sub prefab"),
+				FSlateIcon(),
+				FUIAction(FExecuteAction::CreateStatic(&LPrefabEditorTools::ToggleSubPrefabDeferLoad)
+					, FCanExecuteAction::CreateRaw(this, &FLPrefabEditorModule::CanToggleSubPrefabDeferLoad)
+					, FGetActionCheckState::CreateRaw(this, &FLPrefabEditorModule::GetSubPrefabDeferLoad)
+					, FIsActionButtonVisible::CreateRaw(this, &FLPrefabEditorModule::CanToggleSubPrefabDeferLoad)),
+				NAME_None,
+				EUserInterfaceActionType::ToggleButton
+			);
 			CheckPrefabOverrideDataViewerEntry();
 			MenuBuilder.AddMenuEntry(
 				FUIAction(FExecuteAction()
@@ -19,6 +19,7 @@
 #include "LPrefabEditorModule.h"
 #include "PrefabEditor/LPrefabEditor.h"
 #include "LPrefabHeaders.h"
+#include "LPrefabModule.h"
 #include "Logging/MessageLog.h"
 
 #include "Settings/LevelEditorMiscSettings.h"
@@ -1541,6 +1542,8 @@ void LPrefabEditorTools::RefreshOnSubPrefabChange(ULPrefab* InSubPrefab)
 
 TArray<ULPrefab*> LPrefabEditorTools::GetAllPrefabArray()
 {
+	SCOPE_CYCLE_COUNTER(STAT_LPrefab_GetAllPrefabArray);
+	TRACE_CPUPROFILER_EVENT_SCOPE(LPrefab.GetAllPrefabArray);
 	FAssetRegistryModule& AssetRegistryModule = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(FName("AssetRegistry"));
 	IAssetRegistry& AssetRegistry = AssetRegistryModule.Get();
 
@@ -1659,6 +1662,21 @@ void LPrefabEditorTools::ToggleLevelPrefabAutoUpdate()
 	}
 }
 
+void LPrefabEditorTools::ToggleSubPrefabDeferLoad()
+{
+	auto SelectedActor = GetFirstSelectedActor();
+	if (SelectedActor == nullptr)return;
+	if (auto PrefabHelperObject = LPrefabEditorTools::GetPrefabHelperObject_WhichManageThisActor(SelectedActor))
+	{
+		if (auto SubPrefabDataPtr = PrefabHelperObject->SubPrefabMap.Find(SelectedActor))
+		{
+			PrefabHelperObject->Modify();
+			SubPrefabDataPtr->bDeferLoad = !SubPrefabDataPtr->bDeferLoad;
+			PrefabHelperObject->SetAnythingDirty();
+		}
+	}
+}
+
 ULPrefabHelperObject* LPrefabEditorTools::GetPrefabHelperObject_WhichManageThisActor(AActor* InActor)
 {
 	if (!IsValid(InActor))return nullptr;
@@ -136,6 +136,7 @@ void FLPrefabEditor::IterateAllPrefabEditor(const TFunction<void(FLPrefabEditor*
 
 bool FLPrefabEditor::RefreshOnSubPrefabDirty(ULPrefab* InSubPrefab)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(FLPrefabEditor::RefreshOnSubPrefabDirty);
 	return PrefabHelperObject->RefreshOnSubPrefabDirty(InSubPrefab);
 }
 
@@ -0,0 +1,338 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "CoreMinimal.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+#include "Tests/LPrefabRegistrationProbeComponent.h"
+#include "PrefabSystem/LPrefab.h"
+#include "PrefabSystem/LPrefabBenchmark.h"
+#include "PrefabSystem/LPrefabPoolSubsystem.h"
+#include "LPrefabUtils.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include LPREFAB_SERIALIZER_NEWEST_INCLUDE
+#include "UObject/StrongObjectPtr.h"
+#include "Async/Async.h"
+#include "Misc/TransactionObjectEvent.h"
+
+/** Game world for a test, destroyed when out of scope. Prefab runtime paths (eg: RegisterComponentsOnce, deferred sub prefab) only work in game world. */
+struct FLPrefabTestWorld
+{
+	UWorld* World = nullptr;
+	FLPrefabTestWorld()
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("LPrefabAutomationTest"));
+		auto& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+		World->InitializeActorsForPlay(FURL());
+	}
+	~FLPrefabTestWorld()
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+};
+
+/** Set console variable for a test, restore origin value when out of scope. */
+struct FLPrefabTestCVarScope
+{
+	IConsoleVariable* CVar = nullptr;
+	int32 OriginValue = 0;
+	FLPrefabTestCVarScope(const TCHAR* InName, int32 InValue)
+	{
+		CVar = IConsoleManager::Get().FindConsoleVariable(InName);
+		if (CVar == nullptr)return;
+		OriginValue = CVar->GetInt();
+		CVar->Set(InValue, ECVF_SetByCode);
+	}
+	~FLPrefabTestCVarScope()
+	{
+		if (CVar == nullptr)return;
+		CVar->Set(OriginValue, ECVF_SetByCode);
+	}
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLPrefabComponentRegistrationTest, "LPrefab.ComponentRegistration", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FLPrefabComponentRegistrationTest::RunTest(const FString& Parameters)
+{
+	const int32 ComponentCount = 64;
+	const int32 LoadCount = 10;
+	FLPrefabTestWorld TestWorld;
+	auto World = TestWorld.World;
+	FLPrefabTestCVarScope RegisterOnceScope(TEXT("LPrefab.RegisterComponentsOnce"), 1);
+	if (!TestNotNull(TEXT("LPrefab.RegisterComponentsOnce"), RegisterOnceScope.CVar))return false;
+
+	//synthetic prefab: binary tree of probe components, parent of component i is (i - 1) / 2
+	auto SourceActor = World->SpawnActor<AActor>();
+	TArray<USceneComponent*> SourceComponents;
+	for (int i = 0; i < ComponentCount; i++)
+	{
+		auto Probe = NewObject<ULPrefabRegistrationProbeComponent>(SourceActor);
+		SourceActor->AddInstanceComponent(Probe);
+		if (i == 0)
+		{
+			SourceActor->SetRootComponent(Probe);
+		}
+		else
+		{
+			Probe->SetupAttachment(SourceComponents[(i - 1) / 2]);
+		}
+		Probe->RegisterComponent();
+		SourceComponents.Add(Probe);
+	}
+	TStrongObjectPtr<ULPrefab> Prefab(NewObject<ULPrefab>(GetTransientPackage(), NAME_None, RF_Transient));
+	{
+		TMap<UObject*, FGuid> MapObjectToGuid;
+		TMap<TObjectPtr<AActor>, FLSubPrefabData> SubPrefabMap;
+		Prefab->SavePrefab(SourceActor, MapObjectToGuid, SubPrefabMap);
+	}
+	LPrefabUtils::DestroyActorWithHierarchy(SourceActor);
+
+	for (int i = 0; i < LoadCount; i++)
+	{
+		auto Root = Prefab->LoadPrefab(World, nullptr);
+		if (!TestNotNull(TEXT("Loaded root actor"), Root))return false;
+		TArray<ULPrefabRegistrationProbeComponent*> Probes;
+		Root->GetComponents(Probes);
+		TestEqual(TEXT("Loaded component count"), Probes.Num(), ComponentCount);
+		for (auto Probe : Probes)
+		{
+			TestTrue(TEXT("Component is registered"), Probe->IsRegistered());
+			TestEqual(TEXT("OnRegister count"), Probe->GetRegisterCount(), 1);
+			TestEqual(TEXT("CreateRenderState count"), Probe->GetCreateRenderStateCount(), 1);
+		}
+		LPrefabUtils::DestroyActorWithHierarchy(Root);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLPrefabPoolReuseTest, "LPrefab.PoolReuse", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FLPrefabPoolReuseTest::RunTest(const FString& Parameters)
+{
+	const int32 ComponentCount = 8;
+	FLPrefabTestWorld TestWorld;
+	auto World = TestWorld.World;
+	auto PoolSubsystem = ULPrefabPoolSubsystem::GetInstance(World);
+	if (!TestNotNull(TEXT("Prefab pool subsystem"), PoolSubsystem))return false;
+
+	auto SourceActor = World->SpawnActor<AActor>();
+	for (int i = 0; i < ComponentCount; i++)
+	{
+		auto Probe = NewObject<ULPrefabRegistrationProbeComponent>(SourceActor);
+		SourceActor->AddInstanceComponent(Probe);
+		if (i == 0)
+		{
+			SourceActor->SetRootComponent(Probe);
+		}
+		else
+		{
+			Probe->SetupAttachment(SourceActor->GetRootComponent());
+		}
+		Probe->RegisterComponent();
+	}
+	TStrongObjectPtr<ULPrefab> Prefab(NewObject<ULPrefab>(GetTransientPackage(), NAME_None, RF_Transient));
+	{
+		TMap<UObject*, FGuid> MapObjectToGuid;
+		TMap<TObjectPtr<AActor>, FLSubPrefabData> SubPrefabMap;
+		Prefab->SavePrefab(SourceActor, MapObjectToGuid, SubPrefabMap);
+	}
+	LPrefabUtils::DestroyActorWithHierarchy(SourceActor);
+
+	auto Root = PoolSubsystem->Acquire(Prefab.Get(), nullptr, FTransform::Identity);
+	if (!TestNotNull(TEXT("Acquired root actor"), Root))return false;
+	TArray<ULPrefabRegistrationProbeComponent*> Probes;
+	Root->GetComponents(Probes);
+	if (!TestEqual(TEXT("Component count"), Probes.Num(), ComponentCount))return false;
+	//change one component like gameplay do, only this one should be re-registered when acquire again
+	auto ChangedProbe = Probes.Last();
+	ChangedProbe->SetHiddenInGame(true);
+	TestTrue(TEXT("Release instance"), PoolSubsystem->Release(Root));
+
+	auto ReusedRoot = PoolSubsystem->Acquire(Prefab.Get(), nullptr, FTransform::Identity);
+	TestEqual(TEXT("Instance is reused"), ReusedRoot, Root);
+	for (auto Probe : Probes)
+	{
+		TestTrue(TEXT("Component is registered"), Probe->IsRegistered());
+		TestEqual(TEXT("OnRegister count"), Probe->GetRegisterCount(), Probe == ChangedProbe ? 2 : 1);
+		TestEqual(TEXT("Awake count, same as fresh load every acquire"), Probe->GetAwakeCount(), 2);
+		TestEqual(TEXT("OnReuse count"), Probe->GetReuseCount(), 1);
+	}
+	TestFalse(TEXT("Changed property is restored"), ChangedProbe->bHiddenInGame);
+	PoolSubsystem->Release(ReusedRoot);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLPrefabLoadPrefabBatchTest, "LPrefab.LoadPrefabBatch", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FLPrefabLoadPrefabBatchTest::RunTest(const FString& Parameters)
+{
+	const int32 LoadCount = 8;
+	FLPrefabTestWorld TestWorld;
+	auto World = TestWorld.World;
+	LPrefabBenchmark::FSyntheticPrefabParams Params;
+	TStrongObjectPtr<ULPrefab> Prefab(LPrefabBenchmark::GenerateSyntheticPrefab(World, Params));
+	if (!TestTrue(TEXT("Generate synthetic prefab"), Prefab.IsValid()))return false;
+
+	auto SingleRoot = Prefab->LoadPrefab(World, nullptr);
+	if (!TestNotNull(TEXT("LoadPrefab root actor"), SingleRoot))return false;
+	TArray<AActor*> SingleActors;
+	LPrefabUtils::CollectChildrenActors(SingleRoot, SingleActors, true);
+	LPrefabUtils::DestroyActorWithHierarchy(SingleRoot);
+
+	TArray<FTransform> Transforms;
+	for (int i = 0; i < LoadCount; i++)
+	{
+		Transforms.Add(FTransform(FVector(i * 100.0f, 0, 0)));
+	}
+	TArray<AActor*> Roots;
+	Prefab->LoadPrefabBatch(World, Transforms, {}, Roots);
+	TestEqual(TEXT("LoadPrefabBatch root count"), Roots.Num(), LoadCount);
+	for (int i = 0; i < Roots.Num(); i++)
+	{
+		if (!TestNotNull(TEXT("LoadPrefabBatch root actor"), Roots[i]))continue;
+		TArray<AActor*> Actors;
+		LPrefabUtils::CollectChildrenActors(Roots[i], Actors, true);
+		TestEqual(TEXT("LoadPrefabBatch actor count"), Actors.Num(), SingleActors.Num());
+		TestTrue(TEXT("LoadPrefabBatch root location"), Roots[i]->GetActorLocation().Equals(Transforms[i].GetLocation()));
+		LPrefabUtils::DestroyActorWithHierarchy(Roots[i]);
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLPrefabCookTranscodeTest, "LPrefab.CookTranscode", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FLPrefabCookTranscodeTest::RunTest(const FString& Parameters)
+{
+	FLPrefabTestWorld TestWorld;
+	//sub prefab is not transcoded, so generate flat prefab
+	LPrefabBenchmark::FSyntheticPrefabParams Params;
+	Params.Depth = 0;
+	TStrongObjectPtr<ULPrefab> Prefab(LPrefabBenchmark::GenerateSyntheticPrefab(TestWorld.World, Params));
+	if (!TestTrue(TEXT("Generate synthetic prefab"), Prefab.IsValid()))return false;
+	LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabTranscodedBuildData Data;
+	FString FailReason;
+	bool bTranscoded = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::TranscodeBuildData(Prefab.Get(), true, Data, FailReason);
+	if (!TestTrue(FString::Printf(TEXT("Transcode build data, fail reason: %s"), *FailReason), bTranscoded))return false;
+	//stand-ins are created by game thread transcode above, so worker thread get same result
+	LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabTranscodedBuildData WorkerData;
+	FString WorkerFailReason;
+	bool bWorkerTranscoded = Async(EAsyncExecution::ThreadPool, [&] {
+		return LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::TranscodeBuildData(Prefab.Get(), true, WorkerData, WorkerFailReason);
+		}).Get();
+	if (!TestTrue(FString::Printf(TEXT("Transcode build data in worker thread, fail reason: %s"), *WorkerFailReason), bWorkerTranscoded))return false;
+	TestTrue(TEXT("Build data transcoded in worker thread is the same as in game thread"), WorkerData.BinaryDataForBuild == Data.BinaryDataForBuild);
+	TestTrue(TEXT("Transcoded build data is the same as agent objects"), LPrefabBenchmark::CookTranscode({ Prefab.Get() }));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLPrefabDeltaBuildDataTest, "LPrefab.DeltaBuildData", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FLPrefabDeltaBuildDataTest::RunTest(const FString& Parameters)
+{
+	FLPrefabTestWorld TestWorld;
+	LPrefabBenchmark::FSyntheticPrefabParams Params;
+	Params.Depth = 0;
+	TStrongObjectPtr<ULPrefab> Prefab(LPrefabBenchmark::GenerateSyntheticPrefab(TestWorld.World, Params));
+	if (!TestTrue(TEXT("Generate synthetic prefab"), Prefab.IsValid()))return false;
+	TMap<FGuid, TObjectPtr<UObject>> MapGuidToObject;
+	TMap<TObjectPtr<AActor>, FLSubPrefabData> SubPrefabMap;
+	auto SourceActor = Prefab->LoadPrefabWithExistingObjects(TestWorld.World, nullptr, MapGuidToObject, SubPrefabMap);
+	if (!TestNotNull(TEXT("Loaded root actor"), SourceActor))return false;
+
+	int32 Size[2] = { 0, 0 };
+	for (int Delta = 0; Delta < 2; Delta++)
+	{
+		TMap<UObject*, FGuid> MapObjectToGuid;
+		for (auto& KeyValue : MapGuidToObject)
+		{
+			MapObjectToGuid.Add(KeyValue.Value, KeyValue.Key);
+		}
+		Prefab->SavePrefab(SourceActor, MapObjectToGuid, SubPrefabMap, false, Delta == 1);
+		Size[Delta] = Prefab->BinaryDataForBuild.Num();
+	}
+	LPrefabUtils::DestroyActorWithHierarchy(SourceActor);
+	AddInfo(FString::Printf(TEXT("Build data size, full: %d bytes, delta: %d bytes"), Size[0], Size[1]));
+	TestTrue(TEXT("Delta build data is not empty"), Size[1] > 0);
+	TestTrue(TEXT("Delta build data is smaller than full build data"), Size[1] < Size[0]);
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLPrefabDuplicateActorTest, "LPrefab.DuplicateActor", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FLPrefabDuplicateActorTest::RunTest(const FString& Parameters)
+{
+	FLPrefabTestWorld TestWorld;
+	TestTrue(TEXT("Direct duplicate is the same as duplicate through byte data"), LPrefabBenchmark::DuplicateActor(TestWorld.World, { 10, 100 }, 1));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLPrefabIncrementalSaveTest, "LPrefab.IncrementalSave", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FLPrefabIncrementalSaveTest::RunTest(const FString& Parameters)
+{
+	FLPrefabTestWorld TestWorld;
+	TestTrue(TEXT("Incremental save data is the same as full save"), LPrefabBenchmark::IncrementalSave(TestWorld.World, { 10, 100 }, 5));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLPrefabIncrementalSaveCheckTest, "LPrefab.IncrementalSaveCheck", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+bool FLPrefabIncrementalSaveCheckTest::RunTest(const FString& Parameters)
+{
+	FLPrefabTestWorld TestWorld;
+	LPrefabBenchmark::FSyntheticPrefabParams Params;
+	Params.ActorCount = 10;
+	Params.Depth = 0;
+	TStrongObjectPtr<ULPrefab> Prefab(LPrefabBenchmark::GenerateSyntheticPrefab(TestWorld.World, Params));
+	if (!TestTrue(TEXT("Generate synthetic prefab"), Prefab.IsValid()))return false;
+	TMap<FGuid, TObjectPtr<UObject>> MapGuidToObject;
+	TMap<TObjectPtr<AActor>, FLSubPrefabData> SubPrefabMap;
+	auto SourceActor = Prefab->LoadPrefabWithExistingObjects(TestWorld.World, nullptr, MapGuidToObject, SubPrefabMap);
+	if (!TestNotNull(TEXT("Loaded root actor"), SourceActor))return false;
+	TMap<UObject*, FGuid> MapObjectToGuid;
+	for (auto& KeyValue : MapGuidToObject)
+	{
+		MapObjectToGuid.Add(KeyValue.Value, KeyValue.Key);
+	}
+	TStrongObjectPtr<ULPrefab> IncrementalPrefab(NewObject<ULPrefab>(GetTransientPackage(), NAME_None, RF_Transient));
+	TStrongObjectPtr<ULPrefab> FullPrefab(NewObject<ULPrefab>(GetTransientPackage(), NAME_None, RF_Transient));
+	auto IsSameAsFullSave = [&] {
+		auto FullMapObjectToGuid = MapObjectToGuid;
+		LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::SavePrefab(SourceActor, FullPrefab.Get(), FullMapObjectToGuid, SubPrefabMap, true);
+		return IncrementalPrefab->BinaryData == FullPrefab->BinaryData
+			&& IncrementalPrefab->ReferenceAssetList == FullPrefab->ReferenceAssetList
+			&& IncrementalPrefab->ReferenceClassList == FullPrefab->ReferenceClassList
+			&& IncrementalPrefab->ReferenceNameList == FullPrefab->ReferenceNameList;
+	};
+	LPREFAB_SERIALIZER_NEWEST_NAMESPACE::FLPrefabIncrementalSaveCache Cache;
+	auto SaveIncremental = [&](int32 InCheck) {
+		FLPrefabTestCVarScope CheckScope(TEXT("LPrefab.IncrementalSaveCheck"), InCheck);
+		LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::SavePrefabIncremental(SourceActor, IncrementalPrefab.Get(), MapObjectToGuid, SubPrefabMap, Cache);
+		return IsSameAsFullSave();
+	};
+	auto Comp = SourceActor->GetRootComponent();
+	auto MoveComp = [Comp] {
+		Comp->SetRelativeLocation(Comp->GetRelativeLocation() + FVector(1, 0, 0));
+	};
+	SaveIncremental(0);//fill cache
+
+	//changes with editor notification are tracked by cache itself, no full save check is needed
+	Comp->Modify();
+	MoveComp();
+	TestTrue(TEXT("Change after Modify is saved"), SaveIncremental(0));
+
+	MoveComp();
+	FPropertyChangedEvent PropertyChangedEvent(FindFProperty<FProperty>(USceneComponent::StaticClass(), USceneComponent::GetRelativeLocationPropertyName()));
+	Comp->PostEditChangeProperty(PropertyChangedEvent);
+	TestTrue(TEXT("Change with PostEditChangeProperty is saved"), SaveIncremental(0));
+
+	MoveComp();
+	Comp->PostTransacted(FTransactionObjectEvent());//as undo/redo
+	TestTrue(TEXT("Change by transaction is saved"), SaveIncremental(0));
+
+	//change without notification, like property set by code without Modify, only the check can find it
+	MoveComp();
+	TestFalse(TEXT("Incremental save without check misses the change"), SaveIncremental(0));
+	MoveComp();
+	TestTrue(TEXT("Incremental save with check falls back to full save"), SaveIncremental(1));
+	LPrefabUtils::DestroyActorWithHierarchy(SourceActor);
+	return true;
+}
+#endif
@@ -0,0 +1,32 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "Tests/LPrefabRegistrationProbeComponent.h"
+
+ULPrefabRegistrationProbeComponent::ULPrefabRegistrationProbeComponent()
+{
+	PrimaryComponentTick.bCanEverTick = false;
+	SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	SetGenerateOverlapEvents(false);
+}
+
+void ULPrefabRegistrationProbeComponent::OnRegister()
+{
+	Super::OnRegister();
+	RegisterCount++;
+}
+
+void ULPrefabRegistrationProbeComponent::Awake_Implementation()
+{
+	AwakeCount++;
+}
+
+void ULPrefabRegistrationProbeComponent::OnReuse_Implementation()
+{
+	ReuseCount++;
+}
+
+void ULPrefabRegistrationProbeComponent::CreateRenderState_Concurrent(FRegisterComponentContext* Context)
+{
+	Super::CreateRenderState_Concurrent(Context);
+	FPlatformAtomics::InterlockedIncrement(&CreateRenderStateCount);
+}
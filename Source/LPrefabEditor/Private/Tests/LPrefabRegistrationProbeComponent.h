@@ -0,0 +1,38 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#pragma once
+
+#include "Components/PrimitiveComponent.h"
+#include "PrefabSystem/ILPrefabInterface.h"
+#include "LPrefabRegistrationProbeComponent.generated.h"
+
+/**
+ * Count how many times this component is registered and its render state is created, and how many times prefab's Awake and OnReuse is called.
+ * Used by automation test LPrefab.ComponentRegistration and LPrefab.PoolReuse to check component registration when load prefab or acquire from pool.
+ * Counters start from construction and are not serialized, so every loaded component starts from zero.
+ */
+UCLASS(NotBlueprintable, HideDropdown)
+class ULPrefabRegistrationProbeComponent : public UPrimitiveComponent, public ILPrefabInterface
+{
+	GENERATED_BODY()
+
+public:
+	ULPrefabRegistrationProbeComponent();
+
+	int32 GetRegisterCount()const { return RegisterCount; }
+	int32 GetCreateRenderStateCount()const { return CreateRenderStateCount; }
+	int32 GetAwakeCount()const { return AwakeCount; }
+	int32 GetReuseCount()const { return ReuseCount; }
+protected:
+	virtual void OnRegister()override;
+	virtual void Awake_Implementation()override;
+	virtual void OnReuse_Implementation()override;
+	virtual bool ShouldCreateRenderState()const override { return true; }
+	virtual void CreateRenderState_Concurrent(FRegisterComponentContext* Context)override;
+private:
+	int32 RegisterCount = 0;
+	int32 AwakeCount = 0;
+	int32 ReuseCount = 0;
+	/** Render state may be created in worker thread. */
+	volatile int32 CreateRenderStateCount = 0;
+};
@@ -81,6 +81,8 @@ private:
 	bool CanBrowsePrefab();
 	bool CanUpdateLevelPrefab();
 	ECheckBoxState GetAutoUpdateLevelPrefab()const;
+	bool CanToggleSubPrefabDeferLoad();
+	ECheckBoxState GetSubPrefabDeferLoad()const;
 	bool CanCreatePrefab();
 	bool CanCheckPrefabOverrideParameter()const;
 	bool CanReplaceActor();
@@ -52,6 +52,7 @@ public:
 	static void OpenPrefabAsset();
 	static void UpdateLevelPrefab();
 	static void ToggleLevelPrefabAutoUpdate();
+	static void ToggleSubPrefabDeferLoad();
 	static void CleanupPrefabsInWorld(UWorld* World);
 	static ULPrefabHelperObject* GetPrefabHelperObject_WhichManageThisActor(AActor* InActor);
 	static bool IsActorCompatibleWithLGUIToolsMenu(AActor* InActor);